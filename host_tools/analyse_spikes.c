@@ -0,0 +1,506 @@
+/*
+	Spike train statistics of a recording store, for the checks after a
+	run (spike_analysis.h).
+
+		analyse_spikes FILE [--channel LABEL] [--ticks FIRST:END]
+					   [--neurons FIRST:END] [--isi-bins N] [--isi-bin-ms MS]
+					   [--psth-bin-ms MS] [--correlation-bin-ms MS]
+					   [--correlated N] [--threads N] [--output PREFIX]
+
+	reads the window of a spikes channel (the first, by default) and
+	prints the population's mean rate and CV and the peaks of its ISI
+	histogram and PSTH.  With --output it writes PREFIX.rates (neuron,
+	Hz, CV), PREFIX.isi (bin start in ms, then the population's count and
+	each neuron's), PREFIX.psth (bin start in ms, spikes, Hz per neuron)
+	and PREFIX.correlation (the matrix of the first --correlated neurons,
+	64 by default), for a validation script to compare with its
+	expectations instead of working them out from getSpikes().  ISI bins
+	are 1 ms, 100 of them, and PSTH and correlation bins 10 ms, unless
+	given.
+
+		analyse_spikes --bench [--spikes N] [--neurons N] [--threads N]
+						[--output FILE]
+
+	writes a store of N Poisson spikes (10^7 by default) of neurons at 5
+	to 75 Hz, the first 32 sharing input, and times reading and analysing
+	it on 1 to --threads threads against doing the same one value at a
+	time on one thread, checking that the two agree.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "recording_store.h"
+#include "recording_reader.h"
+#include "spike_analysis.h"
+#include "thread_pool.h"
+
+
+#define TIME_STEP_US		1000
+#define SHARED_NEURONS		32
+
+typedef struct {
+	uint32_t*	ticks;
+	uint64_t*	starts;
+} loaded_trains_t;
+
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static double ms_since( uint64_t start )
+{
+	return ( now_ns() - start ) / 1e6;
+}
+
+
+static bool parse_range( const char* text, uint32_t* first, uint32_t* end )
+{
+	const char* colon = strchr( text, ':' );
+
+	if( colon == NULL )
+		return false;
+	if( colon != text )
+		*first = strtoul( text, NULL, 0 );
+	if( colon[1] != '\0' )
+		*end = strtoul( colon + 1, NULL, 0 );
+	return true;
+}
+
+
+static uint32_t ms_to_ticks( double ms, uint32_t time_step_us )
+{
+	double ticks = floor( ms * 1000.0 / time_step_us + 0.5 );
+
+	return ticks >= 1 ? (uint32_t) ticks : 1;
+}
+
+
+//! \brief Reads a window of a spikes channel as spike trains.  A window
+//! open at the end is closed after the last tick recorded.
+static bool load_trains( const recording_reader_t* reader, uint32_t channel, recording_window_t window,
+						 uint32_t n_threads, spike_trains_t* trains, loaded_trains_t* loaded )
+{
+	const recording_channel_t* c = &reader->channels[channel];
+	uint32_t n_blocks = reader->n_channel_blocks[channel];
+
+	if( window.end_neuron > c->n_neurons )
+		window.end_neuron = c->n_neurons;
+	if( window.first_neuron > window.end_neuron )
+		window.first_neuron = window.end_neuron;
+	if( window.end_tick == UINT32_MAX )
+		window.end_tick = n_blocks > 0 ? reader->blocks[reader->channel_blocks[channel][n_blocks - 1]].last_tick + 1 : 0;
+
+	uint64_t n = recording_reader_count( reader, channel, &window );
+
+	*trains = ( spike_trains_t ) { window.first_neuron, window.end_neuron - window.first_neuron, window.first_tick,
+								   window.end_tick, c->time_step_us / 1000.0 };
+	loaded->ticks = malloc( ( n + 1 ) * sizeof( uint32_t ) );
+	loaded->starts = malloc( ( trains->n_neurons + 1 ) * sizeof( uint64_t ) );
+	if( loaded->ticks == NULL || loaded->starts == NULL )
+		return false;
+	recording_reader_spike_trains( reader, channel, &window, n_threads, loaded->ticks, loaded->starts );
+	trains->ticks = loaded->ticks;
+	trains->starts = loaded->starts;
+	return true;
+}
+
+
+static bool write_outputs( const char* prefix, const spike_trains_t* trains, const spike_analysis_config_t* config,
+						   const spike_analysis_t* a )
+{
+	char path[1024];
+	FILE* f = NULL;
+	bool ok = true;
+
+	snprintf( path, sizeof( path ), "%s.rates", prefix );
+	ok = ok && ( f = fopen( path, "w" ) ) != NULL;
+	for( uint32_t i = 0; ok && i < a->n_neurons; i++ )
+		fprintf( f, "%u %.6f %.6f\n", trains->first_neuron + i, a->rates[i], a->cvs[i] );
+	ok = ok && fclose( f ) == 0;
+
+	snprintf( path, sizeof( path ), "%s.isi", prefix );
+	ok = ok && ( f = fopen( path, "w" ) ) != NULL;
+	for( uint32_t b = 0; ok && b < a->n_isi_bins; b++ ) {
+		fprintf( f, "%g %llu", b * config->isi_bin_ticks * trains->ms_per_tick,
+				 (unsigned long long) a->population_isi[b] );
+		for( uint32_t i = 0; i < a->n_neurons; i++ )
+			fprintf( f, " %u", a->isi_histograms[(size_t) i * a->n_isi_bins + b] );
+		fprintf( f, "\n" );
+		}
+	ok = ok && fclose( f ) == 0;
+
+	snprintf( path, sizeof( path ), "%s.psth", prefix );
+	ok = ok && ( f = fopen( path, "w" ) ) != NULL;
+	for( uint32_t b = 0; ok && b < a->n_psth_bins; b++ )
+		fprintf( f, "%g %u %.6f\n", ( trains->first_tick + b * config->psth_bin_ticks ) * trains->ms_per_tick,
+				 a->psth[b], a->psth[b] / ( config->psth_bin_ticks * trains->ms_per_tick / 1000.0 )
+							 / ( a->n_neurons > 0 ? a->n_neurons : 1 ) );
+	ok = ok && fclose( f ) == 0;
+
+	snprintf( path, sizeof( path ), "%s.correlation", prefix );
+	ok = ok && ( f = fopen( path, "w" ) ) != NULL;
+	for( uint32_t i = 0; ok && i < a->n_correlated; i++ )
+		for( uint32_t j = 0; j < a->n_correlated; j++ )
+			fprintf( f, "%.6f%c", a->correlations[(size_t) i * a->n_correlated + j],
+					 j + 1 < a->n_correlated ? ' ' : '\n' );
+	ok = ok && fclose( f ) == 0;
+	return ok;
+}
+
+
+static void print_summary( const spike_trains_t* trains, const spike_analysis_config_t* config,
+						   const spike_analysis_t* a )
+{
+	double rate = 0, cv = 0;
+	uint32_t n_cvs = 0, isi_peak = 0, psth_peak = 0;
+
+	for( uint32_t i = 0; i < a->n_neurons; i++ ) {
+		rate += a->rates[i];
+		if( !isnan( a->cvs[i] ) ) {
+			cv += a->cvs[i];
+			n_cvs++;
+			}
+		}
+	for( uint32_t b = 0; b < a->n_isi_bins; b++ )
+		if( a->population_isi[b] > a->population_isi[isi_peak] )
+			isi_peak = b;
+	for( uint32_t b = 0; b < a->n_psth_bins; b++ )
+		if( a->psth[b] > a->psth[psth_peak] )
+			psth_peak = b;
+
+	printf( "%u neurons, %llu spikes over %g ms\n", a->n_neurons,
+			(unsigned long long) trains->starts[trains->n_neurons],
+			( trains->end_tick - trains->first_tick ) * trains->ms_per_tick );
+	printf( "mean rate %.3f Hz, mean CV %.3f (%u neurons with two ISIs)\n", a->n_neurons ? rate / a->n_neurons : 0,
+			n_cvs ? cv / n_cvs : NAN, n_cvs );
+	if( a->n_isi_bins > 0 )
+		printf( "ISI peak at %g ms\n", isi_peak * config->isi_bin_ticks * trains->ms_per_tick );
+	if( a->n_psth_bins > 0 )
+		printf( "PSTH peak %u spikes at %g ms\n", a->psth[psth_peak],
+				( trains->first_tick + psth_peak * config->psth_bin_ticks ) * trains->ms_per_tick );
+}
+
+
+static int analyse( const char* path, const char* label, recording_window_t window, spike_analysis_config_t config,
+					double isi_bin_ms, double psth_bin_ms, double correlation_bin_ms, const char* output )
+{
+	recording_reader_t reader;
+	spike_trains_t trains;
+	loaded_trains_t loaded = { NULL, NULL };
+	spike_analysis_t analysis;
+	int channel;
+
+	if( !recording_reader_open( &reader, path ) ) {
+		fprintf( stderr, "analyse_spikes: %s is not a recording store\n", path );
+		return 1;
+		}
+	channel = label != NULL ? recording_reader_find_channel( &reader, label ) : 0;
+	if( channel < 0 || (uint32_t) channel >= reader.n_channels || reader.channels[channel].kind != RECORDING_SPIKES ) {
+		fprintf( stderr, "analyse_spikes: no spikes channel %s in %s\n", label != NULL ? label : "", path );
+		recording_reader_close( &reader );
+		return 1;
+		}
+
+	uint32_t time_step_us = reader.channels[channel].time_step_us;
+
+	config.isi_bin_ticks = ms_to_ticks( isi_bin_ms, time_step_us );
+	config.psth_bin_ticks = ms_to_ticks( psth_bin_ms, time_step_us );
+	config.correlation_bin_ticks = ms_to_ticks( correlation_bin_ms, time_step_us );
+
+	bool ok = load_trains( &reader, channel, window, config.n_threads, &trains, &loaded )
+			  && spike_analysis_run( &trains, &config, &analysis );
+
+	if( ok ) {
+		print_summary( &trains, &config, &analysis );
+		if( output != NULL && !write_outputs( output, &trains, &config, &analysis ) ) {
+			fprintf( stderr, "analyse_spikes: cannot write %s.*\n", output );
+			ok = false;
+			}
+		spike_analysis_free( &analysis );
+		}
+	else
+		fprintf( stderr, "analyse_spikes: out of memory, or a bin of 0\n" );
+
+	free( loaded.ticks );
+	free( loaded.starts );
+	recording_reader_close( &reader );
+	return ok ? 0 : 1;
+}
+
+
+//! \brief Poisson neurons at 5 to 75 Hz; the first SHARED_NEURONS also
+//! fire together, each with probability a half, at 5 Hz.
+static bool write_bench_store( const char* path, uint64_t n_spikes, uint32_t n_neurons )
+{
+	recording_channel_t channel = { RECORDING_SPIKES, n_neurons, TIME_STEP_US, "spikes" };
+	recording_store_t store;
+	uint16_t* neurons = malloc( n_neurons * sizeof( uint16_t ) );
+	uint32_t* thresholds = malloc( n_neurons * sizeof( uint32_t ) );
+	uint32_t shared_threshold = (uint32_t) ( 5 * TIME_STEP_US / 1e6 * 4294967296.0 );
+	uint64_t written = 0;
+	bool ok = neurons != NULL && thresholds != NULL && recording_store_create( &store, path, &channel, 1, 0 );
+
+	for( uint32_t i = 0; ok && i < n_neurons; i++ )
+		thresholds[i] = (uint32_t) ( ( 5 + 70.0 * i / n_neurons ) * TIME_STEP_US / 1e6 * 4294967296.0 );
+	for( uint32_t t = 0; ok && written < n_spikes; t++ ) {
+		bool shared = next_random() < shared_threshold;
+		uint32_t n = 0;
+
+		for( uint32_t i = 0; i < n_neurons && written + n < n_spikes; i++ )
+			if( next_random() < thresholds[i] || ( shared && i < SHARED_NEURONS && ( next_random() & 1 ) ) )
+				neurons[n++] = i;
+		ok = recording_store_add_spikes( &store, 0, t, neurons, n );
+		written += n;
+		}
+	if( neurons != NULL && thresholds != NULL && !recording_store_close( &store ) )
+		ok = false;
+	free( neurons );
+	free( thresholds );
+	return ok;
+}
+
+
+//! \brief The same statistics, one value at a time on one thread, as the
+//! bench's baseline and check.
+static void reference_analysis( const spike_trains_t* trains, const spike_analysis_config_t* config,
+								const spike_analysis_t* a, double* rates, double* cvs, uint32_t* isi, uint32_t* psth,
+								double* correlations )
+{
+	uint32_t n_ticks = trains->end_tick - trains->first_tick;
+	uint32_t n_bins = ( n_ticks + config->correlation_bin_ticks - 1 ) / config->correlation_bin_ticks;
+	double seconds = n_ticks * trains->ms_per_tick / 1000.0;
+	double* counts = calloc( (size_t) a->n_correlated * n_bins + 1, sizeof( double ) );
+
+	memset( isi, 0, (size_t) trains->n_neurons * a->n_isi_bins * sizeof( uint32_t ) );
+	memset( psth, 0, a->n_psth_bins * sizeof( uint32_t ) );
+	for( uint32_t i = 0; i < trains->n_neurons; i++ ) {
+		const uint32_t* ticks = trains->ticks + trains->starts[i];
+		uint64_t n = trains->starts[i + 1] - trains->starts[i];
+		double mean = 0, variance = 0;
+
+		rates[i] = n / seconds;
+		for( uint64_t s = 0; s < n; s++ ) {
+			psth[( ticks[s] - trains->first_tick ) / config->psth_bin_ticks]++;
+			if( i < a->n_correlated )
+				counts[(size_t) i * n_bins + ( ticks[s] - trains->first_tick ) / config->correlation_bin_ticks]++;
+			}
+		for( uint64_t s = 1; s < n; s++ ) {
+			uint32_t bin = ( ticks[s] - ticks[s - 1] ) / config->isi_bin_ticks;
+
+			isi[(size_t) i * a->n_isi_bins + ( bin < a->n_isi_bins ? bin : a->n_isi_bins - 1 )]++;
+			mean += ticks[s] - ticks[s - 1];
+			}
+		mean /= n - 1;
+		for( uint64_t s = 1; s < n; s++ )
+			variance += ( ticks[s] - ticks[s - 1] - mean ) * ( ticks[s] - ticks[s - 1] - mean );
+		cvs[i] = n > 2 ? sqrt( variance / ( n - 1 ) ) / mean : NAN;
+		}
+
+	for( uint32_t i = 0; i < a->n_correlated; i++ )
+		for( uint32_t j = 0; j < a->n_correlated; j++ ) {
+			const double* x = counts + (size_t) i * n_bins;
+			const double* y = counts + (size_t) j * n_bins;
+			double mx = 0, my = 0, sxy = 0, sxx = 0, syy = 0;
+
+			for( uint32_t b = 0; b < n_bins; b++ ) {
+				mx += x[b];
+				my += y[b];
+				}
+			mx /= n_bins;
+			my /= n_bins;
+			for( uint32_t b = 0; b < n_bins; b++ ) {
+				sxy += ( x[b] - mx ) * ( y[b] - my );
+				sxx += ( x[b] - mx ) * ( x[b] - mx );
+				syy += ( y[b] - my ) * ( y[b] - my );
+				}
+			correlations[(size_t) i * a->n_correlated + j] = sxx > 0 && syy > 0 ? sxy / sqrt( sxx * syy ) : NAN;
+			}
+	free( counts );
+}
+
+
+static bool close_to( double a, double b )
+{
+	return ( isnan( a ) && isnan( b ) ) || fabs( a - b ) <= 1e-9 * ( 1 + fabs( b ) );
+}
+
+
+static int bench( const char* path, uint64_t n_spikes, uint32_t n_neurons, uint32_t max_threads )
+{
+	spike_analysis_config_t config = { 100, 1, 10, 10, 64, 1 };
+	recording_reader_t reader;
+	spike_trains_t trains;
+	loaded_trains_t loaded = { NULL, NULL };
+	spike_analysis_t analysis;
+	uint32_t n_failures = 0;
+	uint64_t start = now_ns();
+
+	if( n_neurons == 0 || n_neurons > 0x10000 || !write_bench_store( path, n_spikes, n_neurons ) ) {
+		fprintf( stderr, "analyse_spikes: cannot write %s\n", path );
+		return 1;
+		}
+	printf( "%llu spikes of %u neurons written in %.0f ms\n", (unsigned long long) n_spikes, n_neurons,
+			ms_since( start ) );
+
+	start = now_ns();
+	if( !recording_reader_open( &reader, path )
+		|| !load_trains( &reader, 0, recording_reader_whole( &reader, 0 ), max_threads, &trains, &loaded ) ) {
+		fprintf( stderr, "analyse_spikes: cannot read %s back\n", path );
+		return 1;
+		}
+	printf( "read as spike trains over %u ticks in %.1f ms\n\n", trains.end_tick - trains.first_tick,
+			ms_since( start ) );
+
+	// the baseline and what every run is checked against
+	uint32_t n_psth_bins = ( trains.end_tick - trains.first_tick + config.psth_bin_ticks - 1 ) / config.psth_bin_ticks;
+	double* rates = malloc( n_neurons * sizeof( double ) );
+	double* cvs = malloc( n_neurons * sizeof( double ) );
+	uint32_t* isi = malloc( (size_t) n_neurons * config.n_isi_bins * sizeof( uint32_t ) );
+	uint32_t* psth = malloc( ( n_psth_bins + 1 ) * sizeof( uint32_t ) );
+	double* correlations = malloc( (size_t) config.n_correlated * config.n_correlated * sizeof( double ) + 1 );
+
+	if( rates == NULL || cvs == NULL || isi == NULL || psth == NULL || correlations == NULL
+		|| !spike_analysis_run( &trains, &config, &analysis ) ) {
+		fprintf( stderr, "analyse_spikes: out of memory\n" );
+		return 1;
+		}
+	start = now_ns();
+	reference_analysis( &trains, &config, &analysis, rates, cvs, isi, psth, correlations );
+
+	double reference_ms = ms_since( start );
+
+	spike_analysis_free( &analysis );
+	printf( "%-8s %10s %9s %6s\n", "threads", "ms", "speedup", "check" );
+	printf( "%-8s %10.1f %9s\n", "one by one", reference_ms, "" );
+	for( uint32_t threads = 1; threads <= max_threads; threads *= 2 ) {
+		config.n_threads = threads;
+		start = now_ns();
+
+		bool ok = spike_analysis_run( &trains, &config, &analysis );
+		double ms = ms_since( start );
+
+		ok = ok && analysis.n_psth_bins == n_psth_bins
+			 && !memcmp( analysis.isi_histograms, isi, (size_t) n_neurons * config.n_isi_bins * sizeof( uint32_t ) )
+			 && !memcmp( analysis.psth, psth, n_psth_bins * sizeof( uint32_t ) );
+		for( uint32_t i = 0; ok && i < n_neurons; i++ )
+			ok = close_to( analysis.rates[i], rates[i] ) && close_to( analysis.cvs[i], cvs[i] );
+		for( uint32_t i = 0; ok && i < analysis.n_correlated * analysis.n_correlated; i++ )
+			ok = close_to( analysis.correlations[i], correlations[i] );
+		if( ok && threads == 1 && analysis.n_correlated > SHARED_NEURONS + 1 ) {
+			double shared = 0, independent = 0;
+
+			// neurons that share input correlate; the rest should not
+			for( uint32_t i = 1; i < SHARED_NEURONS; i++ )
+				shared += analysis.correlations[i];
+			for( uint32_t i = SHARED_NEURONS + 1; i < config.n_correlated; i++ )
+				independent += analysis.correlations[(size_t) SHARED_NEURONS * analysis.n_correlated + i];
+			print_summary( &trains, &config, &analysis );
+			printf( "correlation: %.3f between shared-input neurons, %.3f otherwise\n\n",
+					shared / ( SHARED_NEURONS - 1 ), independent / ( analysis.n_correlated - SHARED_NEURONS - 1 ) );
+			printf( "%-8s %10s %9s %6s\n", "threads", "ms", "speedup", "check" );
+			}
+		printf( "%-8u %10.1f %8.1fx %6s\n", threads, ms, reference_ms / ms, ok ? "ok" : "FAILED" );
+		n_failures += !ok;
+		if( analysis.rates != NULL )
+			spike_analysis_free( &analysis );
+		}
+
+	free( rates );
+	free( cvs );
+	free( isi );
+	free( psth );
+	free( correlations );
+	free( loaded.ticks );
+	free( loaded.starts );
+	recording_reader_close( &reader );
+	remove( path );
+	return n_failures ? 1 : 0;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	const char* path = NULL;
+	const char* label = NULL;
+	const char* output = NULL;
+	recording_window_t window = { 0, UINT32_MAX, 0, UINT32_MAX };
+	spike_analysis_config_t config = { 100, 0, 0, 0, 64, 0 };
+	double isi_bin_ms = 1, psth_bin_ms = 10, correlation_bin_ms = 10;
+	uint64_t n_spikes = 10000000;
+	uint32_t n_neurons = 1024;
+	bool run_bench = false, bad = false;
+
+	for( int i = 1; i < argc && !bad; i++ ) {
+		if( !strcmp( argv[i], "--bench" ) )
+			run_bench = true;
+		else if( !strcmp( argv[i], "--channel" ) && i + 1 < argc )
+			label = argv[++i];
+		else if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			bad = !parse_range( argv[++i], &window.first_tick, &window.end_tick );
+		else if( !strcmp( argv[i], "--neurons" ) && i + 1 < argc ) {
+			// a range when analysing, a count when benchmarking
+			if( strchr( argv[i + 1], ':' ) )
+				bad = !parse_range( argv[++i], &window.first_neuron, &window.end_neuron );
+			else
+				n_neurons = strtoul( argv[++i], NULL, 0 );
+			}
+		else if( !strcmp( argv[i], "--isi-bins" ) && i + 1 < argc )
+			config.n_isi_bins = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--isi-bin-ms" ) && i + 1 < argc )
+			isi_bin_ms = atof( argv[++i] );
+		else if( !strcmp( argv[i], "--psth-bin-ms" ) && i + 1 < argc )
+			psth_bin_ms = atof( argv[++i] );
+		else if( !strcmp( argv[i], "--correlation-bin-ms" ) && i + 1 < argc )
+			correlation_bin_ms = atof( argv[++i] );
+		else if( !strcmp( argv[i], "--correlated" ) && i + 1 < argc )
+			config.n_correlated = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--threads" ) && i + 1 < argc )
+			config.n_threads = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--spikes" ) && i + 1 < argc )
+			n_spikes = strtoull( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--output" ) && i + 1 < argc )
+			output = argv[++i];
+		else if( argv[i][0] != '-' && path == NULL )
+			path = argv[i];
+		else
+			bad = true;
+		}
+
+	if( bad || ( !run_bench && path == NULL ) ) {
+		fprintf( stderr, "usage: analyse_spikes FILE [--channel LABEL] [--ticks FIRST:END] [--neurons FIRST:END]\n"
+						 "                      [--isi-bins N] [--isi-bin-ms MS] [--psth-bin-ms MS]\n"
+						 "                      [--correlation-bin-ms MS] [--correlated N] [--threads N]\n"
+						 "                      [--output PREFIX]\n"
+						 "       analyse_spikes --bench [--spikes N] [--neurons N] [--threads N] [--output FILE]\n" );
+		return 1;
+		}
+
+	if( run_bench )
+		return bench( output != NULL ? output : "analyse_spikes_bench.rec", n_spikes, n_neurons,
+					  config.n_threads > 0 ? config.n_threads : online_cpus() );
+	return analyse( path, label, window, config, isi_bin_ms, psth_bin_ms, correlation_bin_ms, output );
+}
@@ -0,0 +1,460 @@
+"""
+Compact columnar format for the mapping reports, written on a background
+thread, and renderers for the existing text layouts.
+
+Rows are appended from the mapping code with the add_* methods of
+BinaryReportWriter, which only append to a list; every BLOCK_ROWS rows of
+a table are handed to a writer thread that packs them column by column,
+compresses each column and appends the block to the file.  Mapping never
+waits on report I/O, and a board's worth of routing entries costs a few
+bytes per entry rather than a line of text.
+
+File layout (little endian):
+
+    MAGIC
+    blocks: table id (u32), n_rows (u32), then per column
+            compressed length (u32) and zlib data; an integer column is
+            n_rows u32, a string column is n_rows + 1 u32 offsets
+            followed by the UTF-8 text
+
+The text reports (placement_by_core.rpt, placement_by_vertex.rpt,
+routing_tables_generated/routing_table_X_Y.rpt,
+chip_sdram_usage_by_core.rpt, network_specification.rpt and
+memory_map_from_processor_to_address_space) are produced on demand by
+render_reports.py, which can also import an existing text report
+directory.
+"""
+import os
+import re
+import struct
+import threading
+import zlib
+
+from collections import OrderedDict
+
+try:
+    import queue
+except ImportError:
+    import Queue as queue
+
+MAGIC = b"SPNRPT01"
+BLOCK_ROWS = 4096
+
+_INT = "I"
+_STR = "S"
+
+# table name -> (id, columns); ids are part of the file format
+TABLES = OrderedDict([
+    ("header", (0, [("machine_name", _STR), ("generated", _STR)])),
+    ("chips", (1, [("x", _INT), ("y", _INT),
+                   ("n_application_cores", _INT), ("sdram_mb", _INT)])),
+    ("vertices", (2, [("kind", _STR), ("label", _STR), ("size", _INT),
+                      ("model", _STR), ("constraints", _STR)])),
+    ("edges", (3, [("kind", _STR), ("label", _STR), ("pre", _STR),
+                   ("pre_size", _INT), ("post", _STR), ("post_size", _INT),
+                   ("model", _STR)])),
+    ("placements", (4, [("kind", _STR), ("label", _STR), ("model", _STR),
+                        ("pop_size", _INT), ("lo_atom", _INT),
+                        ("hi_atom", _INT), ("x", _INT), ("y", _INT),
+                        ("p", _INT)])),
+    ("routing", (5, [("x", _INT), ("y", _INT), ("key", _INT),
+                     ("mask", _INT), ("route", _INT), ("source_x", _INT),
+                     ("source_y", _INT), ("source_p", _INT)])),
+    ("sdram", (6, [("x", _INT), ("y", _INT), ("p", _INT),
+                   ("sdram_bytes", _INT)])),
+    ("memory_map", (7, [("x", _INT), ("y", _INT), ("p", _INT),
+                        ("start_address", _INT), ("memory_used", _INT),
+                        ("memory_written", _INT)])),
+])
+
+_TABLE_NAMES = dict((table_id, name)
+                    for name, (table_id, _) in TABLES.items())
+
+
+def _pack_column(values, column_type):
+    if column_type == _INT:
+        data = struct.pack("<{}I".format(len(values)), *values)
+    else:
+        encoded = [value.encode("utf-8") for value in values]
+        offsets = [0]
+        for text in encoded:
+            offsets.append(offsets[-1] + len(text))
+        data = struct.pack("<{}I".format(len(offsets)), *offsets) + \
+            b"".join(encoded)
+    return zlib.compress(data)
+
+
+def _unpack_column(data, column_type, n_rows):
+    data = zlib.decompress(data)
+    if column_type == _INT:
+        return list(struct.unpack_from("<{}I".format(n_rows), data))
+    offsets = struct.unpack_from("<{}I".format(n_rows + 1), data)
+    text = data[(n_rows + 1) * 4:]
+    return [text[offsets[i]:offsets[i + 1]].decode("utf-8")
+            for i in range(n_rows)]
+
+
+class BinaryReportWriter(object):
+
+    def __init__(self, path, machine_name, generated):
+        """
+        :param machine_name: the target machine, as in the report headers
+        :param generated: the "Generated: ..." time text of the reports
+        """
+        self._rows = dict((name, list()) for name in TABLES)
+        self._queue = queue.Queue()
+        self._file = open(path, "wb")
+        self._file.write(MAGIC)
+        self._error = None
+        self._thread = threading.Thread(target=self._write_blocks,
+                                        name="binary report writer")
+        self._thread.daemon = True
+        self._thread.start()
+        self._add("header", (machine_name, generated))
+
+    def _write_blocks(self):
+        while True:
+            block = self._queue.get()
+            if block is None:
+                return
+            name, rows = block
+            try:
+                table_id, columns = TABLES[name]
+                parts = [struct.pack("<II", table_id, len(rows))]
+                for i, (_, column_type) in enumerate(columns):
+                    data = _pack_column([row[i] for row in rows],
+                                        column_type)
+                    parts.append(struct.pack("<I", len(data)))
+                    parts.append(data)
+                self._file.write(b"".join(parts))
+            except Exception as e:
+                self._error = e
+
+    def _add(self, name, row):
+        rows = self._rows[name]
+        rows.append(row)
+        if len(rows) >= BLOCK_ROWS:
+            self._queue.put((name, rows))
+            self._rows[name] = list()
+
+    def add_chip(self, x, y, n_application_cores, sdram_mb=128):
+        self._add("chips", (x, y, n_application_cores, sdram_mb))
+
+    def add_vertex(self, kind, label, size, model, constraints):
+        """
+        :param kind: the vertex class name, e.g. AbstractConstrainedVertex
+        :param constraints: the constraint descriptions
+        """
+        self._add("vertices", (kind, label, size, model,
+                               "\n".join(constraints)))
+
+    def add_edge(self, kind, label, pre, pre_size, post, post_size,
+                 model="No Model"):
+        self._add("edges", (kind, label, pre, pre_size, post, post_size,
+                            model))
+
+    def add_placement(self, kind, label, model, pop_size, lo_atom, hi_atom,
+                      x, y, p):
+        self._add("placements", (kind, label, model, pop_size, lo_atom,
+                                 hi_atom, x, y, p))
+
+    def add_routing_entry(self, x, y, key, mask, route, source_x, source_y,
+                          source_p):
+        self._add("routing", (x, y, key, mask, route, source_x, source_y,
+                              source_p))
+
+    def add_sdram_usage(self, x, y, p, sdram_bytes):
+        self._add("sdram", (x, y, p, sdram_bytes))
+
+    def add_memory_map_entry(self, x, y, p, start_address, memory_used,
+                             memory_written):
+        self._add("memory_map", (x, y, p, start_address, memory_used,
+                                 memory_written))
+
+    def flush(self):
+        """ Hands every buffered row to the writer thread
+        """
+        for name in TABLES:
+            if self._rows[name]:
+                self._queue.put((name, self._rows[name]))
+                self._rows[name] = list()
+
+    def close(self):
+        self.flush()
+        self._queue.put(None)
+        self._thread.join()
+        self._file.close()
+        if self._error is not None:
+            raise self._error
+
+
+def read_reports(path):
+    """
+    :return: table name -> list of row tuples, in the order written
+    """
+    tables = dict((name, list()) for name in TABLES)
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(MAGIC):
+        raise ValueError("{} is not a binary report file".format(path))
+    offset = len(MAGIC)
+    while offset < len(data):
+        table_id, n_rows = struct.unpack_from("<II", data, offset)
+        offset += 8
+        name = _TABLE_NAMES[table_id]
+        columns = list()
+        for _, column_type in TABLES[name][1]:
+            length, = struct.unpack_from("<I", data, offset)
+            offset += 4
+            columns.append(_unpack_column(data[offset:offset + length],
+                                          column_type, n_rows))
+            offset += length
+        tables[name].extend(zip(*columns))
+    return tables
+
+
+# ---------------------------------------------------------------------------
+# text layouts
+
+def _header(title, underline, tables):
+    machine_name, generated = tables["header"][0]
+    return "        {}\n{}\n\nGenerated: {} for target machine '{}'" \
+           "\n\n".format(title, underline, generated, machine_name)
+
+
+def _chips(tables):
+    return sorted(set((row[6], row[7]) for row in tables["placements"]) |
+                  set((row[0], row[1]) for row in tables["chips"]))
+
+
+def render_placement_by_core(tables):
+    text = [_header("Placement Information by Core",
+                    "        =============================", tables)]
+    n_cores = dict(((x, y), n) for x, y, n, _ in tables["chips"])
+    for x, y in _chips(tables):
+        text.append("**** Chip: ({}, {})\n".format(x, y))
+        text.append("Application cores: {}\n".format(n_cores.get((x, y), 0)))
+        placements = sorted((row for row in tables["placements"]
+                             if row[6] == x and row[7] == y),
+                            key=lambda row: row[8])
+        for kind, label, model, pop_size, lo, hi, _, _, p in placements:
+            text.append("  Processor {}: {}: '{}', pop sz: {}\n".format(
+                p, kind, label, pop_size))
+            text.append("               Slice on this core: {}:{} "
+                        "({} atoms)\n".format(lo, hi, hi - lo + 1))
+            text.append("               Model: {}\n\n\n".format(model))
+    return "".join(text)
+
+
+def render_placement_by_vertex(tables):
+    text = [_header("Placement Information by AbstractConstrainedVertex",
+                    "        ===============================", tables)]
+    # in graph order, as the network specification lists them
+    vertices = OrderedDict((row[1], list()) for row in tables["vertices"])
+    for row in tables["placements"]:
+        vertices.setdefault(row[1], list()).append(row)
+    for label, placements in vertices.items():
+        if not placements:
+            continue
+        kind, _, model, pop_size = placements[0][:4]
+        text.append("**** {}: '{}'\n".format(kind, label))
+        text.append("Model: {}\nPop sz: {}\nSub-vertices: \n".format(
+            model, pop_size))
+        for _, _, _, _, lo, hi, x, y, p in placements:
+            text.append("  Slice {}:{} ({} atoms) on core ({}, {}, {}) "
+                        "\n".format(lo, hi, hi - lo + 1, x, y, p))
+        text.append("\n")
+    return "".join(text)
+
+
+def _key_hex(key):
+    # the PACMAN layout pads keys of four or more digits to five
+    text = "{:x}".format(key)
+    return text.zfill(5) if len(text) >= 4 else text
+
+
+def render_routing_table(tables, x, y):
+    entries = [row for row in tables["routing"] if row[0] == x and row[1] == y]
+    text = ["router contains {} entries \n \n".format(len(entries)),
+            "  Index   Key(hex)    Mask(hex)    Route(hex)    "
+            "Src. Core -> [Cores][Links]\n", "-" * 78 + "\n"]
+    for index, (_, _, key, mask, route, sx, sy, sp) in enumerate(entries):
+        cores = [c for c in range(18) if route & (1 << (6 + c))]
+        links = [l for l in range(6) if route & (1 << l)]
+        text.append("{:>5}     {}       {:08x}      {:04x}         "
+                    "({}, {}, {})      {} {}\n".format(
+                        index, _key_hex(key), mask, route, sx, sy, sp,
+                        cores, links))
+    return "".join(text)
+
+
+def render_sdram_usage(tables):
+    text = [_header("Memory Usage by Core",
+                    "        ====================", tables)]
+    sdram_mb = dict(((x, y), mb) for x, y, _, mb in tables["chips"])
+    for x, y in sorted(set((row[0], row[1]) for row in tables["sdram"])):
+        total_kb = 0
+        for _, _, p, sdram_bytes in (
+                row for row in tables["sdram"] if row[:2] == (x, y)):
+            text.append("SDRAM requirements for core ({},{},{}) is {} "
+                        "KB\n".format(x, y, p, sdram_bytes // 1024))
+            total_kb += sdram_bytes // 1024
+        text.append("**** Chip: ({}, {}) has total memory usage of {} KB out "
+                    "of a max of {} MB \n\n".format(
+                        x, y, total_kb, sdram_mb.get((x, y), 128)))
+    return "".join(text)
+
+
+def render_network_specification(tables):
+    text = [_header("Network Specification", " =====================", tables),
+            "*** Vertices:\n"]
+    for kind, label, size, model, constraints in tables["vertices"]:
+        text.append("{} {}, size: {}\nModel: {}\n".format(
+            kind, label, size, model))
+        for constraint in constraints.split("\n") if constraints else []:
+            text.append("constraint: {}\n".format(constraint))
+        text.append("\n")
+    text.append("*** Edges:\n")
+    for kind, label, pre, pre_size, post, post_size, model in \
+            tables["edges"]:
+        text.append("{} {} from vertex: '{}' ({} atoms) to vertex: '{}' ({} "
+                    "atoms)\n  Model: {}\n\n".format(
+                        kind, label, pre, pre_size, post, post_size, model))
+    return "".join(text)
+
+
+def render_memory_map(tables):
+    return "".join(
+        "({0}, {1}, {2}): ({0}, {1}, {2}): ('start_address': {3}, "
+        "hex({4}), 'memory_used': {5}, 'memory_written': {6} \n".format(
+            x, y, p, start, hex(start), used, written)
+        for x, y, p, start, used, written in tables["memory_map"])
+
+
+def render_all(tables, directory):
+    """
+    Writes every report that has rows into directory, in the layout of the
+    text reports
+    :return: the paths written
+    """
+    reports = list()
+    if tables["placements"]:
+        reports.append(("placement_by_core.rpt",
+                        render_placement_by_core(tables)))
+        reports.append(("placement_by_vertex.rpt",
+                        render_placement_by_vertex(tables)))
+    if tables["sdram"]:
+        reports.append(("chip_sdram_usage_by_core.rpt",
+                        render_sdram_usage(tables)))
+    if tables["vertices"] or tables["edges"]:
+        reports.append(("network_specification.rpt",
+                        render_network_specification(tables)))
+    if tables["memory_map"]:
+        reports.append(("memory_map_from_processor_to_address_space",
+                        render_memory_map(tables)))
+    for x, y in sorted(set((row[0], row[1]) for row in tables["routing"])):
+        reports.append((os.path.join("routing_tables_generated",
+                                     "routing_table_{}_{}.rpt".format(x, y)),
+                        render_routing_table(tables, x, y)))
+
+    paths = list()
+    for name, text in reports:
+        path = os.path.join(directory, name)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        with open(path, "w") as f:
+            f.write(text)
+        paths.append(path)
+    return paths
+
+
+# ---------------------------------------------------------------------------
+# import of existing text reports
+
+_GENERATED = re.compile(r"^Generated: (.*) for target machine '(.*)'$", re.M)
+_CHIP = re.compile(r"^\*\*\*\* Chip: \((\d+), (\d+)\)\nApplication cores: "
+                   r"(\d+)$", re.M)
+_PROCESSOR = re.compile(
+    r"^  Processor (\d+): (\w+): '(.*)', pop sz: (\d+)\n"
+    r" +Slice on this core: (\d+):(\d+) \(\d+ atoms\)\n +Model: (.*)$", re.M)
+_ROUTE = re.compile(r"^ +\d+ +([0-9a-f]+) +([0-9a-f]+) +([0-9a-f]+) +"
+                    r"\((\d+), (\d+), (\d+)\)", re.M)
+_SDRAM = re.compile(r"^SDRAM requirements for core \((\d+),(\d+),(\d+)\) is "
+                    r"(\d+) KB$", re.M)
+_SDRAM_CHIP = re.compile(r"^\*\*\*\* Chip: \((\d+), (\d+)\) has total memory "
+                         r"usage of \d+ KB out of a max of (\d+) MB", re.M)
+_VERTEX = re.compile(r"^(\w+) (.*), size: (\d+)\nModel: (.*)\n"
+                     r"((?:constraint: .*\n)*)", re.M)
+_EDGE = re.compile(r"^(\w+) (.*) from vertex: '(.*)' \((\d+) atoms\) to "
+                   r"vertex: '(.*)' \((\d+) atoms\)\n  Model: (.*)$", re.M)
+_MEMORY = re.compile(r"^\((\d+), (\d+), (\d+)\): .*'start_address': (\d+), "
+                     r".*'memory_used': (\d+), 'memory_written': (\d+)", re.M)
+
+
+def _read(directory, name):
+    path = os.path.join(directory, name)
+    if not os.path.exists(path):
+        return ""
+    with open(path) as f:
+        return f.read()
+
+
+def import_text_reports(directory, path):
+    """ Converts a text report directory into a binary report file
+    """
+    texts = dict((name, _read(directory, name)) for name in (
+        "placement_by_core.rpt", "network_specification.rpt",
+        "chip_sdram_usage_by_core.rpt",
+        "memory_map_from_processor_to_address_space"))
+    generated = None
+    for text in texts.values():
+        generated = generated or _GENERATED.search(text)
+    generated, machine_name = generated.groups() if generated else ("", "")
+
+    writer = BinaryReportWriter(path, machine_name, generated)
+
+    text = texts["placement_by_core.rpt"]
+    sdram_mb = dict(((int(x), int(y)), int(mb)) for x, y, mb in
+                    _SDRAM_CHIP.findall(texts["chip_sdram_usage_by_core.rpt"]))
+    for chip in _CHIP.finditer(text):
+        x, y, n_cores = (int(v) for v in chip.groups())
+        writer.add_chip(x, y, n_cores, sdram_mb.get((x, y), 128))
+        end = text.find("**** Chip:", chip.end())
+        for p, kind, label, pop_size, lo, hi, model in _PROCESSOR.findall(
+                text[chip.end():end if end >= 0 else len(text)]):
+            writer.add_placement(kind, label, model, int(pop_size), int(lo),
+                                 int(hi), x, y, int(p))
+
+    text = texts["network_specification.rpt"]
+    edges_start = text.find("*** Edges:")
+    for kind, label, size, model, constraints in _VERTEX.findall(
+            text[:edges_start if edges_start >= 0 else len(text)]):
+        writer.add_vertex(kind, label, int(size), model,
+                          [line[len("constraint: "):] for line in
+                           constraints.split("\n") if line])
+    for kind, label, pre, pre_size, post, post_size, model in \
+            _EDGE.findall(text):
+        writer.add_edge(kind, label, pre, int(pre_size), post,
+                        int(post_size), model)
+
+    for x, y, p, kb in _SDRAM.findall(texts["chip_sdram_usage_by_core.rpt"]):
+        writer.add_sdram_usage(int(x), int(y), int(p), int(kb) * 1024)
+
+    for row in _MEMORY.findall(
+            texts["memory_map_from_processor_to_address_space"]):
+        writer.add_memory_map_entry(*(int(v) for v in row))
+
+    routing_dir = os.path.join(directory, "routing_tables_generated")
+    if os.path.isdir(routing_dir):
+        for name in sorted(os.listdir(routing_dir)):
+            match = re.match(r"routing_table_(\d+)_(\d+)\.rpt$", name)
+            if match is None:
+                continue
+            x, y = int(match.group(1)), int(match.group(2))
+            for key, mask, route, sx, sy, sp in _ROUTE.findall(
+                    _read(routing_dir, name)):
+                writer.add_routing_entry(x, y, int(key, 16), int(mask, 16),
+                                         int(route, 16), int(sx), int(sy),
+                                         int(sp))
+
+    writer.close()
@@ -0,0 +1,385 @@
+/*
+	Local board stand-in for live I/O; see board_emulator.h.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "board_emulator.h"
+
+
+#define INPUT_BATCH			64
+#define NEURON_MASK			( ~SUBVERTEX_MASK )
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static uint32_t next_random( board_emulator_t* board )
+{
+	// xorshift32
+	board->random ^= board->random << 13;
+	board->random ^= board->random >> 17;
+	board->random ^= board->random << 5;
+	return board->random;
+}
+
+
+static inline bool dropped( board_emulator_t* board )
+{
+	if( board->config.drop_rate <= 0.0 || next_random( board ) >= board->config.drop_rate * 4294967296.0 )
+		return false;
+	board->n_dropped++;
+	return true;
+}
+
+
+void board_config_defaults( board_config_t* config )
+{
+	memset( config, 0, sizeof( board_config_t ) );
+	config->time_step_us = 1000;
+	config->hop_latency_ns = 100;
+	config->max_hops = 16;
+	config->live_output_core = BOARD_NO_CORE;
+	config->live_output_host = "127.0.0.1";
+	config->live_output_ports[0] = 18250;			// as receiver.py
+	config->n_live_output_ports = 1;
+	config->input_port = REVERSE_IP_TAG_PORT;
+	config->seed = 1;
+}
+
+
+static bool push_event( board_emulator_t* board, const board_event_t* event )
+{
+	if( board->n_events == board->max_events ) {
+		uint32_t max_events = board->max_events ? 2 * board->max_events : 4096;
+		board_event_t* events = realloc( board->events, max_events * sizeof( board_event_t ) );
+
+		if( events == NULL )
+			return false;
+		board->events = events;
+		board->max_events = max_events;
+		}
+
+	uint32_t i = board->n_events++;
+
+	while( i > 0 && board->events[( i - 1 ) / 2].time_ns > event->time_ns ) {
+		board->events[i] = board->events[( i - 1 ) / 2];
+		i = ( i - 1 ) / 2;
+		}
+	board->events[i] = *event;
+
+	return true;
+}
+
+
+static board_event_t pop_event( board_emulator_t* board )
+{
+	board_event_t top = board->events[0], last = board->events[--board->n_events];
+	uint32_t i = 0;
+
+	for( ;; ) {
+		uint32_t child = 2 * i + 1;
+
+		if( child >= board->n_events )
+			break;
+		if( child + 1 < board->n_events && board->events[child + 1].time_ns < board->events[child].time_ns )
+			child++;
+		if( board->events[child].time_ns >= last.time_ns )
+			break;
+		board->events[i] = board->events[child];
+		i = child;
+		}
+	board->events[i] = last;
+
+	return top;
+}
+
+
+static void send_from( board_emulator_t* board, uint64_t time_ns, uint32_t chip, int in_link,
+					   uint32_t key, uint32_t hops )
+{
+	board_event_t event = { time_ns + board->config.hop_latency_ns, key, chip, in_link, hops };
+
+	if( !push_event( board, &event ) ) {
+		fprintf( stderr, "board emulator: out of memory for packets in flight\n" );
+		board_emulator_stop( board );
+		}
+}
+
+
+static void deliver( board_emulator_t* board, uint32_t chip, uint32_t p, uint32_t key, uint32_t hops )
+{
+	uint32_t index = chip * BOARD_CORES + p;
+	board_core_t* core = &board->cores[index];
+	uint32_t n = key & NEURON_MASK;
+
+	if( core->fired[n / 32] & ( 1u << ( n % 32 ) ) ) {
+		if( hops < core->hops[n] )
+			core->hops[n] = hops;
+		return;
+		}
+
+	if( core->n_neurons == 0 )
+		board->active[board->n_active++] = index;
+	core->fired[n / 32] |= 1u << ( n % 32 );
+	core->neurons[core->n_neurons++] = n;
+	core->hops[n] = hops;
+}
+
+
+static void route( board_emulator_t* board, const board_event_t* event )
+{
+	uint32_t chip = event->chip, route;
+
+	board->n_routed++;
+	if( !board->has_table[chip] || !routing_engine_route( &board->engines[chip], event->key, &route ) ) {
+		if( event->in_link < 0 ) {
+			board->n_unrouted++;
+			return;
+			}
+		route = ROUTE_LINK( OPPOSITE_LINK( event->in_link ) );
+		}
+
+	for( uint32_t l = 0; l < N_LINKS; l++ ) {
+		uint32_t nx, ny;
+
+		if( !( route & ROUTE_LINK( l ) ) || dropped( board ) )
+			continue;
+		if( !link_neighbour( chip % board->width, chip / board->width, l, board->width, board->height, &nx, &ny ) ) {
+			board->n_unrouted++;
+			continue;
+			}
+		send_from( board, event->time_ns, ny * board->width + nx, OPPOSITE_LINK( l ), event->key, event->hops );
+		}
+
+	for( uint32_t p = 0; p < BOARD_CORES; p++ ) {
+		if( !( route & ROUTE_CORE( p ) ) || dropped( board ) )
+			continue;
+		if( chip == 0 && p == board->config.live_output_core ) {
+			for( uint32_t o = 0; o < board->config.n_live_output_ports; o++ )
+				spike_injector_send( &board->outputs[o], &event->key, 1 );
+			board->n_live_output++;
+			}
+		else
+			deliver( board, chip, p, event->key, event->hops );
+		}
+}
+
+
+static void tick( board_emulator_t* board, uint64_t time_ns )
+{
+	for( uint32_t a = 0; a < board->n_active; a++ ) {
+		uint32_t index = board->active[a], chip = index / BOARD_CORES, p = index % BOARD_CORES;
+		uint32_t base = SUBVERTEX_KEY( chip % board->width, chip / board->width, p );
+		board_core_t* core = &board->cores[index];
+
+		for( uint32_t i = 0; i < core->n_neurons; i++ ) {
+			uint32_t n = core->neurons[i];
+
+			core->fired[n / 32] = 0;
+			if( core->hops[n] < board->config.max_hops )
+				send_from( board, time_ns, chip, -1, base | n, core->hops[n] + 1 );
+			else
+				board->n_hop_limited++;
+			}
+
+		board->n_fired += core->n_neurons;
+		core->n_neurons = 0;
+		}
+	board->n_active = 0;
+
+	for( uint32_t o = 0; o < board->config.n_live_output_ports; o++ )
+		spike_injector_flush( &board->outputs[o] );
+	board->n_ticks++;
+}
+
+
+static void receive( board_emulator_t* board, uint64_t time_ns )
+{
+	static uint8_t buffers[INPUT_BATCH][EIEIO_MAX_MESSAGE_BYTES];
+	static eieio_event_t events[EIEIO_MAX_COUNT];
+	struct mmsghdr headers[INPUT_BATCH];
+	struct iovec iov[INPUT_BATCH];
+
+	memset( headers, 0, sizeof( headers ) );
+	for( uint32_t m = 0; m < INPUT_BATCH; m++ ) {
+		iov[m].iov_base = buffers[m];
+		iov[m].iov_len = EIEIO_MAX_MESSAGE_BYTES;
+		headers[m].msg_hdr.msg_iov = &iov[m];
+		headers[m].msg_hdr.msg_iovlen = 1;
+		}
+
+	for( ;; ) {
+		int n = recvmmsg( board->fd, headers, INPUT_BATCH, MSG_DONTWAIT, NULL );
+
+		if( n <= 0 )
+			return;
+
+		for( int m = 0; m < n; m++ ) {
+			int n_events = eieio_decode( buffers[m], headers[m].msg_len, events, EIEIO_MAX_COUNT );
+
+			if( n_events < 0 ) {
+				board->n_malformed++;
+				continue;
+				}
+			// into chip (0, 0)'s router from the reverse IP tag core
+			for( int e = 0; e < n_events; e++ )
+				send_from( board, time_ns, 0, -1, events[e].key, 0 );
+			board->n_injected += n_events;
+			}
+		board->n_datagrams += n;
+		}
+}
+
+
+bool board_emulator_open( board_emulator_t* board, const board_config_t* config,
+						  const routing_table_t* tables, uint32_t n_tables )
+{
+	memset( board, 0, sizeof( board_emulator_t ) );
+	board->config = *config;
+	board->fd = -1;
+	board->random = config->seed ? config->seed : 1;
+
+	if( config->live_output_core >= BOARD_CORES )
+		return false;
+
+	board->width = board->height = 1;
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		if( tables[t].x >= board->width )
+			board->width = tables[t].x + 1;
+		if( tables[t].y >= board->height )
+			board->height = tables[t].y + 1;
+		}
+	board->n_chips = board->width * board->height;
+
+	board->engines = calloc( board->n_chips, sizeof( routing_engine_t ) );
+	board->has_table = calloc( board->n_chips, sizeof( bool ) );
+	board->cores = calloc( board->n_chips * BOARD_CORES, sizeof( board_core_t ) );
+	board->active = malloc( board->n_chips * BOARD_CORES * sizeof( uint32_t ) );
+	if( !board->engines || !board->has_table || !board->cores || !board->active ) {
+		board_emulator_close( board );
+		return false;
+		}
+
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		uint32_t chip = tables[t].y * board->width + tables[t].x;
+
+		if( !routing_engine_compile( &tables[t], &board->engines[chip] ) ) {
+			board_emulator_close( board );
+			return false;
+			}
+		board->has_table[chip] = true;
+		}
+
+	struct sockaddr_in address;
+	socklen_t length = sizeof( address );
+
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( config->input_port );
+	board->fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	if( board->fd < 0 || bind( board->fd, (struct sockaddr*) &address, sizeof( address ) ) < 0
+		|| getsockname( board->fd, (struct sockaddr*) &address, &length ) < 0 ) {
+		board_emulator_close( board );
+		return false;
+		}
+	board->input_port = ntohs( address.sin_port );
+
+	eieio_format_t format = { EIEIO_KEY_32_BIT, EIEIO_NO_PREFIX, 0, 0 };
+
+	if( board->config.n_live_output_ports > BOARD_MAX_LIVE_OUTPUTS )
+		board->config.n_live_output_ports = BOARD_MAX_LIVE_OUTPUTS;
+	for( uint32_t o = 0; o < board->config.n_live_output_ports; o++ ) {
+		if( !spike_injector_open( &board->outputs[o], config->live_output_host, config->live_output_ports[o],
+								  &format, 0, 16, 0.0 ) ) {
+			board->config.n_live_output_ports = o;
+			board_emulator_close( board );
+			return false;
+			}
+		}
+
+	return true;
+}
+
+
+void board_emulator_run( board_emulator_t* board, uint64_t duration_ns )
+{
+	uint64_t step = board->config.time_step_us * 1000ULL, now = now_ns();
+	uint64_t end = duration_ns ? now + duration_ns : UINT64_MAX;
+	struct pollfd input = { board->fd, POLLIN, 0 };
+
+	if( board->start_ns == 0 ) {
+		board->start_ns = now;
+		board->next_tick_ns = now + step;
+		}
+
+	board->stop = false;
+	while( !board->stop && now < end ) {
+		receive( board, now );
+
+		while( board->n_events > 0 && board->events[0].time_ns <= now ) {
+			board_event_t event = pop_event( board );
+
+			route( board, &event );
+			}
+
+		if( now >= board->next_tick_ns ) {
+			tick( board, now );
+			if( now >= board->next_tick_ns + step ) {
+				// overran a whole timestep: start the schedule again from now
+				board->n_late_ticks++;
+				board->next_tick_ns = now;
+				}
+			board->next_tick_ns += step;
+			}
+
+		uint64_t wake = board->next_tick_ns < end ? board->next_tick_ns : end;
+
+		if( board->n_events > 0 && board->events[0].time_ns < wake )
+			wake = board->events[0].time_ns;
+
+		now = now_ns();
+		if( wake > now ) {
+			struct timespec timeout = { ( wake - now ) / 1000000000ULL, ( wake - now ) % 1000000000ULL };
+
+			ppoll( &input, 1, &timeout, NULL );
+			now = now_ns();
+			}
+		}
+}
+
+
+void board_emulator_close( board_emulator_t* board )
+{
+	for( uint32_t o = 0; o < board->config.n_live_output_ports; o++ )
+		spike_injector_close( &board->outputs[o] );
+	if( board->fd >= 0 )
+		close( board->fd );
+	if( board->engines != NULL )
+		for( uint32_t c = 0; c < board->n_chips; c++ )
+			if( board->has_table != NULL && board->has_table[c] )
+				routing_engine_free( &board->engines[c] );
+	free( board->engines );
+	free( board->has_table );
+	free( board->cores );
+	free( board->active );
+	free( board->events );
+	memset( board, 0, sizeof( board_emulator_t ) );
+	board->fd = -1;
+}
@@ -0,0 +1,139 @@
+/*! \file
+ *
+ *  \brief A local stand-in for a board's live I/O: EIEIO in on the reverse
+ *    IP tag port, multicast routing through the loaded tables, EIEIO out
+ *    to the live output port.
+ *
+ *  \details Keys arriving on the input port are sent into the router of
+ *    chip (0, 0) as if from the ReverseIpTagMultiCastSource core.  Each
+ *    router hop (a chip's table lookup, then the link or core it sends
+ *    to) takes hop_latency_ns and loses the packet with probability
+ *    drop_rate.  An application core receiving neuron n's spike fires
+ *    its own neuron n, key SUBVERTEX_KEY( x, y, p ) | n, at the next
+ *    timestep tick (time_step_us, the machineTimeStep), so a network of
+ *    relays stands in for the populations; a neuron fires at most once a
+ *    tick.  Spikes that have passed max_hops cores fire but are not
+ *    routed on, which ends loops such as a synfire ring.  The live output
+ *    core on chip (0, 0) stands for the live packet gatherer: it does not
+ *    fire, and every packet the tables route to it goes to every live
+ *    output port, packed into EIEIO messages sent when full or at the end
+ *    of the tick, as the gatherer does with strip_sdp.  Only those packets
+ *    reach the host, so the tables must route to it what the host is to
+ *    see.
+ *
+ *    Time is real time: board_emulator_run() sleeps in ppoll() until the
+ *    next input, event or tick.
+ *
+ */
+
+#ifndef __BOARD_EMULATOR_H__
+#define __BOARD_EMULATOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "eieio.h"
+#include "routing_engine.h"
+#include "routing_table.h"
+#include "spike_injector.h"
+
+#define BOARD_MAX_LIVE_OUTPUTS		4
+#define BOARD_CORES					18
+#define BOARD_NEURONS				2048		//!< keys below SUBVERTEX_MASK
+#define LIVE_SPIKE_PORT				17895		//!< pacman.cfg live_spike_port
+#define BOARD_NO_CORE				0xFFFFFFFF
+
+typedef struct {
+	uint32_t	time_step_us;			//!< machineTimeStep
+	uint32_t	hop_latency_ns;
+	double		drop_rate;				//!< per hop
+	uint32_t	max_hops;				//!< cores a spike is relayed through
+	uint32_t	live_output_core;		//!< live packet gatherer's core on chip (0, 0); required
+	const char*	live_output_host;
+	uint16_t	live_output_ports[BOARD_MAX_LIVE_OUTPUTS];
+	uint32_t	n_live_output_ports;
+	uint16_t	input_port;				//!< 0 for any free port, then in board->input_port
+	uint32_t	seed;
+} board_config_t;
+
+//! \brief A multicast packet on its way into a chip's router.
+typedef struct {
+	uint64_t	time_ns;
+	uint32_t	key;
+	uint16_t	chip;
+	int8_t		in_link;				//!< -1 if from a core on the chip
+	uint8_t		hops;
+} board_event_t;
+
+//! \brief Neurons of one core that fire at the next tick.
+typedef struct {
+	uint32_t	fired[BOARD_NEURONS / 32];
+	uint16_t	neurons[BOARD_NEURONS];
+	uint8_t		hops[BOARD_NEURONS];	//!< fewest cores passed by a spike to the neuron
+	uint32_t	n_neurons;
+} board_core_t;
+
+typedef struct {
+	board_config_t		config;
+	uint32_t			width, height;
+	uint32_t			n_chips;
+	routing_engine_t*	engines;		//!< by chip y * width + x
+	bool*				has_table;		//!< chips without one default route everything
+	board_core_t*		cores;			//!< by chip * BOARD_CORES + p
+	uint32_t*			active;			//!< cores with neurons to fire
+	uint32_t			n_active;
+
+	board_event_t*		events;			//!< min-heap on time_ns
+	uint32_t			n_events, max_events;
+
+	int					fd;
+	uint16_t			input_port;
+	spike_injector_t	outputs[BOARD_MAX_LIVE_OUTPUTS];
+	uint64_t			start_ns, next_tick_ns;
+	uint32_t			random;
+	volatile bool		stop;
+
+	uint64_t			n_datagrams;
+	uint64_t			n_injected;		//!< keys received
+	uint64_t			n_malformed;
+	uint64_t			n_routed;		//!< router lookups
+	uint64_t			n_dropped;		//!< to drop_rate
+	uint64_t			n_unrouted;		//!< matched no entry, from a core or off the machine
+	uint64_t			n_fired;
+	uint64_t			n_hop_limited;
+	uint64_t			n_live_output;	//!< keys routed to the live output core
+	uint64_t			n_ticks;
+	uint64_t			n_late_ticks;	//!< started a timestep or more late
+} board_emulator_t;
+
+
+//! \brief A 1 ms timestep, 100 ns hops, no drops, 16 hops, live output to
+//! 127.0.0.1:18250 and input on 12345.  The live output core is left as
+//! BOARD_NO_CORE: it depends on the tables, so the caller sets it.
+
+void board_config_defaults( board_config_t* config );
+
+//! \brief Compiles the tables (one per chip, as read_routing_tables()),
+//! binds the input port and connects the live output ports.
+//! \return false if no live output core is set, the port cannot be bound
+//!   or out of memory
+
+bool board_emulator_open( board_emulator_t* board, const board_config_t* config,
+						  const routing_table_t* tables, uint32_t n_tables );
+
+//! \brief Runs for duration_ns (0 for until board_emulator_stop()), from
+//! timestep 0 at the first call.
+
+void board_emulator_run( board_emulator_t* board, uint64_t duration_ns );
+
+//! \brief Makes board_emulator_run() return; safe from another thread or a
+//! signal handler.
+
+static inline void board_emulator_stop( board_emulator_t* board )
+{
+	board->stop = true;
+}
+
+void board_emulator_close( board_emulator_t* board );
+
+#endif /*__BOARD_EMULATOR_H__*/
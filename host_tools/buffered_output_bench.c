@@ -0,0 +1,368 @@
+/*
+	Buffered output (neural_models/recording_buffer.h, recording_drain.c)
+	against a host that reads the recording at a limited rate.
+
+		buffered_output_bench [--neurons N] [--rate HZ] [--ticks T] [--ring WORDS]
+							  [--bandwidths MBS,...] [--poll-us US] [--output FILE]
+
+	A thread stands in for a core of N neurons (default 1024) running 1 ms
+	ticks in real time: each tick every neuron fires at --rate Hz (default
+	10) and its V, a noisy decay to rest reset on spiking, is recorded
+	with 16 bit changes.  Both go through a ring of --ring words (default
+	65536, 256 KB of SDRAM) that the drain polls every --poll-us (default
+	1000), reading at most the given MB/s, as an SCP read of SDRAM would
+	(0: as fast as memory), into a recording store at --output.
+
+	For each bandwidth it reports how many ticks the core had to wait,
+	how much longer than real time the core took, the fullest the ring
+	got, and the store's size; and it reads the store back with
+	recording_reader.h to check that it holds every spike and every V
+	within half a step.  Ticks only wait once the host reads more slowly
+	than the core records.
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bit_field.h"
+#include "recording_buffer.h"
+#include "spike_recording.h"
+#include "state_recording.h"
+#include "recording_drain.h"
+#include "recording_store.h"
+#include "recording_reader.h"
+
+
+#define MAX_BANDWIDTHS		16
+#define TICK_NS				1000000
+#define V_BITS				16
+#define V_SHIFT				4
+#define V_REST				( -65 << 15 )
+#define V_RESET				( -70 << 15 )
+#define SPIKES_CHANNEL		0
+#define V_CHANNEL			1
+
+typedef struct {
+	recording_buffer_t	buffer;
+	uint32_t			n_neurons;
+	uint32_t			rate;
+	uint32_t			n_ticks;
+
+	// what was recorded, to check the store against
+	uint32_t*			spike_ticks;
+	uint16_t*			spike_neurons;
+	uint64_t			n_spikes;
+	uint64_t			max_spikes;
+	int32_t*			v_trace;		// per tick then neuron
+
+	uint32_t			n_waiting_ticks;
+	double				paused_ns;
+	double				run_ns;
+	volatile bool		done;
+} core_t;
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void sleep_until( uint64_t ns )
+{
+	struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR )
+		;
+}
+
+
+static void* core_thread( void* arg )
+{
+	core_t* core = arg;
+	uint32_t n = core->n_neurons, n_words = get_bit_field_size( n );
+	uint32_t threshold = (uint32_t) ( core->rate / 1000.0 * 4294967296.0 );
+	uint32_t worst = 2 * RECORDING_CHUNK_HEADER_WORDS + 1 + n_words + state_recording_max_record_words( n, V_BITS );
+	uint32_t* spikes = calloc( n_words, sizeof( uint32_t ) );
+	uint32_t* staging = malloc( worst * sizeof( uint32_t ) );
+	int32_t* v = malloc( n * sizeof( int32_t ) );
+	int32_t* rebuilt = malloc( n * sizeof( int32_t ) );
+	recording_buffer_t* buffer = &core->buffer;
+	state_recording_t v_recording;
+	uint64_t start = now_ns(), tick_due = start;
+
+	// only the codec state is used; records go to the staging words
+	state_recording_initialise( &v_recording, staging, worst, n, V_BITS, V_SHIFT, 1, 64, rebuilt );
+	for( uint32_t i = 0; i < n; i++ )
+		v[i] = V_REST;
+
+	for( uint32_t t = 0; t < core->n_ticks; t++ ) {
+		tick_due += TICK_NS;
+		sleep_until( tick_due );
+
+		// back-pressure: the tick waits while the host is too far behind
+		if( !recording_buffer_has_room( buffer, worst ) ) {
+			uint64_t paused = now_ns();
+
+			core->n_waiting_ticks++;
+			while( !recording_buffer_has_room( buffer, worst ) )
+				sleep_until( now_ns() + 100000 );
+			core->paused_ns += now_ns() - paused;
+			tick_due = now_ns();
+			}
+
+		clear_bit_field( spikes, n_words );
+		for( uint32_t i = 0; i < n; i++ ) {
+			int32_t noise = (int32_t) ( next_random() % 65536 ) - 32768;
+
+			v[i] += ( V_REST - v[i] ) / 20 + noise;
+			if( next_random() < threshold ) {
+				bit_field_set( spikes, i );
+				v[i] = V_RESET;
+				if( core->n_spikes < core->max_spikes ) {
+					core->spike_ticks[core->n_spikes] = t;
+					core->spike_neurons[core->n_spikes] = i;
+					}
+				core->n_spikes++;
+				}
+			core->v_trace[(size_t) t * n + i] = v[i];
+			}
+
+		uint32_t n_spikes = count_bit_field( spikes, n_words );
+
+		if( n_spikes > 0 ) {
+			uint32_t length = spike_recording_encode( spikes, n_words, n_spikes, staging );
+
+			recording_buffer_write( buffer, SPIKES_CHANNEL, t, staging, length );
+			}
+
+		uint32_t length = state_recording_encode( &v_recording, v, staging, worst );
+
+		recording_buffer_write( buffer, V_CHANNEL, t, staging, length );
+		recording_buffer_publish( buffer );
+		}
+
+	core->run_ns = now_ns() - start;
+	core->done = true;
+	free( spikes );
+	free( staging );
+	free( v );
+	free( rebuilt );
+	return NULL;
+}
+
+
+// plain memory, with the positions read and written as the core does
+static bool memory_read( void* context, uint32_t offset, uint32_t n_words, uint32_t* out )
+{
+	uint32_t* region = context;
+
+	for( uint32_t i = 0; i < n_words && offset + i < RECORDING_BUFFER_HEADER_WORDS; i++ )
+		out[i] = __atomic_load_n( &region[offset + i], __ATOMIC_ACQUIRE );
+	if( offset + n_words > RECORDING_BUFFER_HEADER_WORDS ) {
+		uint32_t skip = offset < RECORDING_BUFFER_HEADER_WORDS ? RECORDING_BUFFER_HEADER_WORDS - offset : 0;
+
+		memcpy( out + skip, region + offset + skip, ( n_words - skip ) * sizeof( uint32_t ) );
+		}
+	return true;
+}
+
+
+static bool memory_write( void* context, uint32_t offset, uint32_t word )
+{
+	__atomic_store_n( &( (uint32_t*) context )[offset], word, __ATOMIC_RELEASE );
+	return true;
+}
+
+
+// every spike in order and every V within half a step
+static bool check_store( const char* path, const core_t* core )
+{
+	recording_reader_t reader;
+	uint64_t n_spikes = 0, n_v_rows = 0;
+	bool ok = recording_reader_open( &reader, path ) && reader.n_channels == 2 && reader.indexed;
+
+	for( uint32_t b = 0; ok && b < reader.n_blocks; b++ ) {
+		const recording_block_t* block = &reader.blocks[b];
+
+		if( block->channel == SPIKES_CHANNEL )
+			for( uint32_t r = 0; ok && r < block->n_rows; r++, n_spikes++ )
+				ok = n_spikes < core->max_spikes && block->ticks[r] == core->spike_ticks[n_spikes]
+					 && block->neurons[r] == core->spike_neurons[n_spikes];
+		else {
+			for( uint32_t i = 0; ok && i < core->n_neurons; i++ )
+				for( uint32_t r = 0; ok && r < block->n_rows; r++ ) {
+					int32_t value = block->values[(size_t) i * block->stride + r];
+					int32_t error = value - core->v_trace[(size_t) block->ticks[r] * core->n_neurons + i];
+
+					ok = block->ticks[r] == n_v_rows + r && error <= 1 << ( V_SHIFT - 1 )
+						 && error >= -( 1 << ( V_SHIFT - 1 ) );
+					}
+			n_v_rows += block->n_rows;
+			}
+		}
+
+	ok = ok && n_spikes == core->n_spikes && n_v_rows == core->n_ticks;
+	recording_reader_close( &reader );
+	return ok;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t n_neurons = 1024, rate = 10, n_ticks = 2000, ring_words = 65536, poll_us = 1000;
+	double bandwidths[MAX_BANDWIDTHS] = { 0, 8, 2, 1 };
+	uint32_t n_bandwidths = 4;
+	const char* output = "buffered_output.rec";
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--neurons" ) && i + 1 < argc )
+			n_neurons = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--rate" ) && i + 1 < argc )
+			rate = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			n_ticks = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--ring" ) && i + 1 < argc )
+			ring_words = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--poll-us" ) && i + 1 < argc )
+			poll_us = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--output" ) && i + 1 < argc )
+			output = argv[++i];
+		else if( !strcmp( argv[i], "--bandwidths" ) && i + 1 < argc ) {
+			char* next = argv[++i];
+
+			for( n_bandwidths = 0; n_bandwidths < MAX_BANDWIDTHS && *next; n_bandwidths++ ) {
+				bandwidths[n_bandwidths] = strtod( next, &next );
+				if( *next == ',' )
+					next++;
+				}
+			}
+		else {
+			fprintf( stderr, "usage: %s [--neurons N] [--rate HZ] [--ticks T] [--ring WORDS] [--bandwidths MBS,...]"
+					 " [--poll-us US] [--output FILE]\n", argv[0] );
+			return 1;
+			}
+		}
+	if( n_neurons == 0 || n_neurons > 0x10000 || n_ticks == 0 || ring_words <= RECORDING_BUFFER_HEADER_WORDS )
+		return 1;
+
+	uint32_t region_words = RECORDING_BUFFER_HEADER_WORDS + ring_words;
+	uint32_t capacity = 1u << ( 31 - __builtin_clz( ring_words ) );
+	uint32_t worst = 2 * RECORDING_CHUNK_HEADER_WORDS + 1 + get_bit_field_size( n_neurons )
+					 + state_recording_max_record_words( n_neurons, V_BITS );
+	uint32_t n_failures = 0;
+
+	if( worst > capacity ) {
+		fprintf( stderr, "a tick can take %u words, more than a ring of %u\n", worst, capacity );
+		return 1;
+		}
+
+	uint32_t* region = malloc( region_words * sizeof( uint32_t ) );
+	core_t core = { .n_neurons = n_neurons, .rate = rate, .n_ticks = n_ticks };
+
+	core.max_spikes = (uint64_t) n_neurons * n_ticks * ( rate + 10 ) / 1000 + 1024;
+	core.spike_ticks = malloc( core.max_spikes * sizeof( uint32_t ) );
+	core.spike_neurons = malloc( core.max_spikes * sizeof( uint16_t ) );
+	core.v_trace = malloc( (size_t) n_ticks * n_neurons * sizeof( int32_t ) );
+
+	printf( "%u neurons at %u Hz for %u ms, spikes and V (%u bits); ring of %u words, poll every %u us\n", n_neurons,
+			rate, n_ticks, V_BITS, capacity, poll_us );
+	printf( "%10s %9s %9s %9s %10s %9s %11s %7s\n", "read MB/s", "recorded", "waited", "slowdown", "paused ms",
+			"max fill", "store KB", "check" );
+
+	for( uint32_t b = 0; b < n_bandwidths; b++ ) {
+		recording_channel_t channels[2] = {
+			{ RECORDING_SPIKES, n_neurons, 1000, "spikes" }, { RECORDING_STATE, n_neurons, 1000, "v" } };
+		recording_drain_channel_t drain_channels[2] = {
+			{ RECORDING_SPIKES, n_neurons, 0, 0 }, { RECORDING_STATE, n_neurons, V_BITS, V_SHIFT } };
+		recording_source_t source = { memory_read, memory_write, region };
+		recording_store_t store;
+		recording_drain_t drain;
+		pthread_t thread;
+		bool failed = false;
+
+		rng_state = 0x6A09E667;
+		core.n_spikes = core.n_waiting_ticks = 0;
+		core.paused_ns = 0;
+		core.done = false;
+
+		// the region must be set up before the drain reads its header
+		recording_buffer_initialise( &core.buffer, region, region_words );
+		if( !recording_store_create( &store, output, channels, 2, 0 )
+			|| !recording_drain_open( &drain, &source, &store, drain_channels, 2 ) ) {
+			fprintf( stderr, "cannot create %s\n", output );
+			return 1;
+			}
+
+		uint64_t start = now_ns();
+
+		pthread_create( &thread, NULL, core_thread, &core );
+		for( ;; ) {
+			bool done = core.done;
+			int64_t words = recording_drain_poll( &drain );
+
+			if( words < 0 ) {
+				failed = true;
+				break;
+				}
+			if( done && words == 0 )
+				break;
+
+			// the next poll waits for the interval, or for the read to have taken its time
+			uint64_t next = now_ns() + poll_us * 1000ULL;
+
+			if( bandwidths[b] > 0 ) {
+				uint64_t read_until = start + (uint64_t) ( drain.n_words * 4 / bandwidths[b] * 1000 );
+
+				if( read_until > next )
+					next = read_until;
+				}
+			sleep_until( next );
+			}
+		pthread_join( thread, NULL );
+
+		recording_drain_close( &drain );
+		failed = !recording_store_close( &store ) || failed;
+
+		bool checked = !failed && core.n_spikes <= core.max_spikes && check_store( output, &core );
+		char name[16];
+
+		if( !checked )
+			n_failures++;
+		if( bandwidths[b] > 0 )
+			snprintf( name, sizeof( name ), "%.1f", bandwidths[b] );
+		else
+			snprintf( name, sizeof( name ), "memory" );
+		printf( "%10s %7.2fMB %9u %8.2fx %10.0f %8.1f%% %11.0f %7s\n", name, drain.n_words * 4 / 1e6,
+				core.n_waiting_ticks, core.run_ns / ( (double) n_ticks * TICK_NS ), core.paused_ns / 1e6,
+				100.0 * drain.max_fill / capacity, store.n_bytes / 1024.0, checked ? "ok" : "FAILED" );
+		}
+
+	free( region );
+	free( core.spike_ticks );
+	free( core.spike_neurons );
+	free( core.v_trace );
+
+	return n_failures ? 1 : 0;
+}
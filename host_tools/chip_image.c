@@ -0,0 +1,220 @@
+/*
+	Packed per-chip appData image; see chip_image.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chip_image.h"
+
+
+static int compare_inputs( const void* a, const void* b )
+{
+	uint32_t address_a = ( (const chip_image_input_t*) a )->start_address;
+	uint32_t address_b = ( (const chip_image_input_t*) b )->start_address;
+
+	return ( address_a > address_b ) - ( address_a < address_b );
+}
+
+
+static bool write_zeros( FILE* f, uint32_t n_bytes )
+{
+	static const uint8_t zeros[CHIP_IMAGE_PAGE_BYTES];
+
+	while( n_bytes > 0 ) {
+		uint32_t n = n_bytes < sizeof( zeros ) ? n_bytes : sizeof( zeros );
+
+		if( fwrite( zeros, 1, n, f ) != n )
+			return false;
+		n_bytes -= n;
+		}
+
+	return true;
+}
+
+
+bool chip_image_write( const char* path, uint32_t x, uint32_t y, chip_image_input_t* cores,
+					   uint32_t n_cores, uint32_t max_gap )
+{
+	qsort( cores, n_cores, sizeof( chip_image_input_t ), compare_inputs );
+
+	chip_image_core_t* core_entries = calloc( n_cores ? n_cores : 1, sizeof( chip_image_core_t ) );
+	chip_image_transfer_t* transfers = calloc( n_cores ? n_cores : 1, sizeof( chip_image_transfer_t ) );
+	uint32_t n_transfers = 0;
+	uint32_t data_bytes = 0;
+
+	// a core joins the open transfer if it starts where the previous core's
+	// reservation ends and the unwritten tail of that reservation is small
+	for( uint32_t c = 0; c < n_cores; c++ ) {
+		chip_image_input_t* core = &cores[c];
+
+		if( c > 0 ) {
+			chip_image_input_t* previous = &cores[c - 1];
+
+			if( previous->start_address + previous->memory_used > core->start_address ) {
+				free( core_entries );
+				free( transfers );
+				return false;
+				}
+			}
+
+		chip_image_transfer_t* open = n_transfers ? &transfers[n_transfers - 1] : NULL;
+		bool merge = false;
+
+		if( open ) {
+			chip_image_input_t* previous = &cores[c - 1];
+			uint32_t gap = core->start_address - ( previous->start_address + previous->memory_written );
+
+			merge = previous->start_address + previous->memory_used == core->start_address
+					&& gap <= max_gap;
+			}
+
+		if( !merge ) {
+			open = &transfers[n_transfers++];
+			open->sdram_address = core->start_address;
+			open->file_offset = data_bytes;
+			open->length = 0;
+			open->n_cores = 0;
+			}
+
+		uint32_t end = core->start_address + core->memory_written - open->sdram_address;
+
+		data_bytes += end - open->length;
+		open->length = end;
+		open->n_cores++;
+
+		core_entries[c].p = core->p;
+		core_entries[c].start_address = core->start_address;
+		core_entries[c].memory_used = core->memory_used;
+		core_entries[c].memory_written = core->memory_written;
+		core_entries[c].transfer = n_transfers - 1;
+		}
+
+	uint32_t index_bytes = sizeof( chip_image_header_t ) + n_cores * sizeof( chip_image_core_t )
+						   + n_transfers * sizeof( chip_image_transfer_t );
+	uint32_t data_offset = ( index_bytes + CHIP_IMAGE_PAGE_BYTES - 1 ) & ~( CHIP_IMAGE_PAGE_BYTES - 1 );
+
+	chip_image_header_t header = {
+		CHIP_IMAGE_MAGIC_NUMBER, CHIP_IMAGE_VERSION, x, y,
+		n_cores, n_transfers, data_offset, data_bytes
+		};
+
+	for( uint32_t t = 0; t < n_transfers; t++ )
+		transfers[t].file_offset += data_offset;
+
+	FILE* f = fopen( path, "wb" );
+	bool ok = f != NULL;
+
+	ok = ok && fwrite( &header, sizeof( header ), 1, f ) == 1;
+	ok = ok && fwrite( core_entries, sizeof( chip_image_core_t ), n_cores, f ) == n_cores;
+	ok = ok && fwrite( transfers, sizeof( chip_image_transfer_t ), n_transfers, f ) == n_transfers;
+	ok = ok && write_zeros( f, data_offset - index_bytes );
+
+	// the cores are in address order, so each transfer is written in one pass
+	for( uint32_t c = 0; ok && c < n_cores; c++ ) {
+		chip_image_transfer_t* transfer = &transfers[core_entries[c].transfer];
+		uint32_t position = core_entries[c].start_address - transfer->sdram_address;
+
+		if( position > 0 && c > 0 && core_entries[c - 1].transfer == core_entries[c].transfer ) {
+			uint32_t previous_end = core_entries[c - 1].start_address + core_entries[c - 1].memory_written
+									- transfer->sdram_address;
+
+			ok = write_zeros( f, position - previous_end );
+			}
+
+		ok = ok && fwrite( cores[c].data, 1, cores[c].memory_written, f ) == cores[c].memory_written;
+		}
+
+	if( f && fclose( f ) != 0 )
+		ok = false;
+
+	free( core_entries );
+	free( transfers );
+
+	return ok;
+}
+
+
+bool chip_image_map( const char* path, chip_image_t* image )
+{
+	struct stat st;
+	int fd = open( path, O_RDONLY );
+
+	memset( image, 0, sizeof( *image ) );
+
+	if( fd < 0 )
+		return false;
+
+	if( fstat( fd, &st ) != 0 || st.st_size < (off_t) sizeof( chip_image_header_t ) ) {
+		close( fd );
+		return false;
+		}
+
+	void* base = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+
+	close( fd );
+	if( base == MAP_FAILED )
+		return false;
+
+	image->base = base;
+	image->size = st.st_size;
+	image->header = base;
+
+	const chip_image_header_t* header = image->header;
+	uint64_t index_bytes = sizeof( chip_image_header_t )
+						   + (uint64_t) header->n_cores * sizeof( chip_image_core_t )
+						   + (uint64_t) header->n_transfers * sizeof( chip_image_transfer_t );
+
+	if( header->magic_number != CHIP_IMAGE_MAGIC_NUMBER || header->version != CHIP_IMAGE_VERSION
+		|| index_bytes > header->data_offset
+		|| (uint64_t) header->data_offset + header->data_bytes > image->size ) {
+		chip_image_unmap( image );
+		return false;
+		}
+
+	image->cores = (const chip_image_core_t*) ( header + 1 );
+	image->transfers = (const chip_image_transfer_t*) ( image->cores + header->n_cores );
+
+	for( uint32_t t = 0; t < header->n_transfers; t++ )
+		if( (uint64_t) image->transfers[t].file_offset + image->transfers[t].length > image->size ) {
+			chip_image_unmap( image );
+			return false;
+			}
+
+	for( uint32_t c = 0; c < header->n_cores; c++ ) {
+		const chip_image_core_t* core = &image->cores[c];
+		const chip_image_transfer_t* transfer = &image->transfers[core->transfer < header->n_transfers
+																  ? core->transfer : 0];
+
+		if( core->transfer >= header->n_transfers || core->start_address < transfer->sdram_address
+			|| (uint64_t) core->start_address + core->memory_written
+			   > (uint64_t) transfer->sdram_address + transfer->length ) {
+			chip_image_unmap( image );
+			return false;
+			}
+		}
+
+	return true;
+}
+
+
+void chip_image_unmap( chip_image_t* image )
+{
+	if( image->base )
+		munmap( (void*) image->base, image->size );
+	memset( image, 0, sizeof( *image ) );
+}
+
+
+const uint8_t* chip_image_core_data( const chip_image_t* image, uint32_t i )
+{
+	const chip_image_core_t* core = &image->cores[i];
+	const chip_image_transfer_t* transfer = &image->transfers[core->transfer];
+
+	return image->base + transfer->file_offset + core->start_address - transfer->sdram_address;
+}
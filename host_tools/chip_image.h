@@ -0,0 +1,104 @@
+/*! \file
+ *
+ *  \brief Packed per-chip appData image.
+ *
+ *  \details One file per chip replaces the per-core *_appData_X_Y_P.dat
+ *    files.  Cores whose images lie back to back in SDRAM are merged into
+ *    a single transfer, so a chip is loaded with a few large contiguous
+ *    writes straight out of an mmap'ed file.
+ *
+ *    Layout (little endian 32-bit words):
+ *
+ *      chip_image_header_t
+ *      n_cores     x chip_image_core_t       sorted by start_address
+ *      n_transfers x chip_image_transfer_t   sorted by sdram_address
+ *      zero padding to data_offset (a page boundary)
+ *      transfer data, back to back in transfer order
+ *
+ *    A core's image is at file offset
+ *      transfers[core.transfer].file_offset
+ *        + core.start_address - transfers[core.transfer].sdram_address
+ *
+ */
+
+#ifndef __CHIP_IMAGE_H__
+#define __CHIP_IMAGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CHIP_IMAGE_MAGIC_NUMBER		0xAD13C41B
+#define CHIP_IMAGE_VERSION			0x00010000
+#define CHIP_IMAGE_PAGE_BYTES		4096
+
+//! \brief SARK vcpu block: user0 of core p holds its appData address
+#define VCPU_BASE_ADDRESS			0xE5007000
+#define VCPU_BYTES					128
+#define VCPU_USER0_OFFSET			112
+#define USER0_ADDRESS( p )			( VCPU_BASE_ADDRESS + ( p ) * VCPU_BYTES + VCPU_USER0_OFFSET )
+
+typedef struct {
+	uint32_t	magic_number;
+	uint32_t	version;
+	uint32_t	x;
+	uint32_t	y;
+	uint32_t	n_cores;
+	uint32_t	n_transfers;
+	uint32_t	data_offset;		//!< file offset of the first transfer
+	uint32_t	data_bytes;			//!< total bytes of transfer data
+} chip_image_header_t;
+
+typedef struct {
+	uint32_t	p;
+	uint32_t	start_address;		//!< SDRAM address of the core's appData
+	uint32_t	memory_used;		//!< bytes reserved, including unfilled regions
+	uint32_t	memory_written;		//!< bytes of image, i.e. the appData file size
+	uint32_t	transfer;			//!< index of the transfer carrying the image
+} chip_image_core_t;
+
+typedef struct {
+	uint32_t	sdram_address;
+	uint32_t	file_offset;
+	uint32_t	length;
+	uint32_t	n_cores;
+} chip_image_transfer_t;
+
+//! \brief One core's appData, as input to chip_image_write()
+typedef struct {
+	uint32_t		p;
+	uint32_t		start_address;
+	uint32_t		memory_used;
+	uint32_t		memory_written;
+	const uint8_t*	data;			//!< memory_written bytes
+} chip_image_input_t;
+
+//! \brief A mapped image; every pointer points into the mapping
+typedef struct {
+	const chip_image_header_t*		header;
+	const chip_image_core_t*		cores;
+	const chip_image_transfer_t*	transfers;
+	const uint8_t*					base;
+	uint64_t						size;
+} chip_image_t;
+
+
+//! \brief Packs the cores of one chip into path.
+//! \param[in] max_gap Unfilled bytes at the end of a core's reservation that
+//!   may be written as zeros to merge it with the next core; 0 merges only
+//!   images that touch.
+//! \return false on an I/O error or overlapping cores
+
+bool chip_image_write( const char* path, uint32_t x, uint32_t y, chip_image_input_t* cores,
+					   uint32_t n_cores, uint32_t max_gap );
+
+//! \brief Maps and validates an image read-only.
+
+bool chip_image_map( const char* path, chip_image_t* image );
+
+void chip_image_unmap( chip_image_t* image );
+
+//! \brief The appData image of core i, pointing into the mapping.
+
+const uint8_t* chip_image_core_data( const chip_image_t* image, uint32_t i );
+
+#endif /*__CHIP_IMAGE_H__*/
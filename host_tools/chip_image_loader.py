@@ -0,0 +1,124 @@
+"""
+Loads the packed per-chip images written by pack_app_data (see
+chip_image.h) onto a machine.
+
+Each image is mmap'ed and every transfer goes out as one write_memory
+call straight from the mapping, followed by the user0 writes that tell
+each core where its appData starts.  From a rerun_script.py, in place of
+the per-core appData writes::
+
+    from chip_image_loader import load_chip_images
+    load_chip_images(txrx, ".")
+"""
+import glob
+import mmap
+import os
+import struct
+
+CHIP_IMAGE_MAGIC_NUMBER = 0xAD13C41B
+CHIP_IMAGE_VERSION = 0x00010000
+
+_HEADER = struct.Struct("<8I")
+_CORE = struct.Struct("<5I")
+_TRANSFER = struct.Struct("<4I")
+
+# SARK vcpu block: user0 of core p holds its appData address
+VCPU_BASE_ADDRESS = 0xE5007000
+VCPU_BYTES = 128
+VCPU_USER0_OFFSET = 112
+
+
+def user0_address(p):
+    return VCPU_BASE_ADDRESS + p * VCPU_BYTES + VCPU_USER0_OFFSET
+
+
+class MmapDataReader(object):
+    """ A data reader over a slice of a mapping, for write_memory
+    """
+
+    def __init__(self, mapping, offset, length):
+        self._view = memoryview(mapping)[offset:offset + length]
+        self._position = 0
+
+    def read(self, n_bytes):
+        data = self._view[self._position:self._position + n_bytes]
+        self._position += len(data)
+        return bytearray(data)
+
+    def readinto(self, data):
+        n_bytes = min(len(data), len(self._view) - self._position)
+        data[:n_bytes] = self._view[self._position:self._position + n_bytes]
+        self._position += n_bytes
+        return n_bytes
+
+    def readall(self):
+        return self.read(len(self._view) - self._position)
+
+    def tell(self):
+        return self._position
+
+    def close(self):
+        # memoryview.release() is Python 3 only
+        if hasattr(self._view, "release"):
+            self._view.release()
+
+
+class ChipImage(object):
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self._mapping = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        (magic_number, version, self.x, self.y, n_cores, n_transfers,
+         self.data_offset, self.data_bytes) = _HEADER.unpack_from(
+            self._mapping, 0)
+        if (magic_number != CHIP_IMAGE_MAGIC_NUMBER or
+                version != CHIP_IMAGE_VERSION):
+            self._mapping.close()
+            raise ValueError("{} is not a chip image".format(path))
+
+        offset = _HEADER.size
+        self.cores = []
+        for _ in range(n_cores):
+            self.cores.append(_CORE.unpack_from(self._mapping, offset))
+            offset += _CORE.size
+        self.transfers = []
+        for _ in range(n_transfers):
+            self.transfers.append(_TRANSFER.unpack_from(self._mapping, offset))
+            offset += _TRANSFER.size
+
+    def core_data(self, index):
+        """
+        :return: a reader over the appData image of the index'th core
+        """
+        _, start_address, _, memory_written, transfer = self.cores[index]
+        sdram_address, file_offset, _, _ = self.transfers[transfer]
+        return MmapDataReader(
+            self._mapping, file_offset + start_address - sdram_address,
+            memory_written)
+
+    def load(self, txrx):
+        for sdram_address, file_offset, length, _ in self.transfers:
+            reader = MmapDataReader(self._mapping, file_offset, length)
+            txrx.write_memory(self.x, self.y, sdram_address, reader, length)
+            reader.close()
+        for p, start_address, _, _, _ in self.cores:
+            txrx.write_memory(self.x, self.y, user0_address(p), start_address)
+
+    def close(self):
+        self._mapping.close()
+
+
+def load_chip_images(txrx, directory):
+    """
+    Loads every *_chipImage_X_Y.dat in directory
+    :return: the number of transfers made
+    """
+    n_transfers = 0
+    for path in sorted(glob.glob(
+            os.path.join(directory, "*_chipImage_*.dat"))):
+        image = ChipImage(path)
+        image.load(txrx)
+        n_transfers += len(image.transfers)
+        image.close()
+    return n_transfers
@@ -0,0 +1,422 @@
+/*
+	Closed-loop latency of inject -> simulate -> live output, against the
+	in-process board stand-in of board_emulator.c.
+
+		closed_loop_bench [--seconds S] [--rates R,...] [--keys-per-message K,...]
+						  [--time-steps US,...] [--neurons N] [--hop-latency NS]
+						  [--drop-rate P] [--max-hold US] [--routing DIR --live-output-core P]
+
+	Sensor spikes for neurons 0, 1, 2 ... N - 1 in turn are injected as in
+	synfire_inject.py (16-bit keys, prefix 7 upper half-word, so key
+	0x70000 | n) at Poisson times at each rate, packed K keys to a
+	message.  Each spike is stamped when it is handed to the injector, so
+	time spent waiting for a message to fill counts; a part-filled message
+	goes out once its oldest spike has waited --max-hold, by default one
+	timestep, or only when full with --max-hold 0.  By default the board has
+	two table entries, 0x70000/0xFFFFF800 to core 1 and core 1's keys,
+	0x800/0xFFFFF800, to core 2, the live output core, so a spike comes
+	back as key 0x800 | n on the tick after it arrives.  With --routing
+	the tables are those given, and the core they route live output to
+	must be given too.
+
+	A live output spike for neuron n is matched with the oldest injected
+	spike of n not yet matched; other spikes of n injected before it
+	arrived were merged into the same firing (a neuron fires once a tick)
+	and are counted, not timed.  Injected spikes never matched are lost,
+	as are those still unmatched when a spike of n arrives more than half
+	of N / rate (the time before n is injected again) after them, so
+	latencies are only timed up to that.  Live output
+	spikes answering no injected spike are counted as other.
+
+	The latency is from the stamp to the kernel's arrival time of the
+	live output datagram; p50, p99 and p99.9 are reported for every
+	combination of rate, keys per message and machineTimeStep.
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+
+#include "board_emulator.h"
+#include "eieio.h"
+#include "routing_table.h"
+#include "spike_injector.h"
+#include "spike_receiver.h"
+
+
+#define MAX_VALUES			16
+#define INJECT_PREFIX		7
+#define READ_EVENTS			4096
+
+typedef struct {
+	uint64_t*	times;			// ring of injection stamps
+	uint32_t	first, count, size;
+} stamp_queue_t;
+
+typedef struct {
+	double		seconds;
+	uint32_t	n_neurons;
+	uint32_t	hop_latency_ns;
+	double		drop_rate;
+	uint32_t	live_output_core;
+	uint32_t	max_hops;
+	int64_t		max_hold_us;		// -1: one timestep
+	routing_table_t* tables;
+	uint32_t	n_tables;
+} bench_config_t;
+
+
+static uint64_t realtime_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_REALTIME, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void sleep_until( uint64_t ns )
+{
+	struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR )
+		;
+}
+
+
+static void* emulator_thread( void* arg )
+{
+	board_emulator_run( arg, 0 );
+	return NULL;
+}
+
+
+static bool push_stamp( stamp_queue_t* queue, uint64_t time_ns )
+{
+	if( queue->count == queue->size ) {
+		uint32_t size = queue->size ? 2 * queue->size : 16;
+		uint64_t* times = malloc( size * sizeof( uint64_t ) );
+
+		if( times == NULL )
+			return false;
+		for( uint32_t i = 0; i < queue->count; i++ )
+			times[i] = queue->times[( queue->first + i ) % queue->size];
+		free( queue->times );
+		queue->times = times;
+		queue->first = 0;
+		queue->size = size;
+		}
+	queue->times[( queue->first + queue->count++ ) % queue->size] = time_ns;
+	return true;
+}
+
+
+static int compare_uint64( const void* a, const void* b )
+{
+	uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+	return x < y ? -1 : x > y;
+}
+
+
+typedef struct {
+	stamp_queue_t*	queues;			// by neuron
+	uint32_t		n_neurons;
+	uint64_t		reuse_ns;		// between injections of the same neuron, on average
+	uint64_t*		latencies;
+	uint64_t		n_matched, max_matched;
+	uint64_t		n_merged, n_expired, n_unmatched;
+} matcher_t;
+
+
+static inline void pop_stamp( stamp_queue_t* queue )
+{
+	queue->first = ( queue->first + 1 ) % queue->size;
+	queue->count--;
+}
+
+
+static void match( matcher_t* matcher, const spike_event_t* events, uint32_t n )
+{
+	for( uint32_t e = 0; e < n; e++ ) {
+		uint32_t neuron = events[e].key & ~SUBVERTEX_MASK;
+		uint64_t arrived = events[e].time_ns;
+
+		if( neuron >= matcher->n_neurons ) {
+			matcher->n_unmatched++;
+			continue;
+			}
+
+		// a stamp half a reuse period older than this spike was lost on
+		// the way, or an earlier spike would have answered it
+		stamp_queue_t* queue = &matcher->queues[neuron];
+
+		while( queue->count > 0 && queue->times[queue->first] + matcher->reuse_ns / 2 < arrived ) {
+			pop_stamp( queue );
+			matcher->n_expired++;
+			}
+		if( queue->count == 0 || queue->times[queue->first] > arrived ) {
+			matcher->n_unmatched++;
+			continue;
+			}
+
+		if( matcher->n_matched < matcher->max_matched )
+			matcher->latencies[matcher->n_matched++] = arrived - queue->times[queue->first];
+		pop_stamp( queue );
+
+		// the same firing answered these
+		while( queue->count > 0 && queue->times[queue->first] <= arrived ) {
+			pop_stamp( queue );
+			matcher->n_merged++;
+			}
+		}
+}
+
+
+static void run_case( const bench_config_t* config, double rate, uint32_t keys_per_message, uint32_t time_step_us )
+{
+	board_config_t board_config;
+	board_emulator_t board;
+	spike_receiver_t receiver;
+	spike_reader_t reader;
+	spike_injector_t injector;
+	pthread_t thread;
+	static spike_event_t events[READ_EVENTS];
+	eieio_format_t format = { EIEIO_KEY_16_BIT, EIEIO_UPPER_HALF_WORD, INJECT_PREFIX, 0 };
+
+	uint64_t n_spikes = rate * config->seconds;
+	matcher_t matcher = { calloc( config->n_neurons, sizeof( stamp_queue_t ) ), config->n_neurons,
+						  config->n_neurons * 1e9 / rate, malloc( ( n_spikes + 1 ) * sizeof( uint64_t ) ),
+						  0, n_spikes, 0, 0, 0 };
+
+	if( !matcher.queues || !matcher.latencies || !spike_receiver_open( &receiver, 0, 1 << 20, 64 ) ) {
+		fprintf( stderr, "cannot open a receiver\n" );
+		exit( 1 );
+		}
+	spike_reader_init( &reader, &receiver );
+
+	board_config_defaults( &board_config );
+	board_config.time_step_us = time_step_us;
+	board_config.hop_latency_ns = config->hop_latency_ns;
+	board_config.drop_rate = config->drop_rate;
+	board_config.max_hops = config->max_hops;
+	board_config.live_output_core = config->live_output_core;
+	board_config.live_output_ports[0] = receiver.port;
+	board_config.input_port = 0;
+	if( !board_emulator_open( &board, &board_config, config->tables, config->n_tables )
+		|| pthread_create( &thread, NULL, emulator_thread, &board ) != 0 ) {
+		fprintf( stderr, "cannot start the board emulator\n" );
+		exit( 1 );
+		}
+	if( !spike_injector_open( &injector, "127.0.0.1", board.input_port, &format, keys_per_message, 1, 0.0 ) ) {
+		fprintf( stderr, "cannot open the injector\n" );
+		exit( 1 );
+		}
+	spike_injector_set_max_hold( &injector, ( config->max_hold_us < 0 ? time_step_us : config->max_hold_us ) * 1000ULL );
+
+	// Poisson arrivals, so that spikes fall at every phase of the timestep
+	uint64_t start = now_ns(), start_realtime = realtime_ns();
+	uint32_t keys[READ_EVENTS], random = 0x2545F491;
+	double due = 0.0;
+
+	for( uint64_t i = 0; i < n_spikes; ) {
+		uint64_t deadline = spike_injector_deadline( &injector );
+
+		// the next spike, or a part-filled message that has waited long enough
+		sleep_until( start + (uint64_t) due < deadline ? start + (uint64_t) due : deadline );
+
+		uint64_t now = now_ns() - start, n = 0;
+
+		while( i < n_spikes && due <= now && n < READ_EVENTS ) {
+			uint32_t neuron = i % config->n_neurons;
+
+			if( !push_stamp( &matcher.queues[neuron], start_realtime + (uint64_t) due ) ) {
+				fprintf( stderr, "out of memory\n" );
+				exit( 1 );
+				}
+			keys[n++] = ( INJECT_PREFIX << 16 ) | neuron;
+			i++;
+
+			// xorshift32
+			random ^= random << 13;
+			random ^= random >> 17;
+			random ^= random << 5;
+			due -= log( ( random + 1.0 ) / 4294967297.0 ) * 1e9 / rate;
+			}
+		spike_injector_send( &injector, keys, n );
+
+		match( &matcher, events, spike_reader_poll( &reader, events, READ_EVENTS ) );
+		}
+	spike_injector_flush( &injector );
+
+	// everything still to come is due within a few timesteps
+	uint64_t drain_until = now_ns() + 4 * time_step_us * 1000ULL + 100000000ULL;
+
+	while( now_ns() < drain_until )
+		match( &matcher, events, spike_reader_wait( &reader, events, READ_EVENTS, 10000000 ) );
+
+	board_emulator_stop( &board );
+	pthread_join( thread, NULL );
+
+	uint64_t n_lost = matcher.n_expired;
+
+	for( uint32_t n = 0; n < config->n_neurons; n++ ) {
+		n_lost += matcher.queues[n].count;
+		free( matcher.queues[n].times );
+		}
+
+	printf( "%6u %9.0f %5u %9llu %6.2f%% %6.2f%% %8llu", time_step_us, rate, injector.keys_per_message,
+			(unsigned long long) n_spikes, 100.0 * n_lost / ( n_spikes ? n_spikes : 1 ),
+			100.0 * matcher.n_merged / ( n_spikes ? n_spikes : 1 ), (unsigned long long) matcher.n_unmatched );
+
+	if( matcher.n_matched > 0 ) {
+		uint64_t* l = matcher.latencies;
+		uint64_t n = matcher.n_matched;
+
+		qsort( l, n, sizeof( uint64_t ), compare_uint64 );
+		printf( " %9.1f %9.1f %9.1f %9.1f\n", l[n * 50 / 100] / 1e3, l[n * 99 / 100] / 1e3,
+				l[n * 999 / 1000] / 1e3, l[n - 1] / 1e3 );
+		}
+	else
+		printf( " %9s %9s %9s %9s\n", "-", "-", "-", "-" );
+	fflush( stdout );
+
+	spike_injector_close( &injector );
+	board_emulator_close( &board );
+	spike_receiver_close( &receiver );
+	free( matcher.queues );
+	free( matcher.latencies );
+}
+
+
+static uint32_t parse_list( const char* text, double* values )
+{
+	uint32_t n = 0;
+
+	for( char* end; n < MAX_VALUES && *text; text = *end == ',' ? end + 1 : end ) {
+		values[n++] = strtod( text, &end );
+		if( end == text )
+			break;
+		}
+	return n;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [--seconds S] [--rates R,...] [--keys-per-message K,...] [--time-steps US,...]\n"
+			 "          [--neurons N] [--hop-latency NS] [--drop-rate P] [--max-hold US]\n"
+			 "          [--routing DIR --live-output-core P]\n"
+			 "  --seconds           per combination (default 2)\n"
+			 "  --rates             injected spikes per second (default 1000,10000,100000)\n"
+			 "  --keys-per-message  default 1,16,126\n"
+			 "  --time-steps        machineTimeStep in us (default 1000,100)\n"
+			 "  --neurons           injected neurons, taken in turn (default 2048)\n"
+			 "  --hop-latency       per router hop in ns (default 100)\n"
+			 "  --drop-rate         per hop (default 0)\n"
+			 "  --max-hold          longest a spike waits for its message to fill (default: one\n"
+			 "                      timestep; 0 waits for a full message)\n"
+			 "  --routing           routing_table_X_Y.rpt directory instead of the built-in table\n"
+			 "  --live-output-core  core of chip (0, 0) the tables route live output to (default 2;\n"
+			 "                      required with --routing)\n",
+			 name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	double				rates[MAX_VALUES] = { 1000, 10000, 100000 };
+	double				batches[MAX_VALUES] = { 1, 16, 126 };
+	double				time_steps[MAX_VALUES] = { 1000, 100 };
+	uint32_t			n_rates = 3, n_batches = 3, n_time_steps = 2;
+	const char*			routing_dir = NULL;
+	bench_config_t		config = { 2.0, 2048, 100, 0.0, BOARD_NO_CORE, 1, -1, NULL, 0 };
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--seconds" ) && i + 1 < argc )
+			config.seconds = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--rates" ) && i + 1 < argc )
+			n_rates = parse_list( argv[++i], rates );
+		else if( !strcmp( argv[i], "--keys-per-message" ) && i + 1 < argc )
+			n_batches = parse_list( argv[++i], batches );
+		else if( !strcmp( argv[i], "--time-steps" ) && i + 1 < argc )
+			n_time_steps = parse_list( argv[++i], time_steps );
+		else if( !strcmp( argv[i], "--neurons" ) && i + 1 < argc )
+			config.n_neurons = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--hop-latency" ) && i + 1 < argc )
+			config.hop_latency_ns = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--drop-rate" ) && i + 1 < argc )
+			config.drop_rate = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--max-hold" ) && i + 1 < argc )
+			config.max_hold_us = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--routing" ) && i + 1 < argc )
+			routing_dir = argv[++i];
+		else if( !strcmp( argv[i], "--live-output-core" ) && i + 1 < argc )
+			config.live_output_core = strtoul( argv[++i], NULL, 0 );
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( routing_dir == NULL && config.live_output_core == BOARD_NO_CORE )
+		config.live_output_core = 2;
+	if( config.n_neurons == 0 || config.n_neurons > BOARD_NEURONS || n_rates == 0 || n_batches == 0
+		|| n_time_steps == 0 || config.live_output_core >= BOARD_CORES ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	routing_entry_t entries[2] = {
+		{ SUBVERTEX_KEY( 0, 0, 0 ) | ( INJECT_PREFIX << 16 ), SUBVERTEX_MASK, ROUTE_CORE( 1 ), 0, 0, 1, 1 },
+		{ SUBVERTEX_KEY( 0, 0, 1 ), SUBVERTEX_MASK, ROUTE_CORE( config.live_output_core ), 0, 0, 1, 1 } };
+	routing_table_t builtin = { 0, 0, 2, entries };
+
+	if( routing_dir != NULL ) {
+		config.tables = read_routing_tables( routing_dir, &config.n_tables );
+		if( config.tables == NULL ) {
+			fprintf( stderr, "no routing_table_X_Y.rpt in %s\n", routing_dir );
+			return 1;
+			}
+		config.max_hops = 16;
+		}
+	else {
+		config.tables = &builtin;
+		config.n_tables = 1;
+		}
+
+	// wake for the next spike on time rather than up to 50 us late
+	prctl( PR_SET_TIMERSLACK, 1 );
+
+	printf( "latencies in us, %.1f s per combination, %u neurons\n", config.seconds, config.n_neurons );
+	printf( "%6s %9s %5s %9s %7s %7s %8s %9s %9s %9s %9s\n", "step", "spikes/s", "keys", "sent", "lost", "merged",
+			"other", "p50", "p99", "p99.9", "max" );
+
+	for( uint32_t t = 0; t < n_time_steps; t++ )
+		for( uint32_t r = 0; r < n_rates; r++ )
+			for( uint32_t b = 0; b < n_batches; b++ )
+				run_case( &config, rates[r], batches[b], time_steps[t] );
+
+	if( routing_dir != NULL )
+		free_routing_tables( config.tables, config.n_tables );
+
+	return 0;
+}
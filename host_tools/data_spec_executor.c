@@ -0,0 +1,361 @@
+/*
+	Native data specification executor; see data_spec_executor.h.
+
+	Command word layout, as written by the data specification generator:
+
+		31:28	number of argument words that follow (0xF: WRITE_ARRAY)
+		27:20	opcode
+		19:0	command specific fields
+
+	Regions are built in one buffer per spec so the image is assembled with
+	a single copy per region.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "data_spec_executor.h"
+
+
+#define COMMAND_LENGTH( c )		( ( c ) >> 28 )
+#define COMMAND_OPCODE( c )		( ( ( c ) >> 20 ) & 0xFF )
+
+// RESERVE
+#define RESERVE_REGION( c )		( ( c ) & 0x1F )
+#define RESERVE_UNFILLED		( 1 << 7 )
+
+// SWITCH_FOCUS
+#define FOCUS_REGION( c )		( ( ( c ) >> 8 ) & 0xF )
+
+// WRITE
+#define WRITE_DATA_BYTES( c )	( 1u << ( ( ( c ) >> 12 ) & 0x3 ) )
+#define WRITE_REPEATS_IN_REG	( 1 << 16 )
+#define WRITE_DATA_IN_REG		( 1 << 17 )
+#define WRITE_DATA_REG( c )		( ( ( c ) >> 8 ) & 0xF )
+#define WRITE_REPEATS_REG( c )	( ( ( c ) >> 4 ) & 0xF )
+#define WRITE_REPEATS( c )		( ( c ) & 0xFF )
+
+// MV
+#define MV_DEST_REG( c )		( ( ( c ) >> 12 ) & 0xF )
+
+
+typedef struct {
+	uint8_t*	data;
+	uint32_t	size;
+	uint32_t	write_pointer;
+	bool		reserved;
+	bool		unfilled;
+} region_state_t;
+
+
+static dse_status_t region_write( region_state_t* region, const void* data, uint32_t n_bytes )
+{
+	if( region->write_pointer + (uint64_t) n_bytes > region->size )
+		return DSE_REGION_OVERFLOW;
+
+	memcpy( region->data + region->write_pointer, data, n_bytes );
+	region->write_pointer += n_bytes;
+
+	return DSE_OK;
+}
+
+
+static dse_status_t region_write_repeated( region_state_t* region, uint64_t value,
+										   uint32_t data_bytes, uint32_t repeats )
+{
+	uint64_t total = (uint64_t) data_bytes * repeats;
+
+	if( region->write_pointer + total > region->size )
+		return DSE_REGION_OVERFLOW;
+
+	uint8_t* p = region->data + region->write_pointer;
+
+	// little endian host: the low data_bytes of value are the datum
+	if( data_bytes == 1 )
+		memset( p, (uint8_t) value, repeats );
+	else
+		for( uint32_t r = 0; r < repeats; r++, p += data_bytes )
+			memcpy( p, &value, data_bytes );
+
+	region->write_pointer += total;
+
+	return DSE_OK;
+}
+
+
+static dse_status_t run_commands( const uint32_t* spec, uint32_t n_words, region_state_t* regions )
+{
+	uint32_t	registers[DSE_MAX_REGISTERS] = { 0 };
+	int32_t		focus = -1;
+	uint32_t	i = 0;
+
+	while( i < n_words ) {
+		uint32_t c = spec[i];
+		uint32_t n_arguments = COMMAND_LENGTH( c );
+		dse_status_t status = DSE_OK;
+
+		if( COMMAND_OPCODE( c ) != DSE_WRITE_ARRAY && i + n_arguments >= n_words )
+			return DSE_TRUNCATED;
+
+		switch( COMMAND_OPCODE( c ) ) {
+
+		case DSE_RESERVE: {
+			uint32_t id = RESERVE_REGION( c );
+
+			if( id >= DSE_MAX_REGIONS || regions[id].reserved )
+				return DSE_BAD_REGION;
+
+			regions[id].size = spec[i + 1];
+			regions[id].reserved = true;
+			regions[id].unfilled = ( c & RESERVE_UNFILLED ) != 0;
+			regions[id].write_pointer = 0;
+			regions[id].data = calloc( 1, regions[id].size ? regions[id].size : 1 );
+			if( regions[id].data == NULL )
+				return DSE_NO_MEMORY;
+			break;
+			}
+
+		case DSE_SWITCH_FOCUS:
+			focus = FOCUS_REGION( c );
+			if( !regions[focus].reserved )
+				return DSE_BAD_REGION;
+			break;
+
+		case DSE_WRITE: {
+			if( focus < 0 )
+				return DSE_NO_FOCUS;
+
+			uint32_t data_bytes = WRITE_DATA_BYTES( c );
+			uint32_t repeats = ( c & WRITE_REPEATS_IN_REG ) ? registers[WRITE_REPEATS_REG( c )]
+															: WRITE_REPEATS( c );
+			uint64_t value;
+
+			if( c & WRITE_DATA_IN_REG )
+				value = registers[WRITE_DATA_REG( c )];
+			else if( data_bytes == 8 )
+				value = spec[i + 1] | ( (uint64_t) spec[i + 2] << 32 );
+			else
+				value = spec[i + 1];
+
+			status = region_write_repeated( &regions[focus], value, data_bytes, repeats );
+			break;
+			}
+
+		case DSE_WRITE_ARRAY: {
+			if( focus < 0 )
+				return DSE_NO_FOCUS;
+			if( i + 1 >= n_words )
+				return DSE_TRUNCATED;
+
+			// the length word counts itself
+			uint32_t n = spec[i + 1];
+
+			if( n == 0 || i + 1 + (uint64_t) n > n_words )
+				return DSE_TRUNCATED;
+
+			status = region_write( &regions[focus], &spec[i + 2], ( n - 1 ) * sizeof( uint32_t ) );
+			if( status != DSE_OK )
+				return status;
+
+			i += 1 + n;
+			continue;
+			}
+
+		case DSE_MV:
+			registers[MV_DEST_REG( c )] = spec[i + 1];
+			break;
+
+		case DSE_SET_WR_PTR:
+			if( focus < 0 )
+				return DSE_NO_FOCUS;
+			if( spec[i + 1] > regions[focus].size )
+				return DSE_REGION_OVERFLOW;
+			regions[focus].write_pointer = spec[i + 1];
+			break;
+
+		case DSE_END_SPEC:
+			return DSE_OK;
+
+		default:
+			return DSE_UNKNOWN_COMMAND;
+			}
+
+		if( status != DSE_OK )
+			return status;
+
+		i += 1 + n_arguments;
+		}
+
+	// specs always finish with END_SPEC
+	return DSE_TRUNCATED;
+}
+
+
+static dse_status_t build_image( region_state_t* regions, app_data_image_t* image )
+{
+	uint32_t offset = APP_DATA_HEADER_BYTES;
+	uint32_t image_size = APP_DATA_HEADER_BYTES;
+
+	memset( image, 0, sizeof( *image ) );
+
+	// the image stops after the last filled region; unfilled ones in
+	// between are left as zeros
+	for( uint32_t id = 0; id < DSE_MAX_REGIONS; id++ ) {
+		if( !regions[id].reserved )
+			continue;
+
+		image->regions[id].size = regions[id].size;
+		image->regions[id].offset = offset;
+		image->regions[id].unfilled = regions[id].unfilled;
+
+		offset += regions[id].size;
+		if( !regions[id].unfilled )
+			image_size = offset;
+		}
+
+	image->memory_used = offset;
+	image->size = image_size;
+	image->data = calloc( 1, image_size );
+	if( image->data == NULL )
+		return DSE_NO_MEMORY;
+
+	uint32_t* header = (uint32_t*) image->data;
+
+	header[0] = APP_DATA_MAGIC_NUMBER;
+	header[1] = APP_DATA_VERSION;
+
+	for( uint32_t id = 0; id < DSE_MAX_REGIONS; id++ ) {
+		if( !regions[id].reserved )
+			continue;
+
+		header[2 + id] = image->regions[id].offset;
+		if( !regions[id].unfilled )
+			memcpy( image->data + image->regions[id].offset, regions[id].data, regions[id].size );
+		}
+
+	return DSE_OK;
+}
+
+
+dse_status_t dse_execute( const uint32_t* spec, uint32_t n_words, app_data_image_t* image )
+{
+	region_state_t regions[DSE_MAX_REGIONS];
+
+	memset( regions, 0, sizeof( regions ) );
+	memset( image, 0, sizeof( *image ) );
+
+	dse_status_t status = run_commands( spec, n_words, regions );
+
+	if( status == DSE_OK )
+		status = build_image( regions, image );
+
+	for( uint32_t id = 0; id < DSE_MAX_REGIONS; id++ )
+		free( regions[id].data );
+
+	return status;
+}
+
+
+void app_data_image_free( app_data_image_t* image )
+{
+	free( image->data );
+	image->data = NULL;
+	image->size = 0;
+}
+
+
+uint8_t* dse_read_file( const char* path, uint32_t* size )
+{
+	FILE* f = fopen( path, "rb" );
+
+	if( f == NULL )
+		return NULL;
+
+	fseek( f, 0, SEEK_END );
+	long length = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	uint8_t* data = length >= 0 ? malloc( length ? length : 1 ) : NULL;
+
+	if( data && fread( data, 1, length, f ) != (size_t) length ) {
+		free( data );
+		data = NULL;
+		}
+	fclose( f );
+
+	if( data )
+		*size = length;
+
+	return data;
+}
+
+
+dse_status_t dse_execute_file( const char* spec_path, const char* app_data_path,
+							   app_data_image_t* image )
+{
+	uint32_t size;
+	uint8_t* spec = dse_read_file( spec_path, &size );
+
+	if( spec == NULL )
+		return DSE_IO_ERROR;
+
+	dse_status_t status = dse_execute( (const uint32_t*) spec, size / sizeof( uint32_t ), image );
+
+	free( spec );
+
+	if( status != DSE_OK || app_data_path == NULL )
+		return status;
+
+	return dse_write_image( app_data_path, image );
+}
+
+
+dse_status_t dse_write_image( const char* app_data_path, const app_data_image_t* image )
+{
+	dse_status_t status = DSE_OK;
+	FILE* f = fopen( app_data_path, "wb" );
+
+	if( f == NULL || fwrite( image->data, 1, image->size, f ) != image->size )
+		status = DSE_IO_ERROR;
+	if( f && fclose( f ) != 0 )
+		status = DSE_IO_ERROR;
+
+	return status;
+}
+
+
+char* dse_app_data_path( const char* spec_path )
+{
+	const char* base = strrchr( spec_path, '/' );
+	const char* tag = strstr( base ? base : spec_path, "dataSpec" );
+
+	if( tag == NULL )
+		return NULL;
+
+	// "appData" is one character shorter than "dataSpec"
+	size_t prefix = tag - spec_path;
+	char* path = malloc( strlen( spec_path ) );
+
+	memcpy( path, spec_path, prefix );
+	strcpy( path + prefix, "appData" );
+	strcat( path, tag + strlen( "dataSpec" ) );
+
+	return path;
+}
+
+
+const char* dse_status_string( dse_status_t status )
+{
+	switch( status ) {
+	case DSE_OK:				return "ok";
+	case DSE_TRUNCATED:			return "spec truncated";
+	case DSE_UNKNOWN_COMMAND:	return "unsupported command";
+	case DSE_NO_FOCUS:			return "write with no region in focus";
+	case DSE_BAD_REGION:		return "bad region";
+	case DSE_REGION_OVERFLOW:	return "write past end of region";
+	case DSE_NO_MEMORY:			return "out of memory";
+	case DSE_IO_ERROR:			return "I/O error";
+		}
+	return "unknown status";
+}
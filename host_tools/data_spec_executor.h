@@ -0,0 +1,99 @@
+/*! \file
+ *
+ *  \brief Native executor for the data specifications written by the
+ *    host (the *_dataSpec_X_Y_P.dat files).
+ *
+ *  \details Runs the command stream of one core's spec and lays the
+ *    reserved regions out exactly as the Python executor does for the
+ *    *_appData_X_Y_P.dat image: a two word header, a table of 16 region
+ *    offsets (0 when unused), then the regions in id order.  Unfilled
+ *    regions take up address space but are not part of the image.
+ *
+ *    Only the commands the partitioned vertices emit are supported;
+ *    anything else stops execution with DSE_UNKNOWN_COMMAND.
+ *
+ */
+
+#ifndef __DATA_SPEC_EXECUTOR_H__
+#define __DATA_SPEC_EXECUTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DSE_MAX_REGIONS			16
+#define DSE_MAX_REGISTERS		16
+
+#define APP_DATA_MAGIC_NUMBER	0xAD130AD6
+#define APP_DATA_VERSION		0x00010000
+#define APP_DATA_HEADER_BYTES	( ( 2 + DSE_MAX_REGIONS ) * sizeof( uint32_t ) )
+
+//! \brief Data specification command opcodes (bits 27:20 of a command)
+typedef enum {
+	DSE_RESERVE			= 0x02,
+	DSE_WRITE			= 0x41,
+	DSE_WRITE_ARRAY		= 0x42,
+	DSE_SWITCH_FOCUS	= 0x50,
+	DSE_MV				= 0x60,
+	DSE_SET_WR_PTR		= 0x64,
+	DSE_END_SPEC		= 0xFF
+} dse_command_t;
+
+typedef enum {
+	DSE_OK = 0,
+	DSE_TRUNCATED,				//!< the spec ends inside a command
+	DSE_UNKNOWN_COMMAND,
+	DSE_NO_FOCUS,				//!< write before any SWITCH_FOCUS
+	DSE_BAD_REGION,				//!< region not reserved or reserved twice
+	DSE_REGION_OVERFLOW,		//!< write past the end of the region
+	DSE_NO_MEMORY,
+	DSE_IO_ERROR
+} dse_status_t;
+
+//! \brief A region as laid out in the image
+typedef struct {
+	uint32_t	size;			//!< bytes reserved, 0 if not reserved
+	uint32_t	offset;			//!< from the start of the image
+	bool		unfilled;
+} dse_region_t;
+
+//! \brief The result of executing one spec
+typedef struct {
+	uint8_t*		data;		//!< header, offset table and filled regions
+	uint32_t		size;		//!< bytes of data
+	uint32_t		memory_used;	//!< header plus every reserved region
+	dse_region_t	regions[DSE_MAX_REGIONS];
+} app_data_image_t;
+
+
+//! \brief Executes a spec held in memory.
+//! \param[in] spec The command words
+//! \param[in] n_words Number of words in spec
+//! \param[out] image Filled in on DSE_OK; release with app_data_image_free()
+//! \return DSE_OK or the reason execution stopped
+
+dse_status_t dse_execute( const uint32_t* spec, uint32_t n_words, app_data_image_t* image );
+
+void app_data_image_free( app_data_image_t* image );
+
+//! \brief Reads a spec file, executes it and, if app_data_path is not NULL,
+//! writes the image there.
+
+dse_status_t dse_execute_file( const char* spec_path, const char* app_data_path,
+							   app_data_image_t* image );
+
+//! \brief Writes an image to app_data_path.
+
+dse_status_t dse_write_image( const char* app_data_path, const app_data_image_t* image );
+
+//! \brief Reads a whole file into a malloc'ed buffer; NULL on failure.
+
+uint8_t* dse_read_file( const char* path, uint32_t* size );
+
+//! \brief The appData path matching a dataSpec path, or NULL if the name
+//! does not contain "dataSpec".  The caller frees the result.
+
+char* dse_app_data_path( const char* spec_path );
+
+const char* dse_status_string( dse_status_t status );
+
+#endif /*__DATA_SPEC_EXECUTOR_H__*/
@@ -0,0 +1,128 @@
+/*
+	EIEIO data message encoding and decoding; see eieio.h.
+*/
+
+#include <string.h>
+
+#include "eieio.h"
+
+
+static inline uint32_t header_bytes( const eieio_format_t* format )
+{
+	return format->prefix_type == EIEIO_NO_PREFIX ? 2 : 4;
+}
+
+
+static inline uint32_t key_bytes( eieio_type_t type )
+{
+	return type == EIEIO_KEY_16_BIT || type == EIEIO_KEY_PAYLOAD_16_BIT ? 2 : 4;
+}
+
+
+uint32_t eieio_max_keys( const eieio_format_t* format )
+{
+	uint32_t n = ( EIEIO_MAX_MESSAGE_BYTES - header_bytes( format ) ) / key_bytes( format->type );
+
+	return n < EIEIO_MAX_COUNT ? n : EIEIO_MAX_COUNT;
+}
+
+
+uint32_t eieio_encode( const eieio_format_t* format, const uint32_t* keys, uint32_t n_keys, uint8_t* message )
+{
+	uint32_t max_keys = eieio_max_keys( format );
+	uint16_t header;
+	uint8_t* p = message;
+
+	if( n_keys > max_keys )
+		n_keys = max_keys;
+
+	header = ( format->type << 10 ) | ( ( format->tag & 3 ) << 8 ) | n_keys;
+	if( format->prefix_type != EIEIO_NO_PREFIX )
+		header |= EIEIO_PREFIX | ( format->prefix_type == EIEIO_UPPER_HALF_WORD ? EIEIO_PREFIX_UPPER : 0 );
+
+	*p++ = header;
+	*p++ = header >> 8;
+	if( format->prefix_type != EIEIO_NO_PREFIX ) {
+		*p++ = format->prefix;
+		*p++ = format->prefix >> 8;
+		}
+
+	if( key_bytes( format->type ) == 2 ) {
+		uint32_t shift = format->prefix_type == EIEIO_LOWER_HALF_WORD ? 16 : 0;
+
+		for( uint32_t i = 0; i < n_keys; i++ ) {
+			uint16_t key = keys[i] >> shift;
+
+			*p++ = key;
+			*p++ = key >> 8;
+			}
+		}
+	else {
+		// the host is little endian, like the wire format
+		memcpy( p, keys, n_keys * sizeof( uint32_t ) );
+		p += n_keys * sizeof( uint32_t );
+		}
+
+	return p - message;
+}
+
+
+static inline uint32_t read16( const uint8_t* p )
+{
+	return p[0] | ( p[1] << 8 );
+}
+
+
+static inline uint32_t read32( const uint8_t* p )
+{
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (uint32_t) p[3] << 24 );
+}
+
+
+int eieio_decode( const uint8_t* message, uint32_t length, eieio_event_t* events, uint32_t max_events )
+{
+	if( length < 2 )
+		return -1;
+
+	uint32_t header = read16( message );
+	uint32_t type = EIEIO_TYPE( header ), count = EIEIO_COUNT( header );
+	uint32_t size = key_bytes( type );
+	bool with_payload = type == EIEIO_KEY_PAYLOAD_16_BIT || type == EIEIO_KEY_PAYLOAD_32_BIT;
+	uint32_t event_bytes = with_payload ? 2 * size : size;
+	uint32_t key_prefix = 0, payload_prefix = 0, offset = 2;
+	bool upper = header & EIEIO_PREFIX_UPPER;
+
+	// commands have 01 in the top two bits
+	if( ( header & 0xC000 ) == 0x4000 )
+		return -1;
+
+	if( header & EIEIO_PREFIX ) {
+		if( length < offset + 2 )
+			return -1;
+		key_prefix = read16( message + offset );
+		offset += 2;
+		}
+	if( header & EIEIO_PAYLOAD_PREFIX ) {
+		if( length < offset + size )
+			return -1;
+		payload_prefix = size == 2 ? read16( message + offset ) : read32( message + offset );
+		offset += size;
+		}
+
+	if( length < offset + count * event_bytes || count > max_events )
+		return -1;
+
+	const uint8_t* p = message + offset;
+
+	for( uint32_t i = 0; i < count; i++, p += event_bytes ) {
+		uint32_t key = size == 2 ? read16( p ) : read32( p );
+
+		if( header & EIEIO_PREFIX )
+			key = upper ? key | ( key_prefix << 16 ) : ( key << 16 ) | key_prefix;
+		events[i].key = key;
+		events[i].payload = with_payload ? ( size == 2 ? read16( p + 2 ) : read32( p + 4 ) ) | payload_prefix
+										 : payload_prefix;
+		}
+
+	return count;
+}
@@ -0,0 +1,87 @@
+/*! \file
+ *
+ *  \brief EIEIO data messages, as sent to a reverse IP tag (injection) and
+ *    received from a stripped IP tag (live output).
+ *
+ *  \details A message is a 16-bit little-endian header
+ *
+ *      bit 15      P: a 16-bit key prefix follows the header
+ *      bit 14      F: prefix type, 0 lower half-word, 1 upper half-word
+ *      bit 13      D: a payload prefix follows
+ *      bit 12      T: payloads are timestamps
+ *      bits 11:10  type: 16-bit key, 16-bit key + payload, 32-bit key,
+ *                  32-bit key + payload
+ *      bits 9:8    tag
+ *      bits 7:0    count of events
+ *
+ *    then the key prefix, the payload prefix (16 or 32 bits with the key
+ *    size) and count little-endian events.  With an upper half-word
+ *    prefix a 16-bit key k stands for ( prefix << 16 ) | k, with a lower
+ *    half-word prefix for ( k << 16 ) | prefix.
+ *
+ */
+
+#ifndef __EIEIO_H__
+#define __EIEIO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Largest message the board takes from a reverse IP tag
+#define EIEIO_MAX_MESSAGE_BYTES		256
+#define EIEIO_MAX_COUNT				255
+
+#define EIEIO_PREFIX				( 1 << 15 )
+#define EIEIO_PREFIX_UPPER			( 1 << 14 )
+#define EIEIO_PAYLOAD_PREFIX		( 1 << 13 )
+#define EIEIO_TIMESTAMPS			( 1 << 12 )
+#define EIEIO_TYPE( header )		( ( ( header ) >> 10 ) & 3 )
+#define EIEIO_TAG( header )			( ( ( header ) >> 8 ) & 3 )
+#define EIEIO_COUNT( header )		( ( header ) & 0xFF )
+
+typedef enum {
+	EIEIO_KEY_16_BIT = 0,
+	EIEIO_KEY_PAYLOAD_16_BIT,
+	EIEIO_KEY_32_BIT,
+	EIEIO_KEY_PAYLOAD_32_BIT
+} eieio_type_t;
+
+typedef enum {
+	EIEIO_NO_PREFIX = 0,
+	EIEIO_LOWER_HALF_WORD,
+	EIEIO_UPPER_HALF_WORD
+} eieio_prefix_type_t;
+
+//! \brief How keys are packed into messages.
+typedef struct {
+	eieio_type_t			type;			//!< EIEIO_KEY_16_BIT or EIEIO_KEY_32_BIT
+	eieio_prefix_type_t		prefix_type;
+	uint16_t				prefix;
+	uint8_t					tag;
+} eieio_format_t;
+
+//! \brief One decoded event.
+typedef struct {
+	uint32_t	key;
+	uint32_t	payload;		//!< 0 for types without payloads
+} eieio_event_t;
+
+
+//! \brief Keys that fit one message of the given format.
+
+uint32_t eieio_max_keys( const eieio_format_t* format );
+
+//! \brief Packs up to eieio_max_keys() keys into one message.  With a
+//! 16-bit type only the low (upper prefix) or high (lower prefix) half of
+//! each key is sent, so every key must carry the format's prefix.
+//! \return The message length in bytes
+
+uint32_t eieio_encode( const eieio_format_t* format, const uint32_t* keys, uint32_t n_keys, uint8_t* message );
+
+//! \brief Decodes the events of one data message, applying the prefixes.
+//! \return The number of events, or -1 if the message is malformed or a
+//!   command
+
+int eieio_decode( const uint8_t* message, uint32_t length, eieio_event_t* events, uint32_t max_events );
+
+#endif /*__EIEIO_H__*/
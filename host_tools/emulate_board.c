@@ -0,0 +1,170 @@
+/*
+	Local stand-in for a board's live I/O (board_emulator.c), so that the
+	injection and live output scripts can run without 192.168.240.253.
+
+		emulate_board --live-output-core P [--time-step US] [--hop-latency NS]
+					  [--drop-rate P] [--max-hops N] [--live-output-host H]
+					  [--live-output-port P]... [--input-port P] [--seconds S]
+					  [--seed N] routing_dir
+
+	routes the keys sent to the reverse IP tag port (12345) through
+	routing_dir/routing_table_X_Y.rpt and sends the packets the tables
+	route to core P of chip (0, 0), the live packet gatherer's, to the
+	live output ports (18250 by default, as receiver.py; the
+	live_spike_port of pacman.cfg is 17895).  P is required: it is the
+	core placement_by_core.rpt gives the LivePacketGather vertex.  For the
+	tables the tool chain picked for a run with live output:
+
+		python picked_routing_tables.py ../application_generated_data_files/latest picked
+		emulate_board --live-output-core P picked
+
+	then point the scripts at localhost.  Runs until interrupted or for
+	--seconds, then prints what it did.
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "board_emulator.h"
+#include "routing_table.h"
+
+
+static board_emulator_t board;
+
+
+static void interrupted( int signal )
+{
+	board_emulator_stop( &board );
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s --live-output-core P [--time-step US] [--hop-latency NS] [--drop-rate P]\n"
+			 "          [--max-hops N] [--live-output-host H] [--live-output-port P]...\n"
+			 "          [--input-port P] [--seconds S] [--seed N] routing_dir\n"
+			 "  --time-step         machineTimeStep in us (default 1000)\n"
+			 "  --hop-latency       per router hop in ns (default 100)\n"
+			 "  --drop-rate         chance of losing a packet at each hop (default 0)\n"
+			 "  --max-hops          cores a spike is relayed through (default 16)\n"
+			 "  --live-output-core  live packet gatherer's core on chip (0, 0): the packets the\n"
+			 "                      tables route to it go to the host (required)\n"
+			 "  --live-output-host  default 127.0.0.1\n"
+			 "  --live-output-port  default 18250, up to %u\n"
+			 "  --input-port        reverse IP tag port (default 12345)\n",
+			 name, BOARD_MAX_LIVE_OUTPUTS );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	board_config_t		config;
+	const char*			routing_dir = NULL;
+	double				seconds = 0.0;
+	uint32_t			n_ports = 0;
+
+	board_config_defaults( &config );
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--time-step" ) && i + 1 < argc )
+			config.time_step_us = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--hop-latency" ) && i + 1 < argc )
+			config.hop_latency_ns = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--drop-rate" ) && i + 1 < argc )
+			config.drop_rate = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--max-hops" ) && i + 1 < argc )
+			config.max_hops = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--live-output-core" ) && i + 1 < argc )
+			config.live_output_core = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--live-output-host" ) && i + 1 < argc )
+			config.live_output_host = argv[++i];
+		else if( !strcmp( argv[i], "--live-output-port" ) && i + 1 < argc && n_ports < BOARD_MAX_LIVE_OUTPUTS )
+			config.live_output_ports[n_ports++] = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--input-port" ) && i + 1 < argc )
+			config.input_port = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--seconds" ) && i + 1 < argc )
+			seconds = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--seed" ) && i + 1 < argc )
+			config.seed = strtoul( argv[++i], NULL, 0 );
+		else if( argv[i][0] != '-' && routing_dir == NULL )
+			routing_dir = argv[i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( routing_dir == NULL || config.time_step_us == 0 || config.max_hops > 255
+		|| config.live_output_core >= BOARD_CORES ) {
+		usage( argv[0] );
+		return 1;
+		}
+	if( n_ports > 0 )
+		config.n_live_output_ports = n_ports;
+
+	uint32_t n_tables;
+	routing_table_t* tables = read_routing_tables( routing_dir, &n_tables );
+
+	if( tables == NULL ) {
+		fprintf( stderr, "no routing_table_X_Y.rpt in %s\n", routing_dir );
+		return 1;
+		}
+	if( !board_emulator_open( &board, &config, tables, n_tables ) ) {
+		fprintf( stderr, "cannot listen on port %u or reach %s\n", config.input_port, config.live_output_host );
+		free_routing_tables( tables, n_tables );
+		return 1;
+		}
+	free_routing_tables( tables, n_tables );
+
+	printf( "%u chip%s, listening on %u, live output to %s:", board.n_chips, board.n_chips == 1 ? "" : "s",
+			board.input_port, config.live_output_host );
+	for( uint32_t o = 0; o < board.config.n_live_output_ports; o++ )
+		printf( "%s%u", o ? "," : "", board.config.live_output_ports[o] );
+	printf( "\n" );
+	fflush( stdout );
+
+	signal( SIGINT, interrupted );
+	signal( SIGTERM, interrupted );
+
+	double start = now_ns();
+
+	board_emulator_run( &board, seconds * 1e9 );
+
+	double elapsed = ( now_ns() - start ) / 1e9;
+	uint64_t send_errors = 0;
+
+	for( uint32_t o = 0; o < board.config.n_live_output_ports; o++ )
+		send_errors += board.outputs[o].n_send_errors;
+
+	printf( "%.1f s, %llu ticks (%llu late)\n", elapsed, (unsigned long long) board.n_ticks,
+			(unsigned long long) board.n_late_ticks );
+	printf( "in:      %llu keys in %llu datagrams (%.0f keys/s), %llu malformed\n",
+			(unsigned long long) board.n_injected, (unsigned long long) board.n_datagrams,
+			board.n_injected / elapsed, (unsigned long long) board.n_malformed );
+	printf( "routed:  %llu lookups, %llu dropped, %llu unrouted\n", (unsigned long long) board.n_routed,
+			(unsigned long long) board.n_dropped, (unsigned long long) board.n_unrouted );
+	printf( "fired:   %llu spikes, %llu not sent on after %u hops\n", (unsigned long long) board.n_fired,
+			(unsigned long long) board.n_hop_limited, board.config.max_hops );
+	printf( "out:     %llu keys (%.0f keys/s), %llu messages not sent\n", (unsigned long long) board.n_live_output,
+			board.n_live_output / elapsed, (unsigned long long) send_errors );
+
+	board_emulator_close( &board );
+
+	return 0;
+}
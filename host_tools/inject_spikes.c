@@ -0,0 +1,297 @@
+/*
+	Native live spike injector (spike_injector.c), in place of one
+	send_eieio_message() per spike from injector.py.
+
+		inject_spikes [--host H] [--port P] [--type 16|32] [--prefix N]
+					  [--prefix-type upper|lower] [--keys-per-message K]
+					  [--batch B] [--rate R] [--count N] KEY[:N]...
+
+	sends the keys given (KEY:N is N consecutive keys from KEY), cycling
+	through them until --count spikes have gone.  For the
+	ReverseIpTagMultiCastSource of synfire_inject.py (virtual key 458752,
+	prefix 7, UPPER_HALF_WORD):
+
+		inject_spikes --type 16 --prefix 7 --prefix-type upper 0x70000:100
+
+		inject_spikes --bench [--spikes N]
+
+	sends N spikes to a local UDP sink for each of several packings and
+	batch sizes and reports messages/s, spikes/s and the fraction the sink
+	received, then checks the rate control.
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "eieio.h"
+#include "spike_injector.h"
+
+
+#define SINK_BATCH			64
+#define SOCKET_BUFFER_BYTES	( 8 << 20 )
+
+typedef struct {
+	int					fd;
+	uint16_t			port;
+	volatile bool		stop;
+	volatile uint64_t	n_messages;
+	volatile uint64_t	n_spikes;
+} sink_t;
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void* sink_thread( void* arg )
+{
+	sink_t* sink = arg;
+	static uint8_t buffers[SINK_BATCH][EIEIO_MAX_MESSAGE_BYTES];
+	static eieio_event_t events[EIEIO_MAX_COUNT];
+	struct mmsghdr headers[SINK_BATCH];
+	struct iovec iov[SINK_BATCH];
+
+	memset( headers, 0, sizeof( headers ) );
+	for( uint32_t m = 0; m < SINK_BATCH; m++ ) {
+		iov[m].iov_base = buffers[m];
+		iov[m].iov_len = EIEIO_MAX_MESSAGE_BYTES;
+		headers[m].msg_hdr.msg_iov = &iov[m];
+		headers[m].msg_hdr.msg_iovlen = 1;
+		}
+
+	while( !sink->stop ) {
+		int n = recvmmsg( sink->fd, headers, SINK_BATCH, MSG_WAITFORONE, NULL );
+
+		for( int m = 0; m < n; m++ ) {
+			int n_events = eieio_decode( buffers[m], headers[m].msg_len, events, EIEIO_MAX_COUNT );
+
+			sink->n_messages++;
+			if( n_events > 0 )
+				sink->n_spikes += n_events;
+			}
+		}
+
+	return NULL;
+}
+
+
+static bool open_sink( sink_t* sink )
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof( address );
+	struct timeval timeout = { 0, 100000 };
+	int buffer = SOCKET_BUFFER_BYTES;
+
+	memset( sink, 0, sizeof( sink_t ) );
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+	sink->fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	if( sink->fd < 0 || bind( sink->fd, (struct sockaddr*) &address, sizeof( address ) ) < 0
+		|| getsockname( sink->fd, (struct sockaddr*) &address, &length ) < 0 )
+		return false;
+
+	setsockopt( sink->fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof( buffer ) );
+	setsockopt( sink->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+	sink->port = ntohs( address.sin_port );
+
+	return true;
+}
+
+
+static void bench_case( sink_t* sink, const char* name, const eieio_format_t* format,
+						uint32_t keys_per_message, uint32_t batch, double rate, uint32_t n_spikes )
+{
+	spike_injector_t injector;
+	uint32_t keys[4096];
+
+	if( !spike_injector_open( &injector, "127.0.0.1", sink->port, format, keys_per_message, batch, rate ) ) {
+		fprintf( stderr, "cannot open the injector\n" );
+		return;
+		}
+
+	for( uint32_t k = 0; k < 4096; k++ )
+		keys[k] = ( (uint32_t) format->prefix << 16 ) | k;
+
+	uint64_t messages_before = sink->n_messages, spikes_before = sink->n_spikes;
+	double start = now_ns();
+
+	for( uint32_t sent = 0; sent < n_spikes; sent += 4096 )
+		spike_injector_send( &injector, keys, n_spikes - sent < 4096 ? n_spikes - sent : 4096 );
+	spike_injector_flush( &injector );
+
+	double seconds = ( now_ns() - start ) / 1e9;
+
+	// let the sink drain
+	usleep( 200000 );
+
+	printf( "%-24s %5u %6u %12.0f %12.0f %9.2f%%\n", name, injector.keys_per_message, injector.batch,
+			injector.n_messages / seconds, injector.n_spikes / seconds,
+			100.0 * ( sink->n_spikes - spikes_before ) / injector.n_spikes );
+	if( sink->n_messages - messages_before < injector.n_messages * 0.5 )
+		printf( "  (the sink fell behind; the send rate is what matters)\n" );
+
+	spike_injector_close( &injector );
+}
+
+
+static int bench( uint32_t n_spikes )
+{
+	sink_t sink;
+	pthread_t thread;
+	eieio_format_t key16 = { EIEIO_KEY_16_BIT, EIEIO_UPPER_HALF_WORD, 7, 0 };
+	eieio_format_t key32 = { EIEIO_KEY_32_BIT, EIEIO_NO_PREFIX, 7, 0 };
+
+	if( !open_sink( &sink ) || pthread_create( &thread, NULL, sink_thread, &sink ) != 0 ) {
+		fprintf( stderr, "cannot open a local UDP sink\n" );
+		return 1;
+		}
+
+	printf( "%u spikes to 127.0.0.1:%u\n", n_spikes, sink.port );
+	printf( "%-24s %5s %6s %12s %12s %10s\n", "format", "keys", "batch", "messages/s", "spikes/s", "received" );
+
+	// one key per datagram and one syscall per datagram, as injector.py
+	bench_case( &sink, "16-bit, upper prefix", &key16, 1, 1, 0.0, n_spikes / 10 );
+	bench_case( &sink, "16-bit, upper prefix", &key16, 1, 64, 0.0, n_spikes / 10 );
+	bench_case( &sink, "16-bit, upper prefix", &key16, 0, 1, 0.0, n_spikes );
+	bench_case( &sink, "16-bit, upper prefix", &key16, 0, 64, 0.0, n_spikes );
+	bench_case( &sink, "32-bit", &key32, 0, 1, 0.0, n_spikes );
+	bench_case( &sink, "32-bit", &key32, 0, 64, 0.0, n_spikes );
+
+	// rate control: a target of 100k spikes/s for about a second
+	printf( "rate control, 100000 spikes/s target:\n" );
+	bench_case( &sink, "16-bit, upper prefix", &key16, 0, 4, 100000.0, 100000 );
+
+	sink.stop = true;
+	pthread_join( thread, NULL );
+	close( sink.fd );
+
+	return 0;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [--host H] [--port P] [--type 16|32] [--prefix N] [--prefix-type upper|lower]\n"
+			 "          [--keys-per-message K] [--batch B] [--rate R] [--count N] KEY[:N]...\n"
+			 "       %s --bench [--spikes N]\n"
+			 "  --host              board address (default 192.168.240.253)\n"
+			 "  --port              reverse IP tag port (default 12345)\n"
+			 "  --type              key size (default 32)\n"
+			 "  --prefix            16-bit key prefix, with --prefix-type\n"
+			 "  --keys-per-message  default: as many as fit\n"
+			 "  --batch             messages per sendmmsg (default 16)\n"
+			 "  --rate              spikes per second (default: as fast as possible)\n"
+			 "  --count             spikes to send (default: each key once)\n"
+			 "  --bench             benchmark against a local UDP sink\n",
+			 name, name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	const char*		host = "192.168.240.253";
+	uint32_t		port = REVERSE_IP_TAG_PORT, keys_per_message = 0, batch = 16, count = 0;
+	uint32_t		bench_spikes = 2000000;
+	double			rate = 0.0;
+	eieio_format_t	format = { EIEIO_KEY_32_BIT, EIEIO_NO_PREFIX, 0, 0 };
+	bool			run_bench = false;
+	uint32_t*		keys = NULL;
+	uint32_t		n_keys = 0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--host" ) && i + 1 < argc )
+			host = argv[++i];
+		else if( !strcmp( argv[i], "--port" ) && i + 1 < argc )
+			port = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--type" ) && i + 1 < argc )
+			format.type = strtoul( argv[++i], NULL, 0 ) == 16 ? EIEIO_KEY_16_BIT : EIEIO_KEY_32_BIT;
+		else if( !strcmp( argv[i], "--prefix" ) && i + 1 < argc ) {
+			format.prefix = strtoul( argv[++i], NULL, 0 );
+			if( format.prefix_type == EIEIO_NO_PREFIX )
+				format.prefix_type = EIEIO_UPPER_HALF_WORD;
+			}
+		else if( !strcmp( argv[i], "--prefix-type" ) && i + 1 < argc ) {
+			i++;
+			format.prefix_type = !strcmp( argv[i], "lower" ) ? EIEIO_LOWER_HALF_WORD : EIEIO_UPPER_HALF_WORD;
+			}
+		else if( !strcmp( argv[i], "--keys-per-message" ) && i + 1 < argc )
+			keys_per_message = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--batch" ) && i + 1 < argc )
+			batch = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--rate" ) && i + 1 < argc )
+			rate = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--count" ) && i + 1 < argc )
+			count = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--bench" ) )
+			run_bench = true;
+		else if( !strcmp( argv[i], "--spikes" ) && i + 1 < argc )
+			bench_spikes = strtoul( argv[++i], NULL, 0 );
+		else if( argv[i][0] != '-' ) {
+			char* end;
+			uint32_t first = strtoul( argv[i], &end, 0 ), n = *end == ':' ? strtoul( end + 1, NULL, 0 ) : 1;
+
+			keys = realloc( keys, ( n_keys + n ) * sizeof( uint32_t ) );
+			for( uint32_t k = 0; k < n; k++ )
+				keys[n_keys++] = first + k;
+			}
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( run_bench )
+		return bench( bench_spikes );
+
+	if( n_keys == 0 ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	spike_injector_t injector;
+
+	if( !spike_injector_open( &injector, host, port, &format, keys_per_message, batch, rate ) ) {
+		fprintf( stderr, "cannot open a UDP socket to %s:%u\n", host, port );
+		return 1;
+		}
+
+	double start = now_ns();
+	bool ok = true;
+
+	if( count == 0 )
+		count = n_keys;
+	for( uint32_t sent = 0; sent < count; sent += n_keys )
+		ok &= spike_injector_send( &injector, keys, count - sent < n_keys ? count - sent : n_keys );
+	ok &= spike_injector_flush( &injector );
+
+	double seconds = ( now_ns() - start ) / 1e9;
+
+	printf( "%llu spikes in %llu messages to %s:%u in %.3f s (%.0f spikes/s)",
+			(unsigned long long) injector.n_spikes, (unsigned long long) injector.n_messages, host, port,
+			seconds, injector.n_spikes / seconds );
+	if( injector.n_send_errors )
+		printf( ", %llu messages not sent", (unsigned long long) injector.n_send_errors );
+	printf( "\n" );
+
+	spike_injector_close( &injector );
+	free( keys );
+
+	return ok ? 0 : 1;
+}
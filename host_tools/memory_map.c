@@ -0,0 +1,56 @@
+/*
+	Reader for the memory_map_from_processor_to_address_space report; see
+	memory_map.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "memory_map.h"
+
+
+uint32_t read_memory_map( const char* path, memory_map_entry_t* entries, uint32_t max_entries )
+{
+	FILE* f = fopen( path, "r" );
+	char line[512];
+	uint32_t n = 0;
+
+	if( f == NULL )
+		return 0;
+
+	// (0, 0, 1): (0, 0, 1): ('start_address': 1879048192, hex(0x70000000), 'memory_used': 128, 'memory_written': 128
+	while( n < max_entries && fgets( line, sizeof( line ), f ) ) {
+		memory_map_entry_t* e = &entries[n];
+
+		if( sscanf( line, "(%u, %u, %u): (%*u, %*u, %*u): ('start_address': %u, hex(%*[^)]), "
+					"'memory_used': %u, 'memory_written': %u",
+					&e->x, &e->y, &e->p, &e->start_address, &e->memory_used, &e->memory_written ) == 6 )
+			n++;
+		}
+	fclose( f );
+
+	return n;
+}
+
+
+char* app_data_host_prefix( const char* dir )
+{
+	DIR* d = opendir( dir );
+	struct dirent* entry;
+	char* prefix = NULL;
+
+	if( d == NULL )
+		return NULL;
+
+	while( prefix == NULL && ( entry = readdir( d ) ) != NULL ) {
+		char* tag = strstr( entry->d_name, "_appData_" );
+
+		if( tag )
+			prefix = strndup( entry->d_name, tag - entry->d_name );
+		}
+	closedir( d );
+
+	return prefix;
+}
@@ -0,0 +1,31 @@
+/*! \file
+ *
+ *  \brief Reader for the memory_map_from_processor_to_address_space report,
+ *    which gives the SDRAM placement of every core's appData.
+ *
+ */
+
+#ifndef __MEMORY_MAP_H__
+#define __MEMORY_MAP_H__
+
+#include <stdint.h>
+
+typedef struct {
+	uint32_t	x, y, p;
+	uint32_t	start_address;
+	uint32_t	memory_used;
+	uint32_t	memory_written;
+} memory_map_entry_t;
+
+
+//! \brief Parses the report at path.
+//! \return The number of entries read, 0 if the file cannot be read
+
+uint32_t read_memory_map( const char* path, memory_map_entry_t* entries, uint32_t max_entries );
+
+//! \brief The "<host>" part of the <host>_appData_X_Y_P.dat files in dir,
+//! or NULL if there are none.  The caller frees the result.
+
+char* app_data_host_prefix( const char* dir );
+
+#endif /*__MEMORY_MAP_H__*/
@@ -0,0 +1,318 @@
+/*
+	Minimises the multicast routing tables of every chip, one chip per
+	thread, with the ordered-covering minimiser of routing_minimiser.c.
+
+		minimise_routes [-j threads] [--target N] [--output DIR] routing_dir
+
+	reads routing_dir/routing_table_X_Y.rpt, writes the minimised tables in
+	the same layout to DIR (routing_tables_compressed next to routing_dir
+	by default) and a before/after summary, routing_compression.rpt.
+	Traffic that crosses a chip by default routing is worked out from the
+	other tables first, so the minimised tables never capture it.
+
+		minimise_routes [-j threads] [--target N] --bench WIDTH HEIGHT
+						[--fan-out F] [--population-cores C]
+
+	does the same for synthetic_routing_tables() of a WIDTH x HEIGHT
+	machine and reports the time taken with one and with all threads.
+
+	Every minimised table is checked against the original: the keys of
+	each original and each default-routed entry, plus random keys within
+	them, must take the same route (or still no route).
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/stat.h>
+
+#include "routing_table.h"
+#include "routing_minimiser.h"
+#include "thread_pool.h"
+
+
+#define CHECK_SAMPLES		8
+
+typedef struct {
+	const routing_table_t*	original;
+	routing_table_t*		minimised;
+	routing_entry_t**		default_routed;
+	uint32_t*				n_default_routed;
+	double*					ms;
+	uint32_t*				n_mismatches;
+	uint32_t				target;
+} minimise_job_t;
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static bool same_route( const routing_table_t* a, const routing_table_t* b, uint32_t key )
+{
+	uint32_t route_a = 0, route_b = 0;
+	bool hit_a = routing_table_route( a, key, &route_a );
+	bool hit_b = routing_table_route( b, key, &route_b );
+
+	return hit_a == hit_b && route_a == route_b;
+}
+
+
+static uint32_t check_entries( const routing_table_t* original, const routing_table_t* minimised,
+							   const routing_entry_t* entries, uint32_t n_entries, uint32_t* state )
+{
+	uint32_t n_mismatches = 0;
+
+	for( uint32_t i = 0; i < n_entries; i++ )
+		for( uint32_t s = 0; s <= CHECK_SAMPLES; s++ ) {
+			// xorshift32
+			*state ^= *state << 13;
+			*state ^= *state >> 17;
+			*state ^= *state << 5;
+
+			uint32_t key = entries[i].key | ( s ? *state & ~entries[i].mask : 0 );
+
+			n_mismatches += !same_route( original, minimised, key );
+			}
+
+	return n_mismatches;
+}
+
+
+static void minimise_chip( uint32_t index, void* context )
+{
+	minimise_job_t* job = context;
+	const routing_table_t* original = &job->original[index];
+	routing_table_t* minimised = &job->minimised[index];
+	uint32_t state = 0x9E3779B9 ^ index;
+
+	minimised->x = original->x;
+	minimised->y = original->y;
+	minimised->n_entries = original->n_entries;
+	minimised->entries = malloc( ( original->n_entries + 1 ) * sizeof( routing_entry_t ) );
+	memcpy( minimised->entries, original->entries, original->n_entries * sizeof( routing_entry_t ) );
+
+	double start = now_ns();
+
+	minimise_routing_table( minimised, job->default_routed[index], job->n_default_routed[index], job->target );
+	job->ms[index] = ( now_ns() - start ) / 1e6;
+
+	job->n_mismatches[index] = check_entries( original, minimised, original->entries, original->n_entries, &state )
+		+ check_entries( original, minimised, job->default_routed[index], job->n_default_routed[index], &state );
+}
+
+
+// minimises every table; returns the wall time in ms
+static double minimise_all( const routing_table_t* tables, uint32_t n_tables, routing_table_t* minimised,
+							routing_entry_t** default_routed, uint32_t* n_default_routed, uint32_t target,
+							uint32_t n_threads, double* ms, uint32_t* n_mismatches )
+{
+	minimise_job_t job = { tables, minimised, default_routed, n_default_routed, ms, n_mismatches, target };
+	double start = now_ns();
+
+	parallel_for( n_threads, n_tables, minimise_chip, &job );
+
+	return ( now_ns() - start ) / 1e6;
+}
+
+
+static void write_summary( FILE* f, const routing_table_t* tables, const routing_table_t* minimised,
+						   uint32_t n_tables, const uint32_t* n_default_routed, const double* ms,
+						   const uint32_t* n_mismatches )
+{
+	uint64_t total_before = 0, total_after = 0;
+	uint32_t max_before = 0, max_after = 0, over_before = 0, over_after = 0, mismatches = 0;
+
+	fprintf( f, "        Routing table compression\n" );
+	fprintf( f, "        =========================\n\n" );
+	fprintf( f, "%-10s %8s %8s %8s %15s %10s\n", "Chip", "before", "after", "saved", "default routed", "time (ms)" );
+
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		uint32_t before = tables[t].n_entries, after = minimised[t].n_entries;
+		char chip[32];
+
+		snprintf( chip, sizeof( chip ), "(%u, %u)", tables[t].x, tables[t].y );
+		fprintf( f, "%-10s %8u %8u %7.1f%% %15u %10.2f\n", chip, before, after,
+				 before ? 100.0 * ( before - after ) / before : 0.0, n_default_routed[t], ms[t] );
+
+		total_before += before;
+		total_after += after;
+		max_before = before > max_before ? before : max_before;
+		max_after = after > max_after ? after : max_after;
+		over_before += before > ROUTER_ENTRIES;
+		over_after += after > ROUTER_ENTRIES;
+		mismatches += n_mismatches[t];
+		}
+
+	fprintf( f, "\n%u chips: %llu entries before, %llu after (%.1f%% saved)\n", n_tables,
+			 (unsigned long long) total_before, (unsigned long long) total_after,
+			 total_before ? 100.0 * ( total_before - total_after ) / total_before : 0.0 );
+	fprintf( f, "largest table: %u entries before, %u after\n", max_before, max_after );
+	fprintf( f, "chips over %u entries: %u before, %u after\n", ROUTER_ENTRIES, over_before, over_after );
+	fprintf( f, "route check: %u mismatches\n", mismatches );
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [-j threads] [--target N] [--output DIR] routing_dir\n"
+			 "       %s [-j threads] [--target N] --bench WIDTH HEIGHT [--fan-out F] [--population-cores C]\n"
+			 "  -j                  worker threads (default: one per CPU)\n"
+			 "  --target            stop merging a table at N entries (default 0: merge fully)\n"
+			 "  --output            directory for the minimised tables and\n"
+			 "                      routing_compression.rpt (default: routing_tables_compressed\n"
+			 "                      next to routing_dir)\n"
+			 "  --bench             minimise the tables of a synthetic WIDTH x HEIGHT machine\n"
+			 "  --fan-out           target populations per population (default 8)\n"
+			 "  --population-cores  cores per population, dividing 16 (default 4)\n",
+			 name, name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t		n_threads = 0, target = 0;
+	uint32_t		width = 0, height = 0, fan_out = 8, population_cores = 4;
+	const char*		output = NULL;
+	const char*		routing_dir = NULL;
+	bool			bench = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "-j" ) && i + 1 < argc )
+			n_threads = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--target" ) && i + 1 < argc )
+			target = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--output" ) && i + 1 < argc )
+			output = argv[++i];
+		else if( !strcmp( argv[i], "--bench" ) && i + 2 < argc ) {
+			bench = true;
+			width = strtoul( argv[++i], NULL, 0 );
+			height = strtoul( argv[++i], NULL, 0 );
+			}
+		else if( !strcmp( argv[i], "--fan-out" ) && i + 1 < argc )
+			fan_out = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--population-cores" ) && i + 1 < argc )
+			population_cores = strtoul( argv[++i], NULL, 0 );
+		else if( argv[i][0] != '-' && routing_dir == NULL )
+			routing_dir = argv[i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( bench ? ( width == 0 || height == 0 || population_cores == 0 || 16 % population_cores )
+			  : routing_dir == NULL ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	routing_table_t* tables;
+	uint32_t n_tables;
+
+	if( bench ) {
+		n_tables = width * height;
+		tables = synthetic_routing_tables( width, height, population_cores, fan_out, 1 );
+		}
+	else if( ( tables = read_routing_tables( routing_dir, &n_tables ) ) == NULL ) {
+		fprintf( stderr, "no routing_table_X_Y.rpt in %s\n", routing_dir );
+		return 1;
+		}
+
+	uint32_t* n_default_routed = malloc( n_tables * sizeof( uint32_t ) );
+	routing_entry_t** default_routed = default_routed_entries( tables, n_tables, n_default_routed );
+	routing_table_t* minimised = calloc( n_tables, sizeof( routing_table_t ) );
+	double* ms = malloc( n_tables * sizeof( double ) );
+	uint32_t* n_mismatches = malloc( n_tables * sizeof( uint32_t ) );
+	uint32_t mismatches = 0;
+	int status = 0;
+
+	if( bench ) {
+		if( n_threads == 0 )
+			n_threads = online_cpus();
+
+		double serial_ms = minimise_all( tables, n_tables, minimised, default_routed, n_default_routed,
+										 target, 1, ms, n_mismatches );
+
+		for( uint32_t t = 0; t < n_tables; t++ )
+			free( minimised[t].entries );
+
+		double parallel_ms = minimise_all( tables, n_tables, minimised, default_routed, n_default_routed,
+										   target, n_threads, ms, n_mismatches );
+
+		write_summary( stdout, tables, minimised, n_tables, n_default_routed, ms, n_mismatches );
+		printf( "%ux%u machine, fan-out %u, %u cores per population: %.1f ms on 1 thread, "
+				"%.1f ms on %u (%.1fx)\n", width, height, fan_out, population_cores,
+				serial_ms, parallel_ms, n_threads, serial_ms / parallel_ms );
+		}
+	else {
+		char* default_output = NULL;
+
+		if( output == NULL ) {
+			char* copy = strdup( routing_dir );
+			char* parent = dirname( copy );
+
+			default_output = malloc( strlen( parent ) + sizeof( "/routing_tables_compressed" ) );
+			sprintf( default_output, "%s/routing_tables_compressed", parent );
+			free( copy );
+			output = default_output;
+			}
+		mkdir( output, 0755 );
+
+		minimise_all( tables, n_tables, minimised, default_routed, n_default_routed,
+					  target, n_threads, ms, n_mismatches );
+
+		for( uint32_t t = 0; t < n_tables; t++ ) {
+			char path[4096];
+
+			snprintf( path, sizeof( path ), "%s/routing_table_%u_%u.rpt", output, minimised[t].x, minimised[t].y );
+			if( !write_routing_table( path, &minimised[t] ) ) {
+				fprintf( stderr, "cannot write %s\n", path );
+				status = 1;
+				}
+			}
+
+		char path[4096];
+		FILE* f;
+
+		snprintf( path, sizeof( path ), "%s/routing_compression.rpt", output );
+		if( ( f = fopen( path, "w" ) ) == NULL ) {
+			fprintf( stderr, "cannot write %s\n", path );
+			status = 1;
+			}
+		else {
+			write_summary( f, tables, minimised, n_tables, n_default_routed, ms, n_mismatches );
+			fclose( f );
+			}
+		write_summary( stdout, tables, minimised, n_tables, n_default_routed, ms, n_mismatches );
+		free( default_output );
+		}
+
+	for( uint32_t t = 0; t < n_tables; t++ )
+		mismatches += n_mismatches[t];
+	if( mismatches ) {
+		fprintf( stderr, "minimised tables route %u checked keys differently\n", mismatches );
+		status = 1;
+		}
+
+	for( uint32_t t = 0; t < n_tables; t++ )
+		free( default_routed[t] );
+	free( default_routed );
+	free( n_default_routed );
+	free_routing_tables( minimised, n_tables );
+	free_routing_tables( tables, n_tables );
+	free( ms );
+	free( n_mismatches );
+
+	return status;
+}
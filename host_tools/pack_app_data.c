@@ -0,0 +1,192 @@
+/*
+	pack_app_data: packs the per-core appData files of a run into one
+	chip_image.h image per chip.
+
+		pack_app_data --memory-map FILE [--max-gap BYTES] app_dir
+		pack_app_data --list IMAGE
+
+	The SDRAM placement of each core comes from the
+	memory_map_from_processor_to_address_space report of the same run.
+	Images are written as <host>_chipImage_X_Y.dat in app_dir and read back
+	through the mmap reader to check every core against its appData file.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "chip_image.h"
+#include "data_spec_executor.h"
+#include "memory_map.h"
+
+
+#define MAX_CORES		4096
+
+
+static int pack( const char* memory_map, const char* dir, uint32_t max_gap )
+{
+	static memory_map_entry_t	entries[MAX_CORES];
+	static chip_image_input_t	inputs[MAX_CORES];
+	static bool					packed[MAX_CORES];
+
+	uint32_t n_entries = read_memory_map( memory_map, entries, MAX_CORES );
+	char* prefix = app_data_host_prefix( dir );
+	char path[4096];
+	int result = 0;
+
+	if( n_entries == 0 || prefix == NULL ) {
+		fprintf( stderr, "no cores in %s or no appData files in %s\n", memory_map, dir );
+		free( prefix );
+		return 1;
+		}
+
+	uint32_t n_files = 0, n_images = 0, n_transfers = 0;
+
+	for( uint32_t i = 0; i < n_entries; i++ ) {
+		if( packed[i] )
+			continue;
+
+		uint32_t x = entries[i].x, y = entries[i].y;
+		uint32_t n_inputs = 0;
+
+		for( uint32_t j = i; j < n_entries; j++ ) {
+			memory_map_entry_t* e = &entries[j];
+
+			if( packed[j] || e->x != x || e->y != y )
+				continue;
+			packed[j] = true;
+
+			snprintf( path, sizeof( path ), "%s/%s_appData_%u_%u_%u.dat", dir, prefix, x, y, e->p );
+
+			uint32_t size;
+			uint8_t* data = dse_read_file( path, &size );
+
+			if( data == NULL || size != e->memory_written ) {
+				fprintf( stderr, "%s: missing or not %u bytes\n", path, e->memory_written );
+				free( data );
+				result = 1;
+				continue;
+				}
+
+			chip_image_input_t* input = &inputs[n_inputs++];
+
+			input->p = e->p;
+			input->start_address = e->start_address;
+			input->memory_used = e->memory_used;
+			input->memory_written = e->memory_written;
+			input->data = data;
+			}
+
+		snprintf( path, sizeof( path ), "%s/%s_chipImage_%u_%u.dat", dir, prefix, x, y );
+
+		chip_image_t image;
+
+		if( !chip_image_write( path, x, y, inputs, n_inputs, max_gap ) || !chip_image_map( path, &image ) ) {
+			fprintf( stderr, "%s: cannot write image\n", path );
+			result = 1;
+			}
+		else {
+			// inputs are now in address order, as are the image's cores
+			for( uint32_t c = 0; c < n_inputs; c++ )
+				if( memcmp( chip_image_core_data( &image, c ), inputs[c].data, inputs[c].memory_written ) ) {
+					fprintf( stderr, "%s: core %u does not read back\n", path, inputs[c].p );
+					result = 1;
+					}
+
+			printf( "chip (%u, %u): %u cores in %u transfers, %u bytes -> %s\n", x, y, n_inputs,
+					image.header->n_transfers, image.header->data_bytes, path );
+			n_transfers += image.header->n_transfers;
+			chip_image_unmap( &image );
+			}
+
+		n_files += n_inputs;
+		n_images++;
+		for( uint32_t c = 0; c < n_inputs; c++ )
+			free( (void*) inputs[c].data );
+		}
+
+	printf( "%u appData files -> %u chip images, %u transfers\n", n_files, n_images, n_transfers );
+	free( prefix );
+
+	return result;
+}
+
+
+static int list( const char* path )
+{
+	chip_image_t image;
+
+	if( !chip_image_map( path, &image ) ) {
+		fprintf( stderr, "%s: not a chip image\n", path );
+		return 1;
+		}
+
+	const chip_image_header_t* h = image.header;
+
+	printf( "chip (%u, %u): %u cores, %u transfers, %u bytes of data at offset %u\n",
+			h->x, h->y, h->n_cores, h->n_transfers, h->data_bytes, h->data_offset );
+
+	for( uint32_t t = 0; t < h->n_transfers; t++ )
+		printf( "  transfer %u: 0x%08x, %u bytes, %u cores\n", t, image.transfers[t].sdram_address,
+				image.transfers[t].length, image.transfers[t].n_cores );
+
+	for( uint32_t c = 0; c < h->n_cores; c++ ) {
+		const chip_image_core_t* core = &image.cores[c];
+
+		printf( "  core %2u: 0x%08x used %u written %u (transfer %u, user0 0x%08x)\n", core->p,
+				core->start_address, core->memory_used, core->memory_written, core->transfer,
+				USER0_ADDRESS( core->p ) );
+		}
+
+	chip_image_unmap( &image );
+
+	return 0;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s --memory-map FILE [--max-gap BYTES] app_dir\n"
+			 "       %s --list IMAGE\n"
+			 "  --memory-map  memory_map_from_processor_to_address_space report of the run\n"
+			 "  --max-gap     unfilled bytes written as zeros to merge neighbouring cores\n"
+			 "                (default 0: only cores whose images touch are merged)\n",
+			 name, name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	const char*		memory_map = NULL;
+	const char*		image = NULL;
+	const char*		dir = NULL;
+	uint32_t		max_gap = 0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--memory-map" ) && i + 1 < argc )
+			memory_map = argv[++i];
+		else if( !strcmp( argv[i], "--max-gap" ) && i + 1 < argc )
+			max_gap = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--list" ) && i + 1 < argc )
+			image = argv[++i];
+		else if( argv[i][0] != '-' && dir == NULL )
+			dir = argv[i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( image )
+		return list( image );
+
+	if( memory_map == NULL || dir == NULL ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	return pack( memory_map, dir, max_gap );
+}
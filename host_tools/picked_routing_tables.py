@@ -0,0 +1,101 @@
+"""
+Reads the picked_routing_table_for_X_Y files that the tool chain leaves in
+application_generated_data_files, without PACMAN installed, and writes them
+in the routing_table_X_Y.rpt layout that route_bench and minimise_routes
+read.  The picked tables hold the full 32-bit keys and the order the
+entries are loaded into the router.
+
+    python picked_routing_tables.py app_dir output_dir
+"""
+import argparse
+import os
+import pickle
+import re
+import sys
+
+_PICKED = re.compile(r"picked_routing_table_for_(\d+)_(\d+)$")
+
+
+class _Stub(object):
+    """ Stands in for the PACMAN and spinn_machine classes
+    """
+
+    def __setstate__(self, state):
+        self.__dict__.update(state)
+
+
+class _Unpickler(pickle.Unpickler):
+
+    def find_class(self, module, name):
+        if module.split(".")[0] in ("pacman", "spinn_machine"):
+            return type(name, (_Stub,), {})
+        # sets become lists, so the entries keep their pickled order
+        if name == "set" and module in ("__builtin__", "builtins"):
+            return list
+        return pickle.Unpickler.find_class(self, module, name)
+
+
+def load_picked_routing_table(path):
+    """
+    :return: x, y and the entries in router order as (key, mask, route),\
+        with route bits 0-5 the links and 6 + p core p
+    """
+    with open(path, "rb") as f:
+        if sys.version_info[0] >= 3:
+            table = _Unpickler(f, encoding="latin1").load()
+        else:
+            table = _Unpickler(f).load()
+
+    entries = []
+    for entry in table._multicast_routing_entries:
+        route = 0
+        for link in entry._link_ids:
+            route |= 1 << link
+        for p in entry._processor_ids:
+            route |= 1 << (6 + p)
+        entries.append((entry._key_combo, entry._mask, route))
+    return table._x, table._y, entries
+
+
+def write_routing_table_report(path, entries):
+    with open(path, "w") as f:
+        f.write("router contains {} entries \n \n".format(len(entries)))
+        f.write("  Index   Key(hex)    Mask(hex)    Route(hex)    "
+                "Src. Core -> [Cores][Links]\n")
+        f.write("-" * 78 + "\n")
+        for index, (key, mask, route) in enumerate(entries):
+            cores = [c for c in range(18) if route & (1 << (6 + c))]
+            links = [l for l in range(6) if route & (1 << l)]
+            f.write("{:>5}     {:05x}       {:08x}      {:04x}         "
+                    "-      {} {}\n".format(index, key, mask, route,
+                                            cores, links))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("app_dir", help="application_generated_data_files run")
+    parser.add_argument("output_dir")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.output_dir):
+        os.makedirs(args.output_dir)
+    n_tables = 0
+    for name in sorted(os.listdir(args.app_dir)):
+        if _PICKED.match(name) is None:
+            continue
+        x, y, entries = load_picked_routing_table(
+            os.path.join(args.app_dir, name))
+        path = os.path.join(args.output_dir,
+                            "routing_table_{}_{}.rpt".format(x, y))
+        write_routing_table_report(path, entries)
+        print("{}: {} entries".format(path, len(entries)))
+        n_tables += 1
+
+    if n_tables == 0:
+        print("no picked routing tables in {}".format(args.app_dir))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,359 @@
+/*
+	plan_reload: incremental reload of a run's appData.
+
+		plan_reload --memory-map FILE --state FILE [--full] [--script FILE] app_dir
+
+	Every core's appData image is split into header and region spans
+	(region_hash.h) and each span is hashed.  Spans whose address, length
+	and hash match the state recorded at the last load are skipped, so a
+	sweep that only changes i_offset rewrites just the neuron parameter
+	region of the affected cores.
+
+	The new state is written to <state>.next.  With --script, the run's
+	rerun_script.py is regenerated with the per-core appData writes
+	replaced by the planned span writes; the script moves <state>.next over
+	<state> straight after the last of them.  If the script finds the board
+	has to be booted, it deletes <state> and loads every appData file in
+	full instead.  Use --full if an application rewrites its own filled
+	regions while running.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "data_spec_executor.h"
+#include "memory_map.h"
+#include "region_hash.h"
+#include "chip_image.h"
+
+
+#define MAX_CORES		4096
+#define MAX_SPANS		( MAX_CORES * APP_DATA_N_SPANS )
+
+typedef struct {
+	uint32_t	x, y, p, span;
+	uint32_t	address;
+	uint32_t	length;
+	uint64_t	hash;
+} span_state_t;
+
+typedef struct {
+	uint32_t	x, y, p;
+	uint32_t	address;
+	uint32_t	file_offset;
+	uint32_t	length;
+} planned_write_t;
+
+typedef struct {
+	uint32_t	x, y, p;
+	uint32_t	start_address;
+} planned_user0_t;
+
+
+static span_state_t		previous[MAX_SPANS];
+static span_state_t		current[MAX_SPANS];
+static planned_write_t	writes[MAX_SPANS];
+static planned_user0_t	user0s[MAX_CORES];
+
+
+static int compare_states( const void* a, const void* b )
+{
+	const span_state_t* s = a;
+	const span_state_t* t = b;
+
+	if( s->x != t->x ) return s->x < t->x ? -1 : 1;
+	if( s->y != t->y ) return s->y < t->y ? -1 : 1;
+	if( s->p != t->p ) return s->p < t->p ? -1 : 1;
+	if( s->span != t->span ) return s->span < t->span ? -1 : 1;
+	return 0;
+}
+
+
+static uint32_t read_state( const char* path )
+{
+	FILE* f = fopen( path, "r" );
+	char line[256];
+	uint32_t n = 0;
+
+	if( f == NULL )
+		return 0;
+
+	while( n < MAX_SPANS && fgets( line, sizeof( line ), f ) ) {
+		span_state_t* s = &previous[n];
+
+		if( line[0] != '#' && sscanf( line, "%u %u %u %u %u %u %" SCNx64, &s->x, &s->y, &s->p,
+									  &s->span, &s->address, &s->length, &s->hash ) == 7 )
+			n++;
+		}
+	fclose( f );
+
+	qsort( previous, n, sizeof( span_state_t ), compare_states );
+
+	return n;
+}
+
+
+static bool write_state( const char* path, uint32_t n_spans )
+{
+	FILE* f = fopen( path, "w" );
+
+	if( f == NULL )
+		return false;
+
+	fprintf( f, "# x y p span address length hash\n" );
+	for( uint32_t s = 0; s < n_spans; s++ )
+		fprintf( f, "%u %u %u %u %u %u %016" PRIx64 "\n", current[s].x, current[s].y, current[s].p,
+				 current[s].span, current[s].address, current[s].length, current[s].hash );
+
+	return fclose( f ) == 0;
+}
+
+
+static bool is_app_data_line( const char* line )
+{
+	return !strncmp( line, "application_data_file_reader = ", 31 ) || !strncmp( line, "txrx.write_memory(", 18 );
+}
+
+
+// the rerun script with its appData lines replaced: the planned span writes
+// for a board that kept its SDRAM, the original full load for one that
+// had to be booted; either way the state is moved into place straight
+// after the last write, and a boot deletes the old state first
+static void write_script( FILE* out, const char* rerun_script, const char* prefix,
+						  uint32_t n_writes, uint32_t n_user0s, const char* state_path,
+						  uint64_t planned_bytes, uint64_t total_bytes )
+{
+	FILE* in = fopen( rerun_script, "r" );
+	char line[4096];
+	bool planned = false, checked_boot = false;
+
+	while( in && fgets( line, sizeof( line ), in ) ) {
+		if( !strncmp( line, "txrx.ensure_board_is_ready(", 27 ) ) {
+			fprintf( out, "import os\n" );
+			fprintf( out, "try:\n" );
+			fprintf( out, "    txrx.get_scamp_version()\n" );
+			fprintf( out, "    board_booted = False\n" );
+			fprintf( out, "except Exception:\n" );
+			fprintf( out, "    board_booted = True\n" );
+			fputs( line, out );
+			fprintf( out, "# a boot clears SDRAM, so nothing recorded as loaded is there any more\n" );
+			fprintf( out, "if board_booted and os.path.exists(\"%s\"):\n", state_path );
+			fprintf( out, "    os.remove(\"%s\")\n", state_path );
+			checked_boot = true;
+			continue;
+			}
+		if( !is_app_data_line( line ) ) {
+			fputs( line, out );
+			continue;
+			}
+		if( planned )
+			continue;
+		planned = true;
+
+		if( !checked_boot )
+			fprintf( out, "import os\nboard_booted = False\n" );
+		fprintf( out, "def write_app_data(x, y, address, file_name, offset, length):\n" );
+		fprintf( out, "    with open(file_name, \"rb\") as f:\n" );
+		fprintf( out, "        f.seek(offset)\n" );
+		fprintf( out, "        txrx.write_memory(x, y, address, bytearray(f.read(length)), length)\n\n" );
+
+		// the full load, every appData line of the original script
+		fprintf( out, "if board_booted:\n" );
+		long resume = ftell( in );
+		char full_line[4096];
+
+		fputs( "    ", out );
+		fputs( line, out );
+		while( fgets( full_line, sizeof( full_line ), in ) )
+			if( is_app_data_line( full_line ) ) {
+				fputs( "    ", out );
+				fputs( full_line, out );
+				}
+		fseek( in, resume, SEEK_SET );
+
+		fprintf( out, "else:\n" );
+		fprintf( out, "    # incremental reload planned by plan_reload: %" PRIu64 " of %" PRIu64 " bytes\n",
+				 planned_bytes, total_bytes );
+		if( n_writes + n_user0s == 0 )
+			fprintf( out, "    pass\n" );
+		for( uint32_t w = 0; w < n_writes; w++ )
+			fprintf( out, "    write_app_data(%u, %u, %u, \"%s_appData_%u_%u_%u.dat\", %u, %u)\n",
+					 writes[w].x, writes[w].y, writes[w].address, prefix, writes[w].x, writes[w].y,
+					 writes[w].p, writes[w].file_offset, writes[w].length );
+		for( uint32_t u = 0; u < n_user0s; u++ )
+			fprintf( out, "    txrx.write_memory(%u, %u, %u, %u)\n", user0s[u].x, user0s[u].y,
+					 USER0_ADDRESS( user0s[u].p ), user0s[u].start_address );
+
+		fprintf( out, "os.rename(\"%s.next\", \"%s\")\n", state_path, state_path );
+		}
+
+	if( in )
+		fclose( in );
+
+	if( !planned )
+		fprintf( out, "import os\nos.rename(\"%s.next\", \"%s\")\n", state_path, state_path );
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s --memory-map FILE --state FILE [--full] [--script FILE] app_dir\n"
+			 "  --memory-map  memory_map_from_processor_to_address_space report of the run\n"
+			 "  --state       spans loaded last time; the new state goes to FILE.next\n"
+			 "  --full        ignore the state and plan a full load\n"
+			 "  --script      rerun script to generate from app_dir/rerun_script.py\n",
+			 name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	static memory_map_entry_t	cores[MAX_CORES];
+
+	const char*		memory_map = NULL;
+	const char*		state_path = NULL;
+	const char*		script_path = NULL;
+	const char*		dir = NULL;
+	bool			full = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--memory-map" ) && i + 1 < argc )
+			memory_map = argv[++i];
+		else if( !strcmp( argv[i], "--state" ) && i + 1 < argc )
+			state_path = argv[++i];
+		else if( !strcmp( argv[i], "--script" ) && i + 1 < argc )
+			script_path = argv[++i];
+		else if( !strcmp( argv[i], "--full" ) )
+			full = true;
+		else if( argv[i][0] != '-' && dir == NULL )
+			dir = argv[i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( memory_map == NULL || state_path == NULL || dir == NULL ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	uint32_t n_cores = read_memory_map( memory_map, cores, MAX_CORES );
+	uint32_t n_previous = full ? 0 : read_state( state_path );
+	char* prefix = app_data_host_prefix( dir );
+
+	if( n_cores == 0 || prefix == NULL ) {
+		fprintf( stderr, "no cores in %s or no appData files in %s\n", memory_map, dir );
+		return 1;
+		}
+
+	uint32_t n_spans = 0, n_writes = 0, n_user0s = 0, n_changed_spans = 0;
+	uint64_t total_bytes = 0, planned_bytes = 0;
+	char path[4096];
+
+	for( uint32_t c = 0; c < n_cores; c++ ) {
+		memory_map_entry_t* core = &cores[c];
+		region_span_t spans[APP_DATA_N_SPANS];
+		uint32_t size;
+
+		snprintf( path, sizeof( path ), "%s/%s_appData_%u_%u_%u.dat", dir, prefix, core->x, core->y, core->p );
+
+		uint8_t* image = dse_read_file( path, &size );
+
+		if( image == NULL || !app_data_region_spans( image, size, spans ) ) {
+			fprintf( stderr, "%s: missing or not an appData image\n", path );
+			free( image );
+			return 1;
+			}
+		free( image );
+
+		planned_write_t* open = NULL;
+
+		for( uint32_t s = 0; s < APP_DATA_N_SPANS; s++ ) {
+			if( spans[s].length == 0 )
+				continue;
+
+			span_state_t* state = &current[n_spans++];
+
+			state->x = core->x;
+			state->y = core->y;
+			state->p = core->p;
+			state->span = s;
+			state->address = core->start_address + spans[s].offset;
+			state->length = spans[s].length;
+			state->hash = spans[s].hash;
+
+			span_state_t* last = bsearch( state, previous, n_previous, sizeof( span_state_t ), compare_states );
+			bool changed = last == NULL || last->address != state->address
+						   || last->length != state->length || last->hash != state->hash;
+
+			total_bytes += state->length;
+			if( !changed ) {
+				open = NULL;
+				continue;
+				}
+
+			n_changed_spans++;
+			planned_bytes += state->length;
+
+			if( s == 0 ) {
+				planned_user0_t* u = &user0s[n_user0s++];
+
+				u->x = core->x;
+				u->y = core->y;
+				u->p = core->p;
+				u->start_address = core->start_address;
+				}
+
+			// spans of a core are laid out back to back; one write covers a run
+			if( open && open->file_offset + open->length == spans[s].offset ) {
+				open->length += spans[s].length;
+				continue;
+				}
+
+			open = &writes[n_writes++];
+			open->x = core->x;
+			open->y = core->y;
+			open->p = core->p;
+			open->address = state->address;
+			open->file_offset = spans[s].offset;
+			open->length = spans[s].length;
+			}
+		}
+
+	printf( "%u cores: %u of %u spans changed, %" PRIu64 " of %" PRIu64 " bytes in %u writes\n",
+			n_cores, n_changed_spans, n_spans, planned_bytes, total_bytes, n_writes );
+
+	for( uint32_t w = 0; w < n_writes; w++ )
+		printf( "  (%u, %u, %u): 0x%08x %u bytes\n", writes[w].x, writes[w].y, writes[w].p,
+				writes[w].address, writes[w].length );
+
+	snprintf( path, sizeof( path ), "%s.next", state_path );
+	if( !write_state( path, n_spans ) ) {
+		fprintf( stderr, "cannot write %s\n", path );
+		return 1;
+		}
+
+	if( script_path ) {
+		char rerun_script[4096];
+		FILE* out = fopen( script_path, "w" );
+
+		if( out == NULL ) {
+			fprintf( stderr, "cannot write %s\n", script_path );
+			return 1;
+			}
+
+		snprintf( rerun_script, sizeof( rerun_script ), "%s/rerun_script.py", dir );
+		write_script( out, rerun_script, prefix, n_writes, n_user0s, state_path, planned_bytes, total_bytes );
+		fclose( out );
+		}
+
+	free( prefix );
+
+	return 0;
+}
@@ -0,0 +1,410 @@
+/*
+	Reads a recording store (recording_store.h) written by the buffered
+	output drain.
+
+		read_recording FILE [--channel LABEL] [--ticks FIRST:END]
+					   [--neurons FIRST:END] [--order neuron|time] [--threads N]
+
+	prints the channel's rows in the window as getSpikes() or get_v()
+	return them with compatible_output=True: "neuron time" per spike, in
+	neuron order unless --order time, or "neuron time value" per neuron
+	per recorded tick.  END is exclusive; either bound may be left out.
+
+		read_recording --bench [--spikes N] [--neurons N] [--threads N]
+						[--output FILE]
+
+	writes a store of N random spikes (10^7 by default) and a V channel,
+	then times, against reading the file block by block with stdio and
+	sorting with qsort: opening it, a narrow window, a neuron range, and
+	conversion of everything to getSpikes() rows on 1 to --threads
+	threads.  Every result is checked against the stdio one.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "recording_store.h"
+#include "recording_reader.h"
+#include "thread_pool.h"
+
+
+#define TIME_STEP_US		1000
+#define SPIKES_PER_TICK		100
+#define V_NEURONS			64
+
+typedef struct {
+	uint32_t	tick;
+	uint16_t	neuron;
+} spike_t;
+
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static bool parse_range( const char* text, uint32_t* first, uint32_t* end )
+{
+	const char* colon = strchr( text, ':' );
+
+	if( colon == NULL )
+		return false;
+	if( colon != text )
+		*first = strtoul( text, NULL, 0 );
+	if( colon[1] != '\0' )
+		*end = strtoul( colon + 1, NULL, 0 );
+	return true;
+}
+
+
+static int print_rows( const char* path, const char* label, recording_window_t window, bool tick_order,
+					   uint32_t n_threads )
+{
+	recording_reader_t reader;
+
+	if( !recording_reader_open( &reader, path ) ) {
+		fprintf( stderr, "read_recording: %s is not a recording store\n", path );
+		return 1;
+		}
+
+	int channel = label != NULL ? recording_reader_find_channel( &reader, label ) : 0;
+
+	if( channel < 0 || (uint32_t) channel >= reader.n_channels ) {
+		fprintf( stderr, "read_recording: no channel %s in %s\n", label != NULL ? label : "", path );
+		recording_reader_close( &reader );
+		return 1;
+		}
+
+	const recording_channel_t* c = &reader.channels[channel];
+	uint64_t n = recording_reader_count( &reader, channel, &window );
+	bool spikes = c->kind == RECORDING_SPIKES;
+
+	if( window.end_neuron > c->n_neurons )
+		window.end_neuron = c->n_neurons;
+	if( !spikes )
+		n *= window.end_neuron > window.first_neuron ? window.end_neuron - window.first_neuron : 0;
+
+	double* rows = malloc( ( n > 0 ? n : 1 ) * ( spikes ? 2 : 3 ) * sizeof( double ) );
+
+	if( rows == NULL ) {
+		fprintf( stderr, "read_recording: out of memory\n" );
+		recording_reader_close( &reader );
+		return 1;
+		}
+	printf( "# %s: %s of %u neurons, %u blocks%s\n", c->label, spikes ? "spikes" : "state", c->n_neurons,
+			reader.n_channel_blocks[channel], reader.indexed ? "" : " (no index; blocks walked)" );
+	if( spikes ) {
+		n = recording_reader_spike_rows( &reader, channel, &window,
+										 tick_order ? RECORDING_TICK_ORDER : RECORDING_NEURON_ORDER, n_threads, rows );
+		for( uint64_t r = 0; r < n; r++ )
+			printf( "%.0f %g\n", rows[2 * r], rows[2 * r + 1] );
+		}
+	else {
+		n = recording_reader_state_rows( &reader, channel, &window, n_threads, rows );
+		for( uint64_t r = 0; r < n; r++ )
+			printf( "%.0f %g %.6f\n", rows[3 * r], rows[3 * r + 1], rows[3 * r + 2] );
+		}
+
+	free( rows );
+	recording_reader_close( &reader );
+	return 0;
+}
+
+
+static bool write_bench_store( const char* path, uint64_t n_spikes, uint32_t n_neurons, uint32_t* n_ticks )
+{
+	recording_channel_t channels[2] = {
+		{ RECORDING_SPIKES, n_neurons, TIME_STEP_US, "spikes" },
+		{ RECORDING_STATE, V_NEURONS, TIME_STEP_US, "v" } };
+	recording_store_t store;
+	uint16_t* neurons = malloc( n_neurons * sizeof( uint16_t ) );
+	int32_t v[V_NEURONS] = { 0 };
+	uint32_t threshold = (uint32_t) ( (double) SPIKES_PER_TICK / n_neurons * 4294967296.0 );
+	uint64_t written = 0;
+	bool ok = neurons != NULL && recording_store_create( &store, path, channels, 2, 0 );
+
+	*n_ticks = 0;
+	for( uint32_t t = 0; ok && written < n_spikes; t++ ) {
+		uint32_t n = 0;
+
+		for( uint32_t i = 0; i < n_neurons && written + n < n_spikes; i++ )
+			if( next_random() < threshold )
+				neurons[n++] = i;
+		for( uint32_t i = 0; i < V_NEURONS; i++ )
+			v[i] += (int32_t) ( next_random() % 4097 ) - 2048;
+		ok = recording_store_add_spikes( &store, 0, t, neurons, n ) && recording_store_add_state( &store, 1, t, v );
+		written += n;
+		*n_ticks = t + 1;
+		}
+	if( neurons != NULL && !recording_store_close( &store ) )
+		ok = false;
+	free( neurons );
+	return ok;
+}
+
+
+static int compare_spikes( const void* a, const void* b )
+{
+	const spike_t* x = a;
+	const spike_t* y = b;
+
+	if( x->neuron != y->neuron )
+		return x->neuron < y->neuron ? -1 : 1;
+	return x->tick < y->tick ? -1 : x->tick > y->tick;
+}
+
+
+//! \brief The baseline: every spike block read in turn with stdio, the
+//! window's spikes kept and sorted with qsort.
+static uint64_t stdio_spike_rows( const char* path, const recording_window_t* w, double* rows )
+{
+	FILE* f = fopen( path, "rb" );
+	uint32_t header[5], n_channels, bytes, n_blocks;
+	uint64_t index_offset, n = 0, max_spikes = 1 << 20;
+	spike_t* spikes = malloc( max_spikes * sizeof( spike_t ) );
+	uint32_t* ticks = malloc( RECORDING_STORE_BLOCK_ROWS * sizeof( uint32_t ) );
+	uint16_t* neurons = malloc( RECORDING_STORE_BLOCK_ROWS * sizeof( uint16_t ) );
+	bool ok = f != NULL && spikes != NULL && ticks != NULL && neurons != NULL
+			  && fseek( f, -RECORDING_STORE_FOOTER_BYTES, SEEK_END ) == 0
+			  && fread( &index_offset, sizeof( index_offset ), 1, f ) == 1 && fread( &n_blocks, 4, 1, f ) == 1
+			  && fseek( f, 8, SEEK_SET ) == 0 && fread( &n_channels, 4, 1, f ) == 1
+			  && fseek( f, n_channels * ( 3 * sizeof( uint32_t ) + RECORDING_STORE_LABEL_BYTES ), SEEK_CUR ) == 0;
+
+	while( ok && (uint64_t) ftell( f ) < index_offset ) {
+		ok = fread( header, 4, 5, f ) == 5 && header[1] <= RECORDING_STORE_BLOCK_ROWS;
+		for( uint32_t c = 0; ok && c < header[4]; c++ ) {
+			ok = fread( &bytes, 4, 1, f ) == 1;
+			if( ok && header[0] == 0 && c < 2 )
+				ok = fread( c == 0 ? (void*) ticks : (void*) neurons, 1, ( bytes + 3 ) / 4 * 4, f ) == ( bytes + 3 ) / 4 * 4;
+			else if( ok )
+				ok = fseek( f, ( bytes + 3 ) / 4 * 4, SEEK_CUR ) == 0;
+			}
+		for( uint32_t r = 0; ok && header[0] == 0 && r < header[1]; r++ )
+			if( ticks[r] >= w->first_tick && ticks[r] < w->end_tick && neurons[r] >= w->first_neuron
+				&& neurons[r] < w->end_neuron ) {
+				if( n == max_spikes ) {
+					spike_t* more = realloc( spikes, 2 * max_spikes * sizeof( spike_t ) );
+
+					if( more == NULL ) {
+						ok = false;
+						break;
+						}
+					spikes = more;
+					max_spikes *= 2;
+					}
+				spikes[n++] = ( spike_t ) { ticks[r], neurons[r] };
+				}
+		}
+
+	if( ok ) {
+		qsort( spikes, n, sizeof( spike_t ), compare_spikes );
+		for( uint64_t s = 0; s < n; s++ ) {
+			rows[2 * s] = spikes[s].neuron;
+			rows[2 * s + 1] = spikes[s].tick * ( TIME_STEP_US / 1000.0 );
+			}
+		}
+	if( f != NULL )
+		fclose( f );
+	free( spikes );
+	free( ticks );
+	free( neurons );
+	return ok ? n : UINT64_MAX;
+}
+
+
+static double ms_since( uint64_t start )
+{
+	return ( now_ns() - start ) / 1e6;
+}
+
+
+//! \brief Times one window both ways; returns false if they differ.
+static bool bench_window( const char* name, const char* path, const recording_reader_t* reader,
+						  recording_window_t window, uint32_t n_threads, double* rows, double* expected )
+{
+	uint64_t start = now_ns();
+	uint64_t n_expected = stdio_spike_rows( path, &window, expected );
+	double stdio_ms = ms_since( start );
+
+	start = now_ns();
+
+	uint64_t n = recording_reader_spike_rows( reader, 0, &window, RECORDING_NEURON_ORDER, n_threads, rows );
+
+	double mapped_ms = ms_since( start );
+	bool ok = n == n_expected && !memcmp( rows, expected, n * 2 * sizeof( double ) );
+
+	printf( "%-22s %10llu %11.2f %11.2f %8.1fx %6s\n", name, (unsigned long long) n, stdio_ms, mapped_ms,
+			stdio_ms / ( mapped_ms > 0 ? mapped_ms : 1e-3 ), ok ? "ok" : "FAILED" );
+	return ok;
+}
+
+
+static int bench( const char* path, uint64_t n_spikes, uint32_t n_neurons, uint32_t max_threads )
+{
+	recording_reader_t reader;
+	uint32_t n_ticks;
+	uint64_t start = now_ns();
+
+	if( n_neurons == 0 || n_neurons > 0x10000 || !write_bench_store( path, n_spikes, n_neurons, &n_ticks ) ) {
+		fprintf( stderr, "read_recording: cannot write %s\n", path );
+		return 1;
+		}
+	printf( "%llu spikes of %u neurons over %u ticks, V of %u neurons: written in %.0f ms\n",
+			(unsigned long long) n_spikes, n_neurons, n_ticks, V_NEURONS, ms_since( start ) );
+
+	start = now_ns();
+	if( !recording_reader_open( &reader, path ) ) {
+		fprintf( stderr, "read_recording: cannot read %s back\n", path );
+		return 1;
+		}
+	printf( "opened: %u blocks, %.1f MB, %s, in %.3f ms\n\n", reader.n_blocks, reader.size / 1e6,
+			reader.indexed ? "indexed" : "walked", ms_since( start ) );
+
+	double* rows = malloc( 2 * n_spikes * sizeof( double ) );
+	double* expected = malloc( 2 * n_spikes * sizeof( double ) );
+	uint32_t n_failures = 0;
+
+	if( rows == NULL || expected == NULL ) {
+		fprintf( stderr, "read_recording: out of memory\n" );
+		return 1;
+		}
+
+	printf( "%-22s %10s %11s %11s %9s %6s\n", "window", "spikes", "stdio ms", "mapped ms", "speedup", "check" );
+	n_failures += !bench_window( "1% of ticks", path, &reader,
+								 ( recording_window_t ) { n_ticks / 2, n_ticks / 2 + n_ticks / 100, 0, n_neurons },
+								 max_threads, rows, expected );
+	n_failures += !bench_window( "1% ticks, 10% neurons", path, &reader,
+								 ( recording_window_t ) { n_ticks / 2, n_ticks / 2 + n_ticks / 100, n_neurons / 4,
+														  n_neurons / 4 + n_neurons / 10 }, max_threads, rows, expected );
+	n_failures += !bench_window( "10% of neurons", path, &reader,
+								 ( recording_window_t ) { 0, UINT32_MAX, n_neurons / 4, n_neurons / 4 + n_neurons / 10 },
+								 max_threads, rows, expected );
+	n_failures += !bench_window( "everything", path, &reader, recording_reader_whole( &reader, 0 ), max_threads,
+								 rows, expected );
+
+	// conversion alone, the whole channel, as getSpikes() and in tick order
+	recording_window_t all = recording_reader_whole( &reader, 0 );
+
+	printf( "\n%-8s %14s %12s\n", "threads", "neuron order", "tick order" );
+	for( uint32_t threads = 1; threads <= max_threads; threads *= 2 ) {
+		start = now_ns();
+		uint64_t n = recording_reader_spike_rows( &reader, 0, &all, RECORDING_NEURON_ORDER, threads, rows );
+		double neuron_ms = ms_since( start );
+		bool ok = n == n_spikes && !memcmp( rows, expected, n * 2 * sizeof( double ) );
+
+		start = now_ns();
+		n = recording_reader_spike_rows( &reader, 0, &all, RECORDING_TICK_ORDER, threads, rows );
+
+		double tick_ms = ms_since( start );
+
+		for( uint64_t r = 1; ok && r < n; r++ )
+			ok = rows[2 * r + 1] > rows[2 * r - 1] || ( rows[2 * r + 1] == rows[2 * r - 1] && rows[2 * r] > rows[2 * r - 2] );
+		n_failures += !ok || n != n_spikes;
+		printf( "%-8u %11.2f ms %9.2f ms %s\n", threads, neuron_ms, tick_ms, ok && n == n_spikes ? "" : "FAILED" );
+		}
+
+	// V, as get_v(), checked against the columns read directly
+	recording_window_t v_window = recording_reader_whole( &reader, 1 );
+	uint64_t n_v = recording_reader_count( &reader, 1, &v_window );
+	double* v_rows = malloc( 3 * n_v * V_NEURONS * sizeof( double ) );
+	uint32_t* v_ticks = malloc( n_v * sizeof( uint32_t ) );
+	int32_t* v_values = malloc( n_v * V_NEURONS * sizeof( int32_t ) );
+	bool ok = v_rows != NULL && v_ticks != NULL && v_values != NULL && n_v == n_ticks;
+
+	if( ok ) {
+		start = now_ns();
+		ok = recording_reader_state_rows( &reader, 1, &v_window, max_threads, v_rows ) == n_v * V_NEURONS;
+
+		double v_ms = ms_since( start );
+
+		ok = ok && recording_reader_read_state( &reader, 1, &v_window, v_ticks, v_values ) == n_v;
+		for( uint64_t r = 0; ok && r < n_v * V_NEURONS; r++ )
+			ok = v_rows[3 * r] == r / n_v && v_rows[3 * r + 1] == v_ticks[r % n_v]
+				 && v_rows[3 * r + 2] == v_values[r] / 32768.0;
+		printf( "\nV rows (get_v): %llu in %.2f ms %s\n", (unsigned long long) ( n_v * V_NEURONS ), v_ms,
+				ok ? "" : "FAILED" );
+		}
+	n_failures += !ok;
+
+	free( v_rows );
+	free( v_ticks );
+	free( v_values );
+	free( rows );
+	free( expected );
+	recording_reader_close( &reader );
+	remove( path );
+	return n_failures ? 1 : 0;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	const char* path = NULL;
+	const char* label = NULL;
+	const char* output = "read_recording_bench.rec";
+	recording_window_t window = { 0, UINT32_MAX, 0, UINT32_MAX };
+	uint64_t n_spikes = 10000000;
+	uint32_t n_neurons = 1024, n_threads = 0;
+	bool run_bench = false, tick_order = false, bad = false;
+
+	for( int i = 1; i < argc && !bad; i++ ) {
+		if( !strcmp( argv[i], "--bench" ) )
+			run_bench = true;
+		else if( !strcmp( argv[i], "--channel" ) && i + 1 < argc )
+			label = argv[++i];
+		else if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			bad = !parse_range( argv[++i], &window.first_tick, &window.end_tick );
+		else if( !strcmp( argv[i], "--neurons" ) && i + 1 < argc ) {
+			// a range when reading, a count when benchmarking
+			if( strchr( argv[i + 1], ':' ) )
+				bad = !parse_range( argv[++i], &window.first_neuron, &window.end_neuron );
+			else
+				n_neurons = strtoul( argv[++i], NULL, 0 );
+			}
+		else if( !strcmp( argv[i], "--order" ) && i + 1 < argc ) {
+			tick_order = !strcmp( argv[++i], "time" );
+			bad = !tick_order && strcmp( argv[i], "neuron" );
+			}
+		else if( !strcmp( argv[i], "--threads" ) && i + 1 < argc )
+			n_threads = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--spikes" ) && i + 1 < argc )
+			n_spikes = strtoull( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--output" ) && i + 1 < argc )
+			output = argv[++i];
+		else if( argv[i][0] != '-' && path == NULL )
+			path = argv[i];
+		else
+			bad = true;
+		}
+
+	if( bad || ( !run_bench && path == NULL ) ) {
+		fprintf( stderr, "usage: read_recording FILE [--channel LABEL] [--ticks FIRST:END] [--neurons FIRST:END]\n"
+						 "                      [--order neuron|time] [--threads N]\n"
+						 "       read_recording --bench [--spikes N] [--neurons N] [--threads N] [--output FILE]\n" );
+		return 1;
+		}
+
+	if( run_bench )
+		return bench( output, n_spikes, n_neurons, n_threads > 0 ? n_threads : online_cpus() );
+	return print_rows( path, label, window, tick_order, n_threads );
+}
@@ -0,0 +1,333 @@
+/*
+	Native live spike receiver (spike_receiver.c), in place of the
+	per-packet Python callback of receiver.py.
+
+		receive_spikes [--port P] [--ring N] [--batch B] [--seconds S]
+
+	prints "time_ns key payload" for every spike arriving on the stripped
+	IP tag port (default 18250) for S seconds (default 50, as receiver.py).
+
+		receive_spikes --bench [--seconds S] [--readers R]
+
+	runs a local synthetic sender at a range of rates against the
+	receiver and R concurrent readers, and reports per rate and recvmmsg
+	batch the spikes lost (to the kernel socket buffer and to ring
+	overruns) and the latency percentiles from send to kernel arrival and
+	from send to a reader having the spike.
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "eieio.h"
+#include "spike_injector.h"
+#include "spike_receiver.h"
+
+
+#define READ_EVENTS		4096
+#define MAX_READERS		8
+
+typedef struct {
+	spike_reader_t			reader;
+	const uint64_t*			send_ns;		// by key
+	uint32_t				n_sent;
+	volatile const bool*	stop;
+	uint32_t*				arrival_ns;		// latencies, one per spike received
+	uint32_t*				delivery_ns;
+	uint32_t				n_received;
+} bench_reader_t;
+
+
+static uint64_t realtime_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_REALTIME, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void sleep_until( uint64_t ns )
+{
+	struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR )
+		;
+}
+
+
+static inline uint32_t clamp_ns( uint64_t from, uint64_t to )
+{
+	return to <= from ? 0 : to - from > UINT32_MAX ? UINT32_MAX : to - from;
+}
+
+
+static void* reader_thread( void* arg )
+{
+	bench_reader_t* bench = arg;
+	static __thread spike_event_t events[READ_EVENTS];
+
+	for( ;; ) {
+		bool stopping = *bench->stop;
+		uint32_t n = spike_reader_wait( &bench->reader, events, READ_EVENTS, 1000000 );
+		uint64_t now = realtime_ns();
+
+		for( uint32_t e = 0; e < n; e++ ) {
+			if( events[e].key >= bench->n_sent )
+				continue;
+			bench->arrival_ns[bench->n_received] = clamp_ns( bench->send_ns[events[e].key], events[e].time_ns );
+			bench->delivery_ns[bench->n_received] = clamp_ns( bench->send_ns[events[e].key], now );
+			bench->n_received++;
+			}
+		if( n == 0 && stopping )
+			return NULL;
+		}
+}
+
+
+static int compare_uint32( const void* a, const void* b )
+{
+	uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+
+	return x < y ? -1 : x > y;
+}
+
+
+static void print_percentiles( uint32_t* values, uint32_t n )
+{
+	if( n == 0 ) {
+		printf( " %8s %8s %8s", "-", "-", "-" );
+		return;
+		}
+
+	qsort( values, n, sizeof( uint32_t ), compare_uint32 );
+	printf( " %8.1f %8.1f %8.1f", values[(uint64_t) n * 50 / 100] / 1e3, values[(uint64_t) n * 99 / 100] / 1e3,
+			values[(uint64_t) n * 999 / 1000] / 1e3 );
+}
+
+
+// sends n_spikes keys 0, 1, 2 ... at rate spikes/s (0 for as fast as
+// possible), a full message at a time, timing each message as it goes
+static void bench_case( double rate, uint32_t n_spikes, uint32_t batch, uint32_t n_readers )
+{
+	spike_receiver_t receiver;
+	spike_injector_t injector;
+	eieio_format_t format = { EIEIO_KEY_32_BIT, EIEIO_NO_PREFIX, 0, 0 };
+	bench_reader_t readers[MAX_READERS];
+	pthread_t threads[MAX_READERS];
+	volatile bool stop = false;
+
+	uint64_t* send_ns = malloc( n_spikes * sizeof( uint64_t ) );
+	uint32_t* keys = malloc( n_spikes * sizeof( uint32_t ) );
+
+	if( !send_ns || !keys || !spike_receiver_open( &receiver, 0, 1 << 20, batch ) ) {
+		fprintf( stderr, "cannot open a receiver\n" );
+		exit( 1 );
+		}
+	if( !spike_injector_open( &injector, "127.0.0.1", receiver.port, &format, 0, 1, 0.0 ) ) {
+		fprintf( stderr, "cannot open a sender\n" );
+		exit( 1 );
+		}
+
+	for( uint32_t k = 0; k < n_spikes; k++ )
+		keys[k] = k;
+
+	for( uint32_t r = 0; r < n_readers; r++ ) {
+		bench_reader_t* bench = &readers[r];
+
+		spike_reader_init( &bench->reader, &receiver );
+		bench->send_ns = send_ns;
+		bench->n_sent = n_spikes;
+		bench->stop = &stop;
+		bench->arrival_ns = malloc( n_spikes * sizeof( uint32_t ) );
+		bench->delivery_ns = malloc( n_spikes * sizeof( uint32_t ) );
+		bench->n_received = 0;
+		if( !bench->arrival_ns || !bench->delivery_ns
+			|| pthread_create( &threads[r], NULL, reader_thread, bench ) != 0 ) {
+			fprintf( stderr, "cannot start a reader\n" );
+			exit( 1 );
+			}
+		}
+
+	uint32_t per_message = injector.keys_per_message;
+	uint64_t start = now_ns(), interval = rate > 0.0 ? per_message * 1e9 / rate : 0;
+
+	for( uint32_t first = 0, m = 0; first < n_spikes; first += per_message, m++ ) {
+		uint32_t n = n_spikes - first < per_message ? n_spikes - first : per_message;
+
+		if( interval )
+			sleep_until( start + m * interval );
+
+		uint64_t t = realtime_ns();
+
+		for( uint32_t k = first; k < first + n; k++ )
+			send_ns[k] = t;
+		spike_injector_send( &injector, &keys[first], n );
+		spike_injector_flush( &injector );
+		}
+
+	double seconds = ( now_ns() - start ) / 1e9;
+
+	// let the receiver and readers drain before stopping them
+	struct timespec drain = { 0, 200000000 };
+
+	nanosleep( &drain, NULL );
+	stop = true;
+	for( uint32_t r = 0; r < n_readers; r++ )
+		pthread_join( threads[r], NULL );
+
+	uint64_t received = 0, ring_lost = 0;
+	uint32_t all = 0;
+
+	for( uint32_t r = 0; r < n_readers; r++ ) {
+		received += readers[r].n_received;
+		ring_lost += readers[r].reader.n_lost;
+		}
+
+	char label[32];
+
+	if( rate > 0.0 )
+		snprintf( label, sizeof( label ), "%.0f", rate );
+	else
+		snprintf( label, sizeof( label ), "max %.0f", n_spikes / seconds );
+
+	printf( "%-14s %5u %8.3f%% %8u %10llu", label, receiver.batch,
+			100.0 * ( 1.0 - (double) received / ( (uint64_t) n_spikes * n_readers ) ),
+			receiver.n_kernel_drops, (unsigned long long) ring_lost );
+
+	// percentiles over every reader's spikes together
+	uint32_t* arrival = malloc( ( received + 1 ) * sizeof( uint32_t ) );
+	uint32_t* delivery = malloc( ( received + 1 ) * sizeof( uint32_t ) );
+
+	for( uint32_t r = 0; r < n_readers; r++ ) {
+		memcpy( arrival + all, readers[r].arrival_ns, readers[r].n_received * sizeof( uint32_t ) );
+		memcpy( delivery + all, readers[r].delivery_ns, readers[r].n_received * sizeof( uint32_t ) );
+		all += readers[r].n_received;
+		}
+	print_percentiles( arrival, all );
+	print_percentiles( delivery, all );
+	free( arrival );
+	free( delivery );
+	printf( "\n" );
+
+	for( uint32_t r = 0; r < n_readers; r++ ) {
+		free( readers[r].arrival_ns );
+		free( readers[r].delivery_ns );
+		}
+	spike_injector_close( &injector );
+	spike_receiver_close( &receiver );
+	free( send_ns );
+	free( keys );
+}
+
+
+static int bench( double seconds, uint32_t n_readers )
+{
+	static const double rates[] = { 10000, 100000, 1000000, 10000000 };
+	static const uint32_t batches[] = { 1, 64 };
+
+	printf( "%u reader%s, %.1f s per rate, 63 keys per datagram; latencies in us\n",
+			n_readers, n_readers == 1 ? "" : "s", seconds );
+	printf( "%-14s %5s %9s %8s %10s %26s %26s\n", "spikes/s", "batch", "lost", "dropped", "overrun",
+			"arrival p50/p99/p99.9", "delivery p50/p99/p99.9" );
+
+	for( uint32_t b = 0; b < sizeof( batches ) / sizeof( batches[0] ); b++ ) {
+		for( uint32_t r = 0; r < sizeof( rates ) / sizeof( rates[0] ); r++ )
+			bench_case( rates[r], rates[r] * seconds, batches[b], n_readers );
+		bench_case( 0.0, 2000000, batches[b], n_readers );
+		}
+
+	return 0;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [--port P] [--ring N] [--batch B] [--seconds S]\n"
+			 "       %s --bench [--seconds S] [--readers R]\n"
+			 "  --port     live output port (default 18250)\n"
+			 "  --ring     ring size in spikes (default 1048576)\n"
+			 "  --batch    datagrams per recvmmsg (default 64)\n"
+			 "  --seconds  how long to listen (default 50), or to send at each bench rate (default 1)\n"
+			 "  --readers  concurrent readers in the bench (default 1, at most %u)\n"
+			 "  --bench    benchmark against a local synthetic sender\n",
+			 name, name, MAX_READERS );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t	port = LIVE_OUTPUT_PORT, ring = 1 << 20, batch = 64, n_readers = 1;
+	double		seconds = -1.0;
+	bool		run_bench = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--port" ) && i + 1 < argc )
+			port = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--ring" ) && i + 1 < argc )
+			ring = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--batch" ) && i + 1 < argc )
+			batch = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--seconds" ) && i + 1 < argc )
+			seconds = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--readers" ) && i + 1 < argc )
+			n_readers = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--bench" ) )
+			run_bench = true;
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( run_bench ) {
+		if( n_readers < 1 || n_readers > MAX_READERS ) {
+			usage( argv[0] );
+			return 1;
+			}
+		return bench( seconds > 0.0 ? seconds : 1.0, n_readers );
+		}
+
+	spike_receiver_t receiver;
+	spike_reader_t reader;
+	static spike_event_t events[READ_EVENTS];
+	uint64_t end = now_ns() + ( seconds > 0.0 ? seconds : 50.0 ) * 1e9;
+
+	if( !spike_receiver_open( &receiver, port, ring, batch ) ) {
+		fprintf( stderr, "cannot listen on port %u\n", port );
+		return 1;
+		}
+	spike_reader_init( &reader, &receiver );
+
+	while( now_ns() < end ) {
+		uint32_t n = spike_reader_wait( &reader, events, READ_EVENTS, 100000000 );
+
+		for( uint32_t e = 0; e < n; e++ )
+			printf( "%llu %08x %u\n", (unsigned long long) events[e].time_ns, events[e].key, events[e].payload );
+		}
+
+	fprintf( stderr, "%llu spikes in %llu datagrams, %llu malformed, %u dropped by the kernel, %llu overrun\n",
+			 (unsigned long long) spike_receiver_count( &receiver ), (unsigned long long) receiver.n_datagrams,
+			 (unsigned long long) receiver.n_malformed, receiver.n_kernel_drops,
+			 (unsigned long long) reader.n_lost );
+	spike_receiver_close( &receiver );
+
+	return 0;
+}
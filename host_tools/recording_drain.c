@@ -0,0 +1,130 @@
+/*
+	Buffered output drain; see recording_drain.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "recording_buffer.h"
+#include "spike_recording.h"
+#include "state_recording.h"
+#include "recording_drain.h"
+
+
+bool recording_drain_open( recording_drain_t* drain, const recording_source_t* source, recording_store_t* store,
+						   const recording_drain_channel_t* channels, uint32_t n_channels )
+{
+	uint32_t header[RECORDING_BUFFER_HEADER_WORDS];
+
+	memset( drain, 0, sizeof( *drain ) );
+	if( n_channels > RECORDING_STORE_MAX_CHANNELS
+		|| !source->read( source->context, 0, RECORDING_BUFFER_HEADER_WORDS, header ) )
+		return false;
+
+	drain->source = *source;
+	drain->store = store;
+	drain->n_channels = n_channels;
+	memcpy( drain->channels, channels, n_channels * sizeof( recording_drain_channel_t ) );
+	drain->capacity = header[RECORDING_BUFFER_CAPACITY];
+	drain->read_position = header[RECORDING_BUFFER_READ_POSITION];
+
+	// the ring is a power of two, as recording_buffer_initialise makes it
+	if( drain->capacity == 0 || ( drain->capacity & ( drain->capacity - 1 ) ) != 0 )
+		return false;
+
+	drain->scratch = malloc( drain->capacity * sizeof( uint32_t ) );
+	drain->neurons = malloc( 0x10000 * sizeof( uint16_t ) );
+	if( drain->scratch == NULL || drain->neurons == NULL ) {
+		recording_drain_close( drain );
+		return false;
+		}
+	for( uint32_t c = 0; c < n_channels; c++ )
+		if( channels[c].kind == RECORDING_STATE ) {
+			drain->values[c] = calloc( channels[c].n_neurons, sizeof( int32_t ) );
+			if( drain->values[c] == NULL ) {
+				recording_drain_close( drain );
+				return false;
+				}
+			}
+	return true;
+}
+
+
+static bool decode_chunk( recording_drain_t* drain, uint32_t channel, uint32_t tick, const uint32_t* payload,
+						  uint32_t length )
+{
+	if( channel >= drain->n_channels || length == 0 )
+		return false;
+
+	const recording_drain_channel_t* c = &drain->channels[channel];
+
+	if( c->kind == RECORDING_SPIKES ) {
+		uint32_t n_spikes;
+
+		return spike_recording_decode( payload, length, c->n_neurons, drain->neurons, &n_spikes ) == length
+			&& recording_store_add_spikes( drain->store, channel, tick, drain->neurons, n_spikes );
+		}
+	return state_recording_decode( payload, length, c->n_neurons, c->bits, c->shift, drain->values[channel] ) == length
+		&& recording_store_add_state( drain->store, channel, tick, drain->values[channel] );
+}
+
+
+int64_t recording_drain_poll( recording_drain_t* drain )
+{
+	recording_source_t* s = &drain->source;
+	uint32_t header[RECORDING_BUFFER_HEADER_WORDS];
+
+	drain->n_polls++;
+	if( !s->read( s->context, 0, RECORDING_BUFFER_HEADER_WORDS, header ) )
+		return -1;
+	drain->n_stalls = header[RECORDING_BUFFER_N_STALLS];
+
+	uint32_t fill = header[RECORDING_BUFFER_WRITE_POSITION] - drain->read_position;
+
+	if( fill == 0 )
+		return 0;
+	if( fill > drain->capacity )
+		return -1;
+	if( fill > drain->max_fill )
+		drain->max_fill = fill;
+
+	// at most two reads, either side of the end of the ring
+	uint32_t start = drain->read_position & ( drain->capacity - 1 );
+	uint32_t first = drain->capacity - start < fill ? drain->capacity - start : fill;
+
+	if( !s->read( s->context, RECORDING_BUFFER_HEADER_WORDS + start, first, drain->scratch )
+		|| ( first < fill && !s->read( s->context, RECORDING_BUFFER_HEADER_WORDS, fill - first, drain->scratch + first ) ) )
+		return -1;
+
+	for( uint32_t position = 0; position < fill; ) {
+		uint32_t length = RECORDING_CHUNK_LENGTH( drain->scratch[position] );
+
+		if( fill - position < RECORDING_CHUNK_HEADER_WORDS
+			|| length > fill - position - RECORDING_CHUNK_HEADER_WORDS
+			|| !decode_chunk( drain, RECORDING_CHUNK_CHANNEL( drain->scratch[position] ), drain->scratch[position + 1],
+							  drain->scratch + position + RECORDING_CHUNK_HEADER_WORDS, length ) )
+			return -1;
+		position += RECORDING_CHUNK_HEADER_WORDS + length;
+		drain->n_chunks++;
+		}
+
+	// only now may the core write over what was read
+	drain->read_position += fill;
+	if( !s->write( s->context, RECORDING_BUFFER_READ_POSITION, drain->read_position ) )
+		return -1;
+	drain->n_words += fill;
+	return fill;
+}
+
+
+void recording_drain_close( recording_drain_t* drain )
+{
+	for( uint32_t c = 0; c < RECORDING_STORE_MAX_CHANNELS; c++ ) {
+		free( drain->values[c] );
+		drain->values[c] = NULL;
+		}
+	free( drain->scratch );
+	free( drain->neurons );
+	drain->scratch = NULL;
+	drain->neurons = NULL;
+}
@@ -0,0 +1,78 @@
+/*! \file
+ *
+ *  \brief Host side of buffered output: drains a core's recording ring
+ *    (neural_models/recording_buffer.h) during the run into a columnar
+ *    recording store.
+ *
+ *  \details Each poll reads the core's write position, copies every
+ *    whole tick written since the last poll out of the ring in at most
+ *    two reads, decodes the spike and state records into rows of the
+ *    store, and only then hands the space back by writing the read
+ *    position.  The region is reached through a recording_source_t, an
+ *    SCP read and write of the core's SDRAM on a board or plain memory
+ *    for a local stand-in, so the drain does not care which.  A host
+ *    that keeps up never makes the core wait; one that falls behind
+ *    shows as the core's stall count.
+ *
+ */
+
+#ifndef __RECORDING_DRAIN_H__
+#define __RECORDING_DRAIN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "recording_store.h"
+
+//! \brief Access to a core's recording region, in words from its start.
+typedef struct {
+	bool	( *read )( void* context, uint32_t offset, uint32_t n_words, uint32_t* out );
+	bool	( *write )( void* context, uint32_t offset, uint32_t word );
+	void*	context;
+} recording_source_t;
+
+//! \brief How to decode a channel's chunks; its store channel has the same number.
+typedef struct {
+	recording_kind_t	kind;
+	uint32_t			n_neurons;
+	uint32_t			bits;			//!< state codec, as state_recording_initialise
+	uint32_t			shift;
+} recording_drain_channel_t;
+
+typedef struct {
+	recording_source_t			source;
+	recording_store_t*			store;
+	recording_drain_channel_t	channels[RECORDING_STORE_MAX_CHANNELS];
+	uint32_t					n_channels;
+	int32_t*					values[RECORDING_STORE_MAX_CHANNELS];	//!< state channels' last values
+	uint16_t*					neurons;
+
+	uint32_t					capacity;
+	uint32_t					read_position;
+	uint32_t*					scratch;		//!< capacity words
+
+	uint64_t					n_polls;
+	uint64_t					n_chunks;
+	uint64_t					n_words;
+	uint32_t					max_fill;		//!< words waiting at a poll
+	uint32_t					n_stalls;		//!< the core's, as of the last poll
+} recording_drain_t;
+
+
+//! \brief Reads the ring's capacity and read position from the region.
+//! \return false if the region cannot be read or memory allocated
+
+bool recording_drain_open( recording_drain_t* drain, const recording_source_t* source, recording_store_t* store,
+						   const recording_drain_channel_t* channels, uint32_t n_channels );
+
+//! \brief Drains everything the core has published.
+//! \return Words drained, or -1 if the region cannot be reached, a chunk
+//! is malformed or the store cannot be written
+
+int64_t recording_drain_poll( recording_drain_t* drain );
+
+//! \brief Frees the drain; the store stays open.
+
+void recording_drain_close( recording_drain_t* drain );
+
+#endif /*__RECORDING_DRAIN_H__*/
@@ -0,0 +1,606 @@
+/*
+	Recording store reader; see recording_reader.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "thread_pool.h"
+#include "recording_reader.h"
+
+#define HEADER_BYTES		12
+#define CHANNEL_BYTES		( 3 * sizeof( uint32_t ) + RECORDING_STORE_LABEL_BYTES )
+#define BLOCK_HEADER_BYTES	20
+#define INDEX_ENTRY_BYTES	24
+#define STRIPES_PER_THREAD	4
+
+//! \brief Rows [first_row, end_row) of one block.
+typedef struct {
+	const recording_block_t*	block;
+	uint32_t					first_row;
+	uint32_t					end_row;
+} piece_t;
+
+//! \brief A window's rows, block by block in tick order.
+typedef struct {
+	piece_t*	pieces;
+	uint32_t	n_pieces;
+	uint64_t	n_rows;
+} slice_t;
+
+typedef struct {
+	recording_window_t	window;
+	slice_t				slice;
+	recording_order_t	order;
+	double				ms_per_tick;
+	uint32_t			n_stripes;
+	uint32_t			width;			//!< neurons in the window
+	uint64_t*			offsets;		//!< per stripe: its count, then its first row (per neuron in neuron order)
+	double*				rows;
+	uint32_t*			trains;			//!< or just the ticks, neuron by neuron
+} convert_t;
+
+
+static uint32_t load_word( const uint8_t* at )
+{
+	uint32_t word;
+
+	memcpy( &word, at, sizeof( word ) );
+	return word;
+}
+
+
+static uint64_t load_long( const uint8_t* at )
+{
+	uint64_t word;
+
+	memcpy( &word, at, sizeof( word ) );
+	return word;
+}
+
+
+//! \brief Checks the block header at offset and its columns against its
+//! channel.  Returns the offset after it, or 0 if it is not a whole block.
+static uint64_t parse_block( const recording_reader_t* reader, uint64_t offset, recording_block_t* block )
+{
+	if( reader->size - offset < BLOCK_HEADER_BYTES )
+		return 0;
+
+	const uint8_t* at = reader->map + offset;
+
+	block->channel = load_word( at );
+	block->n_rows = load_word( at + 4 );
+	block->first_tick = load_word( at + 8 );
+	block->last_tick = load_word( at + 12 );
+	if( block->channel >= reader->n_channels || block->n_rows == 0 || block->last_tick < block->first_tick )
+		return 0;
+
+	const recording_channel_t* channel = &reader->channels[block->channel];
+	bool spikes = channel->kind == RECORDING_SPIKES;
+	uint32_t n_columns = load_word( at + 16 );
+
+	if( n_columns != ( spikes ? 2 : 1 + channel->n_neurons ) )
+		return 0;
+
+	offset += BLOCK_HEADER_BYTES;
+	for( uint32_t c = 0; c < n_columns; c++ ) {
+		uint64_t bytes = (uint64_t) block->n_rows * ( spikes && c == 1 ? sizeof( uint16_t ) : sizeof( uint32_t ) );
+
+		if( reader->size - offset < 4 + bytes || load_word( reader->map + offset ) != bytes )
+			return 0;
+		if( c == 0 )
+			block->ticks = (const uint32_t*) ( reader->map + offset + 4 );
+		else if( spikes )
+			block->neurons = (const uint16_t*) ( reader->map + offset + 4 );
+		else if( c == 1 )
+			block->values = (const int32_t*) ( reader->map + offset + 4 );
+		offset += 4 + ( bytes + 3 ) / 4 * 4;
+		}
+
+	// each state column is the length word and n_rows values
+	block->stride = block->n_rows + 1;
+	return offset;
+}
+
+
+static bool add_block( recording_reader_t* reader, const recording_block_t* block, uint32_t* max_blocks )
+{
+	if( reader->n_blocks == *max_blocks ) {
+		uint32_t n = *max_blocks > 0 ? 2 * *max_blocks : 256;
+		recording_block_t* blocks = realloc( reader->blocks, n * sizeof( recording_block_t ) );
+
+		if( blocks == NULL )
+			return false;
+		reader->blocks = blocks;
+		*max_blocks = n;
+		}
+	reader->blocks[reader->n_blocks++] = *block;
+	return true;
+}
+
+
+//! \brief Reads the blocks from the index in the footer.
+static bool read_index( recording_reader_t* reader, uint64_t first_block )
+{
+	if( reader->size - first_block < RECORDING_STORE_FOOTER_BYTES
+		|| memcmp( reader->map + reader->size - 8, RECORDING_STORE_INDEX_MAGIC, 8 ) )
+		return false;
+
+	const uint8_t* footer = reader->map + reader->size - RECORDING_STORE_FOOTER_BYTES;
+	uint64_t index_offset = load_long( footer );
+	uint32_t n_blocks = load_word( footer + 8 ), max_blocks = 0;
+
+	if( index_offset < first_block
+		|| index_offset + (uint64_t) n_blocks * INDEX_ENTRY_BYTES + RECORDING_STORE_FOOTER_BYTES != reader->size )
+		return false;
+
+	for( uint32_t b = 0; b < n_blocks; b++ ) {
+		const uint8_t* entry = reader->map + index_offset + (uint64_t) b * INDEX_ENTRY_BYTES;
+		uint64_t offset = load_long( entry + 16 );
+		recording_block_t block = { 0 };
+
+		if( offset < first_block || offset >= index_offset || parse_block( reader, offset, &block ) == 0
+			|| block.channel != load_word( entry ) || block.n_rows != load_word( entry + 4 )
+			|| !add_block( reader, &block, &max_blocks ) )
+			return false;
+		}
+	return true;
+}
+
+
+//! \brief Finds the blocks by walking their headers, up to the first that
+//! is not whole.
+static bool walk_blocks( recording_reader_t* reader, uint64_t offset )
+{
+	uint32_t max_blocks = 0;
+	recording_block_t block = { 0 };
+
+	reader->n_blocks = 0;
+	for( uint64_t next; ( next = parse_block( reader, offset, &block ) ) != 0; offset = next )
+		if( !add_block( reader, &block, &max_blocks ) )
+			return false;
+	return true;
+}
+
+
+bool recording_reader_open( recording_reader_t* reader, const char* path )
+{
+	struct stat st;
+	int fd = open( path, O_RDONLY );
+
+	memset( reader, 0, sizeof( *reader ) );
+	if( fd < 0 )
+		return false;
+	if( fstat( fd, &st ) != 0 || st.st_size < HEADER_BYTES ) {
+		close( fd );
+		return false;
+		}
+
+	void* map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+	close( fd );
+	if( map == MAP_FAILED )
+		return false;
+	reader->map = map;
+	reader->size = st.st_size;
+
+	reader->n_channels = load_word( reader->map + 8 );
+	if( memcmp( reader->map, RECORDING_STORE_MAGIC, 8 ) || reader->n_channels > RECORDING_STORE_MAX_CHANNELS
+		|| reader->size < HEADER_BYTES + reader->n_channels * CHANNEL_BYTES ) {
+		recording_reader_close( reader );
+		return false;
+		}
+
+	for( uint32_t c = 0; c < reader->n_channels; c++ ) {
+		const uint8_t* at = reader->map + HEADER_BYTES + c * CHANNEL_BYTES;
+		recording_channel_t* channel = &reader->channels[c];
+
+		channel->kind = load_word( at );
+		channel->n_neurons = load_word( at + 4 );
+		channel->time_step_us = load_word( at + 8 );
+		memcpy( channel->label, at + 12, RECORDING_STORE_LABEL_BYTES );
+		channel->label[RECORDING_STORE_LABEL_BYTES - 1] = '\0';
+		if( ( channel->kind != RECORDING_SPIKES && channel->kind != RECORDING_STATE )
+			|| ( channel->kind == RECORDING_SPIKES && channel->n_neurons > 0x10000 ) ) {
+			recording_reader_close( reader );
+			return false;
+			}
+		}
+
+	uint64_t first_block = HEADER_BYTES + reader->n_channels * CHANNEL_BYTES;
+
+	reader->indexed = read_index( reader, first_block );
+	if( !reader->indexed && !walk_blocks( reader, first_block ) ) {
+		recording_reader_close( reader );
+		return false;
+		}
+
+	// a channel's blocks are in tick order in the file
+	for( uint32_t c = 0; c < reader->n_channels; c++ ) {
+		reader->channel_blocks[c] = malloc( ( reader->n_blocks + 1 ) * sizeof( uint32_t ) );
+		if( reader->channel_blocks[c] == NULL ) {
+			recording_reader_close( reader );
+			return false;
+			}
+		}
+	for( uint32_t b = 0; b < reader->n_blocks; b++ ) {
+		uint32_t c = reader->blocks[b].channel;
+
+		reader->channel_blocks[c][reader->n_channel_blocks[c]++] = b;
+		}
+	return true;
+}
+
+
+void recording_reader_close( recording_reader_t* reader )
+{
+	if( reader->map != NULL )
+		munmap( (void*) reader->map, reader->size );
+	for( uint32_t c = 0; c < RECORDING_STORE_MAX_CHANNELS; c++ )
+		free( reader->channel_blocks[c] );
+	free( reader->blocks );
+	memset( reader, 0, sizeof( *reader ) );
+}
+
+
+int recording_reader_find_channel( const recording_reader_t* reader, const char* label )
+{
+	for( uint32_t c = 0; c < reader->n_channels; c++ )
+		if( !strcmp( reader->channels[c].label, label ) )
+			return c;
+	return -1;
+}
+
+
+recording_window_t recording_reader_whole( const recording_reader_t* reader, uint32_t channel )
+{
+	return ( recording_window_t ) { 0, UINT32_MAX, 0, reader->channels[channel].n_neurons };
+}
+
+
+//! \brief The first row with a tick at least tick.
+static uint32_t lower_bound( const uint32_t* ticks, uint32_t n, uint32_t tick )
+{
+	uint32_t low = 0, high = n;
+
+	while( low < high ) {
+		uint32_t middle = low + ( high - low ) / 2;
+
+		if( ticks[middle] < tick )
+			low = middle + 1;
+		else
+			high = middle;
+		}
+	return low;
+}
+
+
+//! \brief Finds the rows of a window's ticks.  Neurons are left to the
+//! caller; a spike block is not sorted by them.
+static bool find_slice( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window,
+						slice_t* slice )
+{
+	const uint32_t* blocks = reader->channel_blocks[channel];
+	uint32_t n_blocks = reader->n_channel_blocks[channel], low = 0, high = n_blocks;
+
+	memset( slice, 0, sizeof( *slice ) );
+	if( channel >= reader->n_channels || window->first_tick >= window->end_tick )
+		return true;
+
+	// the first block that ends at or after the window starts
+	while( low < high ) {
+		uint32_t middle = low + ( high - low ) / 2;
+
+		if( reader->blocks[blocks[middle]].last_tick < window->first_tick )
+			low = middle + 1;
+		else
+			high = middle;
+		}
+
+	uint32_t end = low;
+
+	while( end < n_blocks && reader->blocks[blocks[end]].first_tick < window->end_tick )
+		end++;
+	if( end == low )
+		return true;
+
+	slice->pieces = malloc( ( end - low ) * sizeof( piece_t ) );
+	if( slice->pieces == NULL )
+		return false;
+
+	for( uint32_t b = low; b < end; b++ ) {
+		const recording_block_t* block = &reader->blocks[blocks[b]];
+		piece_t piece = { block, 0, block->n_rows };
+
+		if( block->first_tick < window->first_tick )
+			piece.first_row = lower_bound( block->ticks, block->n_rows, window->first_tick );
+		if( block->last_tick >= window->end_tick )
+			piece.end_row = lower_bound( block->ticks, block->n_rows, window->end_tick );
+		if( piece.end_row > piece.first_row ) {
+			slice->pieces[slice->n_pieces++] = piece;
+			slice->n_rows += piece.end_row - piece.first_row;
+			}
+		}
+	return true;
+}
+
+
+static recording_window_t clip( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window )
+{
+	recording_window_t clipped = *window;
+	uint32_t n_neurons = reader->channels[channel].n_neurons;
+
+	if( clipped.end_neuron > n_neurons )
+		clipped.end_neuron = n_neurons;
+	if( clipped.first_neuron > clipped.end_neuron )
+		clipped.first_neuron = clipped.end_neuron;
+	return clipped;
+}
+
+
+static bool all_neurons( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window )
+{
+	return window->first_neuron == 0 && window->end_neuron == reader->channels[channel].n_neurons;
+}
+
+
+uint64_t recording_reader_count( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window )
+{
+	slice_t slice;
+
+	if( channel >= reader->n_channels || !find_slice( reader, channel, window, &slice ) )
+		return 0;
+
+	recording_window_t w = clip( reader, channel, window );
+	uint64_t n = slice.n_rows;
+
+	if( reader->channels[channel].kind == RECORDING_SPIKES && !all_neurons( reader, channel, &w ) ) {
+		n = 0;
+		for( uint32_t p = 0; p < slice.n_pieces; p++ ) {
+			const piece_t* piece = &slice.pieces[p];
+
+			for( uint32_t r = piece->first_row; r < piece->end_row; r++ )
+				n += piece->block->neurons[r] - w.first_neuron < w.end_neuron - w.first_neuron;
+			}
+		}
+	free( slice.pieces );
+	return n;
+}
+
+
+uint64_t recording_reader_read_spikes( const recording_reader_t* reader, uint32_t channel,
+									   const recording_window_t* window, uint32_t* ticks, uint16_t* neurons )
+{
+	slice_t slice;
+
+	if( channel >= reader->n_channels || reader->channels[channel].kind != RECORDING_SPIKES
+		|| !find_slice( reader, channel, window, &slice ) )
+		return 0;
+
+	recording_window_t w = clip( reader, channel, window );
+	uint64_t n = 0;
+
+	for( uint32_t p = 0; p < slice.n_pieces; p++ ) {
+		const piece_t* piece = &slice.pieces[p];
+
+		for( uint32_t r = piece->first_row; r < piece->end_row; r++ )
+			if( piece->block->neurons[r] - w.first_neuron < w.end_neuron - w.first_neuron ) {
+				ticks[n] = piece->block->ticks[r];
+				neurons[n++] = piece->block->neurons[r];
+				}
+		}
+	free( slice.pieces );
+	return n;
+}
+
+
+uint64_t recording_reader_read_state( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, uint32_t* ticks, int32_t* values )
+{
+	slice_t slice;
+
+	if( channel >= reader->n_channels || reader->channels[channel].kind != RECORDING_STATE
+		|| !find_slice( reader, channel, window, &slice ) )
+		return 0;
+
+	recording_window_t w = clip( reader, channel, window );
+	uint64_t n = 0;
+
+	for( uint32_t p = 0; p < slice.n_pieces; p++ ) {
+		const piece_t* piece = &slice.pieces[p];
+		uint32_t rows = piece->end_row - piece->first_row;
+
+		memcpy( ticks + n, piece->block->ticks + piece->first_row, rows * sizeof( uint32_t ) );
+		for( uint32_t i = w.first_neuron; i < w.end_neuron; i++ )
+			memcpy( values + ( i - w.first_neuron ) * slice.n_rows + n,
+					piece->block->values + (size_t) i * piece->block->stride + piece->first_row,
+					rows * sizeof( int32_t ) );
+		n += rows;
+		}
+	free( slice.pieces );
+	return n;
+}
+
+
+//! \brief The pieces of stripe s: the slice split evenly by piece.
+static void stripe_pieces( const convert_t* convert, uint32_t s, uint32_t* first, uint32_t* end )
+{
+	*first = (uint64_t) s * convert->slice.n_pieces / convert->n_stripes;
+	*end = (uint64_t) ( s + 1 ) * convert->slice.n_pieces / convert->n_stripes;
+}
+
+
+static void count_stripe( uint32_t s, void* context )
+{
+	convert_t* convert = context;
+	uint32_t first, end, first_neuron = convert->window.first_neuron, width = convert->width;
+	uint64_t* counts = convert->offsets + (size_t) s * ( convert->order == RECORDING_NEURON_ORDER ? width : 1 );
+
+	stripe_pieces( convert, s, &first, &end );
+	for( uint32_t p = first; p < end; p++ ) {
+		const piece_t* piece = &convert->slice.pieces[p];
+		const uint16_t* neurons = piece->block->neurons;
+
+		if( convert->order == RECORDING_NEURON_ORDER )
+			for( uint32_t r = piece->first_row; r < piece->end_row; r++ ) {
+				uint32_t i = neurons[r] - first_neuron;
+
+				if( i < width )
+					counts[i]++;
+				}
+		else
+			for( uint32_t r = piece->first_row; r < piece->end_row; r++ )
+				*counts += neurons[r] - first_neuron < width;
+		}
+}
+
+
+static void scatter_stripe( uint32_t s, void* context )
+{
+	convert_t* convert = context;
+	uint32_t first, end, first_neuron = convert->window.first_neuron, width = convert->width;
+	uint64_t* offsets = convert->offsets + (size_t) s * ( convert->order == RECORDING_NEURON_ORDER ? width : 1 );
+	double* rows = convert->rows;
+
+	stripe_pieces( convert, s, &first, &end );
+	for( uint32_t p = first; p < end; p++ ) {
+		const piece_t* piece = &convert->slice.pieces[p];
+		const uint32_t* ticks = piece->block->ticks;
+		const uint16_t* neurons = piece->block->neurons;
+
+		for( uint32_t r = piece->first_row; r < piece->end_row; r++ ) {
+			uint32_t i = neurons[r] - first_neuron;
+
+			if( i < width ) {
+				uint64_t row = convert->order == RECORDING_NEURON_ORDER ? offsets[i]++ : ( *offsets )++;
+
+				if( convert->trains != NULL )
+					convert->trains[row] = ticks[r];
+				else {
+					rows[2 * row] = neurons[r];
+					rows[2 * row + 1] = ticks[r] * convert->ms_per_tick;
+					}
+				}
+			}
+		}
+}
+
+
+//! \brief Counts, then scatters, a window's spikes in the convert's order.
+static uint64_t convert_spikes( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window,
+								uint32_t n_threads, convert_t* convert, uint64_t* starts )
+{
+	if( channel >= reader->n_channels || reader->channels[channel].kind != RECORDING_SPIKES
+		|| !find_slice( reader, channel, window, &convert->slice ) )
+		return 0;
+
+	if( n_threads == 0 )
+		n_threads = online_cpus();
+	convert->window = clip( reader, channel, window );
+	convert->width = convert->window.end_neuron - convert->window.first_neuron;
+	convert->ms_per_tick = reader->channels[channel].time_step_us / 1000.0;
+	convert->n_stripes = n_threads * STRIPES_PER_THREAD;
+	if( convert->n_stripes > convert->slice.n_pieces )
+		convert->n_stripes = convert->slice.n_pieces;
+	if( starts != NULL )
+		memset( starts, 0, ( convert->width + 1 ) * sizeof( uint64_t ) );
+	if( convert->n_stripes == 0 || convert->width == 0 ) {
+		free( convert->slice.pieces );
+		return 0;
+		}
+
+	uint32_t per_stripe = convert->order == RECORDING_NEURON_ORDER ? convert->width : 1;
+
+	convert->offsets = calloc( (size_t) convert->n_stripes * per_stripe, sizeof( uint64_t ) );
+	if( convert->offsets == NULL ) {
+		free( convert->slice.pieces );
+		return 0;
+		}
+
+	parallel_for( n_threads, convert->n_stripes, count_stripe, convert );
+
+	// counts to first rows: neuron by neuron, and within a neuron stripe by
+	// stripe, which keeps each neuron's spikes in tick order
+	uint64_t n = 0;
+
+	for( uint32_t i = 0; i < per_stripe; i++ )
+		for( uint32_t s = 0; s < convert->n_stripes; s++ ) {
+			uint64_t count = convert->offsets[(size_t) s * per_stripe + i];
+
+			convert->offsets[(size_t) s * per_stripe + i] = n;
+			n += count;
+			}
+	if( starts != NULL ) {
+		for( uint32_t i = 0; i < convert->width; i++ )
+			starts[i] = convert->offsets[i];
+		starts[convert->width] = n;
+		}
+
+	parallel_for( n_threads, convert->n_stripes, scatter_stripe, convert );
+
+	free( convert->offsets );
+	free( convert->slice.pieces );
+	return n;
+}
+
+
+uint64_t recording_reader_spike_rows( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, recording_order_t order, uint32_t n_threads,
+									  double* rows )
+{
+	convert_t convert = { .order = order, .rows = rows };
+
+	return convert_spikes( reader, channel, window, n_threads, &convert, NULL );
+}
+
+
+uint64_t recording_reader_spike_trains( const recording_reader_t* reader, uint32_t channel,
+										const recording_window_t* window, uint32_t n_threads, uint32_t* ticks,
+										uint64_t* starts )
+{
+	convert_t convert = { .order = RECORDING_NEURON_ORDER, .trains = ticks };
+
+	return convert_spikes( reader, channel, window, n_threads, &convert, starts );
+}
+
+
+static void state_neuron( uint32_t index, void* context )
+{
+	convert_t* convert = context;
+	uint32_t i = convert->window.first_neuron + index;
+	double* row = convert->rows + 3 * (size_t) index * convert->slice.n_rows;
+
+	for( uint32_t p = 0; p < convert->slice.n_pieces; p++ ) {
+		const piece_t* piece = &convert->slice.pieces[p];
+		const int32_t* values = piece->block->values + (size_t) i * piece->block->stride;
+
+		for( uint32_t r = piece->first_row; r < piece->end_row; r++, row += 3 ) {
+			row[0] = i;
+			row[1] = piece->block->ticks[r] * convert->ms_per_tick;
+			row[2] = values[r] / 32768.0;
+			}
+		}
+}
+
+
+uint64_t recording_reader_state_rows( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, uint32_t n_threads, double* rows )
+{
+	convert_t convert = { .rows = rows };
+
+	if( channel >= reader->n_channels || reader->channels[channel].kind != RECORDING_STATE
+		|| !find_slice( reader, channel, window, &convert.slice ) )
+		return 0;
+
+	convert.window = clip( reader, channel, window );
+	convert.width = convert.window.end_neuron - convert.window.first_neuron;
+	convert.ms_per_tick = reader->channels[channel].time_step_us / 1000.0;
+	parallel_for( n_threads, convert.width, state_neuron, &convert );
+
+	free( convert.slice.pieces );
+	return (uint64_t) convert.width * convert.slice.n_rows;
+}
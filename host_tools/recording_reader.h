@@ -0,0 +1,135 @@
+/*! \file
+ *
+ *  \brief Reader for recording stores (recording_store.h): time window and
+ *    neuron range slices straight out of a mapping of the file, and
+ *    parallel conversion to the rows getSpikes(), get_v() and get_gsyn()
+ *    return with compatible_output=True.
+ *
+ *  \details Opening maps the file and reads the block index from its
+ *    footer, or walks the block headers if the run did not finish and
+ *    left none.  A slice finds its first and last blocks by binary search
+ *    of the channel's blocks on their tick ranges, then its rows within
+ *    them by binary search of the sorted tick column, so it only touches
+ *    the pages it returns.  Columns are used where they lie in the
+ *    mapping; nothing is copied until the caller asks for rows.
+ *
+ *    Conversion to rows runs on a thread_pool.h pool over stripes of the
+ *    slice.  In tick order each stripe writes at its own offset.  In
+ *    neuron order, as getSpikes() sorts, it is a stable counting sort:
+ *    each stripe counts its spikes per neuron, the counts give every
+ *    stripe its own offset per neuron, and each stripe then scatters its
+ *    spikes, so every neuron's spikes stay in tick order.
+ *
+ */
+
+#ifndef __RECORDING_READER_H__
+#define __RECORDING_READER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "recording_store.h"
+
+//! \brief A block's columns, in the mapping.
+typedef struct {
+	uint32_t			channel;
+	uint32_t			n_rows;
+	uint32_t			first_tick;
+	uint32_t			last_tick;
+	const uint32_t*		ticks;
+	const uint16_t*		neurons;		//!< spikes
+	const int32_t*		values;			//!< state: neuron i's column at values + i * stride
+	uint32_t			stride;
+} recording_block_t;
+
+//! \brief Ticks [first_tick, end_tick) of neurons [first_neuron, end_neuron).
+typedef struct {
+	uint32_t	first_tick;
+	uint32_t	end_tick;
+	uint32_t	first_neuron;
+	uint32_t	end_neuron;
+} recording_window_t;
+
+typedef enum { RECORDING_TICK_ORDER, RECORDING_NEURON_ORDER } recording_order_t;
+
+typedef struct {
+	const uint8_t*			map;
+	size_t					size;
+	uint32_t				n_channels;
+	recording_channel_t		channels[RECORDING_STORE_MAX_CHANNELS];
+	recording_block_t*		blocks;			//!< in file order
+	uint32_t				n_blocks;
+	uint32_t*				channel_blocks[RECORDING_STORE_MAX_CHANNELS];	//!< indices into blocks, in tick order
+	uint32_t				n_channel_blocks[RECORDING_STORE_MAX_CHANNELS];
+	bool					indexed;		//!< the footer's index was used
+} recording_reader_t;
+
+
+//! \brief Maps a store and reads its index.
+//! \return false if the file cannot be mapped or is not a recording store
+
+bool recording_reader_open( recording_reader_t* reader, const char* path );
+
+//! \brief Unmaps the store; no block pointers may be used after.
+
+void recording_reader_close( recording_reader_t* reader );
+
+//! \brief The channel with the label, or -1.
+
+int recording_reader_find_channel( const recording_reader_t* reader, const char* label );
+
+//! \brief Every tick of every neuron of a channel.
+
+recording_window_t recording_reader_whole( const recording_reader_t* reader, uint32_t channel );
+
+//! \brief The spikes, or recorded ticks of a state channel, in a window.
+
+uint64_t recording_reader_count( const recording_reader_t* reader, uint32_t channel, const recording_window_t* window );
+
+//! \brief Copies a window's spikes in tick order.
+//! \param[out] ticks, neurons recording_reader_count rows each
+//! \return The spikes copied
+
+uint64_t recording_reader_read_spikes( const recording_reader_t* reader, uint32_t channel,
+									   const recording_window_t* window, uint32_t* ticks, uint16_t* neurons );
+
+//! \brief Copies a window of a state channel, a column per neuron.
+//! \param[out] ticks recording_reader_count rows
+//! \param[out] values The same number of rows for each neuron in the window,
+//! neuron by neuron, s16.15
+//! \return The rows copied
+
+uint64_t recording_reader_read_state( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, uint32_t* ticks, int32_t* values );
+
+//! \brief A window's spikes as getSpikes( compatible_output=True ) rows,
+//! (neuron, time in ms).
+//! \param[out] rows 2 * recording_reader_count doubles
+//! \param[in] n_threads 0 for one per online CPU
+//! \return The rows written
+
+uint64_t recording_reader_spike_rows( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, recording_order_t order, uint32_t n_threads,
+									  double* rows );
+
+//! \brief A window's spikes as spike trains, for analysis (spike_analysis.h).
+//! \param[out] ticks recording_reader_count ticks: each neuron's in order,
+//! neuron by neuron
+//! \param[out] starts One more than the neurons in the window: the first of
+//! each neuron's ticks, then the total
+//! \return The spikes written
+
+uint64_t recording_reader_spike_trains( const recording_reader_t* reader, uint32_t channel,
+										const recording_window_t* window, uint32_t n_threads, uint32_t* ticks,
+										uint64_t* starts );
+
+//! \brief A window of a state channel as get_v( compatible_output=True )
+//! rows, (neuron, time in ms, value), neuron by neuron.
+//! \param[out] rows 3 doubles per recorded tick per neuron in the window
+//! \return The rows written
+
+uint64_t recording_reader_state_rows( const recording_reader_t* reader, uint32_t channel,
+									  const recording_window_t* window, uint32_t n_threads, double* rows );
+
+#endif /*__RECORDING_READER_H__*/
@@ -0,0 +1,205 @@
+/*
+	Columnar recording store writer; see recording_store.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "recording_store.h"
+
+
+static bool write_bytes( recording_store_t* store, const void* data, size_t bytes )
+{
+	if( !store->failed && fwrite( data, 1, bytes, store->file ) != bytes )
+		store->failed = true;
+	store->n_bytes += bytes;
+	return !store->failed;
+}
+
+
+static bool write_word( recording_store_t* store, uint32_t word )
+{
+	return write_bytes( store, &word, sizeof( word ) );
+}
+
+
+static void write_column( recording_store_t* store, const void* data, uint32_t bytes )
+{
+	static const uint8_t padding[4] = { 0 };
+
+	write_word( store, bytes );
+	write_bytes( store, data, bytes );
+	write_bytes( store, padding, ( 4 - bytes % 4 ) % 4 );
+}
+
+
+static void flush_block( recording_store_t* store, uint32_t channel )
+{
+	recording_column_buffer_t* buffer = &store->buffers[channel];
+	uint32_t n = buffer->n_rows;
+
+	if( n == 0 )
+		return;
+
+	bool spikes = buffer->channel.kind == RECORDING_SPIKES;
+
+	if( store->n_blocks == store->max_blocks ) {
+		uint64_t max_blocks = store->max_blocks > 0 ? 2 * store->max_blocks : 256;
+		recording_block_index_t* index = realloc( store->index, max_blocks * sizeof( recording_block_index_t ) );
+
+		if( index == NULL ) {
+			store->failed = true;
+			return;
+			}
+		store->index = index;
+		store->max_blocks = max_blocks;
+		}
+	store->index[store->n_blocks] = ( recording_block_index_t ) {
+		channel, n, buffer->first_tick, buffer->last_tick, store->n_bytes };
+
+	write_word( store, channel );
+	write_word( store, n );
+	write_word( store, buffer->first_tick );
+	write_word( store, buffer->last_tick );
+	write_word( store, spikes ? 2 : 1 + buffer->channel.n_neurons );
+	write_column( store, buffer->ticks, n * sizeof( uint32_t ) );
+	if( spikes )
+		write_column( store, buffer->neurons, n * sizeof( uint16_t ) );
+	else
+		for( uint32_t i = 0; i < buffer->channel.n_neurons; i++ )
+			write_column( store, buffer->values + (size_t) i * store->block_rows, n * sizeof( int32_t ) );
+
+	buffer->n_rows = 0;
+	store->n_blocks++;
+}
+
+
+bool recording_store_create( recording_store_t* store, const char* path, const recording_channel_t* channels,
+							 uint32_t n_channels, uint32_t block_rows )
+{
+	memset( store, 0, sizeof( *store ) );
+	if( n_channels > RECORDING_STORE_MAX_CHANNELS )
+		return false;
+
+	store->n_channels = n_channels;
+	store->block_rows = block_rows > 0 ? block_rows : RECORDING_STORE_BLOCK_ROWS;
+	for( uint32_t c = 0; c < n_channels; c++ ) {
+		recording_column_buffer_t* buffer = &store->buffers[c];
+
+		buffer->channel = channels[c];
+		buffer->ticks = malloc( store->block_rows * sizeof( uint32_t ) );
+		if( channels[c].kind == RECORDING_SPIKES )
+			buffer->neurons = malloc( store->block_rows * sizeof( uint16_t ) );
+		else
+			buffer->values = malloc( (size_t) store->block_rows * channels[c].n_neurons * sizeof( int32_t ) );
+		if( buffer->ticks == NULL || ( buffer->neurons == NULL && buffer->values == NULL ) ) {
+			recording_store_close( store );
+			return false;
+			}
+		}
+
+	store->file = fopen( path, "wb" );
+	if( store->file == NULL ) {
+		recording_store_close( store );
+		return false;
+		}
+
+	write_bytes( store, RECORDING_STORE_MAGIC, 8 );
+	write_word( store, n_channels );
+	for( uint32_t c = 0; c < n_channels; c++ ) {
+		char label[RECORDING_STORE_LABEL_BYTES] = { 0 };
+
+		strncpy( label, channels[c].label, RECORDING_STORE_LABEL_BYTES - 1 );
+		write_word( store, channels[c].kind );
+		write_word( store, channels[c].n_neurons );
+		write_word( store, channels[c].time_step_us );
+		write_bytes( store, label, sizeof( label ) );
+		}
+	return !store->failed;
+}
+
+
+static recording_column_buffer_t* add_row( recording_store_t* store, uint32_t channel, uint32_t tick )
+{
+	recording_column_buffer_t* buffer = &store->buffers[channel];
+
+	if( buffer->n_rows == store->block_rows )
+		flush_block( store, channel );
+	if( buffer->n_rows == 0 )
+		buffer->first_tick = tick;
+	buffer->last_tick = tick;
+	buffer->ticks[buffer->n_rows] = tick;
+	return buffer;
+}
+
+
+bool recording_store_add_spikes( recording_store_t* store, uint32_t channel, uint32_t tick, const uint16_t* neurons,
+								 uint32_t n_spikes )
+{
+	if( channel >= store->n_channels || store->buffers[channel].channel.kind != RECORDING_SPIKES )
+		return false;
+
+	for( uint32_t s = 0; s < n_spikes; s++ ) {
+		recording_column_buffer_t* buffer = add_row( store, channel, tick );
+
+		buffer->neurons[buffer->n_rows++] = neurons[s];
+		}
+	return !store->failed;
+}
+
+
+bool recording_store_add_state( recording_store_t* store, uint32_t channel, uint32_t tick, const int32_t* values )
+{
+	if( channel >= store->n_channels || store->buffers[channel].channel.kind != RECORDING_STATE )
+		return false;
+
+	recording_column_buffer_t* buffer = add_row( store, channel, tick );
+
+	// transposed into a column per neuron
+	for( uint32_t i = 0; i < buffer->channel.n_neurons; i++ )
+		buffer->values[(size_t) i * store->block_rows + buffer->n_rows] = values[i];
+	buffer->n_rows++;
+	return !store->failed;
+}
+
+
+static void write_index( recording_store_t* store )
+{
+	uint64_t index_offset = store->n_bytes;
+
+	for( uint64_t b = 0; b < store->n_blocks; b++ ) {
+		const recording_block_index_t* entry = &store->index[b];
+
+		write_word( store, entry->channel );
+		write_word( store, entry->n_rows );
+		write_word( store, entry->first_tick );
+		write_word( store, entry->last_tick );
+		write_bytes( store, &entry->offset, sizeof( entry->offset ) );
+		}
+	write_bytes( store, &index_offset, sizeof( index_offset ) );
+	write_word( store, store->n_blocks );
+	write_bytes( store, RECORDING_STORE_INDEX_MAGIC, 8 );
+}
+
+
+bool recording_store_close( recording_store_t* store )
+{
+	for( uint32_t c = 0; c < store->n_channels; c++ ) {
+		if( store->file != NULL )
+			flush_block( store, c );
+		free( store->buffers[c].ticks );
+		free( store->buffers[c].neurons );
+		free( store->buffers[c].values );
+		store->buffers[c].ticks = NULL;
+		store->buffers[c].neurons = NULL;
+		store->buffers[c].values = NULL;
+		}
+	if( store->file != NULL )
+		write_index( store );
+	free( store->index );
+	store->index = NULL;
+	if( store->file != NULL && fclose( store->file ) != 0 )
+		store->failed = true;
+	store->file = NULL;
+	return !store->failed;
+}
@@ -0,0 +1,113 @@
+/*! \file
+ *
+ *  \brief Columnar on-disk store of recorded spikes and state (V, gsyn),
+ *    written as the recording is drained during a run.
+ *
+ *  \details Like the binary mapping reports (binary_reports.py), rows are
+ *    gathered per channel and written a block at a time, column by
+ *    column, but uncompressed and 4-byte aligned so a reader can use the
+ *    columns where they lie in a mapping of the file.
+ *
+ *    File layout (little endian):
+ *
+ *      MAGIC (8 bytes), n_channels (u32)
+ *      per channel: kind (u32), n_neurons (u32), time_step_us (u32),
+ *                   label (32 bytes, NUL padded)
+ *      blocks: channel (u32), n_rows (u32), first_tick (u32),
+ *              last_tick (u32), n_columns (u32), then per column its
+ *              length in bytes (u32) and data, padded to 4 bytes
+ *      index:  per block channel, n_rows, first_tick, last_tick (u32)
+ *              and the offset of its header (u64)
+ *      footer: index offset (u64), n_blocks (u32), INDEX_MAGIC (8 bytes)
+ *
+ *    A spikes block has a row per spike, sorted by tick then neuron:
+ *    tick (u32) and neuron (u16).  A state block is a dense array, a row
+ *    per recorded tick: tick (u32), then a column of s16.15 values (i32)
+ *    per neuron.  Blocks of a channel are in tick order; channels
+ *    interleave as they were drained.  The index is written on close, so
+ *    a reader finds any tick range without touching other blocks; a file
+ *    left without one by a run that did not finish can still be read by
+ *    walking the block headers (recording_reader.h).
+ *
+ */
+
+#ifndef __RECORDING_STORE_H__
+#define __RECORDING_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define RECORDING_STORE_MAGIC			"SPNREC01"
+#define RECORDING_STORE_INDEX_MAGIC		"SPNRIDX1"
+#define RECORDING_STORE_FOOTER_BYTES	20
+#define RECORDING_STORE_MAX_CHANNELS	16
+#define RECORDING_STORE_LABEL_BYTES		32
+#define RECORDING_STORE_BLOCK_ROWS		4096
+
+typedef enum { RECORDING_SPIKES, RECORDING_STATE } recording_kind_t;
+
+//! \brief What a channel records.
+typedef struct {
+	recording_kind_t	kind;
+	uint32_t			n_neurons;
+	uint32_t			time_step_us;
+	char				label[RECORDING_STORE_LABEL_BYTES];
+} recording_channel_t;
+
+//! \brief Rows of one channel waiting for their block.
+typedef struct {
+	recording_channel_t	channel;
+	uint32_t			n_rows;
+	uint32_t			first_tick;
+	uint32_t			last_tick;
+	uint32_t*			ticks;
+	uint16_t*			neurons;		//!< spikes
+	int32_t*			values;			//!< state, block_rows per neuron
+} recording_column_buffer_t;
+
+//! \brief Where a block is, as written to the index.
+typedef struct {
+	uint32_t	channel;
+	uint32_t	n_rows;
+	uint32_t	first_tick;
+	uint32_t	last_tick;
+	uint64_t	offset;
+} recording_block_index_t;
+
+typedef struct {
+	FILE*						file;
+	uint32_t					n_channels;
+	uint32_t					block_rows;
+	recording_column_buffer_t	buffers[RECORDING_STORE_MAX_CHANNELS];
+	recording_block_index_t*	index;
+	uint64_t					n_blocks;
+	uint64_t					max_blocks;
+	uint64_t					n_bytes;
+	bool						failed;		//!< a write failed; everything after is lost
+} recording_store_t;
+
+
+//! \brief Creates the file and writes its header.
+//! \param[in] block_rows Rows per block, RECORDING_STORE_BLOCK_ROWS if 0
+//! \return false if the file cannot be written or memory allocated
+
+bool recording_store_create( recording_store_t* store, const char* path, const recording_channel_t* channels,
+							 uint32_t n_channels, uint32_t block_rows );
+
+//! \brief Adds a tick's spikes to a spikes channel.
+
+bool recording_store_add_spikes( recording_store_t* store, uint32_t channel, uint32_t tick, const uint16_t* neurons,
+								 uint32_t n_spikes );
+
+//! \brief Adds a recorded tick's values, s16.15, to a state channel.
+
+bool recording_store_add_state( recording_store_t* store, uint32_t channel, uint32_t tick, const int32_t* values );
+
+//! \brief Writes every channel's remaining rows and the index, and closes
+//! the file.
+//! \return false if any write failed
+
+bool recording_store_close( recording_store_t* store );
+
+#endif /*__RECORDING_STORE_H__*/
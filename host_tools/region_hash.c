@@ -0,0 +1,60 @@
+/*
+	Per-region content hashes of an appData image; see region_hash.h.
+*/
+
+#include <string.h>
+
+#include "region_hash.h"
+
+
+#define FNV_OFFSET_BASIS	0xCBF29CE484222325ull
+#define FNV_PRIME			0x00000100000001B3ull
+
+
+uint64_t region_hash( const uint8_t* data, uint32_t n_bytes )
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	for( uint32_t i = 0; i < n_bytes; i++ ) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+		}
+
+	return hash;
+}
+
+
+bool app_data_region_spans( const uint8_t* image, uint32_t size, region_span_t spans[APP_DATA_N_SPANS] )
+{
+	const uint32_t* header = (const uint32_t*) image;
+
+	memset( spans, 0, APP_DATA_N_SPANS * sizeof( region_span_t ) );
+
+	if( size < APP_DATA_HEADER_BYTES || header[0] != APP_DATA_MAGIC_NUMBER )
+		return false;
+
+	const uint32_t* offsets = &header[2];
+
+	spans[0].length = APP_DATA_HEADER_BYTES;
+
+	for( uint32_t r = 0; r < DSE_MAX_REGIONS; r++ ) {
+		uint32_t start = offsets[r];
+		uint32_t end = size;
+
+		if( start == 0 || start >= size )
+			continue;
+
+		// regions are laid out in id order, but do not rely on it
+		for( uint32_t other = 0; other < DSE_MAX_REGIONS; other++ )
+			if( offsets[other] > start && offsets[other] < end )
+				end = offsets[other];
+
+		spans[1 + r].offset = start;
+		spans[1 + r].length = end - start;
+		}
+
+	for( uint32_t s = 0; s < APP_DATA_N_SPANS; s++ )
+		spans[s].hash = region_hash( image + spans[s].offset, spans[s].length );
+
+	return true;
+}
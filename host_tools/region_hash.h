@@ -0,0 +1,38 @@
+/*! \file
+ *
+ *  \brief Per-region content hashes of an appData image.
+ *
+ *  \details An image is split into spans: span 0 is the header and region
+ *    offset table, span 1 + r is region r up to the start of the next
+ *    region or the end of the written image.  Unused and unfilled regions
+ *    give empty spans.
+ *
+ */
+
+#ifndef __REGION_HASH_H__
+#define __REGION_HASH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_spec_executor.h"
+
+#define APP_DATA_N_SPANS		( 1 + DSE_MAX_REGIONS )
+
+typedef struct {
+	uint32_t	offset;			//!< from the start of the image
+	uint32_t	length;
+	uint64_t	hash;
+} region_span_t;
+
+
+//! \brief 64-bit FNV-1a of n_bytes at data.
+
+uint64_t region_hash( const uint8_t* data, uint32_t n_bytes );
+
+//! \brief Splits an appData image into spans and hashes each one.
+//! \return false if the image has no valid header
+
+bool app_data_region_spans( const uint8_t* image, uint32_t size, region_span_t spans[APP_DATA_N_SPANS] );
+
+#endif /*__REGION_HASH_H__*/
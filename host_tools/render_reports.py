@@ -0,0 +1,56 @@
+"""
+Renders a binary report file (see binary_reports.py) as the usual text
+reports, or imports a text report directory into one.
+
+    python render_reports.py reports.bin [--output DIR] [--report NAME]
+    python render_reports.py --import DIR reports.bin
+"""
+import argparse
+import sys
+
+import binary_reports
+
+_RENDERERS = {
+    "placement_by_core": binary_reports.render_placement_by_core,
+    "placement_by_vertex": binary_reports.render_placement_by_vertex,
+    "chip_sdram_usage_by_core": binary_reports.render_sdram_usage,
+    "network_specification": binary_reports.render_network_specification,
+    "memory_map": binary_reports.render_memory_map,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("reports", help="binary report file")
+    parser.add_argument("--output", help="write every text report here")
+    parser.add_argument("--report", help="print one report: {} or "
+                        "routing_table_X_Y".format(", ".join(
+                            sorted(_RENDERERS))))
+    parser.add_argument("--import", dest="import_dir", metavar="DIR",
+                        help="convert the text reports in DIR instead")
+    args = parser.parse_args()
+
+    if args.import_dir:
+        binary_reports.import_text_reports(args.import_dir, args.reports)
+        return 0
+
+    tables = binary_reports.read_reports(args.reports)
+    if args.output:
+        for path in binary_reports.render_all(tables, args.output):
+            print(path)
+    if args.report:
+        if args.report.startswith("routing_table_"):
+            x, y = (int(v) for v in args.report.split("_")[2:4])
+            sys.stdout.write(binary_reports.render_routing_table(tables, x, y))
+        elif args.report in _RENDERERS:
+            sys.stdout.write(_RENDERERS[args.report](tables))
+        else:
+            parser.error("unknown report {}".format(args.report))
+    if not args.output and not args.report:
+        for name, rows in tables.items():
+            print("{:<12} {} rows".format(name, len(rows)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
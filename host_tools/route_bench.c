@@ -0,0 +1,231 @@
+/*
+	Lookup rate of the router emulation (routing_engine.c) against the
+	linear first-match scan of routing_table_route().
+
+		route_bench [--keys N] [--repeats R] [--minimise] [--verify] routing_dir
+		route_bench [--keys N] [--repeats R] [--minimise] [--verify] --synthetic WIDTH HEIGHT
+
+	Each table is routed a stream of N keys: nine in ten fall inside a
+	random entry, the rest are random and mostly default routed.  With
+	--minimise the tables are minimised first (routing_minimiser.c), which
+	gives overlapping entries and many more masks.  --verify checks the
+	engine against the linear scan on the whole stream and on the first
+	key of every entry, and fails on any difference.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "routing_table.h"
+#include "routing_engine.h"
+#include "routing_minimiser.h"
+
+
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void make_keys( const routing_table_t* table, uint32_t* keys, uint32_t n_keys )
+{
+	for( uint32_t k = 0; k < n_keys; k++ ) {
+		if( table->n_entries == 0 || next_random() % 10 == 0 )
+			keys[k] = next_random();
+		else {
+			const routing_entry_t* e = &table->entries[next_random() % table->n_entries];
+
+			keys[k] = e->key | ( next_random() & ~e->mask );
+			}
+		}
+}
+
+
+static void linear_batch( const routing_table_t* table, const uint32_t* keys, uint32_t n, uint32_t* routes )
+{
+	for( uint32_t i = 0; i < n; i++ )
+		if( !routing_table_route( table, keys[i], &routes[i] ) )
+			routes[i] = DEFAULT_ROUTE;
+}
+
+
+static uint32_t verify_table( const routing_table_t* table, const routing_engine_t* engine,
+							  const uint32_t* keys, uint32_t n_keys )
+{
+	uint32_t n_mismatches = 0;
+
+	for( uint32_t i = 0; i < n_keys + table->n_entries; i++ ) {
+		uint32_t key = i < n_keys ? keys[i] : table->entries[i - n_keys].key;
+		uint32_t expected = DEFAULT_ROUTE, route = DEFAULT_ROUTE;
+
+		routing_table_route( table, key, &expected );
+		routing_engine_route( engine, key, &route );
+		if( route != expected ) {
+			if( n_mismatches++ < 10 )
+				fprintf( stderr, "(%u, %u) key %08x: engine %08x, linear scan %08x\n",
+						 table->x, table->y, key, route, expected );
+			}
+		}
+
+	return n_mismatches;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [--keys N] [--repeats R] [--minimise] [--verify] routing_dir\n"
+			 "       %s [--keys N] [--repeats R] [--minimise] [--verify] --synthetic WIDTH HEIGHT\n"
+			 "  --keys       keys routed per table (default 100000)\n"
+			 "  --repeats    timing repeats, best kept (default 5)\n"
+			 "  --minimise   minimise the tables first\n"
+			 "  --verify     check the engine against a linear scan\n"
+			 "  --synthetic  tables of a synthetic WIDTH x HEIGHT machine, fan-out 8\n",
+			 name, name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t		n_keys = 100000, repeats = 5, width = 0, height = 0;
+	bool			minimise = false, verify = false;
+	const char*		routing_dir = NULL;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--keys" ) && i + 1 < argc )
+			n_keys = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--repeats" ) && i + 1 < argc )
+			repeats = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--minimise" ) )
+			minimise = true;
+		else if( !strcmp( argv[i], "--verify" ) )
+			verify = true;
+		else if( !strcmp( argv[i], "--synthetic" ) && i + 2 < argc ) {
+			width = strtoul( argv[++i], NULL, 0 );
+			height = strtoul( argv[++i], NULL, 0 );
+			}
+		else if( argv[i][0] != '-' && routing_dir == NULL )
+			routing_dir = argv[i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	if( ( routing_dir == NULL ) == ( width == 0 || height == 0 ) || n_keys == 0 || repeats == 0 ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	routing_table_t* tables;
+	uint32_t n_tables;
+
+	if( routing_dir == NULL ) {
+		n_tables = width * height;
+		tables = synthetic_routing_tables( width, height, 4, 8, 1 );
+		}
+	else if( ( tables = read_routing_tables( routing_dir, &n_tables ) ) == NULL ) {
+		fprintf( stderr, "no routing_table_X_Y.rpt in %s\n", routing_dir );
+		return 1;
+		}
+
+	if( minimise ) {
+		uint32_t* n_default_routed = malloc( n_tables * sizeof( uint32_t ) );
+		routing_entry_t** default_routed = default_routed_entries( tables, n_tables, n_default_routed );
+
+		for( uint32_t t = 0; t < n_tables; t++ ) {
+			minimise_routing_table( &tables[t], default_routed[t], n_default_routed[t], 0 );
+			free( default_routed[t] );
+			}
+		free( default_routed );
+		free( n_default_routed );
+		}
+
+	uint32_t* keys = malloc( n_keys * sizeof( uint32_t ) );
+	uint32_t* routes = malloc( n_keys * sizeof( uint32_t ) );
+	uint64_t total_entries = 0, total_groups = 0, n_routed = 0;
+	uint32_t max_groups = 0, n_mismatches = 0;
+	double linear_ns = 0.0, engine_ns = 0.0, compile_ns = 0.0;
+
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		routing_engine_t engine;
+		double start = now_ns();
+
+		if( !routing_engine_compile( &tables[t], &engine ) ) {
+			fprintf( stderr, "out of memory compiling (%u, %u)\n", tables[t].x, tables[t].y );
+			return 1;
+			}
+		compile_ns += now_ns() - start;
+
+		total_entries += tables[t].n_entries;
+		total_groups += engine.n_groups;
+		if( engine.n_groups > max_groups )
+			max_groups = engine.n_groups;
+
+		make_keys( &tables[t], keys, n_keys );
+
+		double best_linear = 1e30, best_engine = 1e30;
+
+		for( uint32_t r = 0; r < repeats; r++ ) {
+			start = now_ns();
+			linear_batch( &tables[t], keys, n_keys, routes );
+			if( now_ns() - start < best_linear )
+				best_linear = now_ns() - start;
+
+			start = now_ns();
+			routing_engine_route_batch( &engine, keys, n_keys, routes );
+			if( now_ns() - start < best_engine )
+				best_engine = now_ns() - start;
+			}
+		linear_ns += best_linear;
+		engine_ns += best_engine;
+
+		for( uint32_t k = 0; k < n_keys; k++ )
+			n_routed += routes[k] != DEFAULT_ROUTE;
+
+		if( verify )
+			n_mismatches += verify_table( &tables[t], &engine, keys, n_keys );
+
+		routing_engine_free( &engine );
+		}
+
+	uint64_t n_lookups = (uint64_t) n_keys * n_tables;
+
+	printf( "%u tables, %.1f entries and %.1f masks on average (%u at most)%s\n", n_tables,
+			(double) total_entries / n_tables, (double) total_groups / n_tables, max_groups,
+			minimise ? ", minimised" : "" );
+	printf( "%llu lookups, %.1f%% matched; compile %.1f us per table\n", (unsigned long long) n_lookups,
+			100.0 * n_routed / n_lookups, compile_ns / n_tables / 1e3 );
+	printf( "%-12s %10s %14s\n", "lookup", "ns/key", "Mkeys/s/thread" );
+	printf( "%-12s %10.1f %14.2f\n", "linear scan", linear_ns / n_lookups, n_lookups * 1e3 / linear_ns );
+	printf( "%-12s %10.1f %14.2f\n", "engine", engine_ns / n_lookups, n_lookups * 1e3 / engine_ns );
+	printf( "speed-up %.1fx\n", linear_ns / engine_ns );
+
+	if( verify )
+		printf( "verify: %u mismatches against the linear scan\n", n_mismatches );
+
+	free( keys );
+	free( routes );
+	free_routing_tables( tables, n_tables );
+
+	return n_mismatches ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+/*
+	Multicast router emulation by tuple space search; see routing_engine.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "routing_engine.h"
+
+
+static int compare_groups( const void* a, const void* b )
+{
+	uint32_t s = ( (const mask_group_t*) a )->first_index, t = ( (const mask_group_t*) b )->first_index;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+bool routing_engine_compile( const routing_table_t* table, routing_engine_t* engine )
+{
+	const routing_entry_t* entries = table->entries;
+	uint32_t n = table->n_entries;
+
+	memset( engine, 0, sizeof( routing_engine_t ) );
+
+	// half full at most keeps the probe sequences short
+	engine->slot_bits = 4;
+	while( ( 1u << engine->slot_bits ) < 2 * n )
+		engine->slot_bits++;
+
+	engine->groups = malloc( ( n ? n : 1 ) * sizeof( mask_group_t ) );
+	engine->slots = malloc( ( 1u << engine->slot_bits ) * sizeof( engine_slot_t ) );
+	engine->routes = malloc( ( n ? n : 1 ) * sizeof( uint32_t ) );
+	if( !engine->groups || !engine->slots || !engine->routes ) {
+		routing_engine_free( engine );
+		return false;
+		}
+
+	for( uint32_t s = 0; s < ( 1u << engine->slot_bits ); s++ )
+		engine->slots[s].index = NO_ENTRY;
+
+	// tables have a handful of masks, so a linear search finds the group
+	for( uint32_t i = 0; i < n; i++ ) {
+		uint32_t g = 0;
+
+		engine->routes[i] = entries[i].route;
+		if( entries[i].key & ~entries[i].mask )
+			continue;
+
+		while( g < engine->n_groups && engine->groups[g].mask != entries[i].mask )
+			g++;
+		if( g == engine->n_groups ) {
+			engine->groups[g].mask = entries[i].mask;
+			engine->groups[g].first_index = i;
+			engine->n_groups++;
+			}
+		}
+
+	qsort( engine->groups, engine->n_groups, sizeof( mask_group_t ), compare_groups );
+
+	for( uint32_t i = 0; i < n; i++ ) {
+		uint32_t g = 0, slot_mask = ( 1u << engine->slot_bits ) - 1;
+
+		if( entries[i].key & ~entries[i].mask )
+			continue;
+		while( engine->groups[g].mask != entries[i].mask )
+			g++;
+
+		// an earlier entry with the same key and mask shadows this one
+		for( uint32_t s = engine_hash( entries[i].key, g, engine->slot_bits );; s = ( s + 1 ) & slot_mask ) {
+			engine_slot_t* slot = &engine->slots[s];
+
+			if( slot->index == NO_ENTRY ) {
+				slot->key = entries[i].key;
+				slot->group = g;
+				slot->index = i;
+				break;
+				}
+			if( slot->key == entries[i].key && slot->group == g )
+				break;
+			}
+		}
+
+	return true;
+}
+
+
+void routing_engine_route_batch( const routing_engine_t* engine, const uint32_t* keys, uint32_t n, uint32_t* routes )
+{
+	for( uint32_t i = 0; i < n; i++ ) {
+		uint32_t index = routing_engine_lookup( engine, keys[i] );
+
+		routes[i] = index == NO_ENTRY ? DEFAULT_ROUTE : engine->routes[index];
+		}
+}
+
+
+void routing_engine_free( routing_engine_t* engine )
+{
+	free( engine->groups );
+	free( engine->slots );
+	free( engine->routes );
+	memset( engine, 0, sizeof( routing_engine_t ) );
+}
@@ -0,0 +1,104 @@
+/*! \file
+ *
+ *  \brief Host emulation of a chip's multicast router lookup.
+ *
+ *  \details A table is compiled into one hash set per distinct mask
+ *    ("tuple space search"): the set for mask m holds key & m of every
+ *    entry with that mask, with the index of the first such entry.  A
+ *    lookup probes the sets in order of their first entry index and keeps
+ *    the lowest index found, stopping as soon as no later set can hold a
+ *    lower one, which gives the router's first-match result.  PACMAN
+ *    tables use one or two masks, so most lookups are one or two probes.
+ *
+ */
+
+#ifndef __ROUTING_ENGINE_H__
+#define __ROUTING_ENGINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "routing_table.h"
+
+//! Route given by the batch lookup to a key that no entry matches
+#define DEFAULT_ROUTE			0xFFFFFFFF
+
+#define NO_ENTRY				0xFFFFFFFF
+
+typedef struct {
+	uint32_t	mask;
+	uint32_t	first_index;		//!< lowest entry index with this mask
+} mask_group_t;
+
+typedef struct {
+	uint32_t	key;				//!< masked key
+	uint32_t	group;
+	uint32_t	index;				//!< first entry in the group with this key, NO_ENTRY if empty
+} engine_slot_t;
+
+typedef struct {
+	uint32_t		n_groups;
+	mask_group_t*	groups;			//!< ordered by first_index
+	uint32_t		slot_bits;
+	engine_slot_t*	slots;
+	uint32_t*		routes;			//!< by entry index
+} routing_engine_t;
+
+
+static inline uint32_t engine_hash( uint32_t masked_key, uint32_t group, uint32_t slot_bits )
+{
+	return ( ( masked_key ^ ( group * 0x85EBCA6B ) ) * 0x9E3779B1 ) >> ( 32 - slot_bits );
+}
+
+
+//! \brief The index of the first entry matching key, NO_ENTRY if none.
+
+static inline uint32_t routing_engine_lookup( const routing_engine_t* engine, uint32_t key )
+{
+	uint32_t best = NO_ENTRY, slot_mask = ( 1u << engine->slot_bits ) - 1;
+
+	for( uint32_t g = 0; g < engine->n_groups && engine->groups[g].first_index < best; g++ ) {
+		uint32_t masked = key & engine->groups[g].mask;
+
+		for( uint32_t s = engine_hash( masked, g, engine->slot_bits );; s = ( s + 1 ) & slot_mask ) {
+			const engine_slot_t* slot = &engine->slots[s];
+
+			if( slot->index == NO_ENTRY )
+				break;
+			if( slot->key == masked && slot->group == g ) {
+				if( slot->index < best )
+					best = slot->index;
+				break;
+				}
+			}
+		}
+
+	return best;
+}
+
+//! \brief First-match route of key, as routing_table_route().
+//! \return false if the packet would be default routed
+
+static inline bool routing_engine_route( const routing_engine_t* engine, uint32_t key, uint32_t* route )
+{
+	uint32_t index = routing_engine_lookup( engine, key );
+
+	if( index == NO_ENTRY )
+		return false;
+	*route = engine->routes[index];
+	return true;
+}
+
+//! \brief Routes n keys; unmatched keys get DEFAULT_ROUTE.
+
+void routing_engine_route_batch( const routing_engine_t* engine, const uint32_t* keys, uint32_t n, uint32_t* routes );
+
+//! \brief Compiles table; entries with key bits outside their mask,
+//! which match nothing, are left out.
+//! \return false if out of memory
+
+bool routing_engine_compile( const routing_table_t* table, routing_engine_t* engine );
+
+void routing_engine_free( routing_engine_t* engine );
+
+#endif /*__ROUTING_ENGINE_H__*/
@@ -0,0 +1,391 @@
+/*
+	Ordered-covering routing table minimisation; see routing_minimiser.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "routing_minimiser.h"
+
+
+static inline uint32_t generality( uint32_t mask )
+{
+	return 32 - __builtin_popcount( mask );
+}
+
+
+// entries with key bits outside their mask match nothing; never merge them
+static inline bool entry_valid( const routing_entry_t* e )
+{
+	return ( e->key & ~e->mask ) == 0;
+}
+
+
+typedef struct {
+	const routing_table_t*	table;
+	const routing_entry_t*	default_routed;
+	uint32_t				n_default_routed;
+	bool*					in_merge;
+	uint32_t				n_in_merge;
+	routing_entry_t			merged;
+	uint32_t				insert_at;		// the merged entry goes before this entry
+} merge_t;
+
+
+static void merged_entry( merge_t* m )
+{
+	const routing_entry_t* entries = m->table->entries;
+	uint32_t all_ones = 0xFFFFFFFF, any_ones = 0, mask = 0xFFFFFFFF, last = 0, n_merged = 0;
+
+	for( uint32_t i = 0; i < m->table->n_entries; i++ )
+		if( m->in_merge[i] ) {
+			all_ones &= entries[i].key;
+			any_ones |= entries[i].key;
+			mask &= entries[i].mask;
+			n_merged += entries[i].n_merged;
+			m->merged.route = entries[i].route;
+			last = i;
+			}
+
+	mask &= ~( all_ones ^ any_ones );
+	m->merged.key = all_ones & mask;
+	m->merged.mask = mask;
+	m->merged.n_merged = n_merged;
+	m->merged.source_x = m->merged.source_y = m->merged.source_p = 0;
+
+	// below the last merged entry and below every entry no more general
+	uint32_t g = generality( mask );
+
+	m->insert_at = last + 1;
+	while( m->insert_at < m->table->n_entries && generality( entries[m->insert_at].mask ) <= g )
+		m->insert_at++;
+}
+
+
+// drops merged entries that an entry between them and the merged entry
+// would take keys from
+static bool up_check( merge_t* m )
+{
+	const routing_entry_t* entries = m->table->entries;
+	bool changed = false;
+
+	for( uint32_t i = 0; i < m->insert_at; i++ ) {
+		if( !m->in_merge[i] )
+			continue;
+		for( uint32_t j = i + 1; j < m->insert_at; j++ )
+			if( !m->in_merge[j] && entries[j].route != m->merged.route
+				&& entries_intersect( &entries[i], &entries[j] ) ) {
+				m->in_merge[i] = false;
+				m->n_in_merge--;
+				changed = true;
+				break;
+				}
+		}
+
+	return changed;
+}
+
+
+static const routing_entry_t* down_blocker( const merge_t* m )
+{
+	const routing_entry_t* entries = m->table->entries;
+
+	for( uint32_t j = m->insert_at; j < m->table->n_entries; j++ )
+		if( entries[j].route != m->merged.route && entries_intersect( &m->merged, &entries[j] ) )
+			return &entries[j];
+
+	for( uint32_t j = 0; j < m->n_default_routed; j++ )
+		if( entries_intersect( &m->merged, &m->default_routed[j] ) )
+			return &m->default_routed[j];
+
+	return NULL;
+}
+
+
+// fixes one don't-care bit of the merged entry to the value the blocker
+// does not have, dropping the fewest merged entries
+static bool avoid( merge_t* m, const routing_entry_t* blocker )
+{
+	const routing_entry_t* entries = m->table->entries;
+	uint32_t candidates = ~m->merged.mask & blocker->mask;
+	uint32_t best_bit = 0, best_cost = UINT32_MAX;
+
+	for( uint32_t bit = 0; bit < 32; bit++ ) {
+		if( !( candidates & ( 1u << bit ) ) )
+			continue;
+		uint32_t value = ~blocker->key & ( 1u << bit ), cost = 0;
+
+		for( uint32_t i = 0; i < m->table->n_entries; i++ )
+			if( m->in_merge[i] && ( !( entries[i].mask & ( 1u << bit ) ) || ( entries[i].key & ( 1u << bit ) ) != value ) )
+				cost++;
+		if( cost < best_cost ) {
+			best_cost = cost;
+			best_bit = bit;
+			}
+		}
+
+	if( best_cost == UINT32_MAX || m->n_in_merge - best_cost < 2 )
+		return false;
+
+	uint32_t bit = 1u << best_bit, value = ~blocker->key & bit;
+
+	for( uint32_t i = 0; i < m->table->n_entries; i++ )
+		if( m->in_merge[i] && ( !( entries[i].mask & bit ) || ( entries[i].key & bit ) != value ) ) {
+			m->in_merge[i] = false;
+			m->n_in_merge--;
+			}
+
+	return true;
+}
+
+
+// the largest safe merge of the entries with this route
+static bool refine_merge( merge_t* m, uint32_t route )
+{
+	const routing_entry_t* entries = m->table->entries;
+
+	m->n_in_merge = 0;
+	for( uint32_t i = 0; i < m->table->n_entries; i++ ) {
+		m->in_merge[i] = entries[i].route == route && entry_valid( &entries[i] );
+		m->n_in_merge += m->in_merge[i];
+		}
+
+	while( m->n_in_merge >= 2 ) {
+		merged_entry( m );
+		if( up_check( m ) )
+			continue;
+
+		const routing_entry_t* blocker = down_blocker( m );
+
+		if( blocker == NULL )
+			return true;
+		if( !avoid( m, blocker ) )
+			return false;
+		}
+
+	return false;
+}
+
+
+static void apply_merge( routing_table_t* table, const merge_t* m, routing_entry_t* scratch )
+{
+	uint32_t n = 0;
+
+	for( uint32_t i = 0; i < table->n_entries; i++ ) {
+		if( i == m->insert_at )
+			scratch[n++] = m->merged;
+		if( !m->in_merge[i] )
+			scratch[n++] = table->entries[i];
+		}
+	if( m->insert_at == table->n_entries )
+		scratch[n++] = m->merged;
+
+	memcpy( table->entries, scratch, n * sizeof( routing_entry_t ) );
+	table->n_entries = n;
+}
+
+
+static bool table_orthogonal( const routing_table_t* table )
+{
+	for( uint32_t i = 0; i < table->n_entries; i++ )
+		for( uint32_t j = i + 1; j < table->n_entries; j++ )
+			if( entries_intersect( &table->entries[i], &table->entries[j] ) )
+				return false;
+	return true;
+}
+
+
+// insertion sort: stable, and the tables are nearly always sorted already
+static void sort_by_generality( routing_table_t* table )
+{
+	routing_entry_t* entries = table->entries;
+
+	for( uint32_t i = 1; i < table->n_entries; i++ ) {
+		routing_entry_t e = entries[i];
+		uint32_t j = i;
+
+		while( j > 0 && generality( entries[j - 1].mask ) > generality( e.mask ) ) {
+			entries[j] = entries[j - 1];
+			j--;
+			}
+		entries[j] = e;
+		}
+}
+
+
+typedef struct {
+	uint32_t	route;
+	uint32_t	count;
+} route_count_t;
+
+
+static int compare_route_counts( const void* a, const void* b )
+{
+	const route_count_t* s = a;
+	const route_count_t* t = b;
+
+	if( s->count != t->count )
+		return s->count > t->count ? -1 : 1;
+	return ( s->route > t->route ) - ( s->route < t->route );
+}
+
+
+static int compare_routes( const void* a, const void* b )
+{
+	uint32_t s = ( (const route_count_t*) a )->route, t = ( (const route_count_t*) b )->route;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+uint32_t minimise_routing_table( routing_table_t* table, const routing_entry_t* default_routed,
+								 uint32_t n_default_routed, uint32_t target )
+{
+	uint32_t n = table->n_entries;
+
+	if( n < 2 )
+		return n;
+
+	// first-match order only matters between overlapping entries
+	if( table_orthogonal( table ) )
+		sort_by_generality( table );
+
+	merge_t m = { table, default_routed, n_default_routed, malloc( n * sizeof( bool ) ), 0, { 0 }, 0 };
+	merge_t best = m;
+	route_count_t* routes = malloc( n * sizeof( route_count_t ) );
+	routing_entry_t* scratch = malloc( ( n + 1 ) * sizeof( routing_entry_t ) );
+
+	best.in_merge = malloc( n * sizeof( bool ) );
+
+	while( table->n_entries > target ) {
+		uint32_t n_routes = 0;
+
+		for( uint32_t i = 0; i < table->n_entries; i++ ) {
+			routes[i].route = table->entries[i].route;
+			routes[i].count = 1;
+			}
+		qsort( routes, table->n_entries, sizeof( route_count_t ), compare_routes );
+		for( uint32_t i = 0; i < table->n_entries; i++ ) {
+			if( n_routes > 0 && routes[n_routes - 1].route == routes[i].route )
+				routes[n_routes - 1].count++;
+			else
+				routes[n_routes++] = routes[i];
+			}
+		qsort( routes, n_routes, sizeof( route_count_t ), compare_route_counts );
+
+		// largest saving first; a route can save at most count - 1 entries
+		best.n_in_merge = 0;
+		for( uint32_t r = 0; r < n_routes && routes[r].count > best.n_in_merge; r++ )
+			if( refine_merge( &m, routes[r].route ) && m.n_in_merge > best.n_in_merge ) {
+				bool* in_merge = best.in_merge;
+
+				best = m;
+				best.in_merge = in_merge;
+				memcpy( best.in_merge, m.in_merge, table->n_entries * sizeof( bool ) );
+				}
+
+		if( best.n_in_merge < 2 )
+			break;
+		apply_merge( table, &best, scratch );
+		}
+
+	free( m.in_merge );
+	free( best.in_merge );
+	free( routes );
+	free( scratch );
+
+	return table->n_entries;
+}
+
+
+static int compare_entries( const void* a, const void* b )
+{
+	const routing_entry_t* s = a;
+	const routing_entry_t* t = b;
+
+	if( s->key != t->key )
+		return s->key < t->key ? -1 : 1;
+	return ( s->mask > t->mask ) - ( s->mask < t->mask );
+}
+
+
+typedef struct {
+	routing_entry_t*	entries;
+	uint32_t			n, capacity;
+} entry_list_t;
+
+
+routing_entry_t** default_routed_entries( const routing_table_t* tables, uint32_t n_tables,
+										  uint32_t* n_default_routed )
+{
+	uint32_t width = 0, height = 0;
+
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		if( tables[t].x >= width )
+			width = tables[t].x + 1;
+		if( tables[t].y >= height )
+			height = tables[t].y + 1;
+		}
+
+	int32_t* table_at = malloc( width * height * sizeof( int32_t ) );
+	entry_list_t* lists = calloc( n_tables, sizeof( entry_list_t ) );
+
+	for( uint32_t c = 0; c < width * height; c++ )
+		table_at[c] = -1;
+	for( uint32_t t = 0; t < n_tables; t++ )
+		table_at[tables[t].x * height + tables[t].y] = t;
+
+	for( uint32_t t = 0; t < n_tables; t++ )
+		for( uint32_t i = 0; i < tables[t].n_entries; i++ ) {
+			const routing_entry_t* e = &tables[t].entries[i];
+
+			for( uint32_t link = 0; link < N_LINKS; link++ ) {
+				uint32_t x = tables[t].x, y = tables[t].y;
+
+				if( !( e->route & ROUTE_LINK( link ) ) )
+					continue;
+
+				// straight on through every chip that does not route the key
+				for( uint32_t hop = 0; hop < width + height; hop++ ) {
+					if( !link_neighbour( x, y, link, width, height, &x, &y ) || table_at[x * height + y] < 0 )
+						break;
+					uint32_t next = table_at[x * height + y];
+					bool covered = false;
+
+					for( uint32_t j = 0; j < tables[next].n_entries && !covered; j++ )
+						covered = entry_covers( &tables[next].entries[j], e );
+					if( covered )
+						break;
+
+					entry_list_t* list = &lists[next];
+
+					if( list->n == list->capacity ) {
+						list->capacity = list->capacity ? 2 * list->capacity : 16;
+						list->entries = realloc( list->entries, list->capacity * sizeof( routing_entry_t ) );
+						}
+					list->entries[list->n++] = *e;
+					}
+				}
+			}
+
+	routing_entry_t** result = malloc( n_tables * sizeof( routing_entry_t* ) );
+
+	for( uint32_t t = 0; t < n_tables; t++ ) {
+		entry_list_t* list = &lists[t];
+		uint32_t n = 0;
+
+		if( list->n )
+			qsort( list->entries, list->n, sizeof( routing_entry_t ), compare_entries );
+		for( uint32_t i = 0; i < list->n; i++ )
+			if( n == 0 || compare_entries( &list->entries[n - 1], &list->entries[i] ) )
+				list->entries[n++] = list->entries[i];
+
+		result[t] = list->entries;
+		n_default_routed[t] = n;
+		}
+
+	free( table_at );
+	free( lists );
+
+	return result;
+}
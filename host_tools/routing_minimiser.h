@@ -0,0 +1,52 @@
+/*! \file
+ *
+ *  \brief Ordered-covering minimisation of a chip's multicast routing
+ *    table.
+ *
+ *  \details Entries with the same route are merged into one entry whose
+ *    mask has a don't-care bit wherever they differ.  The table is kept in
+ *    order of increasing generality (number of don't-care bits) and a
+ *    merged entry goes below every entry no more general than itself, so
+ *    more specific entries still win.  A merge is shrunk, by dropping some
+ *    of its entries, until
+ *
+ *      - no entry that ends up above the merged entry takes keys from one
+ *        of the merged entries with a different route ("up check"), and
+ *      - the merged entry takes no keys from an entry below it with a
+ *        different route, nor any key that reaches the chip and is default
+ *        routed ("down check").
+ *
+ *    Keys that neither the table nor the default-routed traffic use may be
+ *    absorbed; nothing sends them.
+ *
+ */
+
+#ifndef __ROUTING_MINIMISER_H__
+#define __ROUTING_MINIMISER_H__
+
+#include <stdint.h>
+
+#include "routing_table.h"
+
+
+//! \brief Minimises table in place.
+//! \param[in] default_routed Keys reaching the chip that no entry covers;
+//!   the minimised table still routes none of them.
+//! \param[in] target Stop once the table has at most this many entries;
+//!   0 merges as far as possible.
+//! \return The number of entries left
+
+uint32_t minimise_routing_table( routing_table_t* table, const routing_entry_t* default_routed,
+								 uint32_t n_default_routed, uint32_t target );
+
+//! \brief The default-routed traffic of every chip.  Entries of each
+//! table are followed along their links; a key arriving at a chip with no
+//! entry covering it continues straight on and is added to that chip's
+//! list.  Chips without a table end the path.
+//! \param[out] n_default_routed Count per table
+//! \return One list per table; free each, then the array
+
+routing_entry_t** default_routed_entries( const routing_table_t* tables, uint32_t n_tables,
+										  uint32_t* n_default_routed );
+
+#endif /*__ROUTING_MINIMISER_H__*/
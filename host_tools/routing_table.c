@@ -0,0 +1,282 @@
+/*
+	Routing table reports and synthetic machine tables; see routing_table.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "routing_table.h"
+
+
+bool routing_table_route( const routing_table_t* table, uint32_t key, uint32_t* route )
+{
+	for( uint32_t i = 0; i < table->n_entries; i++ )
+		if( ( key & table->entries[i].mask ) == table->entries[i].key ) {
+			*route = table->entries[i].route;
+			return true;
+			}
+	return false;
+}
+
+
+static bool read_routing_table( const char* path, routing_table_t* table )
+{
+	FILE* f = fopen( path, "r" );
+	char line[512];
+	uint32_t capacity = 64;
+
+	if( f == NULL )
+		return false;
+
+	table->n_entries = 0;
+	table->entries = malloc( capacity * sizeof( routing_entry_t ) );
+
+	//     0     02000       fffff800      0200         (0, 0, 4)      [3] []
+	while( fgets( line, sizeof( line ), f ) ) {
+		uint32_t index, key, mask, route, sx, sy, sp, n_merged = 1;
+		int n = sscanf( line, "%u %x %x %x (%u, %u, %u)", &index, &key, &mask, &route, &sx, &sy, &sp );
+
+		// merged entries, and tables converted without a source core
+		if( n == 4 ) {
+			sx = sy = sp = 0;
+			sscanf( line, "%*u %*x %*x %*x (merged %u)", &n_merged );
+			}
+		else if( n != 7 )
+			continue;
+
+		if( table->n_entries == capacity ) {
+			capacity *= 2;
+			table->entries = realloc( table->entries, capacity * sizeof( routing_entry_t ) );
+			}
+		routing_entry_t* e = &table->entries[table->n_entries++];
+
+		e->key = key;
+		e->mask = mask;
+		e->route = route;
+		e->source_x = sx;
+		e->source_y = sy;
+		e->source_p = sp;
+		e->n_merged = n_merged;
+		}
+	fclose( f );
+
+	return true;
+}
+
+
+static int compare_tables( const void* a, const void* b )
+{
+	const routing_table_t* s = a;
+	const routing_table_t* t = b;
+
+	if( s->x != t->x )
+		return s->x < t->x ? -1 : 1;
+	return ( s->y > t->y ) - ( s->y < t->y );
+}
+
+
+routing_table_t* read_routing_tables( const char* dir, uint32_t* n_tables )
+{
+	DIR* d = opendir( dir );
+	struct dirent* entry;
+	routing_table_t* tables = NULL;
+	uint32_t n = 0, capacity = 0;
+
+	*n_tables = 0;
+	if( d == NULL )
+		return NULL;
+
+	while( ( entry = readdir( d ) ) != NULL ) {
+		uint32_t x, y;
+		int end = 0;
+		char path[4096];
+
+		if( sscanf( entry->d_name, "routing_table_%u_%u.rpt%n", &x, &y, &end ) != 2
+			|| entry->d_name[end] != '\0' )
+			continue;
+
+		if( n == capacity ) {
+			capacity = capacity ? 2 * capacity : 16;
+			tables = realloc( tables, capacity * sizeof( routing_table_t ) );
+			}
+		snprintf( path, sizeof( path ), "%s/%s", dir, entry->d_name );
+		tables[n].x = x;
+		tables[n].y = y;
+		if( read_routing_table( path, &tables[n] ) )
+			n++;
+		}
+	closedir( d );
+
+	if( n == 0 ) {
+		free( tables );
+		return NULL;
+		}
+	qsort( tables, n, sizeof( routing_table_t ), compare_tables );
+	*n_tables = n;
+
+	return tables;
+}
+
+
+static void print_list( FILE* f, uint32_t bits, uint32_t n )
+{
+	bool first = true;
+
+	fputc( '[', f );
+	for( uint32_t i = 0; i < n; i++ )
+		if( bits & ( 1u << i ) ) {
+			fprintf( f, first ? "%u" : ", %u", i );
+			first = false;
+			}
+	fputc( ']', f );
+}
+
+
+bool write_routing_table( const char* path, const routing_table_t* table )
+{
+	FILE* f = fopen( path, "w" );
+
+	if( f == NULL )
+		return false;
+
+	fprintf( f, "router contains %u entries \n \n", table->n_entries );
+	fprintf( f, "  Index   Key(hex)    Mask(hex)    Route(hex)    Src. Core -> [Cores][Links]\n" );
+	fprintf( f, "------------------------------------------------------------------------------\n" );
+
+	for( uint32_t i = 0; i < table->n_entries; i++ ) {
+		const routing_entry_t* e = &table->entries[i];
+		char key[16];
+
+		// PACMAN pads keys of four or more digits to five
+		int length = snprintf( key, sizeof( key ), "%x", e->key );
+		if( length == 4 )
+			snprintf( key, sizeof( key ), "%05x", e->key );
+
+		fprintf( f, "%5u     %s       %08x      %04x         ", i, key, e->mask, e->route );
+		if( e->n_merged == 1 )
+			fprintf( f, "(%u, %u, %u)      ", e->source_x, e->source_y, e->source_p );
+		else
+			fprintf( f, "(merged %u)      ", e->n_merged );
+		print_list( f, e->route >> N_LINKS, 18 );
+		fputc( ' ', f );
+		print_list( f, e->route, N_LINKS );
+		fputc( '\n', f );
+		}
+
+	return fclose( f ) == 0;
+}
+
+
+void free_routing_tables( routing_table_t* tables, uint32_t n_tables )
+{
+	for( uint32_t i = 0; i < n_tables; i++ )
+		free( tables[i].entries );
+	free( tables );
+}
+
+
+bool link_neighbour( uint32_t x, uint32_t y, uint32_t link, uint32_t width, uint32_t height,
+					 uint32_t* nx, uint32_t* ny )
+{
+	static const int dx[N_LINKS] = { 1, 1, 0, -1, -1, 0 };
+	static const int dy[N_LINKS] = { 0, 1, 1, 0, -1, -1 };
+
+	int64_t tx = (int64_t) x + dx[link], ty = (int64_t) y + dy[link];
+
+	if( tx < 0 || ty < 0 || tx >= width || ty >= height )
+		return false;
+	*nx = tx;
+	*ny = ty;
+	return true;
+}
+
+
+// dimension-ordered on the hexagonal mesh: diagonals first, then straight
+static uint32_t next_link( int32_t dx, int32_t dy )
+{
+	if( dx > 0 && dy > 0 )
+		return 1;
+	if( dx < 0 && dy < 0 )
+		return 4;
+	if( dx > 0 )
+		return 0;
+	if( dx < 0 )
+		return 3;
+	return dy > 0 ? 2 : 5;
+}
+
+
+routing_table_t* synthetic_routing_tables( uint32_t width, uint32_t height, uint32_t cores_per_population,
+										   uint32_t fan_out, uint32_t seed )
+{
+	uint32_t n_chips = width * height;
+	uint32_t populations_per_chip = 16 / cores_per_population;
+	uint32_t n_populations = n_chips * populations_per_chip;
+	uint32_t* tree = malloc( n_chips * sizeof( uint32_t ) );
+	uint32_t* capacity = calloc( n_chips, sizeof( uint32_t ) );
+	routing_table_t* tables = calloc( n_chips, sizeof( routing_table_t ) );
+	uint32_t state = seed ? seed : 1;
+
+	for( uint32_t c = 0; c < n_chips; c++ ) {
+		tables[c].x = c / height;
+		tables[c].y = c % height;
+		}
+
+	// populations in key order, so every table comes out sorted by key
+	for( uint32_t q = 0; q < n_populations; q++ ) {
+		uint32_t source = q / populations_per_chip;
+		uint32_t first_core = 1 + ( q % populations_per_chip ) * cores_per_population;
+
+		memset( tree, 0, n_chips * sizeof( uint32_t ) );
+
+		for( uint32_t t = 0; t < fan_out; t++ ) {
+			// xorshift32
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			uint32_t target = state % n_populations;
+			uint32_t chip = target / populations_per_chip;
+			uint32_t target_core = 1 + ( target % populations_per_chip ) * cores_per_population;
+			uint32_t x = tables[source].x, y = tables[source].y;
+
+			while( x != tables[chip].x || y != tables[chip].y ) {
+				uint32_t link = next_link( (int32_t) tables[chip].x - x, (int32_t) tables[chip].y - y );
+
+				tree[x * height + y] |= ROUTE_LINK( link );
+				link_neighbour( x, y, link, width, height, &x, &y );
+				}
+			for( uint32_t c = 0; c < cores_per_population; c++ )
+				tree[chip] |= ROUTE_CORE( target_core + c );
+			}
+
+		for( uint32_t c = 0; c < n_chips; c++ ) {
+			if( tree[c] == 0 )
+				continue;
+			routing_table_t* table = &tables[c];
+
+			if( table->n_entries + cores_per_population > capacity[c] ) {
+				capacity[c] = capacity[c] ? 2 * capacity[c] : 64;
+				table->entries = realloc( table->entries, capacity[c] * sizeof( routing_entry_t ) );
+				}
+			for( uint32_t p = first_core; p < first_core + cores_per_population; p++ ) {
+				routing_entry_t* e = &table->entries[table->n_entries++];
+
+				e->key = SUBVERTEX_KEY( tables[source].x, tables[source].y, p );
+				e->mask = SUBVERTEX_MASK;
+				e->route = tree[c];
+				e->source_x = tables[source].x;
+				e->source_y = tables[source].y;
+				e->source_p = p;
+				e->n_merged = 1;
+				}
+			}
+		}
+
+	free( tree );
+	free( capacity );
+
+	return tables;
+}
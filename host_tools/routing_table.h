@@ -0,0 +1,96 @@
+/*! \file
+ *
+ *  \brief Multicast routing tables as written to
+ *    routing_tables_generated/routing_table_X_Y.rpt, and a generator of
+ *    machine-sized synthetic tables.
+ *
+ *  \details A packet takes the route of the first entry with
+ *    ( key & mask ) == entry key; a packet matching no entry is default
+ *    routed straight on, out of the link opposite the one it came in on.
+ *
+ */
+
+#ifndef __ROUTING_TABLE_H__
+#define __ROUTING_TABLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Entries in one chip's multicast router
+#define ROUTER_ENTRIES			1024
+
+//! Route bits: links 0-5 (E, NE, N, W, SW, S), then one bit per core
+#define ROUTE_LINK( l )			( 1u << ( l ) )
+#define ROUTE_CORE( c )			( 1u << ( 6 + ( c ) ) )
+#define N_LINKS					6
+#define OPPOSITE_LINK( l )		( ( ( l ) + 3 ) % N_LINKS )
+
+//! PACMAN's keys: chip x, y and core of the source subvertex, neuron index
+//! in the bottom 11 bits
+#define SUBVERTEX_KEY( x, y, p )	( ( ( x ) << 24 ) | ( ( y ) << 16 ) | ( ( p ) << 11 ) )
+#define SUBVERTEX_MASK			0xFFFFF800
+
+typedef struct {
+	uint32_t	key;
+	uint32_t	mask;
+	uint32_t	route;
+	uint8_t		source_x, source_y, source_p;
+	uint32_t	n_merged;			//!< report entries folded into this one, 1 if as read
+} routing_entry_t;
+
+typedef struct {
+	uint32_t			x, y;
+	uint32_t			n_entries;
+	routing_entry_t*	entries;
+} routing_table_t;
+
+
+//! \brief True if some key matches both entries.
+
+static inline bool entries_intersect( const routing_entry_t* a, const routing_entry_t* b )
+{
+	return ( ( a->key ^ b->key ) & a->mask & b->mask ) == 0;
+}
+
+//! \brief True if every key matching inner also matches outer.
+
+static inline bool entry_covers( const routing_entry_t* outer, const routing_entry_t* inner )
+{
+	return ( outer->mask & ~inner->mask ) == 0 && ( ( outer->key ^ inner->key ) & outer->mask ) == 0;
+}
+
+//! \brief First-match lookup by scanning the table, as the router does.
+//! \return false if the packet would be default routed
+
+bool routing_table_route( const routing_table_t* table, uint32_t key, uint32_t* route );
+
+//! \brief Reads every routing_table_X_Y.rpt in dir, ordered by x then y.
+//! \return The tables, or NULL if there are none; free with free_routing_tables()
+
+routing_table_t* read_routing_tables( const char* dir, uint32_t* n_tables );
+
+//! \brief Writes a table in the routing_table_X_Y.rpt layout.  Merged
+//! entries have no single source core and show how many entries they replace.
+
+bool write_routing_table( const char* path, const routing_table_t* table );
+
+void free_routing_tables( routing_table_t* tables, uint32_t n_tables );
+
+//! \brief The chip the given link of chip ( x, y ) leads to, on a machine
+//! without wrap-around.
+//! \return false at the edge of the machine
+
+bool link_neighbour( uint32_t x, uint32_t y, uint32_t link, uint32_t width, uint32_t height,
+					 uint32_t* nx, uint32_t* ny );
+
+//! \brief Tables for a width x height machine with 16 application cores
+//! per chip, in populations of cores_per_population consecutive cores.
+//! Each population projects to fan_out random populations; every core
+//! gets one SUBVERTEX_KEY entry on each chip of its dimension-ordered
+//! route tree, as PACMAN writes them.
+//! \return width * height tables ordered by x then y
+
+routing_table_t* synthetic_routing_tables( uint32_t width, uint32_t height, uint32_t cores_per_population,
+										   uint32_t fan_out, uint32_t seed );
+
+#endif /*__ROUTING_TABLE_H__*/
@@ -0,0 +1,286 @@
+/*
+	Compression ratio and decode cost of compressed synaptic rows
+	(synaptic_row_encoder.c, neural_models/compressed_synaptic_row.h).
+
+	Rows are built for the networks in io/ and two denser connectors:
+
+		synfire			io/synfire_if_curr_exp.py: 200 neurons in a chain,
+						weight 2.0, delay 17
+		synfire_random	io/synfire_if_curr_exp_random.py: the same chain
+						with delays uniform in [1, 50]
+		fixed_prob		256 x 256, p = 0.1, weights uniform in [0, 2),
+						delays uniform in [1, 16]
+		all_to_all		256 x 256, weight 0.5, delay 1
+		near_max		256 rows of 32, weights in [0xFE00, 0xFFFF] at
+						the top of the 16-bit field, the first row only
+						0xFEDF and 0xFFFF
+
+	The uncompressed size is the current layout: three header words plus
+	the fixed synapses, padded to the projection's row length from the
+	row length translation table.  Every row is decoded again and checked
+	against the original; with --weight-bits below 16 the worst weight
+	error is reported instead, and a row fails if any weight is a whole
+	weight step out.  near_max is also run at 3 bits, so the lossy round
+	trip at the top of the weight field is always checked.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "synaptic_row_encoder.h"
+
+
+#define N_TARGETS			256
+#define ROW_HEADER_WORDS	3
+#define WEIGHT_SCALE		4096.0		// weights in nA as s3.12, as in the sample images
+#define MAX_CORE_DELAY		16			// longer delays go through the delay extension
+#define NEAR_MAX_SYNAPSES	32
+#define NEAR_MAX_LOSSY_BITS	3
+
+static const uint32_t	row_lengths[] = { 0, 1, 8, 16, 32, 64, 128, 256 };
+
+typedef enum { SYNFIRE, SYNFIRE_RANDOM, FIXED_PROBABILITY, ALL_TO_ALL, NEAR_MAX, N_NETWORKS } network_t;
+
+static const char*		network_names[] = { "synfire", "synfire_random", "fixed_prob", "all_to_all", "near_max" };
+
+typedef struct {
+	uint32_t	n_rows;
+	uint32_t*	row_start;			// n_rows + 1 offsets into synapses
+	uint32_t*	synapses;
+} network_rows_t;
+
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t next_random( void )
+{
+	// xorshift32; the bench only needs repeatable variety
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static double uniform( double low, double high )
+{
+	return low + ( high - low ) * ( next_random() / 4294967296.0 );
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static uint32_t synapse_word( uint32_t target, double weight, uint32_t delay, uint32_t type )
+{
+	// the on-core part of a delay; the delay extension adds whole multiples of 16
+	uint32_t core_delay = ( ( delay - 1 ) % MAX_CORE_DELAY ) + 1;
+	uint32_t w = (uint32_t) ( weight * WEIGHT_SCALE + 0.5 );
+
+	return ( w << 16 ) | ( core_delay << 9 ) | ( type << 8 ) | target;
+}
+
+
+static network_rows_t build_network( network_t network )
+{
+	network_rows_t rows;
+	uint32_t n_rows = network == SYNFIRE || network == SYNFIRE_RANDOM ? 200 : N_TARGETS;
+	uint32_t capacity = n_rows * N_TARGETS;
+
+	rows.n_rows = n_rows;
+	rows.row_start = malloc( ( n_rows + 1 ) * sizeof( uint32_t ) );
+	rows.synapses = malloc( capacity * sizeof( uint32_t ) );
+
+	uint32_t n = 0;
+
+	for( uint32_t source = 0; source < n_rows; source++ ) {
+		rows.row_start[source] = n;
+
+		switch( network ) {
+		case SYNFIRE:
+			// 100 neurons per core, so the target index is local to its core
+			rows.synapses[n++] = synapse_word( ( source + 1 ) % 200 % 100, 2.0, 17, 0 );
+			break;
+		case SYNFIRE_RANDOM:
+			rows.synapses[n++] = synapse_word( ( source + 1 ) % 200 % 100, 2.0,
+											   1 + next_random() % 50, 0 );
+			break;
+		case FIXED_PROBABILITY:
+			for( uint32_t target = 0; target < N_TARGETS; target++ )
+				if( next_random() < 0.1 * 4294967296.0 )
+					rows.synapses[n++] = synapse_word( target, uniform( 0.0, 2.0 ),
+													   1 + next_random() % 16, 0 );
+			break;
+		case ALL_TO_ALL:
+			for( uint32_t target = 0; target < N_TARGETS; target++ )
+				rows.synapses[n++] = synapse_word( target, 0.5, 1, 0 );
+			break;
+		case NEAR_MAX:
+			// raw weights: the top code must not round past 0xFFFF
+			if( source == 0 ) {
+				rows.synapses[n++] = synapse_word( 0, 0xFEDF / WEIGHT_SCALE, 1, 0 );
+				rows.synapses[n++] = synapse_word( 1, 0xFFFF / WEIGHT_SCALE, 1, 0 );
+				break;
+				}
+			for( uint32_t i = 0; i < NEAR_MAX_SYNAPSES; i++ )
+				rows.synapses[n++] = synapse_word( i * ( N_TARGETS / NEAR_MAX_SYNAPSES ),
+												   ( 0xFE00 + next_random() % 0x200 ) / WEIGHT_SCALE,
+												   1 + next_random() % 16, 0 );
+			break;
+		default:
+			break;
+			}
+		}
+	rows.row_start[n_rows] = n;
+
+	return rows;
+}
+
+
+static uint32_t padded_row_length( uint32_t n )
+{
+	for( uint32_t i = 0; i < sizeof( row_lengths ) / sizeof( row_lengths[0] ); i++ )
+		if( row_lengths[i] >= n )
+			return row_lengths[i];
+	return n;
+}
+
+
+// index and delay first, then weight: the order the encoder keeps, since
+// weight rounding is monotonic
+static int compare_words( const void* a, const void* b )
+{
+	uint32_t s = *(const uint32_t*) a, t = *(const uint32_t*) b;
+
+	s = ( s << 16 ) | ( s >> 16 );
+	t = ( t << 16 ) | ( t >> 16 );
+
+	return ( s > t ) - ( s < t );
+}
+
+
+// returns the rows and synapses that failed the check
+static uint32_t bench_network( network_t network, uint32_t weight_bits, uint32_t repeats )
+{
+	network_rows_t rows = build_network( network );
+	uint32_t max_row = 0;
+
+	for( uint32_t r = 0; r < rows.n_rows; r++ )
+		if( rows.row_start[r + 1] - rows.row_start[r] > max_row )
+			max_row = rows.row_start[r + 1] - rows.row_start[r];
+
+	// one padded row length per projection
+	uint64_t original_bytes = (uint64_t) rows.n_rows * ( ROW_HEADER_WORDS + padded_row_length( max_row ) ) * 4;
+	uint32_t* compressed = malloc( (uint64_t) rows.n_rows * COMPRESSED_ROW_MAX_WORDS * sizeof( uint32_t ) );
+	uint32_t* compressed_start = malloc( ( rows.n_rows + 1 ) * sizeof( uint32_t ) );
+	uint32_t n_words = 0;
+
+	for( uint32_t r = 0; r < rows.n_rows; r++ ) {
+		compressed_start[r] = n_words;
+		n_words += synaptic_row_encode( &rows.synapses[rows.row_start[r]], rows.row_start[r + 1] - rows.row_start[r],
+										weight_bits, &compressed[n_words] );
+		}
+	compressed_start[rows.n_rows] = n_words;
+
+	// check every row: sorted decoded words against the sorted original
+	uint32_t decoded[COMPRESSED_ROW_MAX_SYNAPSES], expected[COMPRESSED_ROW_MAX_SYNAPSES];
+	uint32_t n_errors = 0, max_weight_error = 0;
+
+	for( uint32_t r = 0; r < rows.n_rows; r++ ) {
+		uint32_t n = rows.row_start[r + 1] - rows.row_start[r];
+
+		memcpy( expected, &rows.synapses[rows.row_start[r]], n * sizeof( uint32_t ) );
+		qsort( expected, n, sizeof( uint32_t ), compare_words );
+
+		if( compressed_row_decode( &compressed[compressed_start[r]], decoded ) != n
+			|| CR_SIZE_WORDS( compressed[compressed_start[r]] ) != compressed_start[r + 1] - compressed_start[r] ) {
+			n_errors++;
+			continue;
+			}
+		qsort( decoded, n, sizeof( uint32_t ), compare_words );
+
+		// rounding to nearest, or down at the top code, is within one step
+		uint32_t weight_step = 1u << CR_WEIGHT_SHIFT( compressed[compressed_start[r]] );
+
+		for( uint32_t i = 0; i < n; i++ ) {
+			uint32_t error = abs( (int32_t) ( decoded[i] >> 16 ) - (int32_t) ( expected[i] >> 16 ) );
+
+			if( ( decoded[i] & 0xFFFF ) != ( expected[i] & 0xFFFF ) || ( weight_bits >= 16 && error )
+				|| error >= weight_step )
+				n_errors++;
+			if( error > max_weight_error )
+				max_weight_error = error;
+			}
+		}
+
+	double best = 1e30;
+	uint32_t checksum = 0;
+
+	for( uint32_t repeat = 0; repeat < repeats; repeat++ ) {
+		double start = now_ns();
+
+		for( uint32_t r = 0; r < rows.n_rows; r++ )
+			checksum += compressed_row_decode( &compressed[compressed_start[r]], decoded ) + decoded[0];
+
+		double elapsed = now_ns() - start;
+
+		if( elapsed < best )
+			best = elapsed;
+		}
+
+	uint32_t n_synapses = rows.row_start[rows.n_rows];
+
+	printf( "%-15s %6u %8u %10llu %10u %7.2fx %9.2f %10.4f %7s\n", network_names[network], weight_bits,
+			n_synapses, (unsigned long long) original_bytes, n_words * 4,
+			(double) original_bytes / ( n_words * 4 ), best / n_synapses,
+			max_weight_error / WEIGHT_SCALE, n_errors ? "FAIL" : "ok" );
+
+	if( checksum == 0xFFFFFFFF )
+		fprintf( stderr, "#" );
+
+	free( rows.row_start );
+	free( rows.synapses );
+	free( compressed );
+	free( compressed_start );
+
+	return n_errors;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t	weight_bits = 16;
+	uint32_t	repeats = 200;
+	uint32_t	n_errors = 0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--weight-bits" ) && i + 1 < argc )
+			weight_bits = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--repeats" ) && i + 1 < argc )
+			repeats = strtoul( argv[++i], NULL, 0 );
+		else {
+			fprintf( stderr, "usage: %s [--weight-bits 1-16] [--repeats N]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	printf( "%-15s %6s %8s %10s %10s %8s %9s %10s %7s\n", "network", "w bits", "synapses", "original",
+			"compressed", "ratio", "ns/syn", "max w err", "check" );
+
+	for( network_t network = 0; network < N_NETWORKS; network++ )
+		n_errors += bench_network( network, weight_bits, repeats );
+	if( weight_bits > NEAR_MAX_LOSSY_BITS )
+		n_errors += bench_network( NEAR_MAX, NEAR_MAX_LOSSY_BITS, repeats );
+
+	return n_errors ? 1 : 0;
+}
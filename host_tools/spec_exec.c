@@ -0,0 +1,324 @@
+/*
+	spec_exec: runs data specifications natively, in parallel.
+
+	Every *_dataSpec_X_Y_P.dat named on the command line, or found under a
+	directory named on the command line, is executed on a pool of worker
+	threads and the matching *_appData_X_Y_P.dat is written next to it,
+	byte for byte the same as the Python executor produces.
+
+		spec_exec [-j threads] [--verify] [--bench repeats] [--compress-rows bits] path...
+
+	--verify compares against the appData files already present instead of
+	writing them.  --bench executes the loaded specs the given number of
+	times in memory (no file I/O) on one thread and then on the pool, and
+	reports specs/s and MB/s of generated image for each.
+
+	--compress-rows rewrites the synaptic matrix of every population core
+	as compressed rows with weight codes of at most the given bits, 16 for
+	exact weights (synaptic_matrix_compressor.h); the images then differ
+	from the Python executor's, and need a binary whose row fetch decodes
+	them (neural_models/compressed_synaptic_row.h).
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "data_spec_executor.h"
+#include "synaptic_matrix_compressor.h"
+#include "thread_pool.h"
+
+
+typedef struct {
+	char*			spec_path;
+	char*			app_data_path;
+	uint32_t*		spec;			// loaded for --bench only
+	uint32_t		n_words;
+	dse_status_t	status;
+	bool			mismatch;
+	uint32_t		image_size;
+	bool			compressed;
+	uint32_t		bytes_saved;	// SDRAM, by compressing the synaptic matrix
+} spec_job_t;
+
+typedef struct {
+	spec_job_t*		jobs;
+	uint32_t		n_jobs;
+	uint32_t		n_jobs_allocated;
+	bool			verify;
+	uint32_t		compress_weight_bits;	// 0: leave the rows as they are
+} spec_run_t;
+
+
+static double now_s( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static void add_spec( spec_run_t* run, const char* path )
+{
+	char* app_data_path = dse_app_data_path( path );
+
+	if( app_data_path == NULL )
+		return;
+
+	if( run->n_jobs == run->n_jobs_allocated ) {
+		run->n_jobs_allocated = run->n_jobs_allocated ? 2 * run->n_jobs_allocated : 64;
+		run->jobs = realloc( run->jobs, run->n_jobs_allocated * sizeof( spec_job_t ) );
+		}
+
+	spec_job_t* job = &run->jobs[run->n_jobs++];
+
+	memset( job, 0, sizeof( *job ) );
+	job->spec_path = strdup( path );
+	job->app_data_path = app_data_path;
+}
+
+
+static int compare_jobs( const void* a, const void* b )
+{
+	return strcmp( ( (const spec_job_t*) a )->spec_path, ( (const spec_job_t*) b )->spec_path );
+}
+
+
+static void add_path( spec_run_t* run, const char* path )
+{
+	struct stat st;
+
+	if( stat( path, &st ) != 0 ) {
+		fprintf( stderr, "cannot access %s\n", path );
+		return;
+		}
+
+	if( !S_ISDIR( st.st_mode ) ) {
+		add_spec( run, path );
+		return;
+		}
+
+	DIR* dir = opendir( path );
+
+	if( dir == NULL )
+		return;
+
+	struct dirent* entry;
+
+	while( ( entry = readdir( dir ) ) != NULL ) {
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		size_t length = strlen( path ) + strlen( entry->d_name ) + 2;
+		char* child = malloc( length );
+
+		snprintf( child, length, "%s/%s", path, entry->d_name );
+
+		if( strstr( entry->d_name, "dataSpec" ) && strstr( entry->d_name, ".dat" ) )
+			add_spec( run, child );
+		else if( stat( child, &st ) == 0 && S_ISDIR( st.st_mode ) )
+			add_path( run, child );
+		free( child );
+		}
+	closedir( dir );
+}
+
+
+static void execute_job( uint32_t index, void* context )
+{
+	spec_run_t* run = context;
+	spec_job_t* job = &run->jobs[index];
+	app_data_image_t image;
+	bool write = !run->verify && run->compress_weight_bits == 0;
+
+	job->status = dse_execute_file( job->spec_path, write ? job->app_data_path : NULL, &image );
+	if( job->status != DSE_OK )
+		return;
+
+	if( run->compress_weight_bits > 0 ) {
+		uint32_t memory_used = image.memory_used;
+
+		job->compressed = synaptic_matrix_compress( &image, run->compress_weight_bits );
+		job->bytes_saved = memory_used - image.memory_used;
+		if( !run->verify )
+			job->status = dse_write_image( job->app_data_path, &image );
+		}
+
+	job->image_size = image.size;
+
+	if( run->verify ) {
+		uint32_t expected_size;
+		uint8_t* expected = dse_read_file( job->app_data_path, &expected_size );
+
+		job->mismatch = expected == NULL || expected_size != image.size
+						|| memcmp( expected, image.data, image.size ) != 0;
+		free( expected );
+		}
+
+	app_data_image_free( &image );
+}
+
+
+static void bench_job( uint32_t index, void* context )
+{
+	spec_run_t* run = context;
+	spec_job_t* job = &run->jobs[index % run->n_jobs];
+	app_data_image_t image;
+
+	if( dse_execute( job->spec, job->n_words, &image ) == DSE_OK ) {
+		if( run->compress_weight_bits > 0 )
+			synaptic_matrix_compress( &image, run->compress_weight_bits );
+		app_data_image_free( &image );
+		}
+}
+
+
+static int bench( spec_run_t* run, uint32_t n_threads, uint32_t repeats )
+{
+	uint64_t bytes_per_pass = 0;
+
+	for( uint32_t j = 0; j < run->n_jobs; j++ ) {
+		uint32_t size;
+		spec_job_t* job = &run->jobs[j];
+
+		job->spec = (uint32_t*) dse_read_file( job->spec_path, &size );
+		if( job->spec == NULL ) {
+			fprintf( stderr, "cannot read %s\n", job->spec_path );
+			return 1;
+			}
+		job->n_words = size / sizeof( uint32_t );
+
+		app_data_image_t image;
+
+		if( dse_execute( job->spec, job->n_words, &image ) != DSE_OK ) {
+			fprintf( stderr, "%s: cannot execute\n", job->spec_path );
+			return 1;
+			}
+		bytes_per_pass += image.size;
+		app_data_image_free( &image );
+		}
+
+	uint32_t n_executions = run->n_jobs * repeats;
+	double mb = bytes_per_pass * (double) repeats / ( 1024.0 * 1024.0 );
+
+	if( n_threads == 0 )
+		n_threads = online_cpus();
+
+	printf( "%u specs x %u repeats, %.1f MB of appData\n", run->n_jobs, repeats, mb );
+	printf( "%8s %12s %12s %10s\n", "threads", "specs/s", "MB/s", "speedup" );
+
+	uint32_t thread_counts[2] = { 1, n_threads };
+	double single = 0.0;
+
+	for( uint32_t t = 0; t < ( n_threads > 1 ? 2 : 1 ); t++ ) {
+		double start = now_s();
+
+		parallel_for( thread_counts[t], n_executions, bench_job, run );
+
+		double elapsed = now_s() - start;
+
+		if( t == 0 )
+			single = elapsed;
+		printf( "%8u %12.0f %12.1f %9.2fx\n", thread_counts[t], n_executions / elapsed,
+				mb / elapsed, single / elapsed );
+		}
+
+	return 0;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [-j threads] [--verify] [--bench repeats] [--compress-rows bits] path...\n"
+			 "  path         dataSpec file, or directory searched for dataSpec files\n"
+			 "  -j           worker threads (default: one per CPU)\n"
+			 "  --verify     compare with the existing appData files, write nothing\n"
+			 "  --bench      time repeated in-memory execution instead of writing\n"
+			 "  --compress-rows\n"
+			 "               compress synaptic rows, weight codes of at most bits (1-16)\n",
+			 name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	spec_run_t	run = { NULL, 0, 0, false, 0 };
+	uint32_t	n_threads = 0;
+	uint32_t	repeats = 0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "-j" ) && i + 1 < argc )
+			n_threads = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--verify" ) )
+			run.verify = true;
+		else if( !strcmp( argv[i], "--bench" ) && i + 1 < argc )
+			repeats = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--compress-rows" ) && i + 1 < argc
+				 && ( run.compress_weight_bits = strtoul( argv[i + 1], NULL, 0 ) ) >= 1
+				 && run.compress_weight_bits <= 16 )
+			i++;
+		else if( argv[i][0] == '-' ) {
+			usage( argv[0] );
+			return 1;
+			}
+		else
+			add_path( &run, argv[i] );
+		}
+
+	if( run.n_jobs == 0 ) {
+		usage( argv[0] );
+		return 1;
+		}
+
+	qsort( run.jobs, run.n_jobs, sizeof( spec_job_t ), compare_jobs );
+
+	if( repeats > 0 )
+		return bench( &run, n_threads, repeats );
+
+	double start = now_s();
+
+	parallel_for( n_threads, run.n_jobs, execute_job, &run );
+
+	double elapsed = now_s() - start;
+	uint32_t n_failed = 0, n_compressed = 0;
+	uint64_t total_bytes = 0, bytes_saved = 0;
+
+	for( uint32_t j = 0; j < run.n_jobs; j++ ) {
+		spec_job_t* job = &run.jobs[j];
+
+		if( job->status != DSE_OK ) {
+			fprintf( stderr, "%s: %s\n", job->spec_path, dse_status_string( job->status ) );
+			n_failed++;
+			}
+		else if( job->mismatch ) {
+			fprintf( stderr, "%s: differs from %s\n", job->spec_path, job->app_data_path );
+			n_failed++;
+			}
+		total_bytes += job->image_size;
+		n_compressed += job->compressed;
+		bytes_saved += job->bytes_saved;
+		}
+
+	printf( "%u specs, %u %s, %llu bytes of appData in %.3f s\n", run.n_jobs,
+			run.n_jobs - n_failed, run.verify ? "identical" : "written",
+			(unsigned long long) total_bytes, elapsed );
+	if( run.compress_weight_bits > 0 )
+		printf( "%u synaptic matrices compressed, %llu bytes of SDRAM saved\n", n_compressed,
+				(unsigned long long) bytes_saved );
+
+	for( uint32_t j = 0; j < run.n_jobs; j++ ) {
+		free( run.jobs[j].spec_path );
+		free( run.jobs[j].app_data_path );
+		free( run.jobs[j].spec );
+		}
+	free( run.jobs );
+
+	return n_failed ? 1 : 0;
+}
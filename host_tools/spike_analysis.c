@@ -0,0 +1,289 @@
+/*
+	Spike train statistics; see spike_analysis.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "thread_pool.h"
+#include "spike_analysis.h"
+
+#define NEURONS_PER_ITEM	64
+#define STRIPES_PER_THREAD	4
+#define BATCH				1024
+
+typedef struct {
+	const spike_trains_t*	trains;
+	spike_analysis_t*		analysis;
+	uint64_t				isi_reciprocal;
+	uint64_t				psth_reciprocal;
+	uint64_t				correlation_reciprocal;
+	uint32_t				n_correlation_bins;
+	double*					rows;			//!< per correlated neuron its counts, centred and of unit length
+	bool*					flat;			//!< and whether its count never changes
+	uint32_t				n_stripes;
+	uint32_t*				stripe_psths;
+	volatile bool			failed;
+} analysis_job_t;
+
+
+//! \brief m such that divide( x, m ) is x / d for every 32 bit x; exact,
+//! as in Lemire, Kaser and Kurz, "Faster remainder by direct computation".
+static uint64_t reciprocal( uint32_t d )
+{
+	return d > 1 ? UINT64_MAX / d + 1 : 0;
+}
+
+
+static inline uint32_t divide( uint32_t x, uint64_t m )
+{
+	return m != 0 ? (uint32_t) ( ( (unsigned __int128) m * x ) >> 64 ) : x;
+}
+
+
+//! \brief Counts bins[0, n) into four interleaved histograms in scratch.
+static void count_bins( const uint32_t* bins, uint32_t n, uint32_t n_bins, uint32_t* scratch )
+{
+	uint32_t i = 0;
+
+	for( ; i + 4 <= n; i += 4 ) {
+		scratch[bins[i]]++;
+		scratch[n_bins + bins[i + 1]]++;
+		scratch[2 * n_bins + bins[i + 2]]++;
+		scratch[3 * n_bins + bins[i + 3]]++;
+		}
+	for( ; i < n; i++ )
+		scratch[bins[i]]++;
+}
+
+
+//! \brief Adds the four histograms in scratch to out, leaving scratch zeroed.
+static void add_bins( uint32_t n_bins, uint32_t* scratch, uint32_t* out )
+{
+	for( uint32_t b = 0; b < n_bins; b++ ) {
+		out[b] += scratch[b] + scratch[n_bins + b] + scratch[2 * n_bins + b] + scratch[3 * n_bins + b];
+		scratch[b] = scratch[n_bins + b] = scratch[2 * n_bins + b] = scratch[3 * n_bins + b] = 0;
+		}
+}
+
+
+//! \brief Histograms ticks[0, n) - first_tick in bins of a reciprocal.
+static void tick_histogram( const uint32_t* ticks, uint64_t n, uint32_t first_tick, uint64_t m, uint32_t n_bins,
+							uint32_t* scratch, uint32_t* out )
+{
+	uint32_t bins[BATCH];
+
+	for( uint64_t done = 0; done < n; ) {
+		uint32_t batch = n - done < BATCH ? n - done : BATCH;
+
+		for( uint32_t j = 0; j < batch; j++ )
+			bins[j] = divide( ticks[done + j] - first_tick, m );
+		count_bins( bins, batch, n_bins, scratch );
+		done += batch;
+		}
+	add_bins( n_bins, scratch, out );
+}
+
+
+static void analyse_neurons( uint32_t item, void* context )
+{
+	analysis_job_t* job = context;
+	const spike_trains_t* trains = job->trains;
+	spike_analysis_t* analysis = job->analysis;
+	uint32_t n_isi_bins = analysis->n_isi_bins, n_correlation_bins = job->n_correlation_bins;
+	uint32_t largest = n_isi_bins > n_correlation_bins ? n_isi_bins : n_correlation_bins;
+	uint32_t* scratch = calloc( 4 * (size_t) largest, sizeof( uint32_t ) );
+	uint32_t* counts = calloc( n_correlation_bins > 0 ? n_correlation_bins : 1, sizeof( uint32_t ) );
+	double seconds = ( trains->end_tick - trains->first_tick ) * trains->ms_per_tick / 1000.0;
+	uint32_t first = item * NEURONS_PER_ITEM;
+	uint32_t end = first + NEURONS_PER_ITEM < trains->n_neurons ? first + NEURONS_PER_ITEM : trains->n_neurons;
+
+	if( scratch == NULL || counts == NULL ) {
+		job->failed = true;
+		free( scratch );
+		free( counts );
+		return;
+		}
+
+	for( uint32_t i = first; i < end; i++ ) {
+		const uint32_t* ticks = trains->ticks + trains->starts[i];
+		uint64_t n = trains->starts[i + 1] - trains->starts[i];
+		uint32_t* isi_histogram = analysis->isi_histograms + (size_t) i * n_isi_bins;
+		double sum = 0, sum_squares = 0;
+		uint32_t bins[BATCH];
+
+		analysis->rates[i] = seconds > 0 ? n / seconds : 0;
+
+		// ISIs: bins without branches, and the moments for the CV
+		for( uint64_t done = 1; done < n; ) {
+			uint32_t batch = n - done < BATCH ? n - done : BATCH;
+
+			for( uint32_t j = 0; j < batch; j++ ) {
+				uint32_t isi = ticks[done + j] - ticks[done + j - 1];
+				uint32_t bin = divide( isi, job->isi_reciprocal );
+
+				bins[j] = bin < n_isi_bins ? bin : n_isi_bins - 1;
+				sum += isi;
+				sum_squares += (double) isi * isi;
+				}
+			count_bins( bins, batch, n_isi_bins, scratch );
+			done += batch;
+			}
+		add_bins( n_isi_bins, scratch, isi_histogram );
+		if( n > 2 ) {
+			double mean = sum / ( n - 1 ), variance = sum_squares / ( n - 1 ) - mean * mean;
+
+			analysis->cvs[i] = sqrt( variance > 0 ? variance : 0 ) / mean;
+			}
+		else
+			analysis->cvs[i] = NAN;
+
+		if( i >= analysis->n_correlated )
+			continue;
+
+		// binned counts, centred and scaled so correlations are dot products
+		double* row = job->rows + (size_t) i * n_correlation_bins;
+		double mean = (double) n / n_correlation_bins, length = 0;
+
+		tick_histogram( ticks, n, trains->first_tick, job->correlation_reciprocal, n_correlation_bins, scratch, counts );
+		for( uint32_t b = 0; b < n_correlation_bins; b++ ) {
+			row[b] = counts[b] - mean;
+			length += row[b] * row[b];
+			counts[b] = 0;
+			}
+		job->flat[i] = length == 0;
+		length = length > 0 ? 1 / sqrt( length ) : 0;
+		for( uint32_t b = 0; b < n_correlation_bins; b++ )
+			row[b] *= length;
+		}
+
+	free( scratch );
+	free( counts );
+}
+
+
+static void analyse_stripe( uint32_t s, void* context )
+{
+	analysis_job_t* job = context;
+	const spike_trains_t* trains = job->trains;
+	uint32_t n_bins = job->analysis->n_psth_bins;
+	uint64_t n = trains->starts[trains->n_neurons];
+	uint64_t first = n * s / job->n_stripes, end = n * ( s + 1 ) / job->n_stripes;
+	uint32_t* scratch = calloc( 4 * (size_t) n_bins, sizeof( uint32_t ) );
+
+	if( scratch == NULL ) {
+		job->failed = true;
+		return;
+		}
+
+	// which neuron a spike is does not matter here, so stripes split them evenly
+	tick_histogram( trains->ticks + first, end - first, trains->first_tick, job->psth_reciprocal, n_bins, scratch,
+					job->stripe_psths + (size_t) s * n_bins );
+	free( scratch );
+}
+
+
+static void correlate_row( uint32_t i, void* context )
+{
+	analysis_job_t* job = context;
+	uint32_t n = job->analysis->n_correlated, n_bins = job->n_correlation_bins;
+	const double* x = job->rows + (size_t) i * n_bins;
+	double* correlations = job->analysis->correlations;
+
+	for( uint32_t j = i; j < n; j++ ) {
+		const double* y = job->rows + (size_t) j * n_bins;
+		double sums[4] = { 0, 0, 0, 0 };
+		uint32_t b = 0;
+
+		// four sums, which the compiler may keep in vector registers
+		for( ; b + 4 <= n_bins; b += 4 ) {
+			sums[0] += x[b] * y[b];
+			sums[1] += x[b + 1] * y[b + 1];
+			sums[2] += x[b + 2] * y[b + 2];
+			sums[3] += x[b + 3] * y[b + 3];
+			}
+		for( ; b < n_bins; b++ )
+			sums[0] += x[b] * y[b];
+
+		double r = job->flat[i] || job->flat[j] ? NAN : ( sums[0] + sums[1] ) + ( sums[2] + sums[3] );
+
+		correlations[(size_t) i * n + j] = correlations[(size_t) j * n + i] = r;
+		}
+}
+
+
+bool spike_analysis_run( const spike_trains_t* trains, const spike_analysis_config_t* config,
+						 spike_analysis_t* analysis )
+{
+	uint32_t n_threads = config->n_threads > 0 ? config->n_threads : online_cpus();
+	uint32_t n_ticks = trains->end_tick > trains->first_tick ? trains->end_tick - trains->first_tick : 0;
+	uint32_t n_neurons = trains->n_neurons;
+	analysis_job_t job = { trains, analysis };
+
+	memset( analysis, 0, sizeof( *analysis ) );
+	if( config->n_isi_bins == 0 || config->isi_bin_ticks == 0 || config->psth_bin_ticks == 0
+		|| config->correlation_bin_ticks == 0 )
+		return false;
+
+	analysis->n_neurons = n_neurons;
+	analysis->n_isi_bins = config->n_isi_bins;
+	analysis->n_psth_bins = ( n_ticks + config->psth_bin_ticks - 1 ) / config->psth_bin_ticks;
+	analysis->n_correlated = config->n_correlated < n_neurons ? config->n_correlated : n_neurons;
+	job.n_correlation_bins = ( n_ticks + config->correlation_bin_ticks - 1 ) / config->correlation_bin_ticks;
+	job.isi_reciprocal = reciprocal( config->isi_bin_ticks );
+	job.psth_reciprocal = reciprocal( config->psth_bin_ticks );
+	job.correlation_reciprocal = reciprocal( config->correlation_bin_ticks );
+	job.n_stripes = n_threads * STRIPES_PER_THREAD;
+
+	uint32_t n_correlated = analysis->n_correlated;
+
+	analysis->rates = malloc( n_neurons * sizeof( double ) + 1 );
+	analysis->cvs = malloc( n_neurons * sizeof( double ) + 1 );
+	analysis->isi_histograms = calloc( (size_t) n_neurons * analysis->n_isi_bins + 1, sizeof( uint32_t ) );
+	analysis->population_isi = calloc( analysis->n_isi_bins, sizeof( uint64_t ) );
+	analysis->psth = calloc( analysis->n_psth_bins + 1, sizeof( uint32_t ) );
+	analysis->correlations = malloc( (size_t) n_correlated * n_correlated * sizeof( double ) + 1 );
+	job.rows = malloc( (size_t) n_correlated * job.n_correlation_bins * sizeof( double ) + 1 );
+	job.flat = malloc( n_correlated + 1 );
+	job.stripe_psths = calloc( (size_t) job.n_stripes * analysis->n_psth_bins + 1, sizeof( uint32_t ) );
+	if( analysis->rates == NULL || analysis->cvs == NULL || analysis->isi_histograms == NULL
+		|| analysis->population_isi == NULL || analysis->psth == NULL || analysis->correlations == NULL
+		|| job.rows == NULL || job.flat == NULL || job.stripe_psths == NULL ) {
+		free( job.rows );
+		free( job.flat );
+		free( job.stripe_psths );
+		spike_analysis_free( analysis );
+		return false;
+		}
+
+	parallel_for( n_threads, ( n_neurons + NEURONS_PER_ITEM - 1 ) / NEURONS_PER_ITEM, analyse_neurons, &job );
+	parallel_for( n_threads, job.n_stripes, analyse_stripe, &job );
+	parallel_for( n_threads, n_correlated, correlate_row, &job );
+
+	for( uint32_t s = 0; s < job.n_stripes; s++ )
+		for( uint32_t b = 0; b < analysis->n_psth_bins; b++ )
+			analysis->psth[b] += job.stripe_psths[(size_t) s * analysis->n_psth_bins + b];
+	for( uint32_t i = 0; i < n_neurons; i++ )
+		for( uint32_t b = 0; b < analysis->n_isi_bins; b++ )
+			analysis->population_isi[b] += analysis->isi_histograms[(size_t) i * analysis->n_isi_bins + b];
+
+	free( job.rows );
+	free( job.flat );
+	free( job.stripe_psths );
+	if( job.failed )
+		spike_analysis_free( analysis );
+	return !job.failed;
+}
+
+
+void spike_analysis_free( spike_analysis_t* analysis )
+{
+	free( analysis->rates );
+	free( analysis->cvs );
+	free( analysis->isi_histograms );
+	free( analysis->population_isi );
+	free( analysis->psth );
+	free( analysis->correlations );
+	memset( analysis, 0, sizeof( *analysis ) );
+}
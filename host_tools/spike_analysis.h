@@ -0,0 +1,75 @@
+/*! \file
+ *
+ *  \brief Spike train statistics for validating a run: per-neuron firing
+ *    rates, ISI histograms and CV, the population PSTH, and pairwise
+ *    correlation of binned spike counts.
+ *
+ *  \details Works on spike trains as recording_reader_spike_trains()
+ *    gives them: each neuron's ticks in order, neuron by neuron, so a
+ *    neuron's ISIs are the differences of neighbouring ticks.
+ *
+ *    Everything runs on a thread_pool.h pool: rates, ISIs and binned
+ *    counts by neuron, the PSTH by stripe of the spikes into a histogram
+ *    per stripe that are summed after, and correlations by row of the
+ *    matrix.  Histograms are made in two passes, as compilers can
+ *    vectorise: the bin of every value first, without branches, dividing
+ *    by a precomputed reciprocal; then the counts, into four interleaved
+ *    histograms so that neighbouring values in the same bin do not wait
+ *    on each other.
+ *
+ *    Bins are in ticks.  The last ISI bin also counts every longer ISI.
+ *
+ */
+
+#ifndef __SPIKE_ANALYSIS_H__
+#define __SPIKE_ANALYSIS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! \brief Spike trains of neurons [first_neuron, first_neuron + n_neurons)
+//! over ticks [first_tick, end_tick).
+typedef struct {
+	uint32_t		first_neuron;
+	uint32_t		n_neurons;
+	uint32_t		first_tick;
+	uint32_t		end_tick;
+	double			ms_per_tick;
+	const uint32_t*	ticks;			//!< each neuron's ticks in order, neuron by neuron
+	const uint64_t*	starts;			//!< neuron i's from ticks[starts[i]] to ticks[starts[i + 1]]
+} spike_trains_t;
+
+typedef struct {
+	uint32_t	n_isi_bins;
+	uint32_t	isi_bin_ticks;
+	uint32_t	psth_bin_ticks;
+	uint32_t	correlation_bin_ticks;
+	uint32_t	n_correlated;			//!< the first neurons to correlate, pairwise
+	uint32_t	n_threads;				//!< 0 for one per online CPU
+} spike_analysis_config_t;
+
+typedef struct {
+	uint32_t	n_neurons;
+	double*		rates;					//!< Hz, per neuron
+	double*		cvs;					//!< per neuron; NaN with fewer than two ISIs
+	uint32_t	n_isi_bins;
+	uint32_t*	isi_histograms;			//!< n_isi_bins per neuron
+	uint64_t*	population_isi;			//!< the sum of them
+	uint32_t	n_psth_bins;
+	uint32_t*	psth;					//!< spikes of every neuron per bin
+	uint32_t	n_correlated;
+	double*		correlations;			//!< n_correlated squared; NaN for a neuron whose count never changes
+} spike_analysis_t;
+
+
+//! \brief Analyses spike trains.
+//! \return false if the configuration has a zero bin or memory runs out
+
+bool spike_analysis_run( const spike_trains_t* trains, const spike_analysis_config_t* config,
+						 spike_analysis_t* analysis );
+
+//! \brief Frees what spike_analysis_run allocated.
+
+void spike_analysis_free( spike_analysis_t* analysis );
+
+#endif /*__SPIKE_ANALYSIS_H__*/
@@ -0,0 +1,205 @@
+/*
+	Batched, rate-controlled EIEIO spike injection; see spike_injector.h.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+
+#include "spike_injector.h"
+
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void sleep_until( uint64_t ns )
+{
+	struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR )
+		;
+}
+
+
+bool spike_injector_open( spike_injector_t* injector, const char* host, uint16_t port,
+						  const eieio_format_t* format, uint32_t keys_per_message,
+						  uint32_t batch, double rate )
+{
+	struct addrinfo hints, *address;
+
+	memset( injector, 0, sizeof( spike_injector_t ) );
+	injector->fd = -1;
+
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if( getaddrinfo( host, NULL, &hints, &address ) != 0 )
+		return false;
+	injector->board = *(struct sockaddr_in*) address->ai_addr;
+	injector->board.sin_port = htons( port );
+	freeaddrinfo( address );
+
+	uint32_t max_keys = eieio_max_keys( format );
+
+	injector->format = *format;
+	injector->keys_per_message = keys_per_message && keys_per_message < max_keys ? keys_per_message : max_keys;
+	injector->batch = batch == 0 ? 1 : batch > SPIKE_INJECTOR_MAX_BATCH ? SPIKE_INJECTOR_MAX_BATCH : batch;
+	injector->rate = rate;
+
+	injector->pending = malloc( injector->batch * injector->keys_per_message * sizeof( uint32_t ) );
+	injector->messages = malloc( injector->batch * EIEIO_MAX_MESSAGE_BYTES );
+	injector->headers = calloc( injector->batch, sizeof( struct mmsghdr ) );
+	injector->iov = calloc( injector->batch, sizeof( struct iovec ) );
+	if( !injector->pending || !injector->messages || !injector->headers || !injector->iov ) {
+		spike_injector_close( injector );
+		return false;
+		}
+
+	for( uint32_t m = 0; m < injector->batch; m++ ) {
+		injector->iov[m].iov_base = injector->messages + m * EIEIO_MAX_MESSAGE_BYTES;
+		injector->headers[m].msg_hdr.msg_iov = &injector->iov[m];
+		injector->headers[m].msg_hdr.msg_iovlen = 1;
+		}
+
+	// connected, so sendmmsg needs no addresses
+	injector->fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	if( injector->fd < 0
+		|| connect( injector->fd, (struct sockaddr*) &injector->board, sizeof( injector->board ) ) < 0 ) {
+		spike_injector_close( injector );
+		return false;
+		}
+
+	return true;
+}
+
+
+static bool send_pending( spike_injector_t* injector )
+{
+	uint32_t n_keys = injector->n_pending, n_messages = 0;
+
+	if( n_keys == 0 )
+		return true;
+
+	for( uint32_t first = 0; first < n_keys; first += injector->keys_per_message, n_messages++ ) {
+		uint32_t n = n_keys - first < injector->keys_per_message ? n_keys - first : injector->keys_per_message;
+
+		injector->iov[n_messages].iov_len = eieio_encode( &injector->format, &injector->pending[first], n,
+														 injector->iov[n_messages].iov_base );
+		}
+
+	if( injector->rate > 0.0 ) {
+		uint64_t interval = n_keys * 1e9 / injector->rate, now = now_ns();
+
+		if( injector->next_send_ns == 0 || now > injector->next_send_ns + interval )
+			injector->next_send_ns = now;
+		else
+			sleep_until( injector->next_send_ns );
+		injector->next_send_ns += interval;
+		}
+
+	bool ok = true;
+	uint32_t sent = 0;
+
+	while( sent < n_messages ) {
+		int n = sendmmsg( injector->fd, &injector->headers[sent], n_messages - sent, 0 );
+
+		if( n < 0 ) {
+			if( errno == EINTR )
+				continue;
+			// nobody listening yet (ECONNREFUSED) or no buffer space: drop the rest
+			injector->n_send_errors += n_messages - sent;
+			ok = false;
+			break;
+			}
+		sent += n;
+		injector->n_messages += n;
+		}
+
+	// only the last message can be short
+	uint64_t keys_sent = (uint64_t) sent * injector->keys_per_message;
+
+	injector->n_spikes += keys_sent < n_keys ? keys_sent : n_keys;
+	injector->n_pending = 0;
+
+	return ok;
+}
+
+
+void spike_injector_set_max_hold( spike_injector_t* injector, uint64_t max_hold_ns )
+{
+	injector->max_hold_ns = max_hold_ns;
+}
+
+
+bool spike_injector_send( spike_injector_t* injector, const uint32_t* keys, uint32_t n_keys )
+{
+	uint32_t capacity = injector->batch * injector->keys_per_message;
+	bool ok = true;
+
+	while( n_keys > 0 ) {
+		uint32_t n = capacity - injector->n_pending;
+
+		if( injector->n_pending == 0 && injector->max_hold_ns > 0 )
+			injector->oldest_pending_ns = now_ns();
+
+		if( n > n_keys )
+			n = n_keys;
+		memcpy( &injector->pending[injector->n_pending], keys, n * sizeof( uint32_t ) );
+		injector->n_pending += n;
+		keys += n;
+		n_keys -= n;
+
+		if( injector->n_pending == capacity )
+			ok &= send_pending( injector );
+		}
+
+	return ok & spike_injector_poll( injector );
+}
+
+
+uint64_t spike_injector_deadline( const spike_injector_t* injector )
+{
+	if( injector->n_pending == 0 || injector->max_hold_ns == 0 )
+		return UINT64_MAX;
+	return injector->oldest_pending_ns + injector->max_hold_ns;
+}
+
+
+bool spike_injector_poll( spike_injector_t* injector )
+{
+	uint64_t deadline = spike_injector_deadline( injector );
+
+	if( deadline == UINT64_MAX || deadline > now_ns() )
+		return true;
+	return send_pending( injector );
+}
+
+
+bool spike_injector_flush( spike_injector_t* injector )
+{
+	return send_pending( injector );
+}
+
+
+void spike_injector_close( spike_injector_t* injector )
+{
+	if( injector->fd >= 0 )
+		close( injector->fd );
+	free( injector->pending );
+	free( injector->messages );
+	free( injector->headers );
+	free( injector->iov );
+	memset( injector, 0, sizeof( spike_injector_t ) );
+	injector->fd = -1;
+}
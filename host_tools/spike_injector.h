@@ -0,0 +1,92 @@
+/*! \file
+ *
+ *  \brief Live spike injection into a reverse IP tag
+ *    (ReverseIpTagMultiCastSource) as EIEIO data messages.
+ *
+ *  \details Keys are packed as many to a message as the format allows,
+ *    and messages go out sendmmsg() batch messages at a time.  With a
+ *    rate set, each batch waits for its slot on an absolute schedule of
+ *    rate spikes per second, so pauses in the caller do not accumulate
+ *    as drift; a caller more than one batch behind restarts the schedule
+ *    instead of bursting to catch up.
+ *
+ *    A key waits for its batch to fill, which at low rates can take
+ *    seconds.  With a maximum hold time set, a part-filled batch goes out
+ *    once its oldest key has waited that long: send checks it, and a
+ *    caller with nothing to send polls spike_injector_deadline() and
+ *    calls spike_injector_poll().
+ *
+ */
+
+#ifndef __SPIKE_INJECTOR_H__
+#define __SPIKE_INJECTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "eieio.h"
+
+#define REVERSE_IP_TAG_PORT			12345
+#define SPIKE_INJECTOR_MAX_BATCH	1024
+
+typedef struct {
+	int					fd;
+	struct sockaddr_in	board;
+	eieio_format_t		format;
+	uint32_t			keys_per_message;
+	uint32_t			batch;			//!< messages per sendmmsg
+	double				rate;			//!< spikes per second, 0 for as fast as possible
+	uint64_t			next_send_ns;
+	uint64_t			max_hold_ns;	//!< 0 to wait for a full batch
+	uint64_t			oldest_pending_ns;	//!< when the first pending key was queued
+
+	uint32_t*			pending;		//!< keys not yet in a full batch
+	uint32_t			n_pending;
+	uint8_t*			messages;		//!< batch x EIEIO_MAX_MESSAGE_BYTES
+	struct mmsghdr*		headers;
+	struct iovec*		iov;
+
+	uint64_t			n_messages;
+	uint64_t			n_spikes;		//!< keys in messages actually sent
+	uint64_t			n_send_errors;	//!< messages dropped
+} spike_injector_t;
+
+
+//! \brief Opens a UDP socket to host:port.
+//! \param[in] keys_per_message At most eieio_max_keys(); 0 for the maximum
+//! \return false if the host cannot be resolved or the socket not made
+
+bool spike_injector_open( spike_injector_t* injector, const char* host, uint16_t port,
+						  const eieio_format_t* format, uint32_t keys_per_message,
+						  uint32_t batch, double rate );
+
+//! \brief Sets the longest a key may wait for its batch to fill.
+//! \param[in] max_hold_ns 0 to always wait for a full batch
+
+void spike_injector_set_max_hold( spike_injector_t* injector, uint64_t max_hold_ns );
+
+//! \brief Queues keys, sending every batch that fills up and, with a
+//!   maximum hold time, a part-filled one whose deadline has passed.
+//! \return false if a send failed
+
+bool spike_injector_send( spike_injector_t* injector, const uint32_t* keys, uint32_t n_keys );
+
+//! \brief When the pending keys must go, in CLOCK_MONOTONIC ns.
+//! \return UINT64_MAX if nothing is pending or there is no maximum hold
+
+uint64_t spike_injector_deadline( const spike_injector_t* injector );
+
+//! \brief Sends the pending keys if their deadline has passed.
+//! \return false if a send failed
+
+bool spike_injector_poll( spike_injector_t* injector );
+
+//! \brief Sends whatever is queued, in part-filled messages if need be.
+
+bool spike_injector_flush( spike_injector_t* injector );
+
+void spike_injector_close( spike_injector_t* injector );
+
+#endif /*__SPIKE_INJECTOR_H__*/
@@ -0,0 +1,251 @@
+/*
+	recvmmsg live spike receiver and lock-free ring readers; see
+	spike_receiver.h.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "spike_receiver.h"
+
+
+#define CONTROL_BYTES		( CMSG_SPACE( sizeof( struct timespec ) ) + CMSG_SPACE( sizeof( uint32_t ) ) )
+#define SOCKET_BUFFER_BYTES	( 8 << 20 )
+
+
+static uint64_t realtime_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_REALTIME, &ts );
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// the kernel's arrival time, updating the drop count on the way
+static uint64_t arrival_ns( spike_receiver_t* receiver, struct msghdr* header, uint64_t fallback )
+{
+	uint64_t time_ns = fallback;
+
+	for( struct cmsghdr* c = CMSG_FIRSTHDR( header ); c != NULL; c = CMSG_NXTHDR( header, c ) ) {
+		if( c->cmsg_level != SOL_SOCKET )
+			continue;
+		if( c->cmsg_type == SO_TIMESTAMPNS ) {
+			struct timespec ts;
+
+			memcpy( &ts, CMSG_DATA( c ), sizeof( ts ) );
+			time_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+			}
+		else if( c->cmsg_type == SO_RXQ_OVFL )
+			memcpy( &receiver->n_kernel_drops, CMSG_DATA( c ), sizeof( uint32_t ) );
+		}
+
+	return time_ns;
+}
+
+
+static void* receive_thread( void* arg )
+{
+	spike_receiver_t* receiver = arg;
+	eieio_event_t ( *decoded )[EIEIO_MAX_COUNT] = malloc( receiver->batch * sizeof( *decoded ) );
+	int counts[SPIKE_RECEIVER_MAX_BATCH];
+
+	if( decoded == NULL ) {
+		fprintf( stderr, "spike receiver: out of memory\n" );
+		return NULL;
+		}
+
+	while( !receiver->stop ) {
+		for( uint32_t m = 0; m < receiver->batch; m++ )
+			receiver->headers[m].msg_hdr.msg_controllen = CONTROL_BYTES;
+
+		int n = recvmmsg( receiver->fd, receiver->headers, receiver->batch, MSG_WAITFORONE, NULL );
+
+		if( n <= 0 )
+			continue;
+
+		uint64_t now = realtime_ns(), n_events = 0;
+
+		for( int m = 0; m < n; m++ ) {
+			counts[m] = eieio_decode( receiver->iov[m].iov_base, receiver->headers[m].msg_len,
+									  decoded[m], EIEIO_MAX_COUNT );
+			if( counts[m] < 0 )
+				receiver->n_malformed++;
+			else
+				n_events += counts[m];
+			}
+
+		// claim before writing, so that readers can tell what was overwritten
+		uint64_t first = receiver->written;
+
+		__atomic_store_n( &receiver->claimed, first + n_events, __ATOMIC_RELAXED );
+		__atomic_thread_fence( __ATOMIC_RELEASE );
+
+		uint64_t position = first;
+
+		for( int m = 0; m < n; m++ ) {
+			uint64_t time_ns = arrival_ns( receiver, &receiver->headers[m].msg_hdr, now );
+
+			for( int e = 0; e < counts[m]; e++, position++ ) {
+				spike_event_t* event = &receiver->ring[position & receiver->ring_mask];
+
+				event->time_ns = time_ns;
+				event->key = decoded[m][e].key;
+				event->payload = decoded[m][e].payload;
+				}
+			}
+
+		receiver->n_datagrams += n;
+		__atomic_store_n( &receiver->written, position, __ATOMIC_RELEASE );
+		}
+
+	free( decoded );
+	return NULL;
+}
+
+
+bool spike_receiver_open( spike_receiver_t* receiver, uint16_t port, uint32_t ring_events, uint32_t batch )
+{
+	struct sockaddr_in address;
+	socklen_t length = sizeof( address );
+	struct timeval timeout = { 0, 100000 };
+	int on = 1, buffer = SOCKET_BUFFER_BYTES;
+	uint64_t size = 1;
+
+	memset( receiver, 0, sizeof( spike_receiver_t ) );
+	receiver->batch = batch == 0 ? 1 : batch > SPIKE_RECEIVER_MAX_BATCH ? SPIKE_RECEIVER_MAX_BATCH : batch;
+
+	while( size < ring_events || size < EIEIO_MAX_COUNT * receiver->batch )
+		size <<= 1;
+	receiver->ring_mask = size - 1;
+	receiver->ring = malloc( size * sizeof( spike_event_t ) );
+	receiver->buffers = malloc( receiver->batch * EIEIO_MAX_MESSAGE_BYTES );
+	receiver->control = calloc( receiver->batch, CONTROL_BYTES );
+	receiver->headers = calloc( receiver->batch, sizeof( struct mmsghdr ) );
+	receiver->iov = calloc( receiver->batch, sizeof( struct iovec ) );
+	receiver->fd = socket( AF_INET, SOCK_DGRAM, 0 );
+	if( !receiver->ring || !receiver->buffers || !receiver->control || !receiver->headers || !receiver->iov
+		|| receiver->fd < 0 ) {
+		spike_receiver_close( receiver );
+		return false;
+		}
+
+	for( uint32_t m = 0; m < receiver->batch; m++ ) {
+		receiver->iov[m].iov_base = receiver->buffers + m * EIEIO_MAX_MESSAGE_BYTES;
+		receiver->iov[m].iov_len = EIEIO_MAX_MESSAGE_BYTES;
+		receiver->headers[m].msg_hdr.msg_iov = &receiver->iov[m];
+		receiver->headers[m].msg_hdr.msg_iovlen = 1;
+		receiver->headers[m].msg_hdr.msg_control = receiver->control + m * CONTROL_BYTES;
+		}
+
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( port );
+	if( bind( receiver->fd, (struct sockaddr*) &address, sizeof( address ) ) < 0
+		|| getsockname( receiver->fd, (struct sockaddr*) &address, &length ) < 0 ) {
+		spike_receiver_close( receiver );
+		return false;
+		}
+	receiver->port = ntohs( address.sin_port );
+
+	// the timeout lets the thread see stop; the rest are best effort
+	setsockopt( receiver->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+	setsockopt( receiver->fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof( buffer ) );
+	setsockopt( receiver->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on ) );
+	setsockopt( receiver->fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof( on ) );
+
+	if( pthread_create( &receiver->thread, NULL, receive_thread, receiver ) != 0 ) {
+		spike_receiver_close( receiver );
+		return false;
+		}
+	receiver->running = true;
+
+	return true;
+}
+
+
+void spike_receiver_close( spike_receiver_t* receiver )
+{
+	if( receiver->running ) {
+		receiver->stop = true;
+		pthread_join( receiver->thread, NULL );
+		}
+	if( receiver->fd >= 0 )
+		close( receiver->fd );
+	free( receiver->ring );
+	free( receiver->buffers );
+	free( receiver->control );
+	free( receiver->headers );
+	free( receiver->iov );
+	memset( receiver, 0, sizeof( spike_receiver_t ) );
+	receiver->fd = -1;
+}
+
+
+void spike_reader_init( spike_reader_t* reader, spike_receiver_t* receiver )
+{
+	reader->receiver = receiver;
+	reader->next = spike_receiver_count( receiver );
+	reader->n_lost = 0;
+}
+
+
+uint32_t spike_reader_poll( spike_reader_t* reader, spike_event_t* events, uint32_t max_events )
+{
+	spike_receiver_t* receiver = reader->receiver;
+	uint64_t capacity = receiver->ring_mask + 1;
+	uint64_t written = spike_receiver_count( receiver );
+
+	if( written - reader->next > capacity ) {
+		reader->n_lost += written - capacity - reader->next;
+		reader->next = written - capacity;
+		}
+
+	uint64_t n = written - reader->next < max_events ? written - reader->next : max_events;
+
+	for( uint64_t i = 0; i < n; i++ )
+		events[i] = receiver->ring[( reader->next + i ) & receiver->ring_mask];
+
+	// anything the receiver may have started overwriting since is lost
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+	uint64_t claimed = __atomic_load_n( &receiver->claimed, __ATOMIC_RELAXED );
+	uint64_t oldest = claimed > capacity ? claimed - capacity : 0;
+
+	if( reader->next < oldest ) {
+		uint64_t lost = oldest - reader->next < n ? oldest - reader->next : n;
+
+		memmove( events, events + lost, ( n - lost ) * sizeof( spike_event_t ) );
+		reader->n_lost += lost;
+		n -= lost;
+		// the rest of the gap is caught at the next poll
+		reader->next += lost;
+		}
+
+	reader->next += n;
+
+	return n;
+}
+
+
+uint32_t spike_reader_wait( spike_reader_t* reader, spike_event_t* events, uint32_t max_events,
+							uint64_t timeout_ns )
+{
+	struct timespec pause = { 0, 20000 };
+	uint64_t waited = 0;
+
+	for( ;; ) {
+		uint32_t n = spike_reader_poll( reader, events, max_events );
+
+		if( n > 0 || waited >= timeout_ns )
+			return n;
+		nanosleep( &pause, NULL );
+		waited += pause.tv_nsec;
+		}
+}
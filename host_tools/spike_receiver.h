@@ -0,0 +1,106 @@
+/*! \file
+ *
+ *  \brief Live spike output from a stripped IP tag (activate_live_output_for),
+ *    received natively in place of a Python callback per packet.
+ *
+ *  \details A receiver thread pulls datagrams with recvmmsg() into buffers
+ *    allocated once at open, decodes the EIEIO events of a whole batch
+ *    and appends them, stamped with the kernel's arrival time, to a
+ *    power-of-two ring of spike_event_t.  Any number of spike_reader_t
+ *    each see every event from the point they start, reading without
+ *    locks: the receiver publishes how far it has claimed and how far
+ *    written, and never waits for readers, as the board cannot be held
+ *    up.  A reader more than a ring behind loses the oldest events and
+ *    counts them; datagrams the kernel dropped because the socket buffer
+ *    was full are counted separately (SO_RXQ_OVFL).
+ *
+ */
+
+#ifndef __SPIKE_RECEIVER_H__
+#define __SPIKE_RECEIVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "eieio.h"
+
+#define LIVE_OUTPUT_PORT			18250
+#define SPIKE_RECEIVER_MAX_BATCH	256
+
+//! \brief One received spike.
+typedef struct {
+	uint64_t	time_ns;		//!< arrival, CLOCK_REALTIME
+	uint32_t	key;
+	uint32_t	payload;
+} spike_event_t;
+
+typedef struct {
+	int					fd;
+	uint16_t			port;			//!< as bound, if opened on port 0
+	uint32_t			batch;			//!< datagrams per recvmmsg
+
+	spike_event_t*		ring;
+	uint64_t			ring_mask;
+	uint64_t			claimed;		//!< events up to here may be being written
+	uint64_t			written;		//!< events up to here are readable
+
+	uint8_t*			buffers;		//!< batch x EIEIO_MAX_MESSAGE_BYTES
+	uint8_t*			control;		//!< arrival time and drop count, per datagram
+	struct mmsghdr*		headers;
+	struct iovec*		iov;
+
+	pthread_t			thread;
+	bool				running;
+	volatile bool		stop;
+
+	uint64_t			n_datagrams;
+	uint64_t			n_malformed;	//!< and commands
+	uint32_t			n_kernel_drops;
+} spike_receiver_t;
+
+//! \brief One consumer's position in a receiver's ring.
+typedef struct {
+	spike_receiver_t*	receiver;
+	uint64_t			next;
+	uint64_t			n_lost;			//!< overwritten before this reader got to them
+} spike_reader_t;
+
+
+//! \brief Binds a UDP socket to port on all interfaces and starts the
+//! receiver thread.
+//! \param[in] port 0 for any free port, then in receiver->port
+//! \param[in] ring_events Rounded up to a power of two
+//! \param[in] batch Datagrams per recvmmsg, at most SPIKE_RECEIVER_MAX_BATCH
+//! \return false if the socket cannot be bound or the thread started
+
+bool spike_receiver_open( spike_receiver_t* receiver, uint16_t port, uint32_t ring_events, uint32_t batch );
+
+//! \brief Stops the thread and frees the ring; no reader may be in use.
+
+void spike_receiver_close( spike_receiver_t* receiver );
+
+//! \brief Events the receiver has made readable so far.
+
+static inline uint64_t spike_receiver_count( const spike_receiver_t* receiver )
+{
+	return __atomic_load_n( &receiver->written, __ATOMIC_ACQUIRE );
+}
+
+//! \brief Starts a reader at the receiver's current position.
+
+void spike_reader_init( spike_reader_t* reader, spike_receiver_t* receiver );
+
+//! \brief Copies up to max_events of the events this reader has not yet
+//! seen, oldest first, without blocking.
+//! \return The number copied
+
+uint32_t spike_reader_poll( spike_reader_t* reader, spike_event_t* events, uint32_t max_events );
+
+//! \brief As spike_reader_poll(), but waits up to timeout_ns for an event.
+
+uint32_t spike_reader_wait( spike_reader_t* reader, spike_event_t* events, uint32_t max_events,
+							uint64_t timeout_ns );
+
+#endif /*__SPIKE_RECEIVER_H__*/
@@ -0,0 +1,222 @@
+/*
+	Compressed synaptic matrix for an appData image; see
+	synaptic_matrix_compressor.h.
+
+	A 2dArray entry is ( block offset in KB << 3 ) | row length index, and
+	a block runs to the next block or the end of the region; its rows stop
+	early at the data specification's 0xDDDDDDDD padding.  Rows are encoded
+	twice, once for the block's stride and once into place, rather than
+	holding every compressed row of a large matrix.  The translation table
+	has room for 7 strides, so with more blocks the smallest strides are
+	rounded up to the next one kept.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "synaptic_matrix_compressor.h"
+#include "synaptic_row_encoder.h"
+
+
+#define MASTER_POP_OFFSET_KB( e )	( ( e ) >> 3 )
+#define MASTER_POP_ROW_INDEX( e )	( ( e ) & 0x7 )
+#define MASTER_POP_MAX_OFFSET_KB	( 0xFFFF >> 3 )
+#define ROW_PADDING					0xDDDDDDDD
+
+typedef struct {
+	uint32_t	offset_kb;
+	uint32_t	row_index;
+	uint32_t	n_rows;
+	uint32_t	stride;				// words per compressed row
+	uint32_t	new_offset_kb;
+	uint32_t	new_row_index;
+} matrix_block_t;
+
+
+static int compare_blocks( const void* a, const void* b )
+{
+	uint32_t s = ( (const matrix_block_t*) a )->offset_kb, t = ( (const matrix_block_t*) b )->offset_kb;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+static int compare_words( const void* a, const void* b )
+{
+	uint32_t s = *(const uint32_t*) a, t = *(const uint32_t*) b;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+static uint32_t* region_words( app_data_image_t* image, uint32_t id )
+{
+	dse_region_t* region = &image->regions[id];
+
+	if( region->size == 0 || region->unfilled || region->offset + region->size > image->size )
+		return NULL;
+	return (uint32_t*) ( image->data + region->offset );
+}
+
+
+// counts the rows of a block and finds its stride; false for plastic rows
+// or a row the encoder cannot code
+static bool measure_block( matrix_block_t* block, const uint32_t* matrix, uint32_t end_words,
+						   const uint32_t* row_lengths, uint32_t max_weight_bits, uint32_t* scratch )
+{
+	uint32_t row_words = PLAIN_ROW_HEADER_WORDS + row_lengths[block->row_index];
+	uint32_t start = block->offset_kb * ( MASTER_POP_BLOCK_BYTES / 4 );
+
+	block->n_rows = 0;
+	block->stride = 0;
+
+	for( uint32_t r = start; r + row_words <= end_words && matrix[r] != ROW_PADDING; r += row_words ) {
+		const uint32_t* row = &matrix[r];
+
+		if( row[0] != 0 || row[2] != 0 || row[1] > row_lengths[block->row_index] )
+			return false;
+
+		uint32_t words = synaptic_row_encode( &row[PLAIN_ROW_HEADER_WORDS], row[1], max_weight_bits, scratch );
+
+		if( words == 0 )
+			return false;
+		if( words > block->stride )
+			block->stride = words;
+		block->n_rows++;
+		}
+
+	return true;
+}
+
+
+bool synaptic_matrix_compress( app_data_image_t* image, uint32_t max_weight_bits )
+{
+	uint32_t* row_lengths = region_words( image, ROW_LENGTHS_REGION );
+	uint32_t* master_pop_words = region_words( image, MASTER_POP_REGION );
+	uint32_t* matrix = region_words( image, SYNAPTIC_MATRIX_REGION );
+
+	if( row_lengths == NULL || master_pop_words == NULL || matrix == NULL
+		|| image->regions[ROW_LENGTHS_REGION].size < ROW_LENGTHS_ENTRIES * sizeof( uint32_t ) )
+		return false;
+
+	uint16_t* master_pop = (uint16_t*) master_pop_words;
+	uint32_t n_entries = image->regions[MASTER_POP_REGION].size / sizeof( uint16_t );
+	uint32_t matrix_words = image->regions[SYNAPTIC_MATRIX_REGION].size / sizeof( uint32_t );
+	matrix_block_t* blocks = malloc( ( n_entries + 1 ) * sizeof( matrix_block_t ) );
+	uint32_t n_blocks = 0;
+
+	// one block per distinct offset; entries with row length index 0 have no rows
+	for( uint32_t e = 0; e < n_entries; e++ ) {
+		uint32_t entry = master_pop[e];
+		bool seen = false;
+
+		if( MASTER_POP_ROW_INDEX( entry ) == 0 )
+			continue;
+		for( uint32_t b = 0; b < n_blocks && !seen; b++ )
+			seen = blocks[b].offset_kb == MASTER_POP_OFFSET_KB( entry );
+		if( !seen ) {
+			blocks[n_blocks].offset_kb = MASTER_POP_OFFSET_KB( entry );
+			blocks[n_blocks].row_index = MASTER_POP_ROW_INDEX( entry );
+			n_blocks++;
+			}
+		}
+	qsort( blocks, n_blocks, sizeof( matrix_block_t ), compare_blocks );
+
+	uint32_t* scratch = malloc( COMPRESSED_ROW_MAX_WORDS * sizeof( uint32_t ) );
+	uint32_t* strides = malloc( ( n_blocks + 1 ) * sizeof( uint32_t ) );
+	uint32_t n_strides = 0;
+	bool ok = n_blocks > 0;
+
+	for( uint32_t b = 0; b < n_blocks && ok; b++ ) {
+		uint32_t end_words = b + 1 < n_blocks ? blocks[b + 1].offset_kb * ( MASTER_POP_BLOCK_BYTES / 4 )
+											  : matrix_words;
+
+		ok = measure_block( &blocks[b], matrix, end_words, row_lengths, max_weight_bits, scratch );
+		strides[n_strides++] = blocks[b].stride;
+		}
+
+	// the strides kept, smallest first; the rest round up to the next one
+	qsort( strides, n_strides, sizeof( uint32_t ), compare_words );
+
+	uint32_t n_unique = 0;
+
+	for( uint32_t s = 0; s < n_strides; s++ )
+		if( n_unique == 0 || strides[s] != strides[n_unique - 1] )
+			strides[n_unique++] = strides[s];
+	while( n_unique > ROW_LENGTHS_ENTRIES - 1 ) {
+		memmove( &strides[0], &strides[1], ( n_unique - 1 ) * sizeof( uint32_t ) );
+		n_unique--;
+		}
+
+	// lay the blocks out again, still on KB boundaries
+	uint32_t new_words = 0;
+
+	for( uint32_t b = 0; b < n_blocks && ok; b++ ) {
+		uint32_t i = 0;
+
+		while( strides[i] < blocks[b].stride )
+			i++;
+		blocks[b].stride = strides[i];
+		blocks[b].new_row_index = i + 1;
+		blocks[b].new_offset_kb = ( new_words * 4 + MASTER_POP_BLOCK_BYTES - 1 ) / MASTER_POP_BLOCK_BYTES;
+		new_words = blocks[b].new_offset_kb * ( MASTER_POP_BLOCK_BYTES / 4 ) + blocks[b].n_rows * blocks[b].stride;
+		ok = blocks[b].new_offset_kb <= MASTER_POP_MAX_OFFSET_KB;
+		}
+
+	if( !ok || new_words >= matrix_words ) {
+		free( blocks );
+		free( scratch );
+		free( strides );
+		return false;
+		}
+
+	// into a buffer of its own, as the blocks move down over rows not yet read
+	uint32_t* compressed = calloc( new_words, sizeof( uint32_t ) );
+
+	for( uint32_t b = 0; b < n_blocks; b++ ) {
+		uint32_t row_words = PLAIN_ROW_HEADER_WORDS + row_lengths[blocks[b].row_index];
+		const uint32_t* row = &matrix[blocks[b].offset_kb * ( MASTER_POP_BLOCK_BYTES / 4 )];
+		uint32_t* out = &compressed[blocks[b].new_offset_kb * ( MASTER_POP_BLOCK_BYTES / 4 )];
+
+		for( uint32_t r = 0; r < blocks[b].n_rows; r++, row += row_words, out += blocks[b].stride )
+			synaptic_row_encode( &row[PLAIN_ROW_HEADER_WORDS], row[1], max_weight_bits, out );
+		}
+
+	for( uint32_t e = 0; e < n_entries; e++ ) {
+		for( uint32_t b = 0; b < n_blocks; b++ )
+			if( MASTER_POP_ROW_INDEX( master_pop[e] ) != 0
+				&& MASTER_POP_OFFSET_KB( master_pop[e] ) == blocks[b].offset_kb ) {
+				master_pop[e] = ( blocks[b].new_offset_kb << 3 ) | blocks[b].new_row_index;
+				break;
+				}
+		}
+
+	memset( row_lengths, 0, ROW_LENGTHS_ENTRIES * sizeof( uint32_t ) );
+	for( uint32_t i = 0; i < n_unique; i++ )
+		row_lengths[i + 1] = strides[i] | COMPRESSED_MATRIX_STRIDE_FLAG;
+
+	// move the regions after the matrix down
+	dse_region_t* region = &image->regions[SYNAPTIC_MATRIX_REGION];
+	uint32_t saved = ( matrix_words - new_words ) * sizeof( uint32_t );
+	uint32_t old_end = region->offset + region->size;
+	uint32_t* header = (uint32_t*) image->data;
+
+	memcpy( matrix, compressed, new_words * sizeof( uint32_t ) );
+	memmove( image->data + old_end - saved, image->data + old_end, image->size - old_end );
+	region->size -= saved;
+
+	for( uint32_t id = SYNAPTIC_MATRIX_REGION + 1; id < DSE_MAX_REGIONS; id++ )
+		if( image->regions[id].offset > 0 ) {
+			image->regions[id].offset -= saved;
+			header[2 + id] = image->regions[id].offset;
+			}
+	image->size -= saved;
+	image->memory_used -= saved;
+
+	free( compressed );
+	free( blocks );
+	free( scratch );
+	free( strides );
+
+	return true;
+}
@@ -0,0 +1,46 @@
+/*! \file
+ *
+ *  \brief Rewrites the synaptic matrix of a population core's appData
+ *    image as compressed rows (synaptic_row_encoder.h).
+ *
+ *  \details The population vertex lays out the synaptic matrix in region
+ *    SYNAPTIC_MATRIX_REGION as one block per master population entry, each
+ *    on a 1 KB boundary, with every row of a block 3 + row length words
+ *    long for the row length the entry selects from the translation table
+ *    in ROW_LENGTHS_REGION.  The compressed matrix keeps the blocks, the
+ *    2dArray table and the translation table, but a block's rows are
+ *    compressed rows padded to the block's stride, and the translation
+ *    table holds strides in words; see compressed_synaptic_row.h.
+ *
+ *    Only fixed synapses are compressed: an image with plastic rows is
+ *    left as it is.
+ *
+ */
+
+#ifndef __SYNAPTIC_MATRIX_COMPRESSOR_H__
+#define __SYNAPTIC_MATRIX_COMPRESSOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_spec_executor.h"
+
+//! \brief Population vertex regions holding the synaptic matrix
+#define ROW_LENGTHS_REGION			3
+#define MASTER_POP_REGION			4
+#define SYNAPTIC_MATRIX_REGION		5
+
+#define ROW_LENGTHS_ENTRIES			8
+#define MASTER_POP_BLOCK_BYTES		1024
+
+//! \brief Compresses the synaptic matrix of image in place, moving the
+//!   regions after it down.
+//! \param[in,out] image An image from dse_execute()
+//! \param[in] max_weight_bits As for synaptic_row_encode()
+//! \return true if the matrix was rewritten; false leaves the image as it
+//!   was, for an image with no synaptic matrix, plastic rows, or a row the
+//!   encoder cannot code
+
+bool synaptic_matrix_compress( app_data_image_t* image, uint32_t max_weight_bits );
+
+#endif /*__SYNAPTIC_MATRIX_COMPRESSOR_H__*/
@@ -0,0 +1,182 @@
+/*
+	Host encoder for compressed synaptic rows; the format is described in
+	neural_models/compressed_synaptic_row.h.
+
+	Synapses are sorted by target index so the indices delta code, then the
+	narrowest field widths are chosen for the row.  Weights are coded
+	relative to the smallest weight in steps of the largest power of two
+	dividing every difference, so quantization is lossless unless
+	max_weight_bits forces a coarser step; the weight stream is run-length
+	coded whenever that is smaller.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "synaptic_row_encoder.h"
+
+
+#define SYNAPSE_INDEX( w )		( ( w ) & 0xFF )
+#define SYNAPSE_DT( w )			( ( ( w ) >> 8 ) & 0xFF )
+#define SYNAPSE_WEIGHT( w )		( ( w ) >> 16 )
+
+
+typedef struct {
+	uint32_t*	word;
+	uint32_t	n_words;
+	uint64_t	buffer;
+	uint32_t	n_bits;
+} bit_writer_t;
+
+
+static void write_bits( bit_writer_t* w, uint32_t value, uint32_t bits )
+{
+	if( bits == 0 )
+		return;
+
+	w->buffer |= (uint64_t) value << w->n_bits;
+	w->n_bits += bits;
+
+	if( w->n_bits >= 32 ) {
+		w->word[w->n_words++] = (uint32_t) w->buffer;
+		w->buffer >>= 32;
+		w->n_bits -= 32;
+		}
+}
+
+
+static void flush_bits( bit_writer_t* w )
+{
+	if( w->n_bits > 0 )
+		w->word[w->n_words++] = (uint32_t) w->buffer;
+	w->buffer = 0;
+	w->n_bits = 0;
+}
+
+
+static uint32_t bits_for( uint32_t value )
+{
+	return value ? 32 - __builtin_clz( value ) : 0;
+}
+
+
+static int compare_synapses( const void* a, const void* b )
+{
+	uint32_t s = *(const uint32_t*) a, t = *(const uint32_t*) b;
+	uint32_t key_s = ( SYNAPSE_INDEX( s ) << 24 ) | ( SYNAPSE_DT( s ) << 16 ) | SYNAPSE_WEIGHT( s );
+	uint32_t key_t = ( SYNAPSE_INDEX( t ) << 24 ) | ( SYNAPSE_DT( t ) << 16 ) | SYNAPSE_WEIGHT( t );
+
+	return ( key_s > key_t ) - ( key_s < key_t );
+}
+
+
+uint32_t synaptic_row_encode( const uint32_t* fixed_synapses, uint32_t n,
+							  uint32_t max_weight_bits, uint32_t* compressed )
+{
+	if( n > COMPRESSED_ROW_MAX_SYNAPSES )
+		return 0;
+
+	compressed[0] = COMPRESSED_ROW_HEADER_WORDS << 10;
+	compressed[1] = 0;
+	if( n == 0 )
+		return COMPRESSED_ROW_HEADER_WORDS;
+
+	uint32_t* row = malloc( n * sizeof( uint32_t ) );
+
+	memcpy( row, fixed_synapses, n * sizeof( uint32_t ) );
+	qsort( row, n, sizeof( uint32_t ), compare_synapses );
+
+	uint32_t max_delta = 0, min_dt = 0xFF, max_dt = 0, min_weight = 0xFFFF, max_weight = 0;
+
+	for( uint32_t i = 0; i < n; i++ ) {
+		if( i > 0 && SYNAPSE_INDEX( row[i] ) - SYNAPSE_INDEX( row[i - 1] ) > max_delta )
+			max_delta = SYNAPSE_INDEX( row[i] ) - SYNAPSE_INDEX( row[i - 1] );
+		if( SYNAPSE_DT( row[i] ) < min_dt ) min_dt = SYNAPSE_DT( row[i] );
+		if( SYNAPSE_DT( row[i] ) > max_dt ) max_dt = SYNAPSE_DT( row[i] );
+		if( SYNAPSE_WEIGHT( row[i] ) < min_weight ) min_weight = SYNAPSE_WEIGHT( row[i] );
+		if( SYNAPSE_WEIGHT( row[i] ) > max_weight ) max_weight = SYNAPSE_WEIGHT( row[i] );
+		}
+
+	// the weight step: the largest power of two dividing every difference,
+	// coarsened until the codes fit in max_weight_bits
+	uint32_t differences = 0;
+
+	for( uint32_t i = 0; i < n; i++ )
+		differences |= SYNAPSE_WEIGHT( row[i] ) - min_weight;
+
+	uint32_t weight_shift = differences ? __builtin_ctz( differences ) : 0;
+
+	while( bits_for( ( max_weight - min_weight ) >> weight_shift ) > max_weight_bits )
+		weight_shift++;
+
+	// the top code decodes to at most max_weight, so a row near 0xFFFF
+	// rounds down rather than past the 16-bit weight field
+	uint32_t max_code = ( max_weight - min_weight ) >> weight_shift;
+	uint32_t weight_bits = bits_for( max_code );
+	uint32_t* codes = malloc( n * sizeof( uint32_t ) );
+	uint32_t n_runs = 0;
+
+	for( uint32_t i = 0; i < n; i++ ) {
+		uint32_t code = ( SYNAPSE_WEIGHT( row[i] ) - min_weight + ( ( 1u << weight_shift ) >> 1 ) ) >> weight_shift;
+
+		codes[i] = code < max_code ? code : max_code;
+		}
+
+	for( uint32_t i = 0, run = 0; i < n; i++ ) {
+		if( i == 0 || codes[i] != codes[i - 1] || run == ( 1u << COMPRESSED_ROW_RUN_BITS ) ) {
+			n_runs++;
+			run = 0;
+			}
+		run++;
+		}
+
+	bool rle = weight_bits > 0
+			   && n_runs * ( COMPRESSED_ROW_RUN_BITS + weight_bits ) < n * weight_bits;
+
+	uint32_t index_bits = bits_for( max_delta );
+	uint32_t dt_bits = bits_for( max_dt - min_dt );
+	uint64_t stream_bits = 8 + (uint64_t) ( n - 1 ) * index_bits + (uint64_t) n * dt_bits
+						   + ( rle ? n_runs * ( COMPRESSED_ROW_RUN_BITS + weight_bits ) : n * weight_bits );
+	uint32_t size_words = COMPRESSED_ROW_HEADER_WORDS + ( stream_bits + 31 ) / 32;
+
+	if( size_words > COMPRESSED_ROW_MAX_WORDS || weight_shift > 15 ) {
+		free( row );
+		free( codes );
+		return 0;
+		}
+
+	compressed[0] = n | ( size_words << 10 ) | ( index_bits << 20 ) | ( dt_bits << 24 )
+					| ( weight_shift << 28 );
+	compressed[1] = min_weight | ( min_dt << 16 ) | ( weight_bits << 24 ) | ( (uint32_t) rle << 29 );
+
+	bit_writer_t w = { compressed + COMPRESSED_ROW_HEADER_WORDS, 0, 0, 0 };
+
+	write_bits( &w, SYNAPSE_INDEX( row[0] ), 8 );
+	for( uint32_t i = 1; i < n; i++ )
+		write_bits( &w, SYNAPSE_INDEX( row[i] ) - SYNAPSE_INDEX( row[i - 1] ), index_bits );
+
+	for( uint32_t i = 0; i < n; i++ )
+		write_bits( &w, SYNAPSE_DT( row[i] ) - min_dt, dt_bits );
+
+	if( !rle )
+		for( uint32_t i = 0; i < n; i++ )
+			write_bits( &w, codes[i], weight_bits );
+	else
+		for( uint32_t i = 0; i < n; ) {
+			uint32_t run = 1;
+
+			while( i + run < n && codes[i + run] == codes[i] && run < ( 1u << COMPRESSED_ROW_RUN_BITS ) )
+				run++;
+			write_bits( &w, run - 1, COMPRESSED_ROW_RUN_BITS );
+			write_bits( &w, codes[i], weight_bits );
+			i += run;
+			}
+
+	flush_bits( &w );
+
+	free( row );
+	free( codes );
+
+	return size_words;
+}
@@ -0,0 +1,26 @@
+/*! \file
+ *
+ *  \brief Host encoder for the compressed synaptic rows decoded on the
+ *    core by neural_models/compressed_synaptic_row.h.
+ *
+ */
+
+#ifndef __SYNAPTIC_ROW_ENCODER_H__
+#define __SYNAPTIC_ROW_ENCODER_H__
+
+#include <stdint.h>
+
+#include "compressed_synaptic_row.h"
+
+//! \brief Encodes n fixed synapse words.
+//! \param[in] fixed_synapses The row; not modified
+//! \param[in] n Number of synapses, at most COMPRESSED_ROW_MAX_SYNAPSES
+//! \param[in] max_weight_bits Weight code width; weights needing more are
+//!   rounded to a coarser step.  16 keeps every weight exact.
+//! \param[out] compressed At least COMPRESSED_ROW_MAX_WORDS words
+//! \return Words written, 0 if the row cannot be encoded
+
+uint32_t synaptic_row_encode( const uint32_t* fixed_synapses, uint32_t n,
+							  uint32_t max_weight_bits, uint32_t* compressed );
+
+#endif /*__SYNAPTIC_ROW_ENCODER_H__*/
@@ -0,0 +1,64 @@
+/*
+	Fork-join worker pool shared by the host tools; see thread_pool.h.
+*/
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+
+typedef struct {
+	uint32_t			n_items;
+	uint32_t			next_item;		// taken with __sync_fetch_and_add
+	parallel_item_t		item;
+	void*				context;
+} parallel_job_t;
+
+
+static void* worker( void* arg )
+{
+	parallel_job_t* job = arg;
+
+	for( ;; ) {
+		uint32_t index = __sync_fetch_and_add( &job->next_item, 1 );
+
+		if( index >= job->n_items )
+			return NULL;
+		job->item( index, job->context );
+		}
+}
+
+
+uint32_t online_cpus( void )
+{
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return n > 0 ? (uint32_t) n : 1;
+}
+
+
+void parallel_for( uint32_t n_threads, uint32_t n_items, parallel_item_t item, void* context )
+{
+	parallel_job_t	job = { n_items, 0, item, context };
+
+	if( n_threads == 0 )
+		n_threads = online_cpus();
+	if( n_threads > n_items )
+		n_threads = n_items;
+
+	// the calling thread is one of the workers
+	pthread_t* threads = malloc( n_threads * sizeof( pthread_t ) );
+	uint32_t n_started = 0;
+
+	for( uint32_t t = 1; t < n_threads; t++ )
+		if( pthread_create( &threads[n_started], NULL, worker, &job ) == 0 )
+			n_started++;
+
+	worker( &job );
+
+	for( uint32_t t = 0; t < n_started; t++ )
+		pthread_join( threads[t], NULL );
+
+	free( threads );
+}
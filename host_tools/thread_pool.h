@@ -0,0 +1,29 @@
+/*! \file
+ *
+ *  \brief Minimal fork-join worker pool for the host tools.
+ *
+ *  \details parallel_for() hands out item indices from a shared counter to
+ *    a fixed number of pthreads, so uneven items (a 13 KB core spec next
+ *    to a 100 byte one) balance themselves.
+ *
+ */
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stdint.h>
+
+//! \brief Work function: processes item \p index; \p context is shared.
+typedef void ( *parallel_item_t )( uint32_t index, void* context );
+
+//! \brief Runs item( i, context ) for every i in [0, n_items) on n_threads
+//! threads and returns when all are done.
+//! \param[in] n_threads Worker count; 0 means one per online CPU.
+
+void parallel_for( uint32_t n_threads, uint32_t n_items, parallel_item_t item, void* context );
+
+//! \brief The number of online CPUs, at least 1.
+
+uint32_t online_cpus( void );
+
+#endif /*__THREAD_POOL_H__*/
@@ -0,0 +1,121 @@
+"""
+Chooses max_atoms_per_core for a population from the calibrated CPU cost
+model and the per-atom DTCM footprint, instead of a hand-picked
+set_number_of_neurons_per_core() value.  Each decision is appended to the
+partitioner report.
+
+The partitioner reads max_atoms_per_core before it looks at the graph, so
+this is a ceiling: the CPU limit is for a population with no input.  The
+synaptic fan-in, recording and SDRAM only become known at partition time,
+when the partitioner scales each slice down until the resources the vertex
+reports fit the core; cpu_cycles() is what the vertex reports, with the
+same safety margin.  SDRAM is left to the partitioner altogether, as the
+vertex's SDRAM usage already counts the synaptic matrix and the recording
+regions.
+"""
+import os
+import math
+import logging
+
+from spynnaker.pyNN.utilities.conf import config
+
+logger = logging.getLogger(__name__)
+
+# memory of one application core
+DTCM_BYTES = 64 * 1024
+
+# per-atom DTCM besides the neuron struct: a 16-slot ring buffer of 16-bit
+# inputs for each of the two synapse types, plus the two input accumulators
+RING_BUFFER_SLOTS = 16
+N_SYNAPSE_TYPES = 2
+SYNAPSE_DTCM_BYTES_PER_ATOM = (RING_BUFFER_SLOTS * N_SYNAPSE_TYPES * 2 +
+                               N_SYNAPSE_TYPES * 4)
+
+REPORT_FILE_NAME = "atoms_per_core_tuning.rpt"
+
+
+def _config_value(option, default):
+    if config.has_option("Partitioner", option):
+        return config.getfloat("Partitioner", option)
+    return default
+
+
+class AtomsPerCoreTuner(object):
+
+    def __init__(self, cost_model, safety_margin=None,
+                 dtcm_reserved_bytes=None):
+        """
+        :param cost_model: a NeuronCostModel
+        :param safety_margin: fraction of the tick left free for packet\
+            handling jitter; [Partitioner] atoms_per_core_safety_margin
+        :param dtcm_reserved_bytes: DTCM kept for stack, code data and DMA\
+            buffers; [Partitioner] atoms_per_core_dtcm_reserved_bytes
+        """
+        self._cost_model = cost_model
+        self._safety_margin = safety_margin \
+            if safety_margin is not None \
+            else _config_value("atoms_per_core_safety_margin", 0.1)
+        self._dtcm_reserved_bytes = dtcm_reserved_bytes \
+            if dtcm_reserved_bytes is not None \
+            else int(_config_value("atoms_per_core_dtcm_reserved_bytes",
+                                   16 * 1024))
+
+    def cpu_cycles(self, n_atoms, synaptic_events_per_atom, stochastic,
+                   recording):
+        """ The cycles a slice needs per tick, with the safety margin, for
+            the partitioner to fit against the core
+        """
+        return int(math.ceil(self._cost_model.cycles_per_tick(
+            n_atoms, synaptic_events_per_atom, stochastic, recording) /
+            (1.0 - self._safety_margin)))
+
+    def tune(self, label, machine_time_step, timescale_factor,
+             neuron_struct_bytes, stochastic=True, upper_limit=256):
+        """
+        :return: the densest packing meeting the CPU limit without input,\
+            the DTCM limit and the model's
+        """
+        cpu_limit = self._cost_model.max_atoms_per_core(
+            machine_time_step * (1.0 - self._safety_margin),
+            timescale_factor, 0.0, stochastic, False,
+            upper_limit=upper_limit)
+
+        dtcm_per_atom = neuron_struct_bytes + SYNAPSE_DTCM_BYTES_PER_ATOM
+        dtcm_limit = (DTCM_BYTES - self._dtcm_reserved_bytes) // dtcm_per_atom
+
+        limits = [("cpu", cpu_limit), ("dtcm", dtcm_limit),
+                  ("model", upper_limit)]
+        binding, n_atoms = min(limits, key=lambda limit: limit[1])
+        n_atoms = max(1, n_atoms)
+
+        self._report(label, n_atoms, binding, limits, machine_time_step,
+                     dtcm_per_atom, stochastic)
+        return n_atoms
+
+    def _report(self, label, n_atoms, binding, limits, machine_time_step,
+                dtcm_per_atom, stochastic):
+        logger.info("{}: {} atoms per core ({} bound)".format(
+            label, n_atoms, binding))
+
+        if not (config.getboolean("Reports", "reportsEnabled") and
+                config.getboolean("Reports", "writePartitionerReports")):
+            return
+        report_dir = config.get("Reports", "defaultReportFilePath")
+        if report_dir == "DEFAULT":
+            report_dir = os.path.join(os.getcwd(), "reports")
+        report_dir = os.path.join(report_dir, "latest")
+        if not os.path.isdir(report_dir):
+            return
+
+        with open(os.path.join(report_dir, REPORT_FILE_NAME), "a") as f:
+            f.write("**** Vertex: '{}'\n".format(label))
+            f.write("Atoms per core at most: {} (bound by {}); the "
+                    "partitioner cuts slices further for synaptic input, "
+                    "recording and SDRAM\n".format(n_atoms, binding))
+            f.write("  tick {} us, safety margin {:.0%}, stochastic "
+                    "{}\n".format(machine_time_step, self._safety_margin,
+                                   stochastic))
+            f.write("  per atom: {} bytes DTCM\n".format(dtcm_per_atom))
+            for name, limit in limits:
+                f.write("  {:<6} limit: {} atoms\n".format(name, limit))
+            f.write("\n")
@@ -0,0 +1,239 @@
+"""
+Connector parameter regions for on-core synaptic row generation, and a
+host generator with exactly the semantics of
+neural_models/connector_generators.c.
+
+A projection is shipped as a few words (see connector_generators.h for
+the layout) and each row is expanded on the core on first use.  The host
+generator produces the same rows bit for bit, for checking and for
+reports; ``python connector_generation.py FILE`` writes a set of test
+vectors that neural_models/host/connector_check compares against the C
+generator.
+
+Nothing ships these regions yet: the population vertex still writes the
+synaptic matrix through spynnaker, and no core code reads the connector
+region, so this module and connector_check only verify the generators.
+
+This module deliberately imports nothing from spynnaker so it runs on a
+bare host.
+"""
+import struct
+import sys
+
+ALL_TO_ALL = 0
+ONE_TO_ONE = 1
+FIXED_PROBABILITY = 2
+DISTANCE_DEPENDENT = 3
+
+ALLOW_SELF_CONNECTIONS = 1 << 0
+SYNAPSE_TYPE_BITS = 1
+SYNAPSE_DELAY_BITS = 4
+MAX_ROW_LENGTH = 256
+
+_MASK = 0xFFFFFFFF
+
+
+class MarsKiss64(object):
+    """ Marsaglia JKISS64 with a caller-held seed, as mars_kiss64_seed()
+    """
+
+    def __init__(self, seed):
+        self._seed = list(seed)
+        if self._seed[1] == 0:
+            self._seed[1] = 13031301
+        self._seed[3] = self._seed[3] % 698769068 + 1
+
+    def next(self):
+        s = self._seed
+        s[0] = (314527869 * s[0] + 1234567) & _MASK
+        s[1] ^= (s[1] << 5) & _MASK
+        s[1] ^= s[1] >> 7
+        s[1] ^= (s[1] << 22) & _MASK
+        t = 4294584393 * s[2] + s[3]
+        s[3] = t >> 32
+        s[2] = t & _MASK
+        return (s[0] + s[1] + s[2]) & _MASK
+
+    def uniform_in_range(self, value_range):
+        """ A uniform integer in [0, value_range], as uniform_in_range()
+        """
+        return (self.next() * (value_range + 1)) >> 32
+
+
+def probability_threshold(probability):
+    """ The draw threshold for a connection probability
+    """
+    return max(0, min(int(round(probability * 2 ** 32)), _MASK))
+
+
+def distance_thresholds(probability_of_distance, max_distance):
+    """
+    :param probability_of_distance: function of the Euclidean grid distance
+    :param max_distance: pairs further apart are never connected
+    :return: thresholds indexed by squared distance
+    """
+    return [probability_threshold(probability_of_distance(d2 ** 0.5))
+            for d2 in range(int(max_distance ** 2) + 1)]
+
+
+class ConnectorProjection(object):
+
+    def __init__(self, connector_type, post_slice_start, post_slice_count,
+                 seed, weight_low, weight_range=0, delay_low=1,
+                 delay_range=0, synapse_type=0, allow_self_connections=True,
+                 probability=None, pre_grid_width=None, post_grid_width=None,
+                 thresholds=None):
+        """
+        :param seed: four 32-bit words; use a different seed per post slice
+        :param weight_low: fixed point weight as written in a synapse word
+        :param weight_range: weights are uniform in [low, low + range]
+        :param delay_low: delay in timesteps
+        :param delay_range: delays are uniform in [low, low + range]
+        :param probability: FIXED_PROBABILITY only
+        :param pre_grid_width: DISTANCE_DEPENDENT only: neurons per grid row
+        :param post_grid_width: DISTANCE_DEPENDENT only
+        :param thresholds: DISTANCE_DEPENDENT only, see distance_thresholds
+        """
+        if post_slice_count > MAX_ROW_LENGTH:
+            raise ValueError("at most {} neurons per post slice".format(
+                MAX_ROW_LENGTH))
+        if weight_low + weight_range > 0xFFFF:
+            raise ValueError("weights must fit in 16 bits")
+        if delay_low + delay_range >= 1 << SYNAPSE_DELAY_BITS:
+            raise ValueError("delays must fit in {} bits".format(
+                SYNAPSE_DELAY_BITS))
+        if not 0 <= synapse_type < 1 << SYNAPSE_TYPE_BITS:
+            raise ValueError("synapse types must fit in {} bits".format(
+                SYNAPSE_TYPE_BITS))
+        self._type = connector_type
+        self._post_slice_start = post_slice_start
+        self._post_slice_count = post_slice_count
+        self._seed = list(seed)
+        self._weight_low = weight_low
+        self._weight_range = weight_range
+        self._delay_low = delay_low
+        self._delay_range = delay_range
+        self._synapse_type = synapse_type
+        self._allow_self_connections = allow_self_connections
+        self._threshold = probability_threshold(probability) \
+            if connector_type == FIXED_PROBABILITY else None
+        self._pre_grid_width = pre_grid_width
+        self._post_grid_width = post_grid_width
+        self._thresholds = thresholds
+
+    def to_words(self):
+        flags = self._synapse_type << 8
+        if self._allow_self_connections:
+            flags |= ALLOW_SELF_CONNECTIONS
+        words = [self._type, self._post_slice_start, self._post_slice_count,
+                 flags] + self._seed + [
+            self._weight_low, self._weight_range, self._delay_low,
+            self._delay_range]
+        if self._type == FIXED_PROBABILITY:
+            words.append(self._threshold)
+        elif self._type == DISTANCE_DEPENDENT:
+            words += [self._pre_grid_width, self._post_grid_width,
+                      len(self._thresholds)] + self._thresholds
+        return words
+
+    def row_seed(self, pre):
+        """ As connector_row_seed()
+        """
+        return [(self._seed[0] + pre * 0x9E3779B9) & _MASK,
+                self._seed[1] ^ ((pre * 0x85EBCA6B) & _MASK),
+                (self._seed[2] + pre * 0xC2B2AE35) & _MASK,
+                (self._seed[3] + pre) & _MASK]
+
+    def _distance_connects(self, pre, post, draw):
+        dx = pre % self._pre_grid_width - post % self._post_grid_width
+        dy = pre // self._pre_grid_width - post // self._post_grid_width
+        distance_squared = dx * dx + dy * dy
+        return (distance_squared < len(self._thresholds) and
+                draw < self._thresholds[distance_squared])
+
+    def generate_row(self, pre):
+        """
+        :return: the fixed synapse words of presynaptic neuron pre
+        """
+        rng = MarsKiss64(self.row_seed(pre))
+        row = list()
+        for i in range(self._post_slice_count):
+            post = self._post_slice_start + i
+            if self._type == ALL_TO_ALL:
+                connect = True
+            elif self._type == ONE_TO_ONE:
+                connect = post == pre
+            elif self._type == FIXED_PROBABILITY:
+                connect = rng.next() < self._threshold
+            else:
+                connect = self._distance_connects(pre, post, rng.next())
+
+            if not connect or (not self._allow_self_connections and
+                               post == pre and self._type != ONE_TO_ONE):
+                continue
+
+            weight = self._weight_low
+            if self._weight_range:
+                weight += rng.uniform_in_range(self._weight_range)
+            delay = self._delay_low
+            if self._delay_range:
+                delay += rng.uniform_in_range(self._delay_range)
+
+            row.append(
+                (weight << 16) |
+                ((delay & ((1 << SYNAPSE_DELAY_BITS) - 1)) <<
+                 (8 + SYNAPSE_TYPE_BITS)) |
+                (self._synapse_type << 8) | i)
+        return row
+
+
+def connector_region(projections):
+    """
+    :return: the words of the connector region of one core
+    """
+    words = [len(projections)]
+    for projection in projections:
+        words += projection.to_words()
+    return words
+
+
+def write_test_vectors(path, projections, n_pre):
+    """
+    Writes the region followed by every row the host generator produces:
+    [n_region_words, region..., n_pre, per projection and pre: n, words...]
+    """
+    region = connector_region(projections)
+    words = [len(region)] + region + [n_pre]
+    for projection in projections:
+        for pre in range(n_pre):
+            row = projection.generate_row(pre)
+            words += [len(row)] + row
+    with open(path, "wb") as f:
+        f.write(struct.pack("<{}I".format(len(words)), *words))
+
+
+def _test_projections():
+    seed = [0x1234567, 0x89ABCDE, 0xF012345, 0x6789ABC]
+    return [
+        ConnectorProjection(ALL_TO_ALL, 0, 100, seed, 0x2000,
+                            allow_self_connections=False),
+        ConnectorProjection(ONE_TO_ONE, 100, 100, seed, 0x2000, delay_low=3),
+        ConnectorProjection(FIXED_PROBABILITY, 0, 256, seed, 0x0800,
+                            weight_range=0x1000, delay_low=1, delay_range=14,
+                            probability=0.1),
+        ConnectorProjection(FIXED_PROBABILITY, 0, 200, seed[::-1], 0x2000,
+                            synapse_type=1, delay_low=17 % 16,
+                            allow_self_connections=False, probability=0.5),
+        ConnectorProjection(DISTANCE_DEPENDENT, 0, 256, seed, 0x1000,
+                            delay_range=7, pre_grid_width=16,
+                            post_grid_width=16,
+                            thresholds=distance_thresholds(
+                                lambda d: 0.8 * 2.718281828 ** (-d / 2.0),
+                                6))]
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        sys.stderr.write("usage: {} FILE\n".format(sys.argv[0]))
+        sys.exit(1)
+    write_test_vectors(sys.argv[1], _test_projections(), 256)
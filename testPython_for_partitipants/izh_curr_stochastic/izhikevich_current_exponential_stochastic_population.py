@@ -1,6 +1,11 @@
+import os
+
 from spynnaker.pyNN.models.abstract_models.abstract_population_vertex import \
     AbstractPopulationVertex
-from izk_curr_stochastic.abstract_stochastic_vertex import AbstractStochasticVertex
+from izh_curr_stochastic import model_binaries
+from izh_curr_stochastic.abstract_stochastic_vertex import AbstractStochasticVertex
+from izh_curr_stochastic.neuron_cost_model import NeuronCostModel
+from izh_curr_stochastic.atoms_per_core_tuner import AtomsPerCoreTuner
 from spynnaker.pyNN.utilities import constants
 from data_specification.enums.data_type import DataType
 from spynnaker.pyNN.models.abstract_models.abstract_exp_population_vertex \
@@ -17,14 +22,58 @@ class IzhikevichCurrentExponentialPopulation(
         AbstractPopulationVertex, AbstractStochasticVertex):
 
     CORE_APP_IDENTIFIER = constants.IZK_CURRENT_EXP_CORE_APPLICATION_ID
-    _model_based_max_atoms_per_core = 256
+    _model_based_max_atoms_per_core = None
+    # the flat board figure until the .cost file is measured on the board
+    _cost_model = NeuronCostModel.load("izh_curr_stochastic")
+
+    # sizeof(neuron_t) as reported by neuron_get_info(): the eleven words
+    # written by get_parameters()
+    NEURON_STRUCT_BYTES = 11 * 4
+
+    # neuron_t status flags, see izh_curr_stochastic.h
+    NEURON_QUIESCENCE_ENABLED = 1 << 0
+
+    # ODE solvers the binary can be built with (make ODE_SOLVER=...)
+    ODE_SOLVERS = ("rk2_midpoint", "euler", "rk4", "exponential_euler",
+                   "closed_form")
 
     # noinspection PyPep8Naming
     def __init__(self, n_neurons, machine_time_step, timescale_factor,
                  spikes_per_second, ring_buffer_sigma, constraints=None,
                  label=None, a=0.02, c=-65.0, b=0.2, d=2.0, i_offset=0,
                  u_init=-14.0, v_init=-70.0, tau_syn_E=5.0, tau_syn_I=5.0,
-                 membrane_noise_sd=2.5):
+                 membrane_noise_sd=2.5, quiescence=False,
+                 ode_solver="rk2_midpoint"):
+
+        if ode_solver not in \
+                IzhikevichCurrentExponentialPopulation.ODE_SOLVERS:
+            raise ValueError("ode_solver must be one of {}".format(
+                IzhikevichCurrentExponentialPopulation.ODE_SOLVERS))
+        binary = "izh_curr_stochastic.aplx"
+        if ode_solver != "rk2_midpoint":
+            binary = "izh_curr_stochastic_{}.aplx".format(ode_solver)
+        # binaries are not kept in the tree, as a stale one would read the
+        # neuron parameters misaligned
+        if not os.path.isfile(os.path.join(
+                os.path.dirname(model_binaries.__file__), binary)):
+            raise IOError(
+                "{} is not built: run 'make install{}' in neural_models".format(
+                    binary, "" if ode_solver == "rk2_midpoint" else
+                    " ODE_SOLVER={}".format(ode_solver)))
+
+        # Without a manual setting, pick the densest packing that meets the
+        # timer tick without input and the core's DTCM; the partitioner cuts
+        # slices further from get_cpu_usage_for_atoms once the incoming
+        # projections are known
+        self._tuner = AtomsPerCoreTuner(
+            IzhikevichCurrentExponentialPopulation._cost_model)
+        max_atoms_per_core = IzhikevichCurrentExponentialPopulation.\
+            _model_based_max_atoms_per_core
+        if max_atoms_per_core is None:
+            max_atoms_per_core = self._tuner.tune(
+                label, machine_time_step, timescale_factor,
+                IzhikevichCurrentExponentialPopulation.NEURON_STRUCT_BYTES,
+                stochastic=membrane_noise_sd > 0)
 
         # Instantiate the parent classes
         AbstractExponentialPopulationVertex.__init__(
@@ -35,14 +84,15 @@ class IzhikevichCurrentExponentialPopulation(
                                           v_init=v_init)
         AbstractPopulationVertex.__init__(
             self, n_neurons=n_neurons, n_params=11, label=label,
-            binary="izk_curr_exp_stochastic.aplx", constraints=constraints,
-            max_atoms_per_core=IzhikevichCurrentExponentialPopulation.
-            _model_based_max_atoms_per_core,
+            binary=binary, constraints=constraints,
+            max_atoms_per_core=max_atoms_per_core,
             machine_time_step=machine_time_step,
             timescale_factor=timescale_factor,
             spikes_per_second=spikes_per_second,
             ring_buffer_sigma=ring_buffer_sigma)
         AbstractStochasticVertex.__init__(self, membrane_noise_sd)
+        self._expected_spikes_per_second = spikes_per_second
+        self._quiescence = quiescence
         self._executable_constant = \
             IzhikevichCurrentExponentialPopulation.CORE_APP_IDENTIFIER
 
@@ -55,11 +105,28 @@ class IzhikevichCurrentExponentialPopulation(
         IzhikevichCurrentExponentialPopulation.\
             _model_based_max_atoms_per_core = new_value
 
+    def _synaptic_events_per_atom(self, graph):
+        """
+        Upper bound on the synaptic events each atom receives per tick,
+        taking every incoming edge as dense and firing at spikes_per_second
+        """
+        n_pre_atoms = sum(edge.pre_vertex.n_atoms
+                          for edge in graph.incoming_edges_to_vertex(self))
+        return (n_pre_atoms * self._expected_spikes_per_second *
+                self._machine_time_step / 1000000.0)
+
     def get_cpu_usage_for_atoms(self, vertex_slice, graph):
         """
-        Gets the CPU requirements for a range of atoms
+        Gets the CPU requirements for a range of atoms: the partitioner
+        calls this with the graph and cuts down any slice that does not fit
+        the core, so this is where the synaptic fan-in and recording limit
+        the atoms per core
         """
-        return 782 * ((vertex_slice.hi_atom - vertex_slice.lo_atom) + 1)
+        return self._tuner.cpu_cycles(
+            (vertex_slice.hi_atom - vertex_slice.lo_atom) + 1,
+            self._synaptic_events_per_atom(graph),
+            self._membrane_noise_sd > 0,
+            self._record or self._record_v or self._record_gsyn)
 
     def get_parameters(self):
         """
@@ -82,8 +149,17 @@ class IzhikevichCurrentExponentialPopulation(
         # // offset current [nA]
         #     REAL         I_offset;
         #
-        # // current timestep - simple correction for threshold in beta version
+        # // SD of Gaussian noise added to the membrane before the threshold test
+        #     REAL         membrane_noise_sd;
+        #
+        # // current timestep - only varies with IZH_SIMPLE_TQ_OFFSET
         #     REAL         this_h;
+        #
+        # // fraction of the tick at which the last spike crossed threshold
+        #     REAL         spike_offset;
+        #
+        # // NEURON_* flags: quiescence mode selected by the host, idle mark
+        #     uint32_t     status;
         # } neuron_t;
         return [
             NeuronParameter(self._a, DataType.S1615),
@@ -95,7 +171,13 @@ class IzhikevichCurrentExponentialPopulation(
             NeuronParameter(self.ioffset(self._machine_time_step),
                     DataType.S1615),
             NeuronParameter(self.membrane_noise_sd, DataType.S1615),
-            NeuronParameter(0, DataType.S1615)
+            # the first tick steps by a whole machine timestep, in ms; with
+            # 0 it would not move and a quiescent neuron would look idle
+            NeuronParameter(self._machine_time_step / 1000.0, DataType.S1615),
+            NeuronParameter(0, DataType.S1615),
+            NeuronParameter(
+                IzhikevichCurrentExponentialPopulation.NEURON_QUIESCENCE_ENABLED
+                if self._quiescence else 0, DataType.UINT32)
         ]
 
     def is_stochastic(self):
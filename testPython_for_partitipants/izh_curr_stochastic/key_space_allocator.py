@@ -0,0 +1,406 @@
+"""
+A key allocator that lays the key space out so routing entries collapse.
+
+The PyNN allocator gives every subvertex the key x << 24 | y << 16 |
+p << 11, so a chip needs one routing entry per subvertex whose traffic
+crosses it.  Here every subvertex gets an aligned power-of-two block of
+keys, and blocks are nested:
+
+    destination set  >  source chip  >  subvertex
+
+Subvertices on the same chip that project to the same subvertices follow
+the same route tree, so their blocks are siblings under one aligned
+block, and one key/mask entry routes all of them on every chip of the
+tree.  Traffic to the same destinations from other chips shares the
+next level up, which collapses where the trees join.  A block may hold
+spare keys; nothing else is ever allocated in them, so covering them is
+safe.
+
+The same layout shortens the master population table on the target
+core, which holds one entry per aligned source block.
+
+``python key_space_allocator.py`` compares routing entries for a
+synthetic network under both allocators (see --help).  The saving it
+reports is against the PyNN keys with their aligned blocks merged, the
+same merging the allocator's tables get.  With the defaults, a 16x16
+machine of 4096 cores of 100 atoms with fan-out 8, that is 53599 entries
+against 44628, 16.7% fewer; with --width 8 --height 8 it is 8828 against
+5345, 39.5% fewer.  PACMAN's tables, one entry per subvertex, need 203772
+and 23628, and on 16x16 overflow 70 chips, but merging alone fixes that.
+
+Nothing uses the allocator during mapping yet: [KeyAllocator] is not
+switched to it and nothing calls write_report, so a real run still writes
+the PyNN keys and an empty virtual_key_space_information_report.rpt.
+Like connector_generation.py, the module imports nothing from spynnaker,
+so it runs on a bare host.
+"""
+import argparse
+import bisect
+import os
+import random
+import sys
+
+KEY_SPACE_BITS = 32
+N_LINKS = 6
+
+# PACMAN's PyNN keys: 11 bits of neuron index under the source core
+PYNN_NEURON_BITS = 11
+
+REPORT_FILE_NAME = "virtual_key_space_information_report.rpt"
+
+
+class KeySpaceError(Exception):
+    pass
+
+
+class KeySource(object):
+    """ One subvertex sending spikes
+    """
+
+    def __init__(self, label, x, y, p, n_atoms, destinations):
+        """
+        :param destinations: (x, y, p) of every core it projects to
+        """
+        self.label = label
+        self.x, self.y, self.p = x, y, p
+        self.n_atoms = n_atoms
+        self.destinations = frozenset(destinations)
+
+    @property
+    def chip(self):
+        return self.x, self.y
+
+    def pynn_key(self):
+        return (self.x << 24) | (self.y << 16) | (self.p << 11)
+
+
+def _block_size(n_keys):
+    size = 1
+    while size < n_keys:
+        size <<= 1
+    return size
+
+
+def _mask(size):
+    return (0xFFFFFFFF & ~(size - 1)) & 0xFFFFFFFF
+
+
+class _Block(object):
+
+    def __init__(self, children=None, source=None):
+        self.children = children or []
+        self.source = source
+        self.base = 0
+        if source is not None:
+            self.size = _block_size(max(1, source.n_atoms))
+        else:
+            # largest first keeps every child aligned
+            self.children.sort(key=lambda child: -child.size)
+            self.size = _block_size(sum(child.size for child in self.children))
+
+    def place(self, base):
+        self.base = base
+        for child in self.children:
+            child.place(base)
+            base += child.size
+
+
+class KeySpaceAllocator(object):
+
+    def __init__(self, key_space_bits=KEY_SPACE_BITS):
+        self._key_space_bits = key_space_bits
+        self._root = None
+
+    def allocate(self, sources):
+        """
+        :param sources: KeySource of every subvertex with outgoing edges
+        :return: {label: (key, mask)}
+        :raise KeySpaceError: if the blocks do not fit the key space
+        """
+        by_destinations = dict()
+        for source in sources:
+            by_chip = by_destinations.setdefault(source.destinations, dict())
+            by_chip.setdefault(source.chip, []).append(source)
+
+        groups = []
+        for destinations in sorted(by_destinations, key=sorted):
+            by_chip = by_destinations[destinations]
+            groups.append(_Block([
+                _Block([_Block(source=source) for source in by_chip[chip]])
+                for chip in sorted(by_chip)]))
+        self._root = _Block(groups)
+
+        if self._root.size > 1 << self._key_space_bits:
+            raise KeySpaceError(
+                "{} sources need {} keys, more than the {}-bit key space"
+                .format(len(sources), self._root.size, self._key_space_bits))
+        self._root.place(0)
+
+        return dict((block.source.label, (block.base, _mask(block.size)))
+                    for block in self._leaves(self._root))
+
+    def _leaves(self, block):
+        if block.source is not None:
+            yield block
+        for child in block.children:
+            for leaf in self._leaves(child):
+                yield leaf
+
+    def write_report(self, path):
+        """ Writes the allocated key space, block by block
+        """
+        leaves = list(self._leaves(self._root))
+        n_atoms = sum(leaf.source.n_atoms for leaf in leaves)
+        with open(path, "w") as f:
+            f.write("        Virtual Key Space Information\n")
+            f.write("        =============================\n\n")
+            f.write("Allocator: KeySpace (aligned blocks by destination "
+                    "set, then source chip)\n")
+            f.write("Key space: 0x{:08x}-0x{:08x}, {} keys for {} atoms "
+                    "({:.1%} used)\n\n".format(
+                        0, self._root.size - 1, self._root.size, n_atoms,
+                        float(n_atoms) / max(1, self._root.size)))
+            for g, group in enumerate(self._root.children):
+                destinations = group.children[0].children[0].source\
+                    .destinations
+                f.write("Group {}: key 0x{:08x} mask 0x{:08x}, {} "
+                        "destination cores\n".format(
+                            g, group.base, _mask(group.size),
+                            len(destinations)))
+                for chip_block in group.children:
+                    x, y = chip_block.children[0].source.chip
+                    f.write("  Chip ({}, {}): key 0x{:08x} mask 0x{:08x}\n"
+                            .format(x, y, chip_block.base,
+                                    _mask(chip_block.size)))
+                    for leaf in chip_block.children:
+                        source = leaf.source
+                        f.write("    {} on ({}, {}, {}): key 0x{:08x} mask "
+                                "0x{:08x}, {} atoms, {} keys spare\n".format(
+                                    source.label, source.x, source.y,
+                                    source.p, leaf.base, _mask(leaf.size),
+                                    source.n_atoms,
+                                    leaf.size - source.n_atoms))
+                f.write("\n")
+
+
+def _next_link(dx, dy):
+    # dimension-ordered on the hexagonal mesh, as routing_table.c
+    if dx > 0 and dy > 0:
+        return 1
+    if dx < 0 and dy < 0:
+        return 4
+    if dx > 0:
+        return 0
+    if dx < 0:
+        return 3
+    return 2 if dy > 0 else 5
+
+
+_LINK_STEP = [(1, 0), (1, 1), (0, 1), (-1, 0), (-1, -1), (0, -1)]
+
+
+def route_trees(sources):
+    """
+    :return: {chip: {label: route}} for the route tree of every source,\
+        with an entry on every chip of the tree as PACMAN writes them
+    """
+    routes = dict()
+    for source in sources:
+        for tx, ty, tp in source.destinations:
+            x, y = source.chip
+            while (x, y) != (tx, ty):
+                link = _next_link(tx - x, ty - y)
+                chip = routes.setdefault((x, y), dict())
+                chip[source.label] = chip.get(source.label, 0) | 1 << link
+                x, y = x + _LINK_STEP[link][0], y + _LINK_STEP[link][1]
+            chip = routes.setdefault((tx, ty), dict())
+            chip[source.label] = chip.get(source.label, 0) | \
+                1 << (N_LINKS + tp)
+    return routes
+
+
+def trie_entries(blocks):
+    """
+    The entries one chip needs when every aligned block whose present
+    sources share a route becomes one entry.
+
+    :param blocks: (key, size, route) of the sources crossing the chip,\
+        each key aligned to its power-of-two size
+    :return: [(key, mask, route)]
+    """
+    blocks = sorted(blocks)
+    keys = [block[0] for block in blocks]
+    entries = []
+
+    def cover(base, size):
+        lo = bisect.bisect_left(keys, base)
+        hi = bisect.bisect_left(keys, base + size)
+        if lo == hi:
+            return
+        routes = set(block[2] for block in blocks[lo:hi])
+        if len(routes) == 1:
+            entries.append((base, _mask(size), blocks[lo][2]))
+            return
+        cover(base, size // 2)
+        cover(base + size // 2, size // 2)
+
+    cover(0, 1 << KEY_SPACE_BITS)
+    return entries
+
+
+def count_entries(keys, trees, merge=True):
+    """
+    :param keys: {label: (key, mask)}
+    :param merge: False for one entry per source, as PACMAN writes them
+    :return: {chip: entries}
+    """
+    tables = dict()
+    for chip, routes in trees.items():
+        blocks = [(keys[label][0], (~keys[label][1] & 0xFFFFFFFF) + 1, route)
+                  for label, route in routes.items()]
+        if merge:
+            tables[chip] = trie_entries(blocks)
+        else:
+            tables[chip] = [(key, _mask(size), route)
+                            for key, size, route in sorted(blocks)]
+    return tables
+
+
+def synthetic_network(width, height, cores_per_population, fan_out,
+                      atoms_per_core, seed=1):
+    """ As synthetic_routing_tables() in host_tools/routing_table.c: a
+    width x height machine with 16 application cores per chip, in
+    populations of consecutive cores, each projecting to fan_out random
+    populations
+    """
+    rng = random.Random(seed)
+    per_chip = 16 // cores_per_population
+    n_populations = width * height * per_chip
+    sources = []
+    for q in range(n_populations):
+        chip = q // per_chip
+        x, y = chip // height, chip % height
+        first = 1 + (q % per_chip) * cores_per_population
+        destinations = set()
+        for _ in range(fan_out):
+            target = int(rng.random() * n_populations)
+            t_chip = target // per_chip
+            t_first = 1 + (target % per_chip) * cores_per_population
+            for p in range(t_first, t_first + cores_per_population):
+                destinations.add((t_chip // height, t_chip % height, p))
+        for p in range(first, first + cores_per_population):
+            sources.append(KeySource("pop{}:{}".format(q, p - first), x, y,
+                                     p, atoms_per_core, destinations))
+    return sources
+
+
+def sources_from_graph(partitioned_graph, placements):
+    """ KeySources for a PACMAN partitioned graph and its placements
+    """
+    sources = []
+    for subvertex in partitioned_graph.subvertices:
+        subedges = partitioned_graph.outgoing_subedges_from_subvertex(
+            subvertex)
+        if not subedges:
+            continue
+        placement = placements.get_placement_of_subvertex(subvertex)
+        destinations = []
+        for subedge in subedges:
+            target = placements.get_placement_of_subvertex(
+                subedge.post_subvertex)
+            destinations.append((target.x, target.y, target.p))
+        sources.append(KeySource(subvertex.label, placement.x, placement.y,
+                                 placement.p, subvertex.n_atoms,
+                                 destinations))
+    return sources
+
+
+def write_routing_tables(directory, tables):
+    """ routing_table_X_Y.rpt files, for host_tools/minimise_routes
+    """
+    if not os.path.isdir(directory):
+        os.makedirs(directory)
+    for (x, y), entries in sorted(tables.items()):
+        path = os.path.join(directory, "routing_table_{}_{}.rpt".format(x, y))
+        with open(path, "w") as f:
+            f.write("router contains {} entries \n \n".format(len(entries)))
+            f.write("  Index   Key(hex)    Mask(hex)    Route(hex)    "
+                    "Src. Core -> [Cores][Links]\n")
+            f.write("-" * 78 + "\n")
+            for index, (key, mask, route) in enumerate(entries):
+                cores = [c for c in range(18) if route & (1 << (6 + c))]
+                links = [l for l in range(6) if route & (1 << l)]
+                f.write("{:>5}     {:05x}       {:08x}      {:04x}         "
+                        "-      {} {}\n".format(index, key, mask, route,
+                                                cores, links))
+
+
+def _statistics(name, tables):
+    counts = [len(entries) for entries in tables.values()]
+    return "{:<32} {:>9} {:>9} {:>13}".format(
+        name, sum(counts), max(counts), sum(1 for n in counts if n > 1024))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="routing entries of a synthetic network under the "
+                    "PyNN and the key-space allocator")
+    parser.add_argument("--width", type=int, default=16)
+    parser.add_argument("--height", type=int, default=16)
+    parser.add_argument("--fan-out", type=int, default=8,
+                        help="target populations per population")
+    parser.add_argument("--population-cores", type=int, default=4,
+                        help="cores per population, dividing 16")
+    parser.add_argument("--atoms", type=int, default=100,
+                        help="atoms per core")
+    parser.add_argument("--report", help="write the key space report here")
+    parser.add_argument("--tables", metavar="DIR",
+                        help="write the tables to DIR/pynn and "
+                             "DIR/key_space")
+    args = parser.parse_args()
+
+    sources = synthetic_network(args.width, args.height,
+                                args.population_cores, args.fan_out,
+                                args.atoms)
+    trees = route_trees(sources)
+
+    pynn_keys = dict((source.label, (source.pynn_key(),
+                                     _mask(1 << PYNN_NEURON_BITS)))
+                     for source in sources)
+    allocator = KeySpaceAllocator()
+    keys = allocator.allocate(sources)
+
+    results = [
+        ("PyNN, one entry per subvertex",
+         count_entries(pynn_keys, trees, merge=False)),
+        ("PyNN keys, aligned blocks merged",
+         count_entries(pynn_keys, trees)),
+        ("key space allocator",
+         count_entries(keys, trees))]
+
+    print("{}x{} machine, {} sources of {} atoms, fan-out {}, {} cores per "
+          "population".format(args.width, args.height, len(sources),
+                              args.atoms, args.fan_out,
+                              args.population_cores))
+    print("{:<32} {:>9} {:>9} {:>13}".format(
+        "allocation", "entries", "largest", "chips > 1024"))
+    for name, tables in results:
+        print(_statistics(name, tables))
+    # like for like: both sets of keys with their aligned blocks merged
+    before = sum(len(entries) for entries in results[1][1].values())
+    after = sum(len(entries) for entries in results[2][1].values())
+    print("{} routing entries saved against merged PyNN keys ({:.1%})"
+          .format(before - after, float(before - after) / before))
+
+    if args.report:
+        allocator.write_report(args.report)
+    if args.tables:
+        write_routing_tables(os.path.join(args.tables, "pynn"),
+                             results[0][1])
+        write_routing_tables(os.path.join(args.tables, "key_space"),
+                             results[2][1])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,98 @@
+"""
+CPU cost model of the izh_curr_stochastic neuron kernel.
+
+The coefficients are fitted by neural_models/host/izh_calibrate
+(``make calibrate``) and stored next to the model binary as
+``<model>.cost``.  Without a calibration file the model falls back to the
+flat 782 cycles per atom the vertex used before.
+
+izh_calibrate times the host build, so its split between neuron, noise,
+recording and synapse cycles is a host estimate (``source = host``): the
+noise draw on x86 is nothing like the fixed-point norminv_urb of the
+ARM968.  Such a file is only loaded on request; the vertex keeps the flat
+figure until a file measured on the board says ``source = board``.
+"""
+import os
+from six.moves import configparser
+
+from izh_curr_stochastic import model_binaries
+
+# clock rate of the ARM968 application cores
+CYCLES_PER_MICROSECOND = 200
+
+# the .cost file's source for coefficients measured on the board
+BOARD_SOURCE = "board"
+
+
+class NeuronCostModel(object):
+
+    def __init__(self, base_cycles=0.0, neuron_cycles=782.0,
+                 noise_cycles=0.0, recording_cycles=0.0, synapse_cycles=0.0):
+        self._base_cycles = base_cycles
+        self._neuron_cycles = neuron_cycles
+        self._noise_cycles = noise_cycles
+        self._recording_cycles = recording_cycles
+        self._synapse_cycles = synapse_cycles
+
+    @staticmethod
+    def cost_model_path(model_name):
+        return os.path.join(os.path.dirname(model_binaries.__file__),
+                            "{}.cost".format(model_name))
+
+    @staticmethod
+    def load(model_name, host_estimate=False):
+        """
+        Reads the calibrated cost model of a model binary
+        :param model_name: the binary name without extension
+        :param host_estimate: also accept a file fitted on the host
+        :return: a NeuronCostModel, the uncalibrated default if no file\
+            or only a host estimate
+        """
+        path = NeuronCostModel.cost_model_path(model_name)
+        parser = configparser.RawConfigParser()
+        if not parser.read(path) or not parser.has_section("CostModel"):
+            return NeuronCostModel()
+        source = parser.get("CostModel", "source") \
+            if parser.has_option("CostModel", "source") else "host"
+        if source != BOARD_SOURCE and not host_estimate:
+            return NeuronCostModel()
+        return NeuronCostModel(
+            base_cycles=parser.getfloat("CostModel", "base_cycles"),
+            neuron_cycles=parser.getfloat("CostModel", "neuron_cycles"),
+            noise_cycles=parser.getfloat("CostModel", "noise_cycles"),
+            recording_cycles=parser.getfloat("CostModel", "recording_cycles"),
+            synapse_cycles=parser.getfloat("CostModel", "synapse_cycles"))
+
+    def cycles_per_atom(self, synaptic_events_per_atom=0.0, stochastic=True,
+                        recording=False):
+        cycles = self._neuron_cycles + \
+            self._synapse_cycles * synaptic_events_per_atom
+        if stochastic:
+            cycles += self._noise_cycles
+        if recording:
+            cycles += self._recording_cycles
+        return cycles
+
+    def cycles_per_tick(self, n_atoms, synaptic_events_per_atom=0.0,
+                        stochastic=True, recording=False):
+        """
+        Predicted ARM cycles to update n_atoms neurons in one timer tick
+        """
+        return int(self._base_cycles + n_atoms * self.cycles_per_atom(
+            synaptic_events_per_atom, stochastic, recording))
+
+    def max_atoms_per_core(self, machine_time_step, timescale_factor,
+                           synaptic_events_per_atom=0.0, stochastic=True,
+                           recording=False, upper_limit=256):
+        """
+        The most atoms whose update fits into one timer tick
+        :param machine_time_step: the timer tick in microseconds
+        :param timescale_factor: slow-down of the simulation, or None
+        :param upper_limit: the largest slice the model supports
+        """
+        tick_cycles = (CYCLES_PER_MICROSECOND * machine_time_step *
+                       (timescale_factor or 1))
+        per_atom = self.cycles_per_atom(synaptic_events_per_atom, stochastic,
+                                        recording)
+        n_atoms = int((tick_cycles - self._base_cycles) // per_atom)
+        return max(1, min(upper_limit, n_atoms))
@@ -0,0 +1,206 @@
+"""
+Host side of the adaptive spike recording of
+neural_models/spike_recording.h: a streaming decoder and an SDRAM planner.
+
+Each tick is recorded as a run of empty ticks, a sparse list of neuron
+indices or the whole bit field, whichever is smallest, so the space a run
+takes depends on how much the population fires.  The planner works out the
+expected size from the expected rate, with a margin, so that the recording
+region can be sized for the whole run instead of the worst case of a bit
+field every tick, or the run paused for extraction.
+
+    python spike_recording.py plan --neurons 100 --rate 10 --run 5000
+    python spike_recording.py decode region.bin
+
+Like connector_generation.py, the module imports nothing from spynnaker.
+"""
+import argparse
+import math
+import struct
+import sys
+
+HEADER_WORDS = 2
+EMPTY, SPARSE, DENSE = 0, 1, 2
+
+# a run longer than this starts another empty record
+MAX_COUNT = (1 << 30) - 1
+
+
+class SpikeRecordingError(Exception):
+    pass
+
+
+def bit_field_words(n_neurons):
+    return (n_neurons + 31) // 32
+
+
+def iter_ticks(stream):
+    """ Decodes a region a record at a time, without reading it all
+
+    :param stream: a binary file positioned at the start of the region
+    :return: (tick, neuron indices) for every recorded tick, in order
+    """
+    words_used, n_neurons = struct.unpack("<2I", _read(stream, 8))
+    n_words = bit_field_words(n_neurons)
+    position, tick = 0, 0
+    while position < words_used:
+        header, = struct.unpack("<I", _read(stream, 4))
+        kind, count = header >> 30, header & MAX_COUNT
+        if kind == EMPTY:
+            for _ in range(count):
+                yield tick, []
+                tick += 1
+            position += 1
+            continue
+        if kind == SPARSE:
+            size = (count + 1) // 2
+            halves = struct.unpack("<{}H".format(2 * size),
+                                   _read(stream, 4 * size))
+            neurons = list(halves[:count])
+        elif kind == DENSE:
+            size = n_words
+            words = struct.unpack("<{}I".format(size), _read(stream, 4 * size))
+            neurons = [(w << 5) | b for w, bits in enumerate(words)
+                       for b in range(32) if bits & (1 << b)]
+        else:
+            raise SpikeRecordingError(
+                "record kind {} at word {}".format(kind, position))
+        if len(neurons) != count or count > n_neurons:
+            raise SpikeRecordingError(
+                "record of {} spikes at word {}".format(count, position))
+        yield tick, neurons
+        tick += 1
+        position += 1 + size
+
+
+def iter_spikes(stream, machine_time_step):
+    """ As getSpikes() but streaming: (neuron index, time in ms)
+
+    :param machine_time_step: in microseconds
+    """
+    ms_per_tick = machine_time_step / 1000.0
+    for tick, neurons in iter_ticks(stream):
+        for neuron in neurons:
+            yield neuron, tick * ms_per_tick
+
+
+def _read(stream, n_bytes):
+    data = stream.read(n_bytes)
+    if len(data) != n_bytes:
+        raise SpikeRecordingError("region ends inside a record")
+    return data
+
+
+def _binomial_pmf(n, p, k):
+    if p <= 0.0:
+        return 1.0 if k == 0 else 0.0
+    if p >= 1.0:
+        return 1.0 if k == n else 0.0
+    return math.exp(math.lgamma(n + 1) - math.lgamma(k + 1) -
+                    math.lgamma(n - k + 1) + k * math.log(p) +
+                    (n - k) * math.log(1.0 - p))
+
+
+def tick_words(n_neurons, spikes_per_second, machine_time_step):
+    """ Mean and variance of the words one tick adds, with every neuron
+        firing independently at the given rate
+
+    An empty tick only costs a word when the tick before had spikes.
+    """
+    p = min(1.0, spikes_per_second * machine_time_step / 1000000.0)
+    n_words = bit_field_words(n_neurons)
+    p_empty = _binomial_pmf(n_neurons, p, 0)
+    mean = p_empty * (1.0 - p_empty)
+    square = mean
+    for k in range(1, n_neurons + 1):
+        pmf = _binomial_pmf(n_neurons, p, k)
+        if pmf < 1e-300 and k > n_neurons * p:
+            break
+        words = 1 + min((k + 1) // 2, n_words)
+        mean += pmf * words
+        square += pmf * words * words
+    return mean, max(0.0, square - mean * mean)
+
+
+class SpikeRecordingPlan(object):
+
+    def __init__(self, n_neurons, spikes_per_second, machine_time_step,
+                 run_time, sigmas=4.0):
+        """
+        :param run_time: in ms
+        :param sigmas: margin over the expected size, in standard deviations
+        """
+        self.n_ticks = int(math.ceil(run_time * 1000.0 / machine_time_step))
+        mean, variance = tick_words(n_neurons, spikes_per_second,
+                                    machine_time_step)
+        self.mean_words_per_tick = mean
+        self.worst_words_per_tick = 1 + bit_field_words(n_neurons)
+        words = min(mean * self.n_ticks +
+                    sigmas * math.sqrt(variance * self.n_ticks),
+                    self.worst_words_per_tick * self.n_ticks)
+        self.expected_bytes = 4 * (HEADER_WORDS + mean * self.n_ticks)
+        self.sdram_bytes = 4 * (HEADER_WORDS + int(math.ceil(words)))
+        self.bit_field_bytes = 4 * bit_field_words(n_neurons) * self.n_ticks
+        self._mean = mean
+        self._variance = variance
+        self._sigmas = sigmas
+        self._machine_time_step = machine_time_step
+
+    def max_run_time(self, sdram_bytes):
+        """ The longest run, in ms, whose recording fits sdram_bytes with
+            the same margin
+        """
+        words = sdram_bytes // 4 - HEADER_WORDS
+        if words <= 0 or self._mean <= 0.0:
+            return 0.0 if words <= 0 else float("inf")
+        # mean * t + sigmas * sqrt(variance * t) = words, for t ticks
+        a, b = self._mean, self._sigmas * math.sqrt(self._variance)
+        root = (-b + math.sqrt(b * b + 4 * a * words)) / (2 * a)
+        return math.floor(root * root) * self._machine_time_step / 1000.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    commands = parser.add_subparsers(dest="command")
+    plan = commands.add_parser("plan", help="size the recording region")
+    plan.add_argument("--neurons", type=int, required=True)
+    plan.add_argument("--rate", type=float, required=True,
+                      help="expected spikes per second per neuron")
+    plan.add_argument("--run", type=float, required=True, help="in ms")
+    plan.add_argument("--timestep", type=int, default=1000,
+                      help="machine_time_step in us (default 1000)")
+    plan.add_argument("--sigmas", type=float, default=4.0,
+                      help="margin in standard deviations (default 4)")
+    plan.add_argument("--sdram", type=int,
+                      help="bytes available: report the longest run")
+    decode = commands.add_parser("decode", help="print a region's spikes")
+    decode.add_argument("region")
+    decode.add_argument("--timestep", type=int, default=1000)
+    args = parser.parse_args()
+
+    if args.command == "plan":
+        plan = SpikeRecordingPlan(args.neurons, args.rate, args.timestep,
+                                  args.run, args.sigmas)
+        print("{} ticks: expected {:.0f} bytes, plan {} bytes, "
+              "bit fields {} bytes ({:.1f}x)".format(
+                  plan.n_ticks, plan.expected_bytes, plan.sdram_bytes,
+                  plan.bit_field_bytes,
+                  plan.bit_field_bytes / float(plan.sdram_bytes)))
+        if args.sdram is not None:
+            print("{} bytes hold {:.0f} ms".format(
+                args.sdram, plan.max_run_time(args.sdram)))
+    elif args.command == "decode":
+        n_spikes = 0
+        with open(args.region, "rb") as f:
+            for neuron, time in iter_spikes(f, args.timestep):
+                print("{} {}".format(neuron, time))
+                n_spikes += 1
+        sys.stderr.write("{} spikes\n".format(n_spikes))
+    else:
+        parser.print_help()
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,208 @@
+"""
+Host side of the quantized delta recording of V and gsyn in
+neural_models/state_recording.h: a decoder working on a whole region at
+once with numpy, and the choice of step for a bit depth.
+
+Every recorded tick is a keyframe of exact s16.15 values or each neuron's
+change in 8, 12 or 16 bit steps of 2^shift, with escaped exact values for
+changes that did not fit.  The decoder unpacks every delta record in one
+go and rebuilds the values with a cumulative sum restarted at each
+keyframe and escape, so there is no Python loop over neurons or ticks,
+only over record headers.
+
+    python state_recording.py decode v.bin [--reference v.raw]
+    python state_recording.py shift --bits 12 --max-change 2.5
+
+Like connector_generation.py, the module imports nothing from spynnaker.
+"""
+import argparse
+import math
+import sys
+
+import numpy
+
+HEADER_WORDS = 6
+KEYFRAME, DELTA = 0, 1
+BITS = (8, 12, 16)
+
+
+class StateRecordingError(Exception):
+    pass
+
+
+def delta_words(n_neurons, bits):
+    return (n_neurons * bits + 31) // 32
+
+
+def choose_shift(max_change, bits):
+    """ The smallest step that still codes a change of max_change, in the
+        recorded units (mV or nA), so the error is at most half of it
+    """
+    limit = (1 << (bits - 1)) - 1
+    shift = 0
+    while shift < 16 and (limit << shift) < max_change * 32768.0:
+        shift += 1
+    return shift
+
+
+def _unpack(packed, n_neurons, bits):
+    """ Signed codes from rows of packed words, low bits first
+    """
+    data = packed.astype("<u4").view(numpy.uint8).reshape(len(packed), -1)
+    if bits == 8:
+        codes = data.astype(numpy.int32)
+    elif bits == 16:
+        codes = data.view("<u2").astype(numpy.int32)
+    else:
+        # two 12 bit codes in each three bytes
+        padded = numpy.zeros((len(packed), 3 * -(-data.shape[1] // 3)),
+                             numpy.int32)
+        padded[:, :data.shape[1]] = data
+        triples = padded.reshape(len(packed), -1, 3)
+        codes = numpy.empty((len(packed), 2 * triples.shape[1]),
+                            numpy.int32)
+        codes[:, 0::2] = triples[:, :, 0] | ((triples[:, :, 1] & 0xF) << 8)
+        codes[:, 1::2] = (triples[:, :, 1] >> 4) | (triples[:, :, 2] << 4)
+    codes = codes[:, :n_neurons]
+    sign = 1 << (bits - 1)
+    return (codes ^ sign) - sign
+
+
+def decode(region):
+    """ Rebuilds every recorded tick
+
+    :param region: the region's words, as a numpy uint32 array or bytes
+    :return: (ticks, values), the recorded ticks and a float array of
+        values, a row per recorded tick and a column per neuron
+    """
+    if not isinstance(region, numpy.ndarray):
+        region = numpy.frombuffer(region, dtype="<u4")
+    if len(region) < HEADER_WORDS:
+        raise StateRecordingError("region shorter than its header")
+    used, n_neurons, bits, shift, subsample = [int(w) for w in region[:5]]
+    if bits not in BITS:
+        raise StateRecordingError("bit depth {}".format(bits))
+    records = region[HEADER_WORDS:HEADER_WORDS + used]
+    if len(records) < used:
+        raise StateRecordingError("region ends inside a record")
+    packed_words = delta_words(n_neurons, bits)
+
+    # only the headers are walked one by one
+    starts, kinds = [], []
+    position = 0
+    while position < used:
+        header = int(records[position])
+        kind, count = header >> 30, header & 0x3FFFFFFF
+        if kind == KEYFRAME:
+            size = 1 + n_neurons
+        elif kind == DELTA:
+            size = 1 + packed_words + count
+        else:
+            raise StateRecordingError(
+                "record kind {} at word {}".format(kind, position))
+        if position + size > used:
+            raise StateRecordingError("region ends inside a record")
+        starts.append(position)
+        kinds.append(kind)
+        position += size
+    starts = numpy.array(starts, dtype=numpy.int64)
+    kinds = numpy.array(kinds)
+    n_records = len(starts)
+
+    exact = numpy.zeros((n_records, n_neurons), numpy.int64)
+    steps = numpy.zeros((n_records, n_neurons), numpy.int64)
+    restart = numpy.zeros((n_records, n_neurons), bool)
+
+    keyframes = numpy.nonzero(kinds == KEYFRAME)[0]
+    if len(keyframes):
+        columns = starts[keyframes, None] + 1 + numpy.arange(n_neurons)
+        exact[keyframes] = records[columns].view("<i4")
+        restart[keyframes] = True
+
+    deltas = numpy.nonzero(kinds == DELTA)[0]
+    if len(deltas):
+        columns = starts[deltas, None] + 1 + numpy.arange(packed_words)
+        codes = _unpack(records[columns], n_neurons, bits)
+        escaped = codes == -(1 << (bits - 1))
+        counts = (records[starts[deltas]] & 0x3FFFFFFF).astype(numpy.int64)
+        if not numpy.array_equal(escaped.sum(axis=1), counts):
+            raise StateRecordingError("escape counts do not match")
+        # escapes follow each record's codes, in neuron order
+        first = starts[deltas] + 1 + packed_words
+        offsets = numpy.concatenate(([0], numpy.cumsum(counts)[:-1]))
+        escape_rows, _ = numpy.nonzero(escaped)
+        within = numpy.arange(len(escape_rows)) - offsets[escape_rows]
+        escape_values = records[first[escape_rows] + within].view("<i4")
+        rows = deltas[escape_rows]
+        exact[rows, numpy.nonzero(escaped)[1]] = escape_values
+        restart[deltas] = escaped
+        steps[deltas] = numpy.where(escaped, 0, codes) << shift
+
+    if n_records and not restart[0].all():
+        raise StateRecordingError("the first record is not a keyframe")
+
+    # a cumulative sum of the steps, restarted from each exact value
+    total = numpy.cumsum(steps, axis=0)
+    index = numpy.where(restart, numpy.arange(n_records)[:, None], 0)
+    last = numpy.maximum.accumulate(index, axis=0)
+    column = numpy.arange(n_neurons)
+    values = exact[last, column] + total - total[last, column]
+
+    ticks = numpy.arange(n_records) * subsample
+    return ticks, values / 32768.0
+
+
+def to_pynn(ticks, values, machine_time_step):
+    """ The (neuron, time in ms, value) rows of get_v(compatible_output=True)
+        and get_gsyn(compatible_output=True), neuron by neuron
+    """
+    n_records, n_neurons = values.shape
+    rows = numpy.empty((n_neurons * n_records, 3))
+    rows[:, 0] = numpy.repeat(numpy.arange(n_neurons), n_records)
+    rows[:, 1] = numpy.tile(ticks * machine_time_step / 1000.0, n_neurons)
+    rows[:, 2] = values.T.ravel()
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    commands = parser.add_subparsers(dest="command")
+    decode_command = commands.add_parser(
+        "decode", help="summarise a region, or compare it with true values")
+    decode_command.add_argument("region")
+    decode_command.add_argument(
+        "--reference", help="true s16.15 values, per tick then neuron")
+    shift_command = commands.add_parser(
+        "shift", help="the step for a largest routine change")
+    shift_command.add_argument("--bits", type=int, choices=BITS,
+                               required=True)
+    shift_command.add_argument("--max-change", type=float, required=True,
+                               help="per recorded tick, in mV or nA")
+    args = parser.parse_args()
+
+    if args.command == "decode":
+        region = numpy.fromfile(args.region, dtype="<u4")
+        ticks, values = decode(region)
+        print("{} records of {} neurons, bits {}, step {} of s16.15".format(
+            values.shape[0], values.shape[1], region[2], 1 << region[3]))
+        if args.reference is not None:
+            reference = numpy.fromfile(args.reference, dtype="<i4")
+            reference = reference.reshape(-1, values.shape[1])[ticks]
+            error = numpy.abs(values - reference / 32768.0)
+            print("max error {:.6f}, rms error {:.6f}".format(
+                error.max(), math.sqrt((error ** 2).mean())))
+            if error.max() * 32768.0 > max(0.5, 1 << int(region[3]) >> 1):
+                return 1
+    elif args.command == "shift":
+        shift = choose_shift(args.max_change, args.bits)
+        print("shift {}: step {:.6f}, largest change {:.4f}".format(
+            shift, (1 << shift) / 32768.0,
+            (((1 << (args.bits - 1)) - 1) << shift) / 32768.0))
+    else:
+        parser.print_help()
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
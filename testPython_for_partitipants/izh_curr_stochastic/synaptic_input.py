@@ -0,0 +1,190 @@
+"""
+Host side of the synaptic input ring buffers of
+neural_models/synaptic_input.h: the ring buffer shift of each synapse type,
+chosen from the rates measured on the inputs, and the provenance decoded.
+
+A sum in the ring buffers is in units of 2^(shift - 15) nA, and the host
+writes the weights at the same scale.  [Simulation] chooses one shift from
+every source firing at spikes_per_second, allowing ring_buffer_sigma
+standard deviations above the mean input; with the measured rate of each
+source the estimate follows the network instead, and a Bernstein bound
+allows for the long tail of a few large weights that the normal
+approximation misses.  After a run, the provenance says whether the sums
+saturated and the largest sum drained, and the shifts can only go up.
+
+    python synaptic_input.py check synaptic_input.bin
+    python synaptic_input.py provenance --shifts 5,4 0 0 812 0 0 403
+
+Like connector_generation.py, the module imports nothing from spynnaker.
+"""
+import argparse
+import math
+import struct
+import sys
+
+# sums are s16.15 at a shift of 0
+FRACTION_BITS = 15
+MAX_SHIFT = 30
+PROVENANCE_WORDS_PER_TYPE = 3
+
+
+class SynapticInputError(Exception):
+    pass
+
+
+def shift_for(value, bits):
+    """ The smallest shift at which value nA fits a sum of bits bits
+    """
+    if value <= 0.0:
+        return 0
+    shift = int(math.ceil(FRACTION_BITS +
+                          math.log(value / (2.0 ** bits - 1), 2)))
+    return min(max(shift, 0), MAX_SHIFT)
+
+
+def peak_input(mean, variance, max_weight, sigma):
+    """ The input per tick that Poisson sources exceed no more often than a
+        normal one does sigma SDs above its mean
+
+    With a max_weight of 0 this is mean + sigma SDs, the [Simulation] rule.
+    """
+    skew = sigma * sigma * max_weight / 6.0
+    return mean + skew + math.sqrt(skew * skew + sigma * sigma * variance)
+
+
+def input_statistics(synapses, rates, time_step_us, n_types=2):
+    """ Mean and variance of each neuron's input per tick, by type
+
+    :param synapses: (source, neuron, type, weight in nA) for every synapse
+    :param rates: the rate of each source, in Hz
+    :return: means and variances, dicts of (type, neuron), and the largest\
+        weight of each type
+    """
+    means, variances = dict(), dict()
+    max_weights = [0.0] * n_types
+    for source, neuron, synapse_type, weight in synapses:
+        p = rates[source] * time_step_us / 1000000.0
+        key = (synapse_type, neuron)
+        means[key] = means.get(key, 0.0) + weight * p
+        variances[key] = variances.get(key, 0.0) + weight * weight * p
+        max_weights[synapse_type] = max(max_weights[synapse_type], weight)
+    return means, variances, max_weights
+
+
+def choose_shifts(synapses, rates, time_step_us, n_types=2, sigma=5.0,
+                  wide=False, measured_peaks=None, bernstein=True):
+    """ The ring buffer shift of each synapse type
+
+    :param wide: the sums are 32 bits
+    :param measured_peaks: the largest input of each type in a previous\
+        run, in nA, if known
+    :param bernstein: False for the [Simulation] rule
+    """
+    means, variances, max_weights = input_statistics(
+        synapses, rates, time_step_us, n_types)
+    peaks = [0.0] * n_types
+    for (synapse_type, neuron), mean in means.items():
+        estimate = peak_input(
+            mean, variances[(synapse_type, neuron)],
+            max_weights[synapse_type] if bernstein else 0.0, sigma)
+        peaks[synapse_type] = max(peaks[synapse_type], estimate)
+    if measured_peaks is not None:
+        peaks = [max(p, m) for p, m in zip(peaks, measured_peaks)]
+    return [max(shift_for(peak, 32 if wide else 16), shift_for(weight, 16))
+            for peak, weight in zip(peaks, max_weights)]
+
+
+def decode_provenance(words, shifts):
+    """ (saturations, clipped inputs, largest input in nA) of each type
+    """
+    if len(words) != PROVENANCE_WORDS_PER_TYPE * len(shifts):
+        raise SynapticInputError("{} provenance words for {} types".format(
+            len(words), len(shifts)))
+    return [(words[3 * t], words[3 * t + 1],
+             math.ldexp(words[3 * t + 2], shift - FRACTION_BITS))
+            for t, shift in enumerate(shifts)]
+
+
+def shifts_after_run(shifts, provenance, wide=False):
+    """ The shifts for the next run: large enough for the largest input,
+        and one more where the sums saturated or were clipped, as then the
+        largest input is only a lower bound
+    """
+    bits = 32 if wide else 16
+    return [min(MAX_SHIFT, max(shift, shift_for(peak, bits)) +
+                (1 if saturations or clipped else 0))
+            for shift, (saturations, clipped, peak) in zip(shifts, provenance)]
+
+
+def read_check_file(path):
+    """ The synapses, measured rates and shifts synaptic_input_bench writes
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    n_sources, n_neurons, n_synapses, time_step_us, sigma = \
+        struct.unpack_from("<5I", data, 0)
+    offset = 20
+    rates = struct.unpack_from("<{}d".format(n_sources), data, offset)
+    offset += 8 * n_sources
+    fields = struct.unpack_from("<" + "3Id" * n_synapses, data, offset)
+    synapses = [tuple(fields[i:i + 4]) for i in range(0, len(fields), 4)]
+    offset += 20 * n_synapses
+    words = struct.unpack_from("<6I", data, offset)
+    if offset + 24 != len(data):
+        raise SynapticInputError("{} is not a synaptic input check "
+                                 "file".format(path))
+    shifts = [list(words[0:2]), list(words[2:4]), list(words[4:6])]
+    return synapses, rates, time_step_us, sigma, shifts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    commands = parser.add_subparsers(dest="command")
+    check = commands.add_parser(
+        "check", help="choose the bench's shifts and compare")
+    check.add_argument("file")
+    check.add_argument("--spikes-per-second", type=float, default=30.0,
+                       help="the [Simulation] rate (default 30)")
+    provenance = commands.add_parser(
+        "provenance", help="decode provenance words and adjust the shifts")
+    provenance.add_argument("--shifts", required=True,
+                            help="the shift of each type, e.g. 5,4")
+    provenance.add_argument("--wide", action="store_true",
+                            help="the sums are 32 bits")
+    provenance.add_argument("words", type=int, nargs="+")
+    args = parser.parse_args()
+
+    if args.command == "check":
+        synapses, rates, time_step_us, sigma, expected = \
+            read_check_file(args.file)
+        config_rates = [args.spikes_per_second] * len(rates)
+        rules = [("config", config_rates, False, False),
+                 ("measured", rates, True, False),
+                 ("32-bit", rates, True, True)]
+        n_failures = 0
+        for (name, rule_rates, bernstein, wide), want in zip(rules, expected):
+            got = choose_shifts(synapses, rule_rates, time_step_us,
+                                sigma=sigma, wide=wide, bernstein=bernstein)
+            print("{:<10} {}{}".format(
+                name, " ".join(str(s) for s in got),
+                "" if got == want else "  (C chose {})".format(
+                    " ".join(str(s) for s in want))))
+            n_failures += got != want
+        return 1 if n_failures else 0
+    elif args.command == "provenance":
+        shifts = [int(s) for s in args.shifts.split(",")]
+        decoded = decode_provenance(args.words, shifts)
+        for t, (saturations, clipped, peak) in enumerate(decoded):
+            print("type {}: {} saturations, {} clipped, largest {:.3f} "
+                  "nA".format(t, saturations, clipped, peak))
+        print("shifts {}".format(" ".join(
+            str(s) for s in shifts_after_run(shifts, decoded,
+                                             args.wide))))
+    else:
+        parser.print_help()
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -178,6 +178,21 @@ static inline bool empty_bit_field (bit_field_t b, size_t s)
 static inline bool nonempty_bit_field  (bit_field_t b, size_t s)
 { return (!empty_bit_field (b, s)); }
 
+//! \brief This function counts the bits set in a bit_field.
+//! \param[in] b The sequence of words representing a bit_field.
+//! \param[in] s The size of the bit_field.
+//! \return The number of bits set.
+
+static inline counter_t count_bit_field (bit_field_t b, size_t s)
+{
+    counter_t sum = 0;
+
+    for ( ; s > 0; s--)
+        sum += __builtin_popcount (b [s-1]);
+
+    return (sum);
+}
+
 //! \brief A function that calculates the size of a bit_field to hold 'bits'
 //! bits.
 //! \param[in] bits The number of bits required for this bit_field.
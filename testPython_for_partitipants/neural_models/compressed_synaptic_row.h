@@ -0,0 +1,153 @@
+
+
+#ifndef _COMPRESSED_SYNAPTIC_ROW_
+#define _COMPRESSED_SYNAPTIC_ROW_
+
+
+#include <stdint.h>
+
+
+/*
+	Compact encoding of the fixed synapses of one synaptic row, written on
+	the host by host_tools/synaptic_row_encoder.c and expanded here on the
+	core once the row DMA has completed.
+
+	A fixed synapse word is  weight[31:16] | delay and type[15:8] | index[7:0];
+	the decoder rebuilds these words, sorted by index, so the rest of the
+	synapse processing is unchanged.
+
+	header word 0:	n_synapses[9:0]  size_words[19:10]  index_bits[23:20]
+					dt_bits[27:24]  weight_shift[31:28]
+	header word 1:	base_weight[15:0]  base_dt[23:16]  weight_bits[28:24]
+					weight_rle[29]
+
+	followed by a bit stream, least significant bit first:
+
+		first index				8 bits
+		index deltas			index_bits each, n_synapses - 1 of them
+		delay and type			dt_bits each, added to base_dt
+		weights, plain			weight_bits each
+		weights, run-length		( run - 1 : 8 bits, weight : weight_bits ) pairs
+
+	with weight = base_weight + ( code << weight_shift ).  Width 0 means
+	every synapse shares the base value, so a row with one weight and one
+	delay costs the header plus the index deltas.
+
+	spec_exec --compress-rows writes the synaptic matrix region this way
+	(host_tools/synaptic_matrix_compressor.c).  The 2dArray master
+	population table still gives each source a block and an index into the
+	row length translation table, but the table then holds the block's
+	row stride in words, flagged with COMPRESSED_MATRIX_STRIDE_FLAG, so the
+	row of a neuron is block + neuron * stride and one DMA of the stride
+	fetches it; the decoder runs on the DMA'd row.
+*/
+
+#define COMPRESSED_ROW_HEADER_WORDS		2
+#define COMPRESSED_ROW_MAX_SYNAPSES		1023
+#define COMPRESSED_ROW_MAX_WORDS		1023
+#define COMPRESSED_ROW_RUN_BITS			8
+#define COMPRESSED_MATRIX_STRIDE_FLAG	0x80000000
+#define PLAIN_ROW_HEADER_WORDS			3
+
+#define CR_N_SYNAPSES( h0 )		( ( h0 ) & 0x3FF )
+#define CR_SIZE_WORDS( h0 )		( ( ( h0 ) >> 10 ) & 0x3FF )
+#define CR_INDEX_BITS( h0 )		( ( ( h0 ) >> 20 ) & 0xF )
+#define CR_DT_BITS( h0 )		( ( ( h0 ) >> 24 ) & 0xF )
+#define CR_WEIGHT_SHIFT( h0 )	( ( h0 ) >> 28 )
+
+#define CR_BASE_WEIGHT( h1 )	( ( h1 ) & 0xFFFF )
+#define CR_BASE_DT( h1 )		( ( ( h1 ) >> 16 ) & 0xFF )
+#define CR_WEIGHT_BITS( h1 )	( ( ( h1 ) >> 24 ) & 0x1F )
+#define CR_WEIGHT_RLE( h1 )		( ( ( h1 ) >> 29 ) & 0x1 )
+
+
+typedef struct {
+	const uint32_t*	next_word;
+	uint64_t		buffer;
+	uint32_t		n_bits;
+} compressed_row_reader_t;
+
+
+// fields are at most 16 bits wide, so one refill is always enough
+static inline uint32_t compressed_row_read( compressed_row_reader_t* r, uint32_t bits ) {
+
+	if( bits == 0 )
+		return 0;
+
+	if( r->n_bits < bits ) {
+		r->buffer |= (uint64_t) *r->next_word++ << r->n_bits;
+		r->n_bits += 32;
+		}
+
+	uint32_t value = (uint32_t) r->buffer & ( ( 1u << bits ) - 1 );
+
+	r->buffer >>= bits;
+	r->n_bits -= bits;
+
+	return value;
+}
+
+
+// bytes to DMA for a row of a block given its translation table entry:
+// the stride of a compressed block, else a plain row's header and synapses
+static inline uint32_t synaptic_row_dma_bytes( uint32_t row_length ) {
+
+	if( row_length & COMPRESSED_MATRIX_STRIDE_FLAG )
+		return ( row_length & ~COMPRESSED_MATRIX_STRIDE_FLAG ) * sizeof( uint32_t );
+	return ( PLAIN_ROW_HEADER_WORDS + row_length ) * sizeof( uint32_t );
+}
+
+
+// expands the row at compressed into fixed synapse words; returns their number
+static inline uint32_t compressed_row_decode( const uint32_t* compressed, uint32_t* fixed_synapses ) {
+
+	uint32_t h0 = compressed[0], h1 = compressed[1];
+	uint32_t n = CR_N_SYNAPSES( h0 );
+	compressed_row_reader_t r = { compressed + COMPRESSED_ROW_HEADER_WORDS, 0, 0 };
+
+	if( n == 0 )
+		return 0;
+
+	uint32_t index_bits = CR_INDEX_BITS( h0 );
+	uint32_t index = compressed_row_read( &r, 8 );
+
+	fixed_synapses[0] = index;
+	for( uint32_t i = 1; i < n; i++ ) {
+		index += compressed_row_read( &r, index_bits );
+		fixed_synapses[i] = index;
+		}
+
+	uint32_t dt_bits = CR_DT_BITS( h0 );
+	uint32_t base_dt = CR_BASE_DT( h1 ) << 8;
+
+	if( dt_bits == 0 )
+		for( uint32_t i = 0; i < n; i++ )
+			fixed_synapses[i] |= base_dt;
+	else
+		for( uint32_t i = 0; i < n; i++ )
+			fixed_synapses[i] |= base_dt + ( compressed_row_read( &r, dt_bits ) << 8 );
+
+	uint32_t weight_bits = CR_WEIGHT_BITS( h1 );
+	uint32_t weight_shift = CR_WEIGHT_SHIFT( h0 );
+	uint32_t base_weight = CR_BASE_WEIGHT( h1 );
+
+	if( weight_bits == 0 )
+		for( uint32_t i = 0; i < n; i++ )
+			fixed_synapses[i] |= base_weight << 16;
+	else if( !CR_WEIGHT_RLE( h1 ) )
+		for( uint32_t i = 0; i < n; i++ )
+			fixed_synapses[i] |= ( base_weight + ( compressed_row_read( &r, weight_bits ) << weight_shift ) ) << 16;
+	else
+		for( uint32_t i = 0; i < n; ) {
+			uint32_t run = compressed_row_read( &r, COMPRESSED_ROW_RUN_BITS ) + 1;
+			uint32_t weight = ( base_weight + ( compressed_row_read( &r, weight_bits ) << weight_shift ) ) << 16;
+
+			for( ; run > 0 && i < n; run--, i++ )
+				fixed_synapses[i] |= weight;
+			}
+
+	return n;
+}
+
+
+#endif   // include guard
@@ -0,0 +1,137 @@
+
+
+#include "connector_generators.h"
+
+
+// Words in the common part of a projection and its type specific part
+#define COMMON_WORDS		( sizeof( connector_parameters_t ) / sizeof( uint32_t ) )
+
+
+static uint32_t type_words( uint32_t type, const uint32_t* type_parameters )
+{
+	switch( type ) {
+	case CONNECTOR_FIXED_PROBABILITY:
+		return 1;
+	case CONNECTOR_DISTANCE_DEPENDENT:
+		return 3 + type_parameters[2];
+	default:
+		return 0;
+		}
+}
+
+
+uint32_t connector_read_region( const uint32_t* region, connector_projection_t* projections,
+								uint32_t max_projections )
+{
+	uint32_t n_projections = region[0];
+	const uint32_t* word = &region[1];
+
+	if( n_projections > max_projections )
+		return 0;
+
+	for( uint32_t i = 0; i < n_projections; i++ ) {
+		const connector_parameters_t* parameters = (const connector_parameters_t*) word;
+
+		if( parameters->type >= CONNECTOR_N_TYPES
+			|| parameters->post_slice_count > CONNECTOR_MAX_ROW_LENGTH )
+			return 0;
+
+		projections[i].parameters = parameters;
+		projections[i].type_parameters = word + COMMON_WORDS;
+
+		word += COMMON_WORDS + type_words( parameters->type, projections[i].type_parameters );
+		}
+
+	return n_projections;
+}
+
+
+void connector_row_seed( const connector_parameters_t* parameters, uint32_t pre, mars_kiss64_seed_t seed )
+{
+	// odd multipliers spread consecutive rows across the whole seed space
+	seed[0] = parameters->seed[0] + pre * 0x9E3779B9u;
+	seed[1] = parameters->seed[1] ^ ( pre * 0x85EBCA6Bu );
+	seed[2] = parameters->seed[2] + pre * 0xC2B2AE35u;
+	seed[3] = parameters->seed[3] + pre;
+
+	validate_mars_kiss64_seed( seed );
+}
+
+
+// a uniform integer in [0, range]; one multiply rather than a modulo
+static inline uint32_t uniform_in_range( mars_kiss64_seed_t seed, uint32_t range ) {
+
+	return (uint32_t)( ( (uint64_t) mars_kiss64_seed( seed ) * ( (uint64_t) range + 1 ) ) >> 32 );
+}
+
+
+static inline bool distance_connects( const uint32_t* type_parameters, uint32_t pre, uint32_t post,
+									  uint32_t draw ) {
+
+	uint32_t pre_width = type_parameters[0], post_width = type_parameters[1];
+	uint32_t n_thresholds = type_parameters[2];
+	int32_t dx = (int32_t)( pre % pre_width ) - (int32_t)( post % post_width );
+	int32_t dy = (int32_t)( pre / pre_width ) - (int32_t)( post / post_width );
+	uint32_t distance_squared = dx * dx + dy * dy;
+
+	return distance_squared < n_thresholds && draw < type_parameters[3 + distance_squared];
+}
+
+
+uint32_t connector_generate_row( const connector_projection_t* projection, uint32_t pre,
+								 uint32_t* fixed_synapses )
+{
+	const connector_parameters_t* p = projection->parameters;
+	bool allow_self = p->flags & CONNECTOR_ALLOW_SELF_CONNECTIONS;
+	uint32_t type_and_index_bits = CONNECTOR_SYNAPSE_TYPE( p->flags ) << 8;
+	uint32_t n = 0;
+	mars_kiss64_seed_t seed;
+
+	connector_row_seed( p, pre, seed );
+
+	for( uint32_t i = 0; i < p->post_slice_count; i++ ) {
+		uint32_t post = p->post_slice_start + i;
+		bool connect;
+
+		switch( p->type ) {
+		case CONNECTOR_ALL_TO_ALL:
+			connect = true;
+			break;
+		case CONNECTOR_ONE_TO_ONE:
+			connect = post == pre;
+			break;
+		case CONNECTOR_FIXED_PROBABILITY:
+			connect = mars_kiss64_seed( seed ) < projection->type_parameters[0];
+			break;
+		default:
+			connect = distance_connects( projection->type_parameters, pre, post, mars_kiss64_seed( seed ) );
+			break;
+			}
+
+		if( !connect || ( !allow_self && post == pre && p->type != CONNECTOR_ONE_TO_ONE ) )
+			continue;
+
+		uint32_t weight = p->weight_low + ( p->weight_range ? uniform_in_range( seed, p->weight_range ) : 0 );
+		uint32_t delay = p->delay_low + ( p->delay_range ? uniform_in_range( seed, p->delay_range ) : 0 );
+
+		fixed_synapses[n++] = ( weight << 16 )
+							  | ( ( delay & ( ( 1 << CONNECTOR_SYNAPSE_DELAY_BITS ) - 1 ) ) << ( 8 + CONNECTOR_SYNAPSE_TYPE_BITS ) )
+							  | type_and_index_bits | i;
+		}
+
+	return n;
+}
+
+
+const uint32_t* connector_get_row( const connector_projection_t* projection,
+								   connector_row_cache_t* cache, uint32_t pre )
+{
+	uint32_t* row = &cache->rows[pre * ( 1 + CONNECTOR_MAX_ROW_LENGTH )];
+
+	if( !bit_field_test( cache->expanded, pre ) ) {
+		row[0] = connector_generate_row( projection, pre, &row[1] );
+		bit_field_set( cache->expanded, pre );
+		}
+
+	return row;
+}
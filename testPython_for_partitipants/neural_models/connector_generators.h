@@ -0,0 +1,114 @@
+
+
+#ifndef _CONNECTOR_GENERATORS_
+#define _CONNECTOR_GENERATORS_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "random.h"
+#include "bit_field.h"
+
+
+/*
+	On-core expansion of synaptic rows from connector parameters.
+
+	Instead of a synaptic matrix the host writes a connector region of a
+	few words per projection, and a row is generated the first time a spike
+	from its presynaptic neuron arrives.  The host generator in
+	izh_curr_stochastic/connector_generation.py has the same semantics, so
+	generated rows can be checked bit for bit (host/connector_check).
+
+	Region layout, 32-bit words:
+
+		n_projections
+		per projection:
+			type					connector_type_t
+			post_slice_start		first postsynaptic neuron on this core
+			post_slice_count		neurons on this core, at most 256
+			flags					bit 0: allow self connections,
+									bits 15:8 synapse type, of which the low
+									CONNECTOR_SYNAPSE_TYPE_BITS are used
+			seed[4]					mars_kiss64 seed of this projection and slice
+			weight_low, weight_range	weight = low + uniform in [0, range]
+			delay_low, delay_range		delay in timesteps, likewise
+			per type:
+				FIXED_PROBABILITY	threshold: connect if a draw < threshold
+				DISTANCE_DEPENDENT	pre_grid_width, post_grid_width, n_thresholds,
+									thresholds[n_thresholds] indexed by squared distance
+
+	Rows are generated from a seed derived from the projection seed and the
+	presynaptic index, so they can be expanded in any order.  For each
+	postsynaptic neuron in turn a connection draw is made (random connectors
+	only), then a weight and a delay draw (only if the range is not 0).
+
+	Nothing writes or reads the region yet: the population vertex still
+	writes the synaptic matrix through spynnaker, and rows are fetched by
+	sPyNNaker's synapse code, which would call connector_get_row() from
+	its row fetch once a vertex reserves the region.  Until then the
+	generators only run on the host, in connector_check.
+*/
+
+#define CONNECTOR_SYNAPSE_TYPE_BITS		1
+#define CONNECTOR_SYNAPSE_DELAY_BITS	4
+#define CONNECTOR_MAX_ROW_LENGTH		256
+
+#define CONNECTOR_ALLOW_SELF_CONNECTIONS	( 1 << 0 )
+#define CONNECTOR_SYNAPSE_TYPE( flags )		( ( ( flags ) >> 8 ) & ( ( 1 << CONNECTOR_SYNAPSE_TYPE_BITS ) - 1 ) )
+
+typedef enum {
+	CONNECTOR_ALL_TO_ALL = 0,
+	CONNECTOR_ONE_TO_ONE,
+	CONNECTOR_FIXED_PROBABILITY,
+	CONNECTOR_DISTANCE_DEPENDENT,
+	CONNECTOR_N_TYPES
+} connector_type_t;
+
+typedef struct {
+	uint32_t			type;
+	uint32_t			post_slice_start;
+	uint32_t			post_slice_count;
+	uint32_t			flags;
+	mars_kiss64_seed_t	seed;
+	uint32_t			weight_low;
+	uint32_t			weight_range;
+	uint32_t			delay_low;
+	uint32_t			delay_range;
+} connector_parameters_t;
+
+typedef struct {
+	const connector_parameters_t*	parameters;
+	const uint32_t*					type_parameters;	// words after the common part
+} connector_projection_t;
+
+// Rows already expanded, in memory supplied by the caller (normally SDRAM):
+// 1 + CONNECTOR_MAX_ROW_LENGTH words per presynaptic neuron, the first
+// holding the row length, and one bit per presynaptic neuron
+typedef struct {
+	uint32_t*		rows;
+	bit_field_t		expanded;
+	uint32_t		n_pre;
+} connector_row_cache_t;
+
+
+// Reads up to max_projections projections from the region; returns how many,
+// or 0 if the region is malformed
+uint32_t connector_read_region( const uint32_t* region, connector_projection_t* projections,
+								uint32_t max_projections );
+
+// Generates the row of presynaptic neuron pre as fixed synapse words
+// (weight[31:16] delay[12:9] type[8] index[7:0]); returns the row length
+uint32_t connector_generate_row( const connector_projection_t* projection, uint32_t pre,
+								 uint32_t* fixed_synapses );
+
+// The row of presynaptic neuron pre as [length, fixed synapses...], generated
+// into the cache on first use
+const uint32_t* connector_get_row( const connector_projection_t* projection,
+								   connector_row_cache_t* cache, uint32_t pre );
+
+// The seed of the row of presynaptic neuron pre
+void connector_row_seed( const connector_parameters_t* parameters, uint32_t pre, mars_kiss64_seed_t seed );
+
+
+#endif   // include guard
@@ -213,8 +213,18 @@
 //! \param[in] ptr The pointer whose address is required.
 //! \return The value as an unsigned integer.
 
+#ifndef DEBUG_ON_HOST
 static inline unsigned int __addr__ (void* ptr)
 { return ((unsigned int)(ptr)); }
+#else  /* DEBUG_ON_HOST */
+#include <stdint.h>
+
+//! On a 64-bit host a pointer is wider than an unsigned int, so go through
+//! uintptr_t; the address is only ever used by the checks below.
+
+static inline unsigned int __addr__ (void* ptr)
+{ return ((unsigned int)(uintptr_t)(ptr)); }
+#endif /* DEBUG_ON_HOST */
 
 //! \brief This macro tests whether a pointer returned by malloc is null.
 //! \param[in] a The address returned by malloc.
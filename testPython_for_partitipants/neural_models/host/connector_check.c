@@ -0,0 +1,102 @@
+/*
+	Bit-exactness check of the on-core connector generators
+	(../connector_generators.c) against the host generator in
+	izh_curr_stochastic/connector_generation.py.
+
+		python ../../izh_curr_stochastic/connector_generation.py vectors.bin
+		./connector_check vectors.bin
+
+	The file holds a connector region followed by the rows the host
+	generated for every presynaptic neuron of every projection; each row is
+	generated again here, once directly and once through the row cache, and
+	compared word for word.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "connector_generators.h"
+
+
+#define MAX_PROJECTIONS		64
+
+static const char* type_names[] = { "all_to_all", "one_to_one", "fixed_probability", "distance_dependent" };
+
+
+int main( int argc, char* argv[] )
+{
+	if( argc != 2 ) {
+		fprintf( stderr, "usage: %s VECTORS\n", argv[0] );
+		return 1;
+		}
+
+	FILE* f = fopen( argv[1], "rb" );
+
+	if( f == NULL ) {
+		fprintf( stderr, "cannot read %s\n", argv[1] );
+		return 1;
+		}
+
+	fseek( f, 0, SEEK_END );
+	uint32_t n_words = ftell( f ) / sizeof( uint32_t );
+	fseek( f, 0, SEEK_SET );
+
+	uint32_t* words = malloc( n_words * sizeof( uint32_t ) );
+
+	if( fread( words, sizeof( uint32_t ), n_words, f ) != n_words ) {
+		fprintf( stderr, "short read from %s\n", argv[1] );
+		return 1;
+		}
+	fclose( f );
+
+	connector_projection_t projections[MAX_PROJECTIONS];
+	uint32_t n_region_words = words[0];
+	uint32_t n_projections = connector_read_region( &words[1], projections, MAX_PROJECTIONS );
+	uint32_t n_pre = words[1 + n_region_words];
+	const uint32_t* expected = &words[2 + n_region_words];
+
+	if( n_projections == 0 ) {
+		fprintf( stderr, "malformed connector region\n" );
+		return 1;
+		}
+
+	uint32_t* cache_rows = malloc( n_pre * ( 1 + CONNECTOR_MAX_ROW_LENGTH ) * sizeof( uint32_t ) );
+	uint32_t* cache_bits = malloc( ( n_pre / 32 + 1 ) * sizeof( uint32_t ) );
+	uint32_t row[CONNECTOR_MAX_ROW_LENGTH];
+	uint32_t n_failures = 0;
+
+	for( uint32_t p = 0; p < n_projections; p++ ) {
+		connector_row_cache_t cache = { cache_rows, cache_bits, n_pre };
+		uint32_t n_synapses = 0, n_mismatched_rows = 0;
+
+		memset( cache_bits, 0, ( n_pre / 32 + 1 ) * sizeof( uint32_t ) );
+
+		for( uint32_t pre = 0; pre < n_pre; pre++ ) {
+			uint32_t n_expected = *expected++;
+			uint32_t n = connector_generate_row( &projections[p], pre, row );
+			const uint32_t* cached = connector_get_row( &projections[p], &cache, pre );
+
+			if( n != n_expected || memcmp( row, expected, n * sizeof( uint32_t ) )
+				|| cached[0] != n || memcmp( &cached[1], row, n * sizeof( uint32_t ) ) )
+				n_mismatched_rows++;
+
+			n_synapses += n_expected;
+			expected += n_expected;
+			}
+
+		printf( "projection %u (%s): %u rows, %u synapses, %u rows differ\n", p,
+				type_names[projections[p].parameters->type], n_pre, n_synapses, n_mismatched_rows );
+		n_failures += n_mismatched_rows;
+		}
+
+	printf( "%s\n", n_failures ? "FAIL" : "bit-exact" );
+
+	free( words );
+	free( cache_rows );
+	free( cache_bits );
+
+	return n_failures ? 1 : 0;
+}
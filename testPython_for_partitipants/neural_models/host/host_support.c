@@ -0,0 +1,95 @@
+/*! \file
+ *
+ *  \brief Host implementations of the libspinn_common functions that the
+ *    neuron model links against on the board.
+ *
+ */
+
+#include <math.h>
+#include "neuron/models/generic_neuron.h"
+#include "normal.h"
+#include "random.h"
+
+
+// Marsaglia 32-bit KISS, same constants as the board version so that host
+// and board noise streams are comparable
+uint32_t mars_kiss32( void )
+{
+	static uint32_t	x = 123456789, y = 234567891, z = 345678912, w = 456789123, c = 0;
+	int32_t			t;
+
+	y ^= ( y << 5 );
+	y ^= ( y >> 7 );
+	y ^= ( y << 22 );
+	t = z + w + c;
+	z = w;
+	c = t < 0;
+	w = t & 2147483647;
+	x += 1411392427;
+
+	return x + y + w;
+}
+
+
+// Marsaglia JKISS64 with a caller-held seed, as in libspinn_common, so that
+// rows generated on the host match those generated on the board
+void validate_mars_kiss64_seed( mars_kiss64_seed_t seed )
+{
+	if( seed[1] == 0 )
+		seed[1] = 13031301;
+	seed[3] = seed[3] % 698769068 + 1;
+}
+
+
+uint32_t mars_kiss64_seed( mars_kiss64_seed_t seed )
+{
+	uint64_t	t;
+
+	seed[0] = 314527869 * seed[0] + 1234567;
+	seed[1] ^= ( seed[1] << 5 );
+	seed[1] ^= ( seed[1] >> 7 );
+	seed[1] ^= ( seed[1] << 22 );
+	t = 4294584393ULL * seed[2] + seed[3];
+	seed[3] = t >> 32;
+	seed[2] = t;
+
+	return seed[0] + seed[1] + seed[2];
+}
+
+
+// Acklam's rational approximation to the inverse normal CDF; accurate to
+// about 1e-9 which is far better than the s16.15 board arithmetic needs
+REAL norminv_urb( uint32_t uniform )
+{
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02,
+								-2.759285104469687e+02, 1.383577518672690e+02,
+								-3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02,
+								-1.556989798598866e+02, 6.680131188771972e+01,
+								-1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01,
+								-2.400758277161838e+00, -2.549732539343734e+00,
+								4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01,
+								2.445134137142996e+00, 3.754408661907416e+00 };
+	static const double p_low = 0.02425;
+
+	double	p = ( (double) uniform + 0.5 ) / 4294967296.0, q, r;
+
+	if( p < p_low ) {
+		q = sqrt( -2.0 * log( p ) );
+		return (REAL)( ( ( ( ( ( c[0] * q + c[1] ) * q + c[2] ) * q + c[3] ) * q + c[4] ) * q + c[5] ) /
+					   ( ( ( ( d[0] * q + d[1] ) * q + d[2] ) * q + d[3] ) * q + 1.0 ) );
+		}
+
+	if( p > 1.0 - p_low ) {
+		q = sqrt( -2.0 * log( 1.0 - p ) );
+		return (REAL)( -( ( ( ( ( c[0] * q + c[1] ) * q + c[2] ) * q + c[3] ) * q + c[4] ) * q + c[5] ) /
+					   ( ( ( ( d[0] * q + d[1] ) * q + d[2] ) * q + d[3] ) * q + 1.0 ) );
+		}
+
+	q = p - 0.5;
+	r = q * q;
+	return (REAL)( ( ( ( ( ( a[0] * r + a[1] ) * r + a[2] ) * r + a[3] ) * r + a[4] ) * r + a[5] ) * q /
+				   ( ( ( ( ( b[0] * r + b[1] ) * r + b[2] ) * r + b[3] ) * r + b[4] ) * r + 1.0 ) );
+}
@@ -0,0 +1,300 @@
+/*
+	Calibration benchmark for the izh_curr_stochastic neuron kernel.
+
+	Runs the real model update (../izh_curr_stochastic.c, host build) over a
+	grid of atom counts, synaptic fan-in, recording on/off and noise on/off,
+	then least-squares fits
+
+		cycles per tick = base + n * ( neuron + noise*s + recording*r + synapse*f )
+
+	with n atoms, s = 1 if stochastic, r = 1 if recording and f synaptic
+	events per atom per tick.  Host nanoseconds are converted to ARM cycles
+	by anchoring the plain stochastic update to a figure measured on the
+	board (--board-cycles-per-atom, 782 by default), so only the relative
+	costs come from the host.  Those are not the board's: the host noise
+	draw is a double-precision norminv, where the board's norminv_urb is
+	fixed point on an ARM968 without an FPU.  The file is therefore marked
+	source = host, and the vertex keeps to the flat board figure until a
+	split measured on the board is written with source = board.
+
+	The result is written in the same INI style as pacman.cfg and read by
+	izh_curr_stochastic/neuron_cost_model.py.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "izh_curr_stochastic.h"
+#include "bit_field.h"
+#include "random.h"
+
+
+#define RING_BUFFER_SLOTS		16
+#define MAX_ATOMS				256
+#define N_COEFFICIENTS			5
+
+static const uint32_t	atom_counts[] = { 16, 64, 128, 256 };
+static const uint32_t	fan_ins[] = { 0, 4, 16, 64 };
+
+static bool				quiescence = false;
+
+typedef struct {
+	uint32_t	n_atoms;
+	uint32_t	fan_in;
+	bool		recording;
+	bool		stochastic;
+	double		ns_per_tick;
+} calibration_point_t;
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+// one configuration: emulates the synaptic row processing of static_synapses.c
+// (ring buffer adds), then the neuron loop and the spike / V recording
+static double time_configuration( uint32_t n_atoms, uint32_t fan_in, bool recording,
+								  bool stochastic, uint32_t n_ticks )
+{
+	static struct neuron_t	neurons[MAX_ATOMS];
+	static uint16_t			ring_buffer[RING_BUFFER_SLOTS][MAX_ATOMS];
+	static REAL				recorded_v[MAX_ATOMS];
+	static uint32_t			spike_words[MAX_ATOMS / 32];
+
+	uint32_t	n_events = n_atoms * fan_in;
+	uint32_t*	synaptic_words = malloc( ( n_events + 1 ) * sizeof( uint32_t ) );
+	double		best = 1e30;
+	uint32_t	spikes = 0;
+
+	for( uint32_t e = 0; e < n_events; e++ )
+		synaptic_words[e] = ( mars_kiss32() % n_atoms ) | ( ( mars_kiss32() & 0xF ) << 8 )
+							| ( ( mars_kiss32() & 0x3FF ) << 16 );
+
+	for( uint32_t repeat = 0; repeat < 3; repeat++ ) {
+
+		for( uint32_t i = 0; i < n_atoms; i++ ) {
+			struct neuron_t* n = &neurons[i];
+
+			n->A = 0.02f; n->B = 0.2f; n->C = -65.0f; n->D = 2.0f;
+			n->V = -70.0f; n->U = -14.0f;
+			n->I_offset = (REAL)( mars_kiss32() % 1000 ) * 0.01f;
+			n->membrane_noise_sd = stochastic ? 2.5f : 0.0f;
+			n->this_h = 1.0f;
+			n->status = quiescence ? NEURON_QUIESCENCE_ENABLED : 0;
+			}
+		memset( ring_buffer, 0, sizeof( ring_buffer ) );
+
+		double start = now_ns();
+
+		for( uint32_t tick = 0; tick < n_ticks; tick++ ) {
+			uint16_t* this_slot = ring_buffer[tick & ( RING_BUFFER_SLOTS - 1 )];
+
+			for( uint32_t e = 0; e < n_events; e++ ) {
+				uint32_t word = synaptic_words[e];
+				uint32_t slot = ( tick + ( ( word >> 8 ) & 0xF ) ) & ( RING_BUFFER_SLOTS - 1 );
+
+				ring_buffer[slot][word & 0xFF] += word >> 16;
+				}
+
+			if( recording )
+				clear_bit_field( spike_words, get_bit_field_size( n_atoms ) );
+
+			for( uint32_t i = 0; i < n_atoms; i++ ) {
+				REAL exc_input = (REAL) this_slot[i] * ( 1.0f / 256.0f );
+
+				this_slot[i] = 0;
+
+				bool spike = neuron_state_update( exc_input, REAL_CONST( 0.0 ), REAL_CONST( 0.0 ), &neurons[i] );
+
+				if( recording ) {
+					recorded_v[i] = neurons[i].V;
+					if( spike )
+						bit_field_set( spike_words, i );
+					}
+				spikes += spike;
+				}
+			}
+
+		double elapsed = ( now_ns() - start ) / n_ticks;
+
+		if( elapsed < best )
+			best = elapsed;
+		}
+
+	free( synaptic_words );
+
+	// keep the recording stores and the spike count observable
+	if( spikes == UINT32_MAX || recorded_v[0] == 12345.0f )
+		fprintf( stderr, "#" );
+
+	return best;
+}
+
+
+// solves the normal equations of the least-squares fit by Gaussian elimination
+static bool fit_cost_model( calibration_point_t* points, uint32_t n_points,
+							double coefficients[N_COEFFICIENTS] )
+{
+	double ata[N_COEFFICIENTS][N_COEFFICIENTS + 1];
+
+	memset( ata, 0, sizeof( ata ) );
+
+	for( uint32_t p = 0; p < n_points; p++ ) {
+		double n = points[p].n_atoms;
+		double x[N_COEFFICIENTS] = { 1.0, n, n * points[p].stochastic,
+									 n * points[p].recording, n * points[p].fan_in };
+
+		for( uint32_t i = 0; i < N_COEFFICIENTS; i++ ) {
+			for( uint32_t j = 0; j < N_COEFFICIENTS; j++ )
+				ata[i][j] += x[i] * x[j];
+			ata[i][N_COEFFICIENTS] += x[i] * points[p].ns_per_tick;
+			}
+		}
+
+	for( uint32_t col = 0; col < N_COEFFICIENTS; col++ ) {
+		uint32_t pivot = col;
+
+		for( uint32_t row = col + 1; row < N_COEFFICIENTS; row++ )
+			if( fabs( ata[row][col] ) > fabs( ata[pivot][col] ) )
+				pivot = row;
+		if( ata[pivot][col] == 0.0 )
+			return false;
+
+		for( uint32_t k = 0; k <= N_COEFFICIENTS; k++ ) {
+			double t = ata[col][k];
+			ata[col][k] = ata[pivot][k];
+			ata[pivot][k] = t;
+			}
+
+		for( uint32_t row = 0; row < N_COEFFICIENTS; row++ ) {
+			if( row == col )
+				continue;
+			double f = ata[row][col] / ata[col][col];
+			for( uint32_t k = col; k <= N_COEFFICIENTS; k++ )
+				ata[row][k] -= f * ata[col][k];
+			}
+		}
+
+	for( uint32_t i = 0; i < N_COEFFICIENTS; i++ )
+		coefficients[i] = ata[i][N_COEFFICIENTS] / ata[i][i];
+
+	return true;
+}
+
+
+static void usage( const char* name )
+{
+	fprintf( stderr,
+			 "usage: %s [--ticks N] [--quiescence] [--board-cycles-per-atom C] [--output FILE]\n"
+			 "  --ticks                 ticks timed per configuration (default 2000)\n"
+			 "  --quiescence            time with idle neurons skipped (NEURON_QUIESCENCE_ENABLED)\n"
+			 "  --board-cycles-per-atom ARM cycles of the plain stochastic update,\n"
+			 "                          measured on the board (default 782)\n"
+			 "  --output                cost model file (default: stdout only)\n",
+			 name );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t		n_ticks = 2000;
+	double			board_cycles_per_atom = 782.0;
+	const char*		output = NULL;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			n_ticks = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--quiescence" ) )
+			quiescence = true;
+		else if( !strcmp( argv[i], "--board-cycles-per-atom" ) && i + 1 < argc )
+			board_cycles_per_atom = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--output" ) && i + 1 < argc )
+			output = argv[++i];
+		else {
+			usage( argv[0] );
+			return 1;
+			}
+		}
+
+	provide_machine_timestep( 1000 );
+
+	uint32_t n_atom_counts = sizeof( atom_counts ) / sizeof( atom_counts[0] );
+	uint32_t n_fan_ins = sizeof( fan_ins ) / sizeof( fan_ins[0] );
+	uint32_t n_points = 0;
+	calibration_point_t* points = malloc( n_atom_counts * n_fan_ins * 4 * sizeof( calibration_point_t ) );
+
+	printf( "%8s %8s %10s %11s %14s\n", "atoms", "fan_in", "recording", "stochastic", "ns/tick" );
+
+	for( uint32_t a = 0; a < n_atom_counts; a++ )
+		for( uint32_t f = 0; f < n_fan_ins; f++ )
+			for( uint32_t flags = 0; flags < 4; flags++ ) {
+				calibration_point_t* p = &points[n_points++];
+
+				p->n_atoms = atom_counts[a];
+				p->fan_in = fan_ins[f];
+				p->recording = flags & 1;
+				p->stochastic = ( flags >> 1 ) & 1;
+				p->ns_per_tick = time_configuration( p->n_atoms, p->fan_in, p->recording,
+													 p->stochastic, n_ticks );
+
+				printf( "%8u %8u %10u %11u %14.1f\n", p->n_atoms, p->fan_in, p->recording,
+						p->stochastic, p->ns_per_tick );
+				}
+
+	double c[N_COEFFICIENTS];
+
+	if( !fit_cost_model( points, n_points, c ) ) {
+		fprintf( stderr, "cost model fit is singular\n" );
+		return 1;
+		}
+
+	// anchor: plain stochastic update, no input, no recording == board figure
+	double arm_cycles_per_ns = board_cycles_per_atom / ( c[1] + c[2] );
+
+	for( uint32_t i = 0; i < N_COEFFICIENTS; i++ ) {
+		c[i] *= arm_cycles_per_ns;
+		if( c[i] < 0.0 )
+			c[i] = 0.0;
+		}
+
+	FILE* out = output ? fopen( output, "w" ) : NULL;
+
+	if( output && !out ) {
+		fprintf( stderr, "cannot write %s\n", output );
+		return 1;
+		}
+
+	FILE* streams[2] = { stdout, out };
+
+	for( uint32_t s = 0; s < 2 && streams[s]; s++ ) {
+		fprintf( streams[s], "\n[CostModel]\n" );
+		fprintf( streams[s], "# ARM cycles per timer tick, fitted by izh_calibrate over %u configurations\n", n_points );
+		fprintf( streams[s], "# A host estimate: the split between the terms is x86 timing of the host\n" );
+		fprintf( streams[s], "# build, scaled so neuron + noise is %.0f cycles.  neuron_cost_model.py\n",
+				 board_cycles_per_atom );
+		fprintf( streams[s], "# keeps to that flat figure until source is board.\n" );
+		fprintf( streams[s], "model = izh_curr_stochastic\n" );
+		fprintf( streams[s], "source = host\n" );
+		fprintf( streams[s], "base_cycles = %.1f\n", c[0] );
+		fprintf( streams[s], "neuron_cycles = %.1f\n", c[1] );
+		fprintf( streams[s], "noise_cycles = %.1f\n", c[2] );
+		fprintf( streams[s], "recording_cycles = %.1f\n", c[3] );
+		fprintf( streams[s], "synapse_cycles = %.1f\n", c[4] );
+		}
+
+	if( out )
+		fclose( out );
+	free( points );
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+	Accuracy / cost comparison of the ODE solvers in ../izh_ode_solvers.c.
+
+	For each solver, the cost is the time of one step of a 256-neuron core
+	(ns per neuron-step on this host, and relative to RK2 midpoint, which is
+	what the board build uses by default).  Accuracy is the firing rate and
+	first-spike time error against the izh_reference.c trains over a sweep
+	of constant currents, with the neuron run through the real
+	neuron_state_update() at the chosen machine timestep.
+
+	Pick a solver for a population with 'make ODE_SOLVER=<name>' in ../
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "izh_curr_stochastic.h"
+#include "izh_ode_solvers.h"
+#include "izh_reference.h"
+
+
+#define N_TIMED_NEURONS			256
+
+typedef struct {
+	const char*			name;
+	izh_ode_solver_t	solver;
+} named_solver_t;
+
+static const named_solver_t	solvers[] = {
+	{ "euler",				izh_euler },
+	{ "rk2_midpoint",		izh_rk2_midpoint },
+	{ "rk4",				izh_rk4 },
+	{ "exponential_euler",	izh_exponential_euler },
+	{ "closed_form",		izh_closed_form_subthreshold },
+};
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+// best of three runs of n_steps steps over a core's worth of neurons, spread
+// across the subthreshold and spiking input range
+static double ns_per_step( izh_ode_solver_t solver, REAL h, uint32_t n_steps )
+{
+	static struct neuron_t	neurons[N_TIMED_NEURONS];
+	double					best = 1e30;
+
+	for( uint32_t repeat = 0; repeat < 3; repeat++ ) {
+		for( uint32_t i = 0; i < N_TIMED_NEURONS; i++ ) {
+			memset( &neurons[i], 0, sizeof( neurons[i] ) );
+			neurons[i].A = 0.02f; neurons[i].B = 0.2f; neurons[i].C = -65.0f; neurons[i].D = 2.0f;
+			neurons[i].V = -70.0f; neurons[i].U = -14.0f;
+			neurons[i].I_offset = 0.04f * i;
+			}
+
+		double start = now_ns();
+
+		for( uint32_t step = 0; step < n_steps; step++ )
+			for( uint32_t i = 0; i < N_TIMED_NEURONS; i++ ) {
+				struct neuron_t* n = &neurons[i];
+
+				solver( h, n->I_offset, n );
+				if( n->V >= 30.0f ) {
+					n->V = n->C;
+					n->U += n->D;
+					}
+				}
+
+		double elapsed = ( now_ns() - start ) / ( (double) n_steps * N_TIMED_NEURONS );
+
+		if( elapsed < best )
+			best = elapsed;
+		}
+
+	return best;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint16_t	timestep_us = 1000;
+	double		duration_ms = 1000.0;
+	uint32_t	n_steps = 2000;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--timestep" ) && i + 1 < argc )
+			timestep_us = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--duration" ) && i + 1 < argc )
+			duration_ms = strtod( argv[++i], NULL );
+		else if( !strcmp( argv[i], "--steps" ) && i + 1 < argc )
+			n_steps = strtoul( argv[++i], NULL, 0 );
+		else {
+			fprintf( stderr, "usage: %s [--timestep us] [--duration ms] [--steps N]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	provide_machine_timestep( timestep_us );
+
+	uint32_t	n_solvers = sizeof( solvers ) / sizeof( solvers[0] );
+	double		cost[n_solvers], baseline_ns = 0.0;
+
+	for( uint32_t s = 0; s < n_solvers; s++ ) {
+		cost[s] = ns_per_step( solvers[s].solver, timestep_us / 1000.0f, n_steps );
+		if( solvers[s].solver == izh_rk2_midpoint )
+			baseline_ns = cost[s];
+		}
+
+	// the reference does not depend on the solver
+	spike_train_t	reference[izh_n_reference_currents];
+
+	for( uint32_t c = 0; c < izh_n_reference_currents; c++ )
+		reference[c] = izh_reference_train( izh_reference_currents[c], duration_ms );
+
+	printf( "timestep %u us, %.0f ms per current, %u currents\n", timestep_us, duration_ms,
+			izh_n_reference_currents );
+	printf( "%-18s %10s %8s %12s %16s\n", "solver", "ns/step", "vs rk2", "rate err", "spike time err" );
+
+	for( uint32_t s = 0; s < n_solvers; s++ ) {
+		double rate_error = 0.0, time_error = 0.0;
+
+		izh_ode_step = solvers[s].solver;
+
+		for( uint32_t c = 0; c < izh_n_reference_currents; c++ ) {
+			spike_train_t model = izh_model_train( izh_reference_currents[c], duration_ms, timestep_us );
+
+			rate_error += fabs( (double) model.n_spikes - reference[c].n_spikes ) / reference[c].n_spikes;
+			time_error += izh_spike_time_error( &reference[c], &model );
+			}
+
+		printf( "%-18s %10.2f %7.2fx %11.1f%% %13.3f ms\n", solvers[s].name, cost[s], cost[s] / baseline_ns,
+				100.0 * rate_error / izh_n_reference_currents, time_error / izh_n_reference_currents );
+		}
+
+	return 0;
+}
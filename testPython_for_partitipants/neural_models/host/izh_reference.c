@@ -0,0 +1,105 @@
+/*
+	High-precision reference spike trains for the host benchmarks, and the
+	matching run of the model under test.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "izh_curr_stochastic.h"
+#include "izh_reference.h"
+
+
+#define REFERENCE_STEP_MS		0.001
+
+const double	izh_reference_currents[] = { 4.0, 5.0, 7.0, 10.0, 14.0, 20.0, 30.0 };
+const uint32_t	izh_n_reference_currents = sizeof( izh_reference_currents ) / sizeof( izh_reference_currents[0] );
+
+// regular-spiking parameters used by the workshop examples
+static const double		A = 0.02, B = 0.2, C = -65.0, D = 2.0, V0 = -70.0, U0 = -14.0;
+
+
+static void reference_derivatives( double v, double u, double i, double* dv, double* du )
+{
+	*dv = 0.04 * v * v + 5.0 * v + 140.0 - u + i;
+	*du = A * ( B * v - u );
+}
+
+
+spike_train_t izh_reference_train( double current, double duration_ms )
+{
+	spike_train_t	train = { 0, { 0 } };
+	double			v = V0, u = U0, h = REFERENCE_STEP_MS;
+	uint64_t		n_steps = (uint64_t)( duration_ms / h );
+
+	for( uint64_t step = 0; step < n_steps; step++ ) {
+		double k1v, k1u, k2v, k2u, k3v, k3u, k4v, k4u;
+
+		reference_derivatives( v, u, current, &k1v, &k1u );
+		reference_derivatives( v + 0.5 * h * k1v, u + 0.5 * h * k1u, current, &k2v, &k2u );
+		reference_derivatives( v + 0.5 * h * k2v, u + 0.5 * h * k2u, current, &k3v, &k3u );
+		reference_derivatives( v + h * k3v, u + h * k3u, current, &k4v, &k4u );
+
+		double next_v = v + h / 6.0 * ( k1v + 2.0 * k2v + 2.0 * k3v + k4v );
+		double next_u = u + h / 6.0 * ( k1u + 2.0 * k2u + 2.0 * k3u + k4u );
+
+		if( next_v >= 30.0 ) {
+			double fraction = ( 30.0 - v ) / ( next_v - v );
+
+			if( train.n_spikes < N_TIMED_SPIKES )
+				train.spike_times[train.n_spikes] = ( step + fraction ) * h;
+			train.n_spikes++;
+			next_u = u + fraction * ( next_u - u ) + D;
+			next_v = C;
+			}
+		v = next_v;
+		u = next_u;
+		}
+
+	return train;
+}
+
+
+// spike time is the end of the tick, or the interpolated offset when the build has one
+spike_train_t izh_model_train( double current, double duration_ms, uint16_t timestep_us )
+{
+	spike_train_t	train = { 0, { 0 } };
+	struct neuron_t	n;
+	double			h = timestep_us / 1000.0;
+	uint64_t		n_ticks = (uint64_t)( duration_ms / h );
+
+	memset( &n, 0, sizeof( n ) );
+	n.A = A; n.B = B; n.C = C; n.D = D; n.V = V0; n.U = U0;
+	n.I_offset = current;
+	n.this_h = h;
+
+	for( uint64_t tick = 0; tick < n_ticks; tick++ )
+		if( neuron_state_update( 0.0f, 0.0f, 0.0f, &n ) ) {
+			if( train.n_spikes < N_TIMED_SPIKES ) {
+#ifdef IZH_SIMPLE_TQ_OFFSET
+				train.spike_times[train.n_spikes] = ( tick + 1 ) * h;
+#else
+				train.spike_times[train.n_spikes] = ( tick + n.spike_offset ) * h;
+#endif
+				}
+			train.n_spikes++;
+			}
+
+	return train;
+}
+
+
+double izh_spike_time_error( const spike_train_t* reference, const spike_train_t* model )
+{
+	uint32_t	n_common = reference->n_spikes < model->n_spikes ? reference->n_spikes : model->n_spikes;
+	double		error = 0.0;
+
+	if( n_common > N_TIMED_SPIKES )
+		n_common = N_TIMED_SPIKES;
+	for( uint32_t s = 0; s < n_common; s++ )
+		error += fabs( model->spike_times[s] - reference->spike_times[s] );
+
+	return n_common > 0 ? error / n_common : 0.0;
+}
@@ -0,0 +1,32 @@
+/*
+	High-precision reference spike trains for the host benchmarks, and the
+	matching run of the model under test.
+*/
+
+#ifndef _IZH_REFERENCE_
+#define _IZH_REFERENCE_
+
+#include <stdint.h>
+
+
+#define N_TIMED_SPIKES			10
+
+typedef struct {
+	uint32_t	n_spikes;
+	double		spike_times[N_TIMED_SPIKES];	// first spikes only [ms]
+} spike_train_t;
+
+// constant currents [nA] swept by the benchmarks
+extern const double		izh_reference_currents[];
+extern const uint32_t	izh_n_reference_currents;
+
+// double precision RK4 at 1 us, crossing located within the step
+spike_train_t izh_reference_train( double current, double duration_ms );
+
+// deterministic neuron driven through neuron_state_update()
+spike_train_t izh_model_train( double current, double duration_ms, uint16_t timestep_us );
+
+// mean absolute spike time error over the first spikes both trains have [ms]
+double izh_spike_time_error( const spike_train_t* reference, const spike_train_t* model );
+
+#endif   // include guard
@@ -0,0 +1,70 @@
+/*
+	Spike-timing accuracy of the izh_curr_stochastic update at a given
+	machine timestep.
+
+	Drives single deterministic neurons with a sweep of constant currents and
+	compares the firing rate and the time of the first ten spikes with the
+	double precision reference of izh_reference.c.  Build once as
+	izh_spike_timing (threshold interpolation) and once as
+	izh_spike_timing_tq (-DIZH_SIMPLE_TQ_OFFSET) to compare the two reset
+	schemes.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "izh_curr_stochastic.h"
+#include "izh_reference.h"
+
+
+int main( int argc, char* argv[] )
+{
+	uint16_t	timestep_us = 1000;
+	double		duration_ms = 1000.0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--timestep" ) && i + 1 < argc )
+			timestep_us = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--duration" ) && i + 1 < argc )
+			duration_ms = strtod( argv[++i], NULL );
+		else {
+			fprintf( stderr, "usage: %s [--timestep us] [--duration ms]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	provide_machine_timestep( timestep_us );
+
+#ifdef IZH_SIMPLE_TQ_OFFSET
+	printf( "reset: SIMPLE_TQ_OFFSET, timestep %u us, %.0f ms\n", timestep_us, duration_ms );
+#else
+	printf( "reset: threshold interpolation, timestep %u us, %.0f ms\n", timestep_us, duration_ms );
+#endif
+	printf( "%8s %10s %10s %10s %16s\n", "I [nA]", "ref [Hz]", "model [Hz]", "rate err", "spike time err" );
+
+	double total_rate_error = 0.0;
+
+	for( uint32_t c = 0; c < izh_n_reference_currents; c++ ) {
+		double current = izh_reference_currents[c];
+		spike_train_t reference = izh_reference_train( current, duration_ms );
+		spike_train_t model = izh_model_train( current, duration_ms, timestep_us );
+
+		double reference_rate = reference.n_spikes * 1000.0 / duration_ms;
+		double model_rate = model.n_spikes * 1000.0 / duration_ms;
+		double rate_error = reference_rate > 0.0 ? fabs( model_rate - reference_rate ) / reference_rate : 0.0;
+
+		double time_error = izh_spike_time_error( &reference, &model );
+
+		total_rate_error += rate_error;
+		printf( "%8.1f %10.1f %10.1f %9.1f%% %13.3f ms\n", current, reference_rate, model_rate,
+				100.0 * rate_error, time_error );
+		}
+
+	printf( "mean rate error %.1f%%\n", 100.0 * total_rate_error / izh_n_reference_currents );
+
+	return 0;
+}
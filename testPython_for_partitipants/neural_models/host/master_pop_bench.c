@@ -0,0 +1,285 @@
+/*
+	Lookup cost of the master population table against the number of
+	incoming projections.
+
+	For 1 to 1000 projections from distinct source cores of an 8 x 8
+	machine (PyNN keys, 2048 keys per core) the same spike stream is
+	looked up with
+
+		linear		a scan of the sorted entries
+		2dArray		the direct ( x, y, p ) index of the 2dArray generator,
+					which only works for PyNN keys on small machines
+		binary		binary search of the sorted entries
+		eytzinger	master_population_table_search (../master_population_table.h)
+		cached		master_population_table_find, through the cache
+
+	Nine spikes in ten come from a source in the table.  The stream is
+	either uniform, a new source for every spike, or in bursts of eight
+	spikes from one source, as when several neurons of a population fire
+	in the same tick.  Every method must find the same entries.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "master_population_table.h"
+
+
+#define MACHINE_SIDE		8
+#define CORES_PER_CHIP		18
+#define N_SOURCES			( MACHINE_SIDE * MACHINE_SIDE * 16 )
+#define PYNN_KEY( x, y, p )	( ( ( x ) << 24 ) | ( ( y ) << 16 ) | ( ( p ) << 11 ) )
+#define PYNN_MASK			0xFFFFF800
+#define ROW_LENGTH			35
+#define BURST				8
+
+static const uint32_t	projection_counts[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static uint32_t source_key( uint32_t source )
+{
+	uint32_t chip = source / 16;
+
+	return PYNN_KEY( chip / MACHINE_SIDE, chip % MACHINE_SIDE, 1 + source % 16 );
+}
+
+
+static int compare_entries( const void* a, const void* b )
+{
+	uint32_t s = ( (const master_population_entry_t*) a )->key, t = ( (const master_population_entry_t*) b )->key;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+// lookups return the sorted index + 1, so every method can be compared
+static uint32_t linear_lookup( const master_population_entry_t* sorted, uint32_t n, uint32_t key )
+{
+	for( uint32_t i = 0; i < n; i++ )
+		if( ( key & sorted[i].mask ) == sorted[i].key )
+			return i + 1;
+	return 0;
+}
+
+
+static uint32_t binary_lookup( const master_population_entry_t* sorted, uint32_t n, uint32_t key )
+{
+	uint32_t low = 0, high = n;
+
+	while( low < high ) {
+		uint32_t middle = ( low + high ) / 2;
+
+		if( ( sorted[middle].key | ~sorted[middle].mask ) < key )
+			low = middle + 1;
+		else
+			high = middle;
+		}
+	return low < n && ( key & sorted[low].mask ) == sorted[low].key ? low + 1 : 0;
+}
+
+
+static inline uint32_t two_d_array_lookup( const uint16_t* array, uint32_t key )
+{
+	uint32_t x = key >> 24, y = ( key >> 16 ) & 0xFF, p = ( key >> 11 ) & 0x1F;
+
+	if( x >= MACHINE_SIDE || y >= MACHINE_SIDE || p >= CORES_PER_CHIP )
+		return 0;
+	return array[( x * MACHINE_SIDE + y ) * CORES_PER_CHIP + p];
+}
+
+
+typedef enum { LINEAR, TWO_D_ARRAY, BINARY, EYTZINGER, CACHED, N_METHODS } method_t;
+
+static const char*		method_names[] = { "linear", "2dArray", "binary", "eytzinger", "cached" };
+
+
+typedef struct {
+	const master_population_entry_t*	sorted;
+	uint32_t							n;
+	const uint16_t*						array;
+	master_population_table_t*			table;
+	const uint32_t*						tree_to_sorted;
+} lookup_context_t;
+
+
+static uint32_t run( method_t method, const lookup_context_t* c, const uint32_t* keys, uint32_t n_keys,
+					 double* ns )
+{
+	uint32_t checksum = 0;
+	double start = now_ns();
+
+	switch( method ) {
+	case LINEAR:
+		for( uint32_t k = 0; k < n_keys; k++ )
+			checksum += linear_lookup( c->sorted, c->n, keys[k] );
+		break;
+	case TWO_D_ARRAY:
+		for( uint32_t k = 0; k < n_keys; k++ )
+			checksum += two_d_array_lookup( c->array, keys[k] );
+		break;
+	case BINARY:
+		for( uint32_t k = 0; k < n_keys; k++ )
+			checksum += binary_lookup( c->sorted, c->n, keys[k] );
+		break;
+	case EYTZINGER:
+		for( uint32_t k = 0; k < n_keys; k++ )
+			checksum += c->tree_to_sorted[master_population_table_search( c->table, keys[k] )];
+		break;
+	case CACHED:
+		for( uint32_t k = 0; k < n_keys; k++ )
+			checksum += c->tree_to_sorted[master_population_table_find( c->table, keys[k] )];
+		break;
+	default:
+		break;
+		}
+
+	*ns = ( now_ns() - start ) / n_keys;
+	return checksum;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t n_keys = 1000000, repeats = 5;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--keys" ) && i + 1 < argc )
+			n_keys = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--repeats" ) && i + 1 < argc )
+			repeats = strtoul( argv[++i], NULL, 0 );
+		else {
+			fprintf( stderr, "usage: %s [--keys N] [--repeats R]\n", argv[0] );
+			return 1;
+			}
+		}
+	if( n_keys == 0 || repeats == 0 )
+		return 1;
+
+	uint32_t* region = malloc( ( 1 + 4 * MASTER_POP_MAX_ENTRIES ) * sizeof( uint32_t ) );
+	master_population_entry_t* memory = malloc( ( MASTER_POP_MAX_ENTRIES + 1 ) * sizeof( master_population_entry_t ) );
+	uint16_t* array = malloc( MACHINE_SIDE * MACHINE_SIDE * CORES_PER_CHIP * sizeof( uint16_t ) );
+	uint32_t* tree_to_sorted = malloc( ( MASTER_POP_MAX_ENTRIES + 1 ) * sizeof( uint32_t ) );
+	uint32_t* keys = malloc( n_keys * sizeof( uint32_t ) );
+	uint32_t* sources = malloc( N_SOURCES * sizeof( uint32_t ) );
+	uint32_t n_mismatches = 0;
+
+	printf( "ns per lookup, %u lookups, best of %u\n", n_keys, repeats );
+	printf( "%6s %7s", "proj", "stream" );
+	for( uint32_t m = 0; m < N_METHODS; m++ )
+		printf( " %10s", method_names[m] );
+	printf( " %9s\n", "cache hit" );
+
+	for( uint32_t c = 0; c < sizeof( projection_counts ) / sizeof( projection_counts[0] ); c++ ) {
+		uint32_t n = projection_counts[c];
+		master_population_entry_t* sorted = (master_population_entry_t*) &region[1];
+		master_population_table_t table;
+
+		// n distinct sources: a partial Fisher-Yates shuffle
+		for( uint32_t s = 0; s < N_SOURCES; s++ )
+			sources[s] = s;
+		for( uint32_t s = 0; s < n; s++ ) {
+			uint32_t other = s + next_random() % ( N_SOURCES - s );
+			uint32_t t = sources[s];
+
+			sources[s] = sources[other];
+			sources[other] = t;
+			}
+
+		region[0] = n;
+		for( uint32_t s = 0; s < n; s++ ) {
+			sorted[s].key = source_key( sources[s] );
+			sorted[s].mask = PYNN_MASK;
+			sorted[s].row_length = ROW_LENGTH;
+			}
+		qsort( sorted, n, sizeof( master_population_entry_t ), compare_entries );
+		for( uint32_t s = 0; s < n; s++ )
+			sorted[s].row_offset = s * 2048 * ROW_LENGTH;
+
+		if( !master_population_table_initialise( region, memory, &table ) ) {
+			fprintf( stderr, "table of %u entries rejected\n", n );
+			return 1;
+			}
+
+		memset( array, 0, MACHINE_SIDE * MACHINE_SIDE * CORES_PER_CHIP * sizeof( uint16_t ) );
+		for( uint32_t s = 0; s < n; s++ )
+			array[( ( sorted[s].key >> 24 ) * MACHINE_SIDE + ( ( sorted[s].key >> 16 ) & 0xFF ) ) * CORES_PER_CHIP
+				  + ( ( sorted[s].key >> 11 ) & 0x1F )] = s + 1;
+
+		tree_to_sorted[MASTER_POP_NO_ENTRY] = 0;
+		for( uint32_t i = 1; i <= n; i++ )
+			tree_to_sorted[i] = binary_lookup( sorted, n, memory[i].key );
+
+		lookup_context_t context = { sorted, n, array, &table, tree_to_sorted };
+
+		for( uint32_t burst = 1; burst <= BURST; burst += BURST - 1 ) {
+			uint32_t source = 0;
+
+			for( uint32_t k = 0; k < n_keys; k++ ) {
+				if( k % burst == 0 )
+					source = next_random() % 10 ? sources[next_random() % n] : sources[n + next_random() % ( N_SOURCES - n )];
+				keys[k] = source_key( source ) | ( next_random() & 0x7FF );
+				}
+
+			printf( "%6u %7s", n, burst == 1 ? "uniform" : "bursts" );
+
+			uint32_t expected = 0;
+
+			for( uint32_t m = 0; m < N_METHODS; m++ ) {
+				double best = 1e30, ns;
+				uint32_t checksum = 0;
+
+				// the linear scan of a large table needs fewer keys to time
+				uint32_t n_timed = m == LINEAR && n > 100 ? n_keys / 10 : n_keys;
+
+				for( uint32_t r = 0; r < repeats; r++ ) {
+					checksum = run( m, &context, keys, n_timed, &ns );
+					if( ns < best )
+						best = ns;
+					}
+				if( m == LINEAR )
+					expected = run( m, &context, keys, n_keys, &ns );
+				else if( checksum != expected )
+					n_mismatches++;
+				printf( " %10.2f", best );
+				}
+			printf( " %8.1f%%\n", 100.0 * table.n_cache_hits / table.n_lookups );
+			table.n_cache_hits = table.n_lookups = 0;
+			}
+		}
+
+	if( n_mismatches )
+		printf( "%u lookup methods disagree with the linear scan\n", n_mismatches );
+
+	free( region );
+	free( memory );
+	free( array );
+	free( tree_to_sorted );
+	free( keys );
+	free( sources );
+
+	return n_mismatches ? 1 : 0;
+}
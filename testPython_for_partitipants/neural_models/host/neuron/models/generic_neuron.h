@@ -0,0 +1,47 @@
+/*! \file
+ *
+ *  \brief Host-side stand-in for the sPyNNaker generic neuron interface.
+ *
+ *  \details Lets the neuron model sources in ../ be compiled with the
+ *    native compiler (-DDEBUG_ON_HOST -DFLOATING_POINT) so that the
+ *    update kernel can be timed and checked on a workstation.  REAL is a
+ *    float here, exactly as it is for FLOATING_POINT builds of
+ *    neural_modelling.
+ *
+ */
+
+#ifndef _GENERIC_NEURON_H_
+#define _GENERIC_NEURON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef FLOATING_POINT
+#error "host builds of the neuron model need -DFLOATING_POINT"
+#endif
+
+typedef float REAL;
+
+#define REAL_CONST(x)			((REAL)(x))
+#define REAL_HALF(x)			((x) * 0.5f)
+#define REAL_COMPARE(x, op, y)	((x) op (y))
+
+typedef struct neuron_t* neuron_pointer_t;
+
+#define spin1_malloc			malloc
+#define io_printf				fprintf
+#define IO_BUF					stderr
+#define WHERE_TO				stderr
+
+// the model interface called by the (board-side) neuron.c main loop
+bool neuron_state_update( REAL exc_input, REAL inh_input, REAL external_bias,
+						  neuron_pointer_t neuron );
+REAL neuron_get_exc_input( REAL exc_input );
+REAL neuron_get_inh_input( REAL inh_input );
+void provide_machine_timestep( uint16_t microsecs );
+void neuron_print( neuron_pointer_t neuron );
+void neuron_get_info( uint8_t *num_state_vars, uint16_t *struct_size );
+
+#endif   // include guard
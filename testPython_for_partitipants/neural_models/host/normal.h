@@ -0,0 +1,20 @@
+/*! \file
+ *
+ *  \brief Host-side stand-in for the inverse-normal transform used by the
+ *    stochastic neuron models.
+ *
+ */
+
+#ifndef __NORMAL_H__
+#define __NORMAL_H__
+
+#include "neuron/models/generic_neuron.h"
+
+//! \brief Converts a uniform 32-bit random number into a standard Gaussian
+//! deviate by inverting the normal CDF.
+//! \param[in] uniform An unsigned 32-bit uniform random number.
+//! \return A standard normal deviate.
+
+REAL norminv_urb( uint32_t uniform );
+
+#endif /*__NORMAL_H__*/
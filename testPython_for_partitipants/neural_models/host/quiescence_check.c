@@ -0,0 +1,110 @@
+/*
+	Checks that NEURON_QUIESCENCE_ENABLED only skips neurons that would not
+	have moved: each neuron is run with quiescence off and on, from the
+	state the population vertex writes, and the two must fire the same
+	spikes and end within a few hundredths of a mV, as an idle neuron is
+	parked within tolerance of its fixed point.  Neurons that rest under
+	their I_offset must also end up idle, or the mode saves nothing.
+
+	Every case starts both from this_h as the vertex now writes it, one
+	machine timestep, and from this_h = 0 as older vertices wrote it, whose
+	first step does not move the neuron.
+
+		quiescence_check [--ticks N]
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "izh_curr_stochastic.h"
+
+
+#define PULSE_TICK			500
+#define PULSE_NA			20.0f
+
+typedef struct {
+	const char*	name;
+	float		current;		// I_offset, nA
+	bool		pulse;			// one tick of synaptic input at PULSE_TICK
+	bool		rests;			// should end idle with quiescence on
+} check_case_t;
+
+typedef struct {
+	uint32_t	n_spikes;
+	uint32_t	first_spike;
+	float		V;
+	uint32_t	status;
+} run_t;
+
+static const check_case_t	cases[] = {
+	{ "rest at I=0",			0.0f,	false,	true },
+	{ "settle at I=3",			3.0f,	false,	true },
+	{ "tonic at I=10",			10.0f,	false,	false },
+	{ "tonic at I=4",			4.0f,	false,	false },
+	{ "pulse from rest",		0.0f,	true,	true },
+};
+
+
+// regular-spiking neuron as get_parameters writes it
+static run_t run( const check_case_t* c, REAL first_h, bool quiescence, uint32_t n_ticks )
+{
+	struct neuron_t	n;
+	run_t			r = { 0, UINT32_MAX, 0.0f, 0 };
+
+	memset( &n, 0, sizeof( n ) );
+	n.A = 0.02f; n.B = 0.2f; n.C = -65.0f; n.D = 2.0f;
+	n.V = -70.0f; n.U = -14.0f;
+	n.I_offset = c->current;
+	n.this_h = first_h;
+	n.status = quiescence ? NEURON_QUIESCENCE_ENABLED : 0;
+
+	for( uint32_t tick = 0; tick < n_ticks; tick++ ) {
+		REAL exc_input = c->pulse && tick == PULSE_TICK ? PULSE_NA : 0.0f;
+
+		if( neuron_state_update( exc_input, 0.0f, 0.0f, &n ) ) {
+			if( r.n_spikes++ == 0 )
+				r.first_spike = tick;
+			}
+		}
+	r.V = n.V;
+	r.status = n.status;
+	return r;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t	n_ticks = 1000, n_failures = 0;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			n_ticks = strtoul( argv[++i], NULL, 0 );
+		else {
+			fprintf( stderr, "usage: %s [--ticks N]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	printf( "%-18s %7s   %14s   %14s   %s\n", "", "first h", "spikes off/on", "V off/on", "idle" );
+	for( uint32_t k = 0; k < sizeof( cases ) / sizeof( cases[0] ); k++ ) {
+		const REAL	first_hs[] = { 1.0f, 0.0f };
+
+		for( uint32_t j = 0; j < 2; j++ ) {
+			run_t	off = run( &cases[k], first_hs[j], false, n_ticks );
+			run_t	on = run( &cases[k], first_hs[j], true, n_ticks );
+			bool	idle = ( on.status & NEURON_IDLE ) != 0;
+			bool	ok = off.n_spikes == on.n_spikes && off.first_spike == on.first_spike
+						 && fabsf( off.V - on.V ) < 0.05f && idle == cases[k].rests;
+
+			printf( "%-18s %7.1f   %6u %6u   %6.2f %6.2f   %-4s %s\n", cases[k].name, first_hs[j], off.n_spikes,
+					on.n_spikes, off.V, on.V, idle ? "yes" : "no", ok ? "" : "FAILED" );
+			n_failures += !ok;
+			}
+		}
+
+	return n_failures ? 1 : 0;
+}
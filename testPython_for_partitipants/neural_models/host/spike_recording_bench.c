@@ -0,0 +1,193 @@
+/*
+	Size and speed of the adaptive spike recording (../spike_recording.h)
+	against a bit field every tick, the recording it replaces.
+
+	Each population is run for --ticks ticks of 1 ms with every neuron
+	firing as a Poisson process at 0 (silent) to 200 Hz, plus the
+	io/synfire_if_curr_exp.py pattern: a ring of 200 neurons passing a
+	single spike on every 17 ticks.  Every recording is decoded again and
+	must give back the same spikes.
+
+		spike_recording_bench [--ticks N] [--write FILE]
+
+	--write saves the 100 neuron, 10 Hz region, for checking
+	izh_curr_stochastic/spike_recording.py decode against it.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "spike_recording.h"
+
+
+#define SYNFIRE_NEURONS		200
+#define SYNFIRE_DELAY		17
+#define SYNFIRE_RATE		-1
+
+static const uint32_t	neuron_counts[] = { 100, 256, 1024 };
+static const int		rates[] = { 0, 1, 10, 50, 200, SYNFIRE_RATE };
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+// every tick's bit field, one after another
+static void generate( uint32_t* spikes, uint32_t n_neurons, uint32_t n_words, int rate, uint32_t n_ticks )
+{
+	// spike probability per 1 ms tick, against the top of a random word
+	uint32_t threshold = (uint32_t) ( rate / 1000.0 * 4294967296.0 );
+
+	memset( spikes, 0, n_ticks * n_words * sizeof( uint32_t ) );
+	for( uint32_t t = 0; t < n_ticks; t++ ) {
+		bit_field_t field = spikes + t * n_words;
+
+		if( rate == SYNFIRE_RATE ) {
+			if( t % SYNFIRE_DELAY == 0 )
+				bit_field_set( field, ( t / SYNFIRE_DELAY ) % n_neurons );
+			}
+		else if( rate > 0 )
+			for( uint32_t n = 0; n < n_neurons; n++ )
+				if( next_random() < threshold )
+					bit_field_set( field, n );
+		}
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t n_ticks = 5000;
+	const char* write_path = NULL;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			n_ticks = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--write" ) && i + 1 < argc )
+			write_path = argv[++i];
+		else {
+			fprintf( stderr, "usage: %s [--ticks N] [--write FILE]\n", argv[0] );
+			return 1;
+			}
+		}
+	if( n_ticks == 0 )
+		return 1;
+
+	uint32_t max_words = get_bit_field_size( neuron_counts[sizeof( neuron_counts ) / sizeof( neuron_counts[0] ) - 1] );
+	uint32_t region_words = SPIKE_RECORDING_HEADER_WORDS + n_ticks * ( 1 + max_words );
+	uint32_t* spikes = malloc( n_ticks * max_words * sizeof( uint32_t ) );
+	uint32_t* region = malloc( region_words * sizeof( uint32_t ) );
+	uint16_t* neurons = malloc( 0x10000 * sizeof( uint16_t ) );
+	uint32_t n_failures = 0;
+
+	printf( "%u ticks of 1 ms\n", n_ticks );
+	printf( "%7s %8s %9s %11s %11s %7s %8s %8s %8s %11s %11s\n", "neurons", "rate", "spikes", "bit fields",
+			"adaptive", "ratio", "empty", "sparse", "dense", "ns/record", "ns/decode" );
+
+	for( uint32_t c = 0; c < sizeof( neuron_counts ) / sizeof( neuron_counts[0] ); c++ )
+		for( uint32_t r = 0; r < sizeof( rates ) / sizeof( rates[0] ); r++ ) {
+			int rate = rates[r];
+			uint32_t n_neurons = rate == SYNFIRE_RATE ? SYNFIRE_NEURONS : neuron_counts[c];
+			uint32_t n_words = get_bit_field_size( n_neurons );
+			spike_recording_t recording;
+			spike_recording_reader_t reader;
+			uint32_t n_spikes = 0, tick, n_read, n_ticks_read = 0;
+
+			// the synfire ring has its own size
+			if( rate == SYNFIRE_RATE && c > 0 )
+				continue;
+
+			generate( spikes, n_neurons, n_words, rate, n_ticks );
+
+			double start = now_ns();
+
+			spike_recording_initialise( &recording, region, region_words, n_neurons );
+			for( uint32_t t = 0; t < n_ticks; t++ )
+				spike_recording_record( &recording, spikes + t * n_words );
+			spike_recording_finish( &recording );
+
+			double record_ns = ( now_ns() - start ) / n_ticks;
+
+			start = now_ns();
+			spike_recording_reader_initialise( &reader, region );
+			while( spike_recording_read_tick( &reader, &tick, neurons, &n_read ) ) {
+				n_spikes += n_read;
+				n_ticks_read++;
+				}
+
+			double decode_ns = ( now_ns() - start ) / n_ticks;
+
+			// and again, against the bit fields
+			spike_recording_reader_initialise( &reader, region );
+			while( spike_recording_read_tick( &reader, &tick, neurons, &n_read ) ) {
+				bit_field_t field = spikes + tick * n_words;
+				bool same = n_read == count_bit_field( field, n_words );
+
+				for( uint32_t s = 0; s < n_read && same; s++ )
+					same = ( s == 0 || neurons[s] > neurons[s - 1] ) && bit_field_test( field, neurons[s] );
+				if( !same ) {
+					fprintf( stderr, "%u neurons, rate %d: tick %u decodes wrongly\n", n_neurons, rate, tick );
+					n_failures++;
+					break;
+					}
+				}
+			if( n_ticks_read != n_ticks || recording.n_dropped > 0 ) {
+				fprintf( stderr, "%u neurons, rate %d: %u of %u ticks decoded\n", n_neurons, rate, n_ticks_read,
+						 n_ticks );
+				n_failures++;
+				}
+
+			uint32_t bit_field_bytes = n_ticks * n_words * sizeof( uint32_t );
+			uint32_t adaptive_bytes = ( SPIKE_RECORDING_HEADER_WORDS + recording.used ) * sizeof( uint32_t );
+			char rate_name[16];
+
+			if( rate == SYNFIRE_RATE )
+				snprintf( rate_name, sizeof( rate_name ), "synfire" );
+			else
+				snprintf( rate_name, sizeof( rate_name ), "%d Hz", rate );
+			printf( "%7u %8s %9u %11u %11u %6.1fx %8u %8u %8u %11.1f %11.1f\n", n_neurons, rate_name, n_spikes,
+					bit_field_bytes, adaptive_bytes, (double) bit_field_bytes / adaptive_bytes,
+					recording.n_records[SPIKE_RECORD_EMPTY], recording.n_records[SPIKE_RECORD_SPARSE],
+					recording.n_records[SPIKE_RECORD_DENSE], record_ns, decode_ns );
+
+			if( write_path != NULL && n_neurons == 100 && rate == 10 ) {
+				FILE* f = fopen( write_path, "wb" );
+
+				if( f == NULL || fwrite( region, sizeof( uint32_t ), SPIKE_RECORDING_HEADER_WORDS + recording.used, f )
+								 != SPIKE_RECORDING_HEADER_WORDS + recording.used ) {
+					fprintf( stderr, "cannot write %s\n", write_path );
+					n_failures++;
+					}
+				if( f != NULL )
+					fclose( f );
+				}
+			}
+
+	if( n_failures )
+		printf( "%u recordings do not decode to their spikes\n", n_failures );
+
+	free( spikes );
+	free( region );
+	free( neurons );
+
+	return n_failures ? 1 : 0;
+}
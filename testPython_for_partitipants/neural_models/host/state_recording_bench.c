@@ -0,0 +1,254 @@
+/*
+	Compression and error of the quantized delta recording
+	(../state_recording.h) on the V and gsyn traces of the synfire examples.
+
+	The examples are simulated here, as sPyNNaker's IF_curr_exp with the
+	cell parameters of io/synfire_if_curr_exp.py: a ring of 200 neurons,
+	each exciting the next with 2 nA after 17 ms, started by one spike
+	into neuron 0, for 400 ms; and io/synfire_if_curr_exp_random.py, the
+	same ring with delays drawn from 1 to 50 ms, for 10 s.  V (mV) and the
+	excitatory gsyn (nA) are recorded as s16.15, as record_v() and
+	record_gsyn() do now, then with 8, 12 and 16 bit changes, every tick
+	and every 4th tick.
+
+	The step is chosen from the trace, as from a short pilot run: the
+	smallest whose largest change fits the 99th percentile of the nonzero
+	changes, the rest being escaped.  Error is against the true value at
+	the recorded ticks.
+
+		state_recording_bench [--keyframes N] [--write PREFIX]
+
+	--write saves the 12 bit every tick V region of the random example as
+	PREFIX.bin and its true values, s16.15 per tick then neuron, as
+	PREFIX.raw, for checking izh_curr_stochastic/state_recording.py.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "state_recording.h"
+
+
+#define N_NEURONS		200
+#define MAX_DELAY		64
+#define CM				0.25
+#define TAU_M			20.0
+#define TAU_REFRAC		2
+#define TAU_SYN			5.0
+#define V_RESET			-70.0
+#define V_REST			-65.0
+#define V_THRESH		-50.0
+#define WEIGHT			2.0
+#define S1615( x )		( (int32_t) lrint( ( x ) * 32768.0 ) )
+
+static const uint32_t	depths[] = { 8, 12, 16 };
+static const uint32_t	subsamples[] = { 1, 4 };
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+// V and gsyn, s16.15, per tick then neuron
+static void simulate( uint32_t max_delay, uint32_t n_ticks, int32_t* v_trace, int32_t* gsyn_trace )
+{
+	double v[N_NEURONS], gsyn[N_NEURONS], input[MAX_DELAY][N_NEURONS];
+	uint32_t refractory[N_NEURONS], delays[N_NEURONS];
+	double synapse_decay = exp( -1.0 / TAU_SYN ), membrane_decay = exp( -1.0 / TAU_M );
+
+	memset( input, 0, sizeof( input ) );
+	for( uint32_t n = 0; n < N_NEURONS; n++ ) {
+		v[n] = V_REST;
+		gsyn[n] = 0.0;
+		refractory[n] = 0;
+		delays[n] = max_delay == 0 ? 17 : 1 + next_random() % max_delay;
+		}
+	// the spike source fires at 0 ms into neuron 0, 1 ms later
+	input[1][0] = WEIGHT;
+
+	for( uint32_t t = 0; t < n_ticks; t++ ) {
+		double* arriving = input[t % MAX_DELAY];
+
+		for( uint32_t n = 0; n < N_NEURONS; n++ ) {
+			gsyn[n] = gsyn[n] * synapse_decay + arriving[n];
+			arriving[n] = 0.0;
+
+			if( refractory[n] > 0 )
+				refractory[n]--;
+			else {
+				double v_inf = V_REST + gsyn[n] * TAU_M / CM;
+
+				v[n] = v_inf + ( v[n] - v_inf ) * membrane_decay;
+				if( v[n] >= V_THRESH ) {
+					v[n] = V_RESET;
+					refractory[n] = TAU_REFRAC;
+					input[( t + delays[n] ) % MAX_DELAY][( n + 1 ) % N_NEURONS] += WEIGHT;
+					}
+				}
+
+			v_trace[t * N_NEURONS + n] = S1615( v[n] );
+			gsyn_trace[t * N_NEURONS + n] = S1615( gsyn[n] );
+			}
+		}
+}
+
+
+static int compare_magnitudes( const void* a, const void* b )
+{
+	uint32_t s = *(const uint32_t*) a, t = *(const uint32_t*) b;
+
+	return ( s > t ) - ( s < t );
+}
+
+
+static uint32_t choose_shift( const int32_t* trace, uint32_t n_ticks, uint32_t subsample, uint32_t bits,
+							  uint32_t* scratch )
+{
+	uint32_t n_changes = 0, limit = ( 1 << ( bits - 1 ) ) - 1, shift = 0;
+
+	for( uint32_t t = subsample; t < n_ticks; t += subsample )
+		for( uint32_t n = 0; n < N_NEURONS; n++ ) {
+			int32_t change = trace[t * N_NEURONS + n] - trace[( t - subsample ) * N_NEURONS + n];
+
+			if( change != 0 )
+				scratch[n_changes++] = change < 0 ? -change : change;
+			}
+	if( n_changes == 0 )
+		return 0;
+
+	qsort( scratch, n_changes, sizeof( uint32_t ), compare_magnitudes );
+
+	uint32_t typical = scratch[n_changes * 99 / 100];
+
+	while( shift < 16 && ( (uint64_t) limit << shift ) < typical )
+		shift++;
+	return shift;
+}
+
+
+static bool write_file( const char* path, const void* data, size_t bytes )
+{
+	FILE* f = fopen( path, "wb" );
+	bool written = f != NULL && fwrite( data, 1, bytes, f ) == bytes;
+
+	if( f != NULL )
+		fclose( f );
+	if( !written )
+		fprintf( stderr, "cannot write %s\n", path );
+	return written;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t keyframe_interval = 64;
+	const char* write_prefix = NULL;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--keyframes" ) && i + 1 < argc )
+			keyframe_interval = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--write" ) && i + 1 < argc )
+			write_prefix = argv[++i];
+		else {
+			fprintf( stderr, "usage: %s [--keyframes N] [--write PREFIX]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	struct { const char* name; uint32_t max_delay, n_ticks; } examples[] = {
+		{ "synfire", 0, 400 }, { "random", 50, 50 * N_NEURONS } };
+	uint32_t max_ticks = 50 * N_NEURONS;
+	uint32_t region_words = STATE_RECORDING_HEADER_WORDS + max_ticks * ( 1 + 2 * N_NEURONS );
+	int32_t* traces[2] = { malloc( max_ticks * N_NEURONS * sizeof( int32_t ) ),
+						   malloc( max_ticks * N_NEURONS * sizeof( int32_t ) ) };
+	uint32_t* region = malloc( region_words * sizeof( uint32_t ) );
+	uint32_t* scratch = malloc( max_ticks * N_NEURONS * sizeof( uint32_t ) );
+	int32_t rebuilt[N_NEURONS], values[N_NEURONS];
+	const char* signals[2] = { "V mV", "gsyn nA" };
+	uint32_t n_failures = 0;
+
+	printf( "keyframe every %u records; size against s16.15 every tick\n", keyframe_interval );
+	printf( "%8s %8s %5s %6s %6s %8s %9s %11s %11s\n", "example", "signal", "bits", "every", "shift", "ratio",
+			"escaped", "max error", "rms error" );
+
+	for( uint32_t e = 0; e < 2; e++ ) {
+		uint32_t n_ticks = examples[e].n_ticks;
+
+		simulate( examples[e].max_delay, n_ticks, traces[0], traces[1] );
+
+		for( uint32_t s = 0; s < 2; s++ )
+			for( uint32_t d = 0; d < sizeof( depths ) / sizeof( depths[0] ); d++ )
+				for( uint32_t u = 0; u < sizeof( subsamples ) / sizeof( subsamples[0] ); u++ ) {
+					const int32_t* trace = traces[s];
+					uint32_t bits = depths[d], subsample = subsamples[u];
+					uint32_t shift = choose_shift( trace, n_ticks, subsample, bits, scratch );
+					state_recording_t recording;
+					state_recording_reader_t reader;
+					uint32_t tick, n_records = 0;
+					double max_error = 0.0, square_error = 0.0;
+
+					state_recording_initialise( &recording, region, region_words, N_NEURONS, bits, shift,
+												subsample, keyframe_interval, rebuilt );
+					for( uint32_t t = 0; t < n_ticks; t++ )
+						state_recording_record( &recording, trace + t * N_NEURONS );
+
+					state_recording_reader_initialise( &reader, region );
+					while( state_recording_read( &reader, &tick, values ) ) {
+						for( uint32_t n = 0; n < N_NEURONS; n++ ) {
+							double error = fabs( (double) values[n] - trace[tick * N_NEURONS + n] );
+
+							if( error > max_error )
+								max_error = error;
+							square_error += error * error;
+							}
+						n_records++;
+						}
+
+					// the error bound is half a step
+					if( n_records != ( n_ticks + subsample - 1 ) / subsample || recording.n_dropped > 0
+						|| max_error > ( shift > 0 ? 1 << ( shift - 1 ) : 0 ) ) {
+						fprintf( stderr, "%s %s %u bits: %u records, max error %.0f\n", examples[e].name, signals[s],
+								 bits, n_records, max_error );
+						n_failures++;
+						}
+
+					uint32_t raw_bytes = n_ticks * N_NEURONS * sizeof( int32_t );
+					uint32_t bytes = ( STATE_RECORDING_HEADER_WORDS + recording.used ) * sizeof( uint32_t );
+
+					printf( "%8s %8s %5u %6u %6u %7.1fx %8.2f%% %11.6f %11.6f\n", examples[e].name, signals[s], bits,
+							subsample, shift, (double) raw_bytes / bytes,
+							100.0 * recording.n_escapes / ( n_records * N_NEURONS ), max_error / 32768.0,
+							sqrt( square_error / ( n_records * N_NEURONS ) ) / 32768.0 );
+
+					if( write_prefix != NULL && e == 1 && s == 0 && bits == 12 && subsample == 1 ) {
+						char path[1024];
+
+						snprintf( path, sizeof( path ), "%s.bin", write_prefix );
+						n_failures += !write_file( path, region, bytes );
+						snprintf( path, sizeof( path ), "%s.raw", write_prefix );
+						n_failures += !write_file( path, trace, raw_bytes );
+						}
+					}
+		}
+
+	if( n_failures )
+		printf( "%u recordings do not decode within half a step\n", n_failures );
+
+	free( traces[0] );
+	free( traces[1] );
+	free( region );
+	free( scratch );
+
+	return n_failures ? 1 : 0;
+}
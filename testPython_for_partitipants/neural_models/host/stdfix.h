@@ -0,0 +1,17 @@
+/*! \file
+ *
+ *  \brief Host-side stand-in for the ISO/IEC TR 18037 <stdfix.h> header.
+ *
+ *  \details x86 gcc has no fixed-point types.  The host build only needs
+ *    the prototypes in random.h to parse, so the fixed-point keywords are
+ *    mapped onto native types of the same width.
+ *
+ */
+
+#ifndef __HOST_STDFIX_H__
+#define __HOST_STDFIX_H__
+
+#define accum	float
+#define fract	int
+
+#endif /*__HOST_STDFIX_H__*/
@@ -0,0 +1,503 @@
+/*
+	Accuracy and speed of the synaptic input ring buffers
+	(../synaptic_input.h) under ring buffer shifts chosen three ways.
+
+	A core of 256 neurons receives from 2000 Poisson sources, 80%
+	excitatory, through synapses of random delay and mostly small weights
+	(a cube of a uniform draw).  Each scenario is run with the shifts of
+
+		config		the [Simulation] rule: every source at spikes_per_second
+					(30 Hz), ring_buffer_sigma (5) SDs above the mean input
+		measured	the rate each source was measured at, and a bound that
+					allows for the tail of a few large weights
+		32-bit		measured rates and 32-bit sums, where only the largest
+					weight limits the shift
+		provenance	measured rates and the peaks the 32-bit run reported
+
+	and the drained inputs are compared, tick by tick, with the same
+	inputs summed exactly.  It reports the shifts, the saturations and
+	clipped inputs in the provenance, the weights that round to nothing,
+	and the RMS error of the inputs.  Then it times the drain against
+	converting a neuron's input at a time, and the guarded adds against
+	plain ones.
+
+		synaptic_input_bench [--ticks N] [--write FILE]
+
+	--write saves the busy scenario's synapses, measured rates and shifts,
+	for checking izh_curr_stochastic/synaptic_input.py against them.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "synaptic_input.h"
+
+
+#define N_SOURCES			2000
+#define N_NEURONS			256
+#define EXCITATORY_PERCENT	80
+#define TIME_STEP_US		1000
+#define CONFIG_RATE			30.0
+#define SIGMA				5.0
+#define MAX_DELAY			15
+
+typedef struct {
+	const char*	name;
+	double		low_rate;
+	double		high_rate;
+	uint32_t	fan_in;
+	double		max_weight;			// nA
+	uint32_t	burst_period;		// ticks; 0 for none
+	double		burst_fraction;		// of the sources, firing together
+} scenario_t;
+
+typedef struct {
+	uint32_t	n_synapses;
+	uint32_t	starts[N_SOURCES + 1];	// each source's synapses
+	uint8_t		types[N_SOURCES];
+	double		rates[N_SOURCES];		// Hz
+	uint16_t*	posts;
+	uint8_t*	delays;
+	double*		weights;				// nA
+} network_t;
+
+typedef struct {
+	uint32_t	shifts[SYNAPTIC_INPUT_TYPES];
+	uint32_t	provenance[SYNAPTIC_INPUT_PROVENANCE_WORDS];
+	uint32_t	n_lost;					// weights that round to 0
+	uint32_t	n_too_big;				// weights beyond the 16 bit field
+	double		rms_error;				// of the inputs, relative to their RMS
+} run_result_t;
+
+static const scenario_t scenarios[] = {
+	{ "quiet",  1, 5,   1000, 2.0, 0,   0 },
+	{ "busy",   60, 100, 500, 2.0, 0,   0 },
+	{ "bursty", 5, 15,   500, 2.0, 100, 0.5 } };
+
+static uint32_t rng_state = 0x6A09E667;
+
+static uint32_t next_random( void )
+{
+	// xorshift32
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+
+static double uniform( void )
+{
+	return next_random() / 4294967296.0;
+}
+
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static bool build_network( network_t* network, const scenario_t* scenario )
+{
+	uint32_t max_synapses = N_SOURCES * N_NEURONS;
+	uint32_t threshold = (uint32_t) ( (double) scenario->fan_in / N_SOURCES * 4294967295.0 );
+
+	network->posts = malloc( max_synapses * sizeof( uint16_t ) );
+	network->delays = malloc( max_synapses );
+	network->weights = malloc( max_synapses * sizeof( double ) );
+	if( network->posts == NULL || network->delays == NULL || network->weights == NULL )
+		return false;
+
+	network->n_synapses = 0;
+	for( uint32_t s = 0; s < N_SOURCES; s++ ) {
+		network->starts[s] = network->n_synapses;
+		network->types[s] = next_random() % 100 < EXCITATORY_PERCENT ? 0 : 1;
+		network->rates[s] = scenario->low_rate + ( scenario->high_rate - scenario->low_rate ) * uniform();
+		for( uint32_t j = 0; j < N_NEURONS; j++ )
+			if( next_random() < threshold ) {
+				double u = uniform();
+
+				network->posts[network->n_synapses] = j;
+				network->delays[network->n_synapses] = 1 + next_random() % MAX_DELAY;
+				network->weights[network->n_synapses++] = scenario->max_weight * u * u * u;
+				}
+		}
+	network->starts[N_SOURCES] = network->n_synapses;
+	return true;
+}
+
+
+static void free_network( network_t* network )
+{
+	free( network->posts );
+	free( network->delays );
+	free( network->weights );
+}
+
+
+// the sources that fire this tick: Poisson, and in a burst a fraction of
+// them together
+static uint32_t fire( const network_t* network, const scenario_t* scenario, uint32_t tick, uint32_t* sources )
+{
+	bool burst = scenario->burst_period > 0 && tick % scenario->burst_period == 0;
+	uint32_t n = 0;
+
+	for( uint32_t s = 0; s < N_SOURCES; s++ )
+		if( uniform() < network->rates[s] * TIME_STEP_US / 1e6 || ( burst && uniform() < scenario->burst_fraction ) )
+			sources[n++] = s;
+	return n;
+}
+
+
+// the rate each source fires at, over a run of its own
+static void measure_rates( const network_t* network, const scenario_t* scenario, uint32_t n_ticks, double* rates )
+{
+	uint32_t sources[N_SOURCES];
+	uint32_t counts[N_SOURCES] = { 0 };
+
+	rng_state = 0x3C6EF372;
+	for( uint32_t t = 0; t < n_ticks; t++ ) {
+		uint32_t n = fire( network, scenario, t, sources );
+
+		for( uint32_t k = 0; k < n; k++ )
+			counts[sources[k]]++;
+		}
+	for( uint32_t s = 0; s < N_SOURCES; s++ )
+		rates[s] = counts[s] / ( n_ticks * TIME_STEP_US / 1e6 );
+}
+
+
+// the smallest shift at which value nA fits a sum of bits bits
+static uint32_t shift_for( double value, uint32_t bits )
+{
+	double shift = ceil( 15 + log2( value / ( pow( 2, bits ) - 1 ) ) );
+
+	return value <= 0 || shift < 0 ? 0 : shift > 30 ? 30 : (uint32_t) shift;
+}
+
+
+// the input per tick that a neuron's Poisson sources exceed no more often
+// than a normal one does sigma SDs above its mean.  For many small events
+// that is mean + sigma SDs; a few large ones have a longer tail, which the
+// Bernstein bound allows for with the largest weight.  With a largest
+// weight of 0 it is the [Simulation] rule
+static double peak_input( double mean, double variance, double max_weight, double sigma )
+{
+	double skew = sigma * sigma * max_weight / 6;
+
+	return mean + skew + sqrt( skew * skew + sigma * sigma * variance );
+}
+
+
+// per type, the largest peak_input over neurons for sources at the given
+// rates, or the peak measured in a previous run if higher; and room for the
+// largest weight
+static void choose_shifts( const network_t* network, const double* rates, double sigma, bool bernstein, bool wide,
+						   const double* measured_peaks, uint32_t* shifts )
+{
+	static double means[SYNAPTIC_INPUT_TYPES][N_NEURONS], variances[SYNAPTIC_INPUT_TYPES][N_NEURONS];
+	double max_weights[SYNAPTIC_INPUT_TYPES] = { 0 };
+
+	memset( means, 0, sizeof( means ) );
+	memset( variances, 0, sizeof( variances ) );
+	for( uint32_t s = 0; s < N_SOURCES; s++ ) {
+		double p = rates[s] * TIME_STEP_US / 1e6;
+		uint32_t type = network->types[s];
+
+		for( uint32_t k = network->starts[s]; k < network->starts[s + 1]; k++ ) {
+			double w = network->weights[k];
+
+			means[type][network->posts[k]] += w * p;
+			variances[type][network->posts[k]] += w * w * p;
+			if( w > max_weights[type] )
+				max_weights[type] = w;
+			}
+		}
+
+	for( uint32_t t = 0; t < SYNAPTIC_INPUT_TYPES; t++ ) {
+		double peak = 0;
+
+		for( uint32_t j = 0; j < N_NEURONS; j++ ) {
+			double estimate = peak_input( means[t][j], variances[t][j], bernstein ? max_weights[t] : 0, sigma );
+
+			if( estimate > peak )
+				peak = estimate;
+			}
+		if( measured_peaks != NULL && measured_peaks[t] > peak )
+			peak = measured_peaks[t];
+
+		uint32_t for_sums = shift_for( peak, wide ? 32 : 16 ), for_weights = shift_for( max_weights[t], 16 );
+
+		shifts[t] = for_sums > for_weights ? for_sums : for_weights;
+		}
+}
+
+
+static bool run( const network_t* network, const scenario_t* scenario, const uint32_t* shifts, bool wide,
+				 uint32_t n_ticks, run_result_t* result )
+{
+	static double exact[SYNAPTIC_INPUT_SLOTS][SYNAPTIC_INPUT_TYPES][N_NEURONS];
+	static int32_t inputs[SYNAPTIC_INPUT_SLOT_ENTRIES];
+	static uint32_t buffer[SYNAPTIC_INPUT_ENTRIES];
+	uint32_t* words = malloc( ( network->n_synapses + 1 ) * sizeof( uint32_t ) );
+	uint32_t sources[N_SOURCES];
+	synaptic_input_t input;
+	double error = 0, total = 0;
+
+	memset( result, 0, sizeof( *result ) );
+	memcpy( result->shifts, shifts, sizeof( result->shifts ) );
+	if( words == NULL || !synaptic_input_initialise( &input, buffer, N_NEURONS, wide, shifts ) ) {
+		free( words );
+		return false;
+		}
+
+	// the weights as the host writes them, at each type's scale
+	for( uint32_t s = 0; s < N_SOURCES; s++ )
+		for( uint32_t k = network->starts[s]; k < network->starts[s + 1]; k++ ) {
+			uint32_t type = network->types[s];
+			double units = floor( ldexp( network->weights[k], 15 - shifts[type] ) + 0.5 );
+
+			result->n_lost += units == 0;
+			result->n_too_big += units > UINT16_MAX;
+			units = units > UINT16_MAX ? UINT16_MAX : units;
+			words[k] = ( (uint32_t) units << 16 )
+					   | ( network->delays[k] << ( SYNAPTIC_INPUT_INDEX_BITS + SYNAPTIC_INPUT_TYPE_BITS ) )
+					   | ( type << SYNAPTIC_INPUT_INDEX_BITS ) | network->posts[k];
+			}
+
+	memset( exact, 0, sizeof( exact ) );
+	rng_state = 0x6A09E667;
+	for( uint32_t t = 0; t < n_ticks; t++ ) {
+		uint32_t n = fire( network, scenario, t, sources );
+
+		for( uint32_t f = 0; f < n; f++ ) {
+			uint32_t s = sources[f];
+
+			for( uint32_t k = network->starts[s]; k < network->starts[s + 1]; k++ ) {
+				synaptic_input_add( &input, t, words[k] );
+				exact[( t + network->delays[k] ) & SYNAPTIC_INPUT_SLOT_MASK][network->types[s]][network->posts[k]]
+					+= network->weights[k];
+				}
+			}
+
+		synaptic_input_drain( &input, t, inputs );
+		for( uint32_t type = 0; type < SYNAPTIC_INPUT_TYPES; type++ )
+			for( uint32_t j = 0; j < N_NEURONS; j++ ) {
+				double want = exact[t & SYNAPTIC_INPUT_SLOT_MASK][type][j];
+				double got = inputs[( type << SYNAPTIC_INPUT_INDEX_BITS ) | j] / 32768.0;
+
+				error += ( got - want ) * ( got - want );
+				total += want * want;
+				exact[t & SYNAPTIC_INPUT_SLOT_MASK][type][j] = 0;
+				}
+		}
+
+	synaptic_input_provenance( &input, result->provenance );
+	result->rms_error = total > 0 ? sqrt( error / total ) : 0;
+	free( words );
+	return true;
+}
+
+
+static void print_result( const char* strategy, const run_result_t* r )
+{
+	printf( "  %-11s %3u %3u   %10u %8u   %9u %9u   %8.4f%%\n", strategy, r->shifts[0], r->shifts[1],
+			r->provenance[0] + r->provenance[3], r->provenance[1] + r->provenance[4], r->n_lost, r->n_too_big,
+			100 * r->rms_error );
+}
+
+
+static void peaks_in_na( const run_result_t* r, double* peaks )
+{
+	for( uint32_t t = 0; t < SYNAPTIC_INPUT_TYPES; t++ )
+		peaks[t] = ldexp( r->provenance[3 * t + 2], (int) r->shifts[t] - 15 );
+}
+
+
+static bool write_check_file( const char* path, const network_t* network, const double* rates,
+							  const uint32_t shifts[3][SYNAPTIC_INPUT_TYPES] )
+{
+	FILE* f = fopen( path, "wb" );
+	uint32_t header[5] = { N_SOURCES, N_NEURONS, network->n_synapses, TIME_STEP_US, (uint32_t) SIGMA };
+	bool ok = f != NULL && fwrite( header, sizeof( header ), 1, f ) == 1
+			  && fwrite( rates, sizeof( double ), N_SOURCES, f ) == N_SOURCES;
+
+	for( uint32_t s = 0; ok && s < N_SOURCES; s++ )
+		for( uint32_t k = network->starts[s]; ok && k < network->starts[s + 1]; k++ ) {
+			uint32_t fields[3] = { s, network->posts[k], network->types[s] };
+
+			ok = fwrite( fields, sizeof( fields ), 1, f ) == 1 && fwrite( &network->weights[k], sizeof( double ), 1, f ) == 1;
+			}
+	ok = ok && fwrite( shifts, sizeof( uint32_t ), 3 * SYNAPTIC_INPUT_TYPES, f ) == 3 * SYNAPTIC_INPUT_TYPES;
+	if( f != NULL && fclose( f ) != 0 )
+		ok = false;
+	return ok;
+}
+
+
+// the conversion the neuron loop did before, a neuron and type at a time
+static __attribute__((noinline)) int32_t neuron_input( uint16_t* sums, uint32_t index, uint32_t shift )
+{
+	uint32_t sum = sums[index];
+
+	sums[index] = 0;
+	return sum << shift;
+}
+
+
+static void time_paths( void )
+{
+	static uint32_t buffer[SYNAPTIC_INPUT_ENTRIES];
+	static uint16_t plain[SYNAPTIC_INPUT_ENTRIES];
+	static int32_t inputs[SYNAPTIC_INPUT_SLOT_ENTRIES];
+	const uint32_t shifts[SYNAPTIC_INPUT_TYPES] = { 5, 5 };
+	const uint32_t n_ticks = 100000, n_words = 1 << 16;
+	uint32_t* words = malloc( n_words * sizeof( uint32_t ) );
+	synaptic_input_t input;
+	int64_t sink = 0;
+
+	for( uint32_t k = 0; k < n_words; k++ )
+		words[k] = ( ( next_random() & 0x1F ) << 16 ) | ( next_random() & 0xFFFF );
+
+	synaptic_input_initialise( &input, buffer, N_NEURONS, false, shifts );
+	double start = now_ns();
+
+	for( uint32_t t = 0; t < n_ticks; t++ )
+		for( uint32_t type = 0; type < SYNAPTIC_INPUT_TYPES; type++ )
+			for( uint32_t j = 0; j < N_NEURONS; j++ )
+				sink += neuron_input( plain, ( ( t & SYNAPTIC_INPUT_SLOT_MASK ) * SYNAPTIC_INPUT_SLOT_ENTRIES )
+											 | ( type << SYNAPTIC_INPUT_INDEX_BITS ) | j, shifts[type] );
+
+	double per_neuron_ns = ( now_ns() - start ) / n_ticks;
+
+	start = now_ns();
+	for( uint32_t t = 0; t < n_ticks; t++ ) {
+		synaptic_input_drain( &input, t, inputs );
+		sink += inputs[t % SYNAPTIC_INPUT_SLOT_ENTRIES];
+		}
+
+	double drain_ns = ( now_ns() - start ) / n_ticks;
+
+	printf( "\nper tick, %u neurons x %u types: a neuron at a time %.0f ns, drain %.0f ns (%.1fx)\n", N_NEURONS,
+			SYNAPTIC_INPUT_TYPES, per_neuron_ns, drain_ns, per_neuron_ns / drain_ns );
+
+	// adds: unguarded 16 bit, as before, against the guarded ones
+	double add_ns[3];
+
+	for( uint32_t variant = 0; variant < 3; variant++ ) {
+		synaptic_input_initialise( &input, buffer, N_NEURONS, variant == 2, shifts );
+		memset( plain, 0, sizeof( plain ) );
+		start = now_ns();
+		for( uint32_t repeat = 0; repeat < 100; repeat++ )
+			for( uint32_t k = 0; k < n_words; k++ ) {
+				uint32_t word = words[k];
+
+				if( variant == 0 )
+					plain[( ( ( repeat + SYNAPTIC_INPUT_DELAY( word ) ) & SYNAPTIC_INPUT_SLOT_MASK )
+							<< ( SYNAPTIC_INPUT_TYPE_BITS + SYNAPTIC_INPUT_INDEX_BITS ) )
+						  | ( word & SYNAPTIC_INPUT_TYPE_INDEX_MASK )] += word >> 16;
+				else
+					synaptic_input_add( &input, repeat, word );
+				}
+		add_ns[variant] = ( now_ns() - start ) / ( 100.0 * n_words );
+		}
+	sink += plain[0] + input.n_saturations[0];
+
+	printf( "per synaptic event: unguarded %.2f ns, guarded 16-bit %.2f ns, guarded 32-bit %.2f ns\n", add_ns[0],
+			add_ns[1], add_ns[2] );
+
+	// keep the conversions observable
+	if( sink == 12345 )
+		fprintf( stderr, "#" );
+	free( words );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	uint32_t n_ticks = 5000, n_failures = 0;
+	const char* write_path = NULL;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "--ticks" ) && i + 1 < argc )
+			n_ticks = strtoul( argv[++i], NULL, 0 );
+		else if( !strcmp( argv[i], "--write" ) && i + 1 < argc )
+			write_path = argv[++i];
+		else {
+			fprintf( stderr, "usage: %s [--ticks N] [--write FILE]\n", argv[0] );
+			return 1;
+			}
+		}
+
+	printf( "%u neurons from %u sources (%u%% excitatory), %u ticks of %u us\n\n", N_NEURONS, N_SOURCES,
+			EXCITATORY_PERCENT, n_ticks, TIME_STEP_US );
+	printf( "  %-11s %7s   %10s %8s   %9s %9s   %9s\n", "shifts", "exc inh", "saturated", "clipped",
+			"lost", "too big", "RMS error" );
+
+	for( uint32_t sc = 0; sc < sizeof( scenarios ) / sizeof( scenarios[0] ); sc++ ) {
+		const scenario_t* scenario = &scenarios[sc];
+		network_t network;
+		double config_rates[N_SOURCES], measured_rates[N_SOURCES], peaks[SYNAPTIC_INPUT_TYPES];
+		uint32_t shifts[3][SYNAPTIC_INPUT_TYPES], provenance_shifts[SYNAPTIC_INPUT_TYPES];
+		run_result_t results[4];
+
+		rng_state = 0x6A09E667 + sc;
+		if( !build_network( &network, scenario ) ) {
+			fprintf( stderr, "out of memory\n" );
+			return 1;
+			}
+		for( uint32_t s = 0; s < N_SOURCES; s++ )
+			config_rates[s] = CONFIG_RATE;
+		measure_rates( &network, scenario, n_ticks, measured_rates );
+
+		choose_shifts( &network, config_rates, SIGMA, false, false, NULL, shifts[0] );
+		choose_shifts( &network, measured_rates, SIGMA, true, false, NULL, shifts[1] );
+		choose_shifts( &network, measured_rates, SIGMA, true, true, NULL, shifts[2] );
+
+		bool ok = run( &network, scenario, shifts[0], false, n_ticks, &results[0] )
+				  && run( &network, scenario, shifts[1], false, n_ticks, &results[1] )
+				  && run( &network, scenario, shifts[2], true, n_ticks, &results[2] );
+
+		// a 32-bit run does not saturate, so its peaks are the true ones
+		peaks_in_na( &results[2], peaks );
+		choose_shifts( &network, measured_rates, SIGMA, true, false, peaks, provenance_shifts );
+		ok = ok && run( &network, scenario, provenance_shifts, false, n_ticks, &results[3] );
+
+		printf( "%s: %.0f-%.0f Hz, fan-in %u%s\n", scenario->name, scenario->low_rate, scenario->high_rate,
+				scenario->fan_in, scenario->burst_period ? ", bursts" : "" );
+		if( ok ) {
+			print_result( "config", &results[0] );
+			print_result( "measured", &results[1] );
+			print_result( "32-bit", &results[2] );
+			print_result( "provenance", &results[3] );
+			}
+		else
+			n_failures++;
+
+		// nothing is lost with 32-bit sums, and provenance fixes any saturation
+		if( ok && ( results[2].provenance[0] + results[2].provenance[3] > 0
+					|| results[3].provenance[0] + results[3].provenance[3] > 0 ) ) {
+			printf( "  FAILED: saturated with 32-bit sums or shifts from provenance\n" );
+			n_failures++;
+			}
+
+		if( write_path != NULL && !strcmp( scenario->name, "busy" ) && !write_check_file( write_path, &network,
+																						   measured_rates, shifts ) ) {
+			fprintf( stderr, "cannot write %s\n", write_path );
+			n_failures++;
+			}
+		free_network( &network );
+		}
+
+	time_paths();
+	return n_failures ? 1 : 0;
+}
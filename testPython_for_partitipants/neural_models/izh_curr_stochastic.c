@@ -1,6 +1,7 @@
 
 
 #include "izh_curr_stochastic.h"
+#include "izh_ode_solvers.h"
 #include "random.h"
 #include "normal.h"
 #include <debug.h>
@@ -12,7 +13,22 @@ static REAL machine_timestep = REAL_CONST( 1.0 );  // in msecs
 
 static const REAL V_threshold = REAL_CONST( 30.0 );
 
+#ifdef IZH_SIMPLE_TQ_OFFSET
 static const REAL SIMPLE_TQ_OFFSET = REAL_CONST( 1.85 );
+#else
+static const REAL WHOLE_STEP = REAL_CONST( 1.0 );
+#endif
+
+static const REAL ZERO = REAL_CONST( 0.0 );
+
+// largest |dV/dt| [mV/ms] and |dU/dt| under I_offset still counted as sitting on the
+// fixed point; U relaxes with time constant 1/A so its bound has to be tighter
+static const REAL QUIESCENT_V_TOLERANCE = REAL_CONST( 0.001 );
+static const REAL QUIESCENT_U_TOLERANCE = REAL_CONST( 0.0001 );
+
+// an idle neuron only draws noise within this many SDs of threshold; beyond it the
+// chance of a noise-driven spike is below 1e-15 per tick
+static const REAL NOISE_SD_BOUND = REAL_CONST( 8.0 );
 
 
 // function that converts the input into the real value to be used by the neuron
@@ -32,8 +48,8 @@ void neuron_ode( REAL t, REAL stateVar[], REAL dstateVar_dt[], neuron_pointer_t
 	REAL V_now = stateVar[1], U_now = stateVar[2];
 //io_printf( IO_BUF, " sv1 %9.4k  V %9.4k --- sv2 %9.4k  U %9.4k\n", stateVar[1], neuron->V, stateVar[2], neuron->U );
 
-	dstateVar_dt[1] = REAL_CONST(140.0) + (REAL_CONST(5.0) + REAL_CONST(0.0400) * V_now) * V_now - U_now + input_this_timestep; // V
-	dstateVar_dt[2] = neuron->A * ( neuron->B * V_now - U_now );  // U
+	dstateVar_dt[1] = izh_dV_dt( V_now, U_now, input_this_timestep ); // V
+	dstateVar_dt[2] = izh_dU_dt( V_now, U_now, neuron );  // U
 }
 
 
@@ -47,54 +63,97 @@ void provide_machine_timestep( uint16_t microsecs ){
 }
 
 
-/*
-		best balance between speed and accuracy so far from ODE solve comparison work
-*/
-void rk2_kernel_midpoint( REAL h, neuron_pointer_t neuron ) {
+// ODE solver has just set neuron->V which is current state of membrane voltage
+void neuron_discrete_changes( neuron_pointer_t neuron ) {
+
+   neuron->V  = neuron->C;    // reset membrane voltage
+	neuron->U += neuron->D;		// offset 2nd state variable
+}
+
+
+#ifndef IZH_SIMPLE_TQ_OFFSET
+// the step just taken carried V from last_V to crossing_V across threshold: find where
+// by linear interpolation, reset the neuron at that instant and integrate it over the
+// rest of the step, so spike timing is right to well inside one tick
+static void neuron_reset_at_crossing( neuron_pointer_t neuron, REAL last_V, REAL last_U, REAL crossing_V ) {
 
-	REAL 	lastV1 = neuron->V, lastU1 = neuron->U, a = neuron->A, b = neuron->B;  // to match Mathematica names
+	REAL	fraction = WHOLE_STEP;
 
-	REAL	pre_alph = REAL_CONST(140.0) + input_this_timestep - lastU1,
-			alpha = pre_alph + ( REAL_CONST(5.0) + REAL_CONST(0.0400) * lastV1 ) * lastV1,
-			eta = lastV1 + REAL_HALF( h * alpha ),
-			beta = REAL_HALF( h * ( b * lastV1 - lastU1 ) * a ); // could be represented as a long fract?
+	if( REAL_COMPARE( crossing_V, >, last_V ) && REAL_COMPARE( last_V, <, V_threshold ) )
+		fraction = ( V_threshold - last_V ) / ( crossing_V - last_V );
+	if( REAL_COMPARE( fraction, >, WHOLE_STEP ) )
+		fraction = WHOLE_STEP;
 
-//	neuron->V = lastV1 +
-	neuron->V +=
-					h * ( pre_alph - beta + ( REAL_CONST(5.0) + REAL_CONST(0.0400) * eta ) * eta );
+	neuron->U = last_U + fraction * ( neuron->U - last_U );
+	neuron_discrete_changes( neuron );
+	neuron->spike_offset = fraction;
 
-//	neuron->U = lastU1 +
-	neuron->U +=
-					a * h * ( -lastU1 - beta + b * eta );
+	if( REAL_COMPARE( fraction, <, WHOLE_STEP ) )
+		izh_ode_step( ( WHOLE_STEP - fraction ) * machine_timestep, input_this_timestep, neuron );
 }
+#endif
 
 
-// ODE solver has just set neuron->V which is current state of membrane voltage
-void neuron_discrete_changes( neuron_pointer_t neuron ) {
+// TRUE if x lies strictly inside ( -tolerance, tolerance )
+static inline bool within_tolerance( REAL x, REAL tolerance ) {
 
-   neuron->V  = neuron->C;    // reset membrane voltage
-	neuron->U += neuron->D;		// offset 2nd state variable
+	return REAL_COMPARE( x, <, tolerance ) && REAL_COMPARE( x, >, -tolerance );
 }
 
 
 //
 bool neuron_state_update( REAL exc_input, REAL inh_input, REAL external_bias, neuron_pointer_t neuron ) {
 
-	input_this_timestep = exc_input - inh_input + external_bias + neuron->I_offset; 	// all need to be in nA
+	REAL synaptic_input = exc_input - inh_input + external_bias;
+
+	input_this_timestep = synaptic_input + neuron->I_offset; 	// all need to be in nA
+
+	// an idle neuron sits on its fixed point under I_offset, so without new input
+	// the ODE step would leave it where it is
+	bool idle = ( neuron->status & NEURON_IDLE ) && REAL_COMPARE( synaptic_input, ==, ZERO );
+
+#ifndef IZH_SIMPLE_TQ_OFFSET
+	REAL last_V = neuron->V, last_U = neuron->U;
+#endif
 
-	rk2_kernel_midpoint( neuron->this_h, neuron );  						// the best AR update so far
+	if( !idle ) {
+		REAL h = neuron->this_h;
+
+		izh_ode_step( h, input_this_timestep, neuron );  		// RK2 midpoint unless built with another ODE_SOLVER
+
+		// idle only on the fixed point itself, never after a step that could not
+		// have moved the neuron
+		if( ( neuron->status & NEURON_QUIESCENCE_ENABLED )
+				&& REAL_COMPARE( synaptic_input, ==, ZERO )
+				&& REAL_COMPARE( h, >, ZERO )
+				&& within_tolerance( izh_dV_dt( neuron->V, neuron->U, input_this_timestep ), QUIESCENT_V_TOLERANCE )
+				&& within_tolerance( izh_dU_dt( neuron->V, neuron->U, neuron ), QUIESCENT_U_TOLERANCE ) )
+			neuron->status |= NEURON_IDLE;
+		else
+			neuron->status &= ~NEURON_IDLE;
+		}
 
-	
    // create noisy membrane voltage by adding Gaussian noise with SD = membrane_noise_sd
-   REAL noisy_membrane = neuron->V + norminv_urb( mars_kiss32() ) * neuron->membrane_noise_sd;
+   // (a deterministic neuron skips the RNG draw, which is most of the noise cost, and so
+   // does an idle one whose membrane is too far below threshold for noise to matter)
+   REAL noisy_membrane = neuron->V;
+
+   if( REAL_COMPARE( neuron->membrane_noise_sd, >, ZERO )
+		   && ( !idle || REAL_COMPARE( V_threshold - neuron->V, <, NOISE_SD_BOUND * neuron->membrane_noise_sd ) ) )
+	   noisy_membrane += norminv_urb( mars_kiss32() ) * neuron->membrane_noise_sd;
 
    // compare noisy membrane voltage with threshold
    bool spike = REAL_COMPARE( noisy_membrane, >=, V_threshold );
 
 
 	if( spike ) {
+		neuron->status &= ~NEURON_IDLE;
+#ifdef IZH_SIMPLE_TQ_OFFSET
 		neuron_discrete_changes( neuron );
 		neuron->this_h = machine_timestep * SIMPLE_TQ_OFFSET; //REAL_CONST( 1.85 );  // simple threshold correction - next timestep (only) gets a bump
+#else
+		neuron_reset_at_crossing( neuron, last_V, last_U, noisy_membrane );
+#endif
 		}
 	else
 		neuron->this_h = machine_timestep;
@@ -117,6 +176,8 @@ REAL neuron_get_state( uint8_t i, neuron_pointer_t neuron ) {
 	switch ( i ) {
 		case  1: return neuron->V;
 		case  2: return neuron->U;
+		case  3: return neuron->spike_offset;		// fraction of the tick at which the last spike fell
+		default: return ZERO;
 		}
 }
 
@@ -138,6 +199,10 @@ neuron_pointer_t create_izh_neuron(  REAL A, REAL B, REAL C, REAL D, REAL V, REA
 
 	neuron->this_h = machine_timestep * REAL_CONST(1.001);  io_printf( WHERE_TO, "h = %11.4k ms\n", neuron->this_h );
 
+	neuron->membrane_noise_sd = ZERO;
+	neuron->status = 0;
+	neuron->spike_offset = ZERO;
+
 	return neuron;
 }
 
@@ -160,7 +225,7 @@ void neuron_print( restrict neuron_pointer_t neuron )
 // access number of state variables, number of parameters & size of the per neuron data structure
 void neuron_get_info( uint8_t *num_state_vars, uint16_t *struct_size )
 {
-	*num_state_vars = 2;
+	*num_state_vars = 3;		// V, U and spike_offset; only V and U can be set
 	*struct_size = sizeof( neuron_t );
 }
 
@@ -22,14 +22,28 @@ typedef struct neuron_t {
 // offset current [nA]
 	REAL		I_offset;
 
+// SD of Gaussian noise added to the membrane before the threshold test [mV]
+	REAL		membrane_noise_sd;
+
 // anything from here onwards is private to the c code (non neural parameters)
-// current timestep - simple correction for threshold in beta version	
+// current timestep - only varies when built with the IZH_SIMPLE_TQ_OFFSET threshold correction
 	REAL		this_h;
 
+// fraction of the tick, from its start, at which the last spike crossed threshold
+	REAL		spike_offset;
+
+// NEURON_* flags: quiescence mode selected by the host, idle mark set by the update
+	uint32_t	status;
+
 	
 } neuron_t;
 
 
+// neuron_t status flags
+#define NEURON_QUIESCENCE_ENABLED	( 1 << 0 )	// may be skipped while at rest with no input
+#define NEURON_IDLE					( 1 << 1 )	// converged to its fixed point, update skipped
+
+
 //
 neuron_pointer_t create_izh_neuron( REAL A, REAL B, REAL C, REAL D, REAL V, REAL U, REAL I );
 
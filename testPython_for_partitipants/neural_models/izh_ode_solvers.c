@@ -0,0 +1,136 @@
+
+
+#include "izh_ode_solvers.h"
+
+#ifdef FLOATING_POINT
+#include <math.h>
+#define REAL_EXP( x )		expf( x )
+#define REAL_SQRT( x )		sqrtf( x )
+#else
+#include "stdfix-exp.h"
+#include "sqrt.h"
+#define REAL_EXP( x )		expk( x )
+#define REAL_SQRT( x )		sqrtk( x )
+#endif
+
+
+#ifdef DEBUG_ON_HOST
+izh_ode_solver_t izh_ode_step = IZH_BUILD_SOLVER;
+#endif
+
+// below this |dV'/dV| the exponential Euler factor ( e^(jh) - 1 ) / j is taken as h
+static const REAL SMALL_JACOBIAN = REAL_CONST( 0.001 );
+
+// the closed form is only used this far [mV] below the unstable root r2, where the
+// solution blows up into a spike
+static const REAL CLOSED_FORM_MARGIN = REAL_CONST( 1.0 );
+
+
+/*
+		forward Euler - cheapest, first order
+*/
+void izh_euler( REAL h, REAL input, neuron_pointer_t neuron ) {
+
+	REAL	V = neuron->V, U = neuron->U;
+
+	neuron->V = V + h * izh_dV_dt( V, U, input );
+	neuron->U = U + h * izh_dU_dt( V, U, neuron );
+}
+
+
+/*
+		best balance between speed and accuracy so far from ODE solve comparison work
+		(see host/izh_ode_bench)
+*/
+void izh_rk2_midpoint( REAL h, REAL input, neuron_pointer_t neuron ) {
+
+	REAL 	lastV1 = neuron->V, lastU1 = neuron->U, a = neuron->A, b = neuron->B;  // to match Mathematica names
+
+	REAL	pre_alph = REAL_CONST(140.0) + input - lastU1,
+			alpha = pre_alph + ( REAL_CONST(5.0) + REAL_CONST(0.0400) * lastV1 ) * lastV1,
+			eta = lastV1 + REAL_HALF( h * alpha ),
+			beta = REAL_HALF( h * ( b * lastV1 - lastU1 ) * a ); // could be represented as a long fract?
+
+	neuron->V +=
+					h * ( pre_alph - beta + ( REAL_CONST(5.0) + REAL_CONST(0.0400) * eta ) * eta );
+
+	neuron->U +=
+					a * h * ( -lastU1 - beta + b * eta );
+}
+
+
+/*
+		classical 4th order Runge-Kutta - four derivative evaluations per step
+*/
+void izh_rk4( REAL h, REAL input, neuron_pointer_t neuron ) {
+
+	REAL	V = neuron->V, U = neuron->U, half_h = REAL_HALF( h );
+
+	REAL	k1V = izh_dV_dt( V, U, input ),
+			k1U = izh_dU_dt( V, U, neuron ),
+			k2V = izh_dV_dt( V + half_h * k1V, U + half_h * k1U, input ),
+			k2U = izh_dU_dt( V + half_h * k1V, U + half_h * k1U, neuron ),
+			k3V = izh_dV_dt( V + half_h * k2V, U + half_h * k2U, input ),
+			k3U = izh_dU_dt( V + half_h * k2V, U + half_h * k2U, neuron ),
+			k4V = izh_dV_dt( V + h * k3V, U + h * k3U, input ),
+			k4U = izh_dU_dt( V + h * k3V, U + h * k3U, neuron );
+
+	neuron->V = V + h * ( k1V + k2V + k2V + k3V + k3V + k4V ) * REAL_CONST( 0.1666667 );
+	neuron->U = U + h * ( k1U + k2U + k2U + k3U + k3U + k4U ) * REAL_CONST( 0.1666667 );
+}
+
+
+/*
+		exponential Euler - V linearised about its current value, U exact for
+		V held over the step
+*/
+void izh_exponential_euler( REAL h, REAL input, neuron_pointer_t neuron ) {
+
+	REAL	V = neuron->V, U = neuron->U;
+	REAL	jacobian = REAL_CONST(5.0) + REAL_CONST(0.0800) * V,
+			factor = h;
+
+	if( REAL_COMPARE( jacobian, >, SMALL_JACOBIAN ) || REAL_COMPARE( jacobian, <, -SMALL_JACOBIAN ) )
+		factor = ( REAL_EXP( jacobian * h ) - REAL_CONST( 1.0 ) ) / jacobian;
+
+	REAL	U_inf = neuron->B * V;
+
+	neuron->V = V + factor * izh_dV_dt( V, U, input );
+	neuron->U = U_inf + ( U - U_inf ) * REAL_EXP( -neuron->A * h );
+}
+
+
+/*
+		closed form for U held over the step: dV/dt = 0.04 (V - r1)(V - r2) has the
+		solution (V - r1)/(V - r2) = z0 e^(-kt), k = 0.04 (r2 - r1).  Only valid below
+		the saddle-node (two real roots) and clear of the unstable root r2; elsewhere
+		it falls back to RK2
+*/
+void izh_closed_form_subthreshold( REAL h, REAL input, neuron_pointer_t neuron ) {
+
+	REAL	V = neuron->V, U = neuron->U;
+	REAL	discriminant = REAL_CONST(25.0) - REAL_CONST(0.16) * ( REAL_CONST(140.0) - U + input );
+
+	if( REAL_COMPARE( discriminant, <=, REAL_CONST( 0.0 ) ) ) {
+		izh_rk2_midpoint( h, input, neuron );
+		return;
+		}
+
+	REAL	k = REAL_SQRT( discriminant ),
+			r1 = ( REAL_CONST(-5.0) - k ) * REAL_CONST(12.5),		// 1 / 0.08
+			r2 = ( REAL_CONST(-5.0) + k ) * REAL_CONST(12.5);
+
+	if( REAL_COMPARE( V, >=, r2 - CLOSED_FORM_MARGIN ) ) {
+		izh_rk2_midpoint( h, input, neuron );
+		return;
+		}
+
+	// z decays to 0, so V relaxes to the stable root r1
+	REAL	z = ( ( V - r1 ) / ( V - r2 ) ) * REAL_EXP( -k * h ),
+			next_V = ( r1 - z * r2 ) / ( REAL_CONST( 1.0 ) - z );
+
+	REAL	U_inf = neuron->B * REAL_HALF( V + next_V );
+
+	neuron->V = next_V;
+	neuron->U = U_inf + ( U - U_inf ) * REAL_EXP( -neuron->A * h );
+}
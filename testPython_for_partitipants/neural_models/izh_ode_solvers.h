@@ -0,0 +1,58 @@
+
+
+#ifndef _IZH_ODE_SOLVERS_
+#define _IZH_ODE_SOLVERS_
+
+
+#include "izh_curr_stochastic.h"
+
+
+// every solver advances V and U of one neuron by h [ms] under a constant input [nA]
+typedef void ( *izh_ode_solver_t )( REAL h, REAL input, neuron_pointer_t neuron );
+
+
+// the Izhikevich right-hand side, shared by all solvers and neuron_ode()
+static inline REAL izh_dV_dt( REAL V, REAL U, REAL input ) {
+
+	return REAL_CONST(140.0) + ( REAL_CONST(5.0) + REAL_CONST(0.0400) * V ) * V - U + input;
+}
+
+static inline REAL izh_dU_dt( REAL V, REAL U, neuron_pointer_t neuron ) {
+
+	return neuron->A * ( neuron->B * V - U );
+}
+
+
+void izh_euler( REAL h, REAL input, neuron_pointer_t neuron );
+
+void izh_rk2_midpoint( REAL h, REAL input, neuron_pointer_t neuron );
+
+void izh_rk4( REAL h, REAL input, neuron_pointer_t neuron );
+
+void izh_exponential_euler( REAL h, REAL input, neuron_pointer_t neuron );
+
+void izh_closed_form_subthreshold( REAL h, REAL input, neuron_pointer_t neuron );
+
+
+// build-time choice of solver for the population binary: make ODE_SOLVER=<name>
+#if defined( IZH_SOLVER_EULER )
+#define IZH_BUILD_SOLVER	izh_euler
+#elif defined( IZH_SOLVER_RK4 )
+#define IZH_BUILD_SOLVER	izh_rk4
+#elif defined( IZH_SOLVER_EXPONENTIAL_EULER )
+#define IZH_BUILD_SOLVER	izh_exponential_euler
+#elif defined( IZH_SOLVER_CLOSED_FORM )
+#define IZH_BUILD_SOLVER	izh_closed_form_subthreshold
+#else
+#define IZH_BUILD_SOLVER	izh_rk2_midpoint
+#endif
+
+#ifdef DEBUG_ON_HOST
+// host benchmarks swap the solver at run time
+extern izh_ode_solver_t izh_ode_step;
+#else
+#define izh_ode_step		IZH_BUILD_SOLVER
+#endif
+
+
+#endif   // include guard
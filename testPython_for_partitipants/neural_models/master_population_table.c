@@ -0,0 +1,56 @@
+
+
+#include "master_population_table.h"
+
+
+// Writes the sorted entries into the in-order positions of the implicit
+// tree rooted at i; returns the next sorted entry
+static uint32_t eytzinger_fill( const master_population_entry_t* sorted, master_population_entry_t* tree,
+								uint32_t n, uint32_t i, uint32_t next )
+{
+	if( i <= n ) {
+		next = eytzinger_fill( sorted, tree, n, 2 * i, next );
+		tree[i] = sorted[next++];
+		next = eytzinger_fill( sorted, tree, n, 2 * i + 1, next );
+		}
+	return next;
+}
+
+
+bool master_population_table_initialise( const uint32_t* region, master_population_entry_t* memory,
+										 master_population_table_t* table )
+{
+	uint32_t n_entries = region[0];
+	const master_population_entry_t* sorted = (const master_population_entry_t*) &region[1];
+	uint32_t cache_shift = 32;
+
+	if( n_entries > MASTER_POP_MAX_ENTRIES )
+		return false;
+
+	for( uint32_t i = 0; i < n_entries; i++ ) {
+		uint32_t neuron_bits = ~sorted[i].mask;
+
+		// contiguous ranges in key order, or the descent cannot find them
+		if( ( neuron_bits & ( neuron_bits + 1 ) ) != 0 || ( sorted[i].key & neuron_bits ) != 0 )
+			return false;
+		if( i > 0 && ( sorted[i - 1].key | ~sorted[i - 1].mask ) >= sorted[i].key )
+			return false;
+
+		uint32_t shift = 32 - __builtin_popcount( sorted[i].mask );
+
+		if( shift < cache_shift )
+			cache_shift = shift;
+		}
+
+	eytzinger_fill( sorted, memory, n_entries, 1, 0 );
+
+	table->n_entries = n_entries;
+	table->entries = memory;
+	table->cache_shift = cache_shift < 32 ? cache_shift : 0;
+	table->n_lookups = 0;
+	table->n_cache_hits = 0;
+	for( uint32_t s = 0; s < MASTER_POP_CACHE_SLOTS; s++ )
+		table->cache[s] = MASTER_POP_NO_ENTRY;
+
+	return true;
+}
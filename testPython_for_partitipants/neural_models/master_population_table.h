@@ -0,0 +1,122 @@
+
+#ifndef _MASTER_POPULATION_TABLE_
+#define _MASTER_POPULATION_TABLE_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+	Master population table for any key allocation, as an alternative to
+	the 2dArray generator.
+
+	2dArray indexes the table directly by the x, y and p fields of a PyNN
+	key, which is one load but only works for those keys.  Here the table
+	is an array of key/mask entries kept in Eytzinger (breadth-first)
+	order, so a lookup is a branch-free descent of log2( n ) probes
+	through contiguous memory, four 16-byte entries to a 64-byte line on
+	a host.  In front of it sits a small direct-mapped cache indexed by the
+	key above its neuron bits: the spikes of one source in a tick nearly
+	always arrive back to back, and hit after the first.
+
+	Region layout, 32-bit words:
+
+		n_entries
+		per entry, sorted by key:
+			key, mask		mask is ones then zeros, key & ~mask == 0,
+							entries disjoint
+			row_offset		words from the synaptic matrix to the row of
+							the source's first neuron
+			row_length		words per row, header included
+
+	The row of a spike is row_offset + ( key & ~mask ) * row_length.  The
+	same code builds on the core and on the host (host/master_pop_bench).
+*/
+
+#define MASTER_POP_MAX_ENTRIES			1024
+#define MASTER_POP_CACHE_SLOTS			32			// a power of two
+#define MASTER_POP_NO_ENTRY				0
+
+typedef struct {
+	uint32_t	key;
+	uint32_t	mask;
+	uint32_t	row_offset;
+	uint32_t	row_length;
+} master_population_entry_t;
+
+typedef struct {
+	uint32_t					n_entries;
+	master_population_entry_t*	entries;		// [1, n_entries] in Eytzinger order
+	uint32_t					cache_shift;	// neuron bits of the narrowest entry
+	uint32_t					cache[MASTER_POP_CACHE_SLOTS];
+	uint32_t					n_lookups;
+	uint32_t					n_cache_hits;
+} master_population_table_t;
+
+
+// Builds the table from the region into memory, which must hold
+// n_entries + 1 entries (DTCM on the core); false if the region is malformed
+bool master_population_table_initialise( const uint32_t* region, master_population_entry_t* memory,
+										 master_population_table_t* table );
+
+
+// The entry whose key range holds key, MASTER_POP_NO_ENTRY if none; the
+// Eytzinger descent finds the first entry whose last key is >= key
+static inline uint32_t master_population_table_search( const master_population_table_t* table, uint32_t key )
+{
+	const master_population_entry_t* entries = table->entries;
+	uint32_t i = 1;
+
+	while( i <= table->n_entries ) {
+		const master_population_entry_t* e = &entries[i];
+
+		i = 2 * i + ( ( e->key | ~e->mask ) < key );
+		}
+	i >>= __builtin_ffs( ~i );
+
+	if( i == 0 || ( key & entries[i].mask ) != entries[i].key )
+		return MASTER_POP_NO_ENTRY;
+	return i;
+}
+
+
+// As master_population_table_search, through the cache
+static inline uint32_t master_population_table_find( master_population_table_t* table, uint32_t key )
+{
+	uint32_t* slot = &table->cache[( key >> table->cache_shift ) & ( MASTER_POP_CACHE_SLOTS - 1 )];
+	uint32_t i = *slot;
+
+	table->n_lookups++;
+	if( i != MASTER_POP_NO_ENTRY && ( key & table->entries[i].mask ) == table->entries[i].key ) {
+		table->n_cache_hits++;
+		return i;
+		}
+
+	i = master_population_table_search( table, key );
+	if( i != MASTER_POP_NO_ENTRY )
+		*slot = i;
+	return i;
+}
+
+
+// The synaptic row of the neuron that sent key, for the row DMA; false if
+// no projection from its source ends on this core
+static inline bool master_population_table_get_row( master_population_table_t* table, uint32_t key,
+													const uint32_t* synaptic_matrix,
+													const uint32_t** row, uint32_t* n_bytes )
+{
+	uint32_t i = master_population_table_find( table, key );
+
+	if( i == MASTER_POP_NO_ENTRY )
+		return false;
+
+	const master_population_entry_t* e = &table->entries[i];
+
+	*row = synaptic_matrix + e->row_offset + ( key & ~e->mask ) * e->row_length;
+	*n_bytes = e->row_length * sizeof( uint32_t );
+	return true;
+}
+
+
+#endif   // include guard
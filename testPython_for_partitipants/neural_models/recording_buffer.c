@@ -0,0 +1,67 @@
+
+
+#include "recording_buffer.h"
+
+
+bool recording_buffer_initialise( recording_buffer_t* buffer, uint32_t* region, uint32_t region_words )
+{
+	if( region_words <= RECORDING_BUFFER_HEADER_WORDS + RECORDING_CHUNK_HEADER_WORDS )
+		return false;
+
+	// a power of two, so positions stay in step with the ring when they wrap
+	buffer->capacity = 1u << ( 31 - __builtin_clz( region_words - RECORDING_BUFFER_HEADER_WORDS ) );
+	buffer->region = region;
+	buffer->ring = region + RECORDING_BUFFER_HEADER_WORDS;
+	buffer->write_position = 0;
+	buffer->n_stalls = 0;
+
+	region[RECORDING_BUFFER_WRITE_POSITION] = 0;
+	region[RECORDING_BUFFER_READ_POSITION] = 0;
+	region[RECORDING_BUFFER_CAPACITY] = buffer->capacity;
+	region[RECORDING_BUFFER_N_STALLS] = 0;
+	return true;
+}
+
+
+bool recording_buffer_has_room( recording_buffer_t* buffer, uint32_t words )
+{
+	uint32_t read_position = __atomic_load_n( &buffer->region[RECORDING_BUFFER_READ_POSITION], __ATOMIC_ACQUIRE );
+
+	// positions wrap at 2^32, so the difference is still the fill
+	if( buffer->capacity - ( buffer->write_position - read_position ) >= words )
+		return true;
+
+	buffer->region[RECORDING_BUFFER_N_STALLS] = ++buffer->n_stalls;
+	return false;
+}
+
+
+static inline void put( recording_buffer_t* buffer, uint32_t word )
+{
+	buffer->ring[buffer->write_position++ & ( buffer->capacity - 1 )] = word;
+}
+
+
+void recording_buffer_write( recording_buffer_t* buffer, uint32_t channel, uint32_t tick, const uint32_t* payload,
+							 uint32_t length )
+{
+	uint32_t start, first;
+
+	put( buffer, RECORDING_CHUNK_HEADER( channel, length ) );
+	put( buffer, tick );
+
+	// at most two copies, either side of the end of the ring
+	start = buffer->write_position & ( buffer->capacity - 1 );
+	first = buffer->capacity - start < length ? buffer->capacity - start : length;
+	for( uint32_t i = 0; i < first; i++ )
+		buffer->ring[start + i] = payload[i];
+	for( uint32_t i = first; i < length; i++ )
+		buffer->ring[i - first] = payload[i];
+	buffer->write_position += length;
+}
+
+
+void recording_buffer_publish( recording_buffer_t* buffer )
+{
+	__atomic_store_n( &buffer->region[RECORDING_BUFFER_WRITE_POSITION], buffer->write_position, __ATOMIC_RELEASE );
+}
@@ -0,0 +1,81 @@
+
+
+#ifndef _RECORDING_BUFFER_
+#define _RECORDING_BUFFER_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+	Buffered output: a recording region used as a ring that the host
+	drains while the simulation runs, so a run can record more than fits
+	in SDRAM and nothing is left to extract after it.
+
+	Region layout, 32-bit words:
+
+		write_position	words written since the start, modulo 2^32; only
+						the core writes it
+		read_position	words the host has drained; only the host writes it
+		capacity		of the ring, in words, the largest power of two that fits
+		n_stalls		ticks the core waited for the host
+		ring
+
+	The ring holds chunks, which may wrap around its end:
+
+		channel[31:24]  length[23:0], the words of payload
+		tick
+		payload			a spike_recording_encode or state_recording_encode
+						record, for spikes or state channels
+
+	The core writes a tick's chunks and then publishes write_position, so
+	the host only ever sees whole ticks; the host copies chunks out and
+	then publishes read_position.  Back-pressure: before running a tick the
+	core asks for room for the tick's largest chunks.  When the host has
+	fallen that far behind the tick is not run, the stall is counted, and
+	it is tried again on the next timer tick, so the simulation only
+	pauses while the host is behind.  host_tools/recording_drain.h is the
+	host side.
+*/
+
+#define RECORDING_BUFFER_HEADER_WORDS		4
+#define RECORDING_BUFFER_WRITE_POSITION		0
+#define RECORDING_BUFFER_READ_POSITION		1
+#define RECORDING_BUFFER_CAPACITY			2
+#define RECORDING_BUFFER_N_STALLS			3
+#define RECORDING_CHUNK_HEADER_WORDS		2
+#define RECORDING_CHUNK_HEADER( c, n )		( ( ( c ) << 24 ) | ( n ) )
+#define RECORDING_CHUNK_CHANNEL( h )		( ( h ) >> 24 )
+#define RECORDING_CHUNK_LENGTH( h )			( ( h ) & 0xFFFFFF )
+
+typedef struct {
+	uint32_t*	region;
+	uint32_t*	ring;
+	uint32_t	capacity;
+	uint32_t	write_position;		// ahead of the published one during a tick
+	uint32_t	n_stalls;
+} recording_buffer_t;
+
+
+// Sets up a ring in a region of region_words words; false if there is no
+// room for a ring after the header
+bool recording_buffer_initialise( recording_buffer_t* buffer, uint32_t* region, uint32_t region_words );
+
+
+// Whether words more words fit until the host next drains the ring; if not,
+// the stall is counted and the tick should wait
+bool recording_buffer_has_room( recording_buffer_t* buffer, uint32_t words );
+
+
+// Appends a chunk of length words; has_room must have allowed for
+// RECORDING_CHUNK_HEADER_WORDS + length
+void recording_buffer_write( recording_buffer_t* buffer, uint32_t channel, uint32_t tick, const uint32_t* payload,
+							 uint32_t length );
+
+
+// Makes the chunks written so far visible to the host
+void recording_buffer_publish( recording_buffer_t* buffer );
+
+
+#endif   // include guard
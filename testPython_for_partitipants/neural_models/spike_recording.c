@@ -0,0 +1,195 @@
+
+
+#include "spike_recording.h"
+
+
+bool spike_recording_initialise( spike_recording_t* recording, uint32_t* region, uint32_t region_words,
+								 uint32_t n_neurons )
+{
+	if( region_words < SPIKE_RECORDING_HEADER_WORDS || n_neurons > 0xFFFF )
+		return false;
+
+	recording->region = region;
+	recording->records = region + SPIKE_RECORDING_HEADER_WORDS;
+	recording->capacity = region_words - SPIKE_RECORDING_HEADER_WORDS;
+	recording->n_words = get_bit_field_size( n_neurons );
+	recording->used = 0;
+	recording->empty_run = NULL;
+	recording->n_dropped = 0;
+	recording->n_records[SPIKE_RECORD_EMPTY] = 0;
+	recording->n_records[SPIKE_RECORD_SPARSE] = 0;
+	recording->n_records[SPIKE_RECORD_DENSE] = 0;
+
+	region[0] = 0;
+	region[1] = n_neurons;
+	return true;
+}
+
+
+uint32_t spike_recording_encode( bit_field_t spikes, uint32_t n_words, uint32_t n_spikes, uint32_t* out )
+{
+	uint32_t sparse_words = ( n_spikes + 1 ) / 2;
+
+	if( sparse_words >= n_words ) {
+		out[0] = SPIKE_RECORD_HEADER( SPIKE_RECORD_DENSE, n_spikes );
+		for( uint32_t w = 0; w < n_words; w++ )
+			out[1 + w] = spikes[w];
+		return 1 + n_words;
+		}
+
+	uint32_t pending = 0, n = 0;
+
+	out[0] = SPIKE_RECORD_HEADER( SPIKE_RECORD_SPARSE, n_spikes );
+
+	// lowest set bit first, so indices come out in order
+	for( uint32_t w = 0; w < n_words; w++ )
+		for( uint32_t bits = spikes[w]; bits != 0; bits &= bits - 1, n++ ) {
+			uint32_t index = ( w << 5 ) | __builtin_ctz( bits );
+
+			if( n & 1 )
+				out[1 + n / 2] = pending | ( index << 16 );
+			else
+				pending = index;
+			}
+	if( n & 1 )
+		out[1 + n / 2] = pending;
+	return 1 + sparse_words;
+}
+
+
+bool spike_recording_record( spike_recording_t* recording, bit_field_t spikes )
+{
+	uint32_t n_words = recording->n_words;
+	uint32_t n_spikes = count_bit_field( spikes, n_words );
+	uint32_t* out = recording->records + recording->used;
+
+	// once a tick is lost, later ones would be recorded against the wrong tick
+	if( recording->n_dropped > 0 ) {
+		recording->n_dropped++;
+		return false;
+		}
+
+	if( n_spikes == 0 ) {
+		recording->n_records[SPIKE_RECORD_EMPTY]++;
+		if( recording->empty_run != NULL && SPIKE_RECORD_COUNT( *recording->empty_run ) < 0x3FFFFFFF ) {
+			*recording->empty_run += 1;
+			return true;
+			}
+		// a full run is published as another one opens
+		recording->region[0] = recording->used;
+		if( recording->used + 1 > recording->capacity ) {
+			recording->empty_run = NULL;
+			recording->n_dropped++;
+			return false;
+			}
+		out[0] = SPIKE_RECORD_HEADER( SPIKE_RECORD_EMPTY, 1 );
+		recording->empty_run = out;
+		recording->used += 1;
+		return true;
+		}
+
+	uint32_t sparse_words = ( n_spikes + 1 ) / 2;
+	uint32_t kind = sparse_words < n_words ? SPIKE_RECORD_SPARSE : SPIKE_RECORD_DENSE;
+	uint32_t size = 1 + ( kind == SPIKE_RECORD_SPARSE ? sparse_words : n_words );
+
+	if( recording->used + size > recording->capacity ) {
+		recording->n_dropped++;
+		return false;
+		}
+
+	spike_recording_encode( spikes, n_words, n_spikes, out );
+	recording->n_records[kind]++;
+	recording->empty_run = NULL;
+	recording->used += size;
+	recording->region[0] = recording->used;
+	return true;
+}
+
+
+void spike_recording_finish( spike_recording_t* recording )
+{
+	recording->empty_run = NULL;
+	recording->region[0] = recording->used;
+}
+
+
+void spike_recording_reader_initialise( spike_recording_reader_t* reader, const uint32_t* region )
+{
+	reader->records = region + SPIKE_RECORDING_HEADER_WORDS;
+	reader->used = region[0];
+	reader->n_neurons = region[1];
+	reader->n_words = get_bit_field_size( region[1] );
+	reader->position = 0;
+	reader->empty_left = 0;
+	reader->tick = 0;
+}
+
+
+uint32_t spike_recording_decode( const uint32_t* record, uint32_t available, uint32_t n_neurons, uint16_t* neurons,
+								 uint32_t* n_spikes )
+{
+	uint32_t kind = SPIKE_RECORD_KIND( record[0] ), count = SPIKE_RECORD_COUNT( record[0] );
+	uint32_t n_words = get_bit_field_size( n_neurons ), size;
+
+	if( count > n_neurons )
+		return 0;
+
+	if( kind == SPIKE_RECORD_SPARSE ) {
+		size = 1 + ( count + 1 ) / 2;
+		if( size > available )
+			return 0;
+		for( uint32_t n = 0; n < count; n++ )
+			neurons[n] = record[1 + n / 2] >> ( ( n & 1 ) << 4 );
+		}
+	else if( kind == SPIKE_RECORD_DENSE ) {
+		uint32_t n = 0;
+
+		size = 1 + n_words;
+		if( size > available )
+			return 0;
+		for( uint32_t w = 0; w < n_words; w++ )
+			for( uint32_t bits = record[1 + w]; bits != 0 && n < count; bits &= bits - 1 )
+				neurons[n++] = ( w << 5 ) | __builtin_ctz( bits );
+		count = n;
+		}
+	else
+		return 0;
+
+	*n_spikes = count;
+	return size;
+}
+
+
+bool spike_recording_read_tick( spike_recording_reader_t* reader, uint32_t* tick, uint16_t* neurons,
+								uint32_t* n_spikes )
+{
+	if( reader->empty_left > 0 ) {
+		reader->empty_left--;
+		*tick = reader->tick++;
+		*n_spikes = 0;
+		return true;
+		}
+	if( reader->position >= reader->used )
+		return false;
+
+	const uint32_t* record = reader->records + reader->position;
+	uint32_t size;
+
+	if( SPIKE_RECORD_KIND( record[0] ) == SPIKE_RECORD_EMPTY ) {
+		if( SPIKE_RECORD_COUNT( record[0] ) == 0 )
+			return false;
+		reader->empty_left = SPIKE_RECORD_COUNT( record[0] ) - 1;
+		size = 1;
+		*n_spikes = 0;
+		}
+	else {
+		size = spike_recording_decode( record, reader->used - reader->position, reader->n_neurons, neurons,
+									   n_spikes );
+		if( size == 0 )
+			return false;
+		}
+
+	reader->position += size;
+	*tick = reader->tick++;
+	return true;
+}
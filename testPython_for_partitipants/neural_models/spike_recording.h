@@ -0,0 +1,117 @@
+
+
+#ifndef _SPIKE_RECORDING_
+#define _SPIKE_RECORDING_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bit_field.h"
+
+
+/*
+	Adaptive spike recording: each tick's spike bit field is stored as
+	whichever of three records is smallest, chosen by its popcount,
+	instead of the whole bit field every tick.
+
+		empty	one header word for a run of silent ticks; a silent tick
+				after another lengthens the run in place
+		sparse	a header and the neuron indices, 16 bits each, two to a
+				word, low half first
+		dense	a header and the bit field
+
+	Header word:  kind[31:30]  count[29:0], the run length for empty,
+	the number of spikes for sparse and dense.  A tick with k spikes is
+	sparse while ( k + 1 ) / 2 words are fewer than the bit field.
+
+	Region layout, 32-bit words:
+
+		words_used		of complete records, so the region can be read while
+						the core is still writing it
+		n_neurons
+		records, one tick after another from tick 0
+
+	words_used is updated with every record but an empty run, which stays
+	open, and out of words_used, until a tick with spikes ends it, it
+	reaches the largest count, or spike_recording_finish is called at the
+	end of the run: a published word never changes, and a reader sees the
+	silent ticks late rather than misses them.
+
+	When a tick does not fit, it and every later tick are dropped and
+	counted, so what was recorded stays a gapless prefix of the run.
+	spike_recording_encode and spike_recording_decode handle a single
+	record, for buffered output (recording_buffer.h).  The host decodes a
+	region a tick at a time with spike_recording_reader_t (here, for host
+	tools) or izh_curr_stochastic/spike_recording.py, which also sizes the
+	region from the expected firing rate.
+*/
+
+#define SPIKE_RECORDING_HEADER_WORDS	2
+#define SPIKE_RECORD_EMPTY				0
+#define SPIKE_RECORD_SPARSE				1
+#define SPIKE_RECORD_DENSE				2
+#define SPIKE_RECORD_KIND( h )			( ( h ) >> 30 )
+#define SPIKE_RECORD_COUNT( h )			( ( h ) & 0x3FFFFFFF )
+#define SPIKE_RECORD_HEADER( k, n )		( ( ( k ) << 30 ) | ( n ) )
+
+typedef struct {
+	uint32_t*	region;
+	uint32_t*	records;
+	uint32_t	capacity;			// words for records
+	uint32_t	n_words;			// bit field words
+	uint32_t	used;
+	uint32_t*	empty_run;			// header of the last record, if an open run of empty ticks
+	uint32_t	n_dropped;			// ticks that did not fit
+	uint32_t	n_records[3];		// by kind, empty counting ticks
+} spike_recording_t;
+
+typedef struct {
+	const uint32_t*	records;
+	uint32_t		used;
+	uint32_t		n_neurons;
+	uint32_t		n_words;
+	uint32_t		position;
+	uint32_t		empty_left;
+	uint32_t		tick;
+} spike_recording_reader_t;
+
+
+// Sets up recording into a region of region_words words; false if it
+// cannot hold the header
+bool spike_recording_initialise( spike_recording_t* recording, uint32_t* region, uint32_t region_words,
+								 uint32_t n_neurons );
+
+
+// Publishes an empty run still open, for the end of the run
+void spike_recording_finish( spike_recording_t* recording );
+
+
+// Writes a sparse or dense record of a tick with n_spikes > 0 spikes to out,
+// which has room for 1 + n_words words; returns the words written
+uint32_t spike_recording_encode( bit_field_t spikes, uint32_t n_words, uint32_t n_spikes, uint32_t* out );
+
+
+// Records one tick's spikes; false if it did not fit
+bool spike_recording_record( spike_recording_t* recording, bit_field_t spikes );
+
+
+// Starts decoding a region as written so far
+void spike_recording_reader_initialise( spike_recording_reader_t* reader, const uint32_t* region );
+
+
+// Decodes one sparse or dense record of at most available words into
+// neuron indices (room for n_neurons); returns its size in words, or 0 if
+// it is malformed
+uint32_t spike_recording_decode( const uint32_t* record, uint32_t available, uint32_t n_neurons, uint16_t* neurons,
+								 uint32_t* n_spikes );
+
+
+// The next tick's spikes, as neuron indices in increasing order (room for
+// n_neurons); false at the end of the records or at a malformed record
+bool spike_recording_read_tick( spike_recording_reader_t* reader, uint32_t* tick, uint16_t* neurons,
+								uint32_t* n_spikes );
+
+
+#endif   // include guard
@@ -0,0 +1,236 @@
+
+
+#include "state_recording.h"
+
+
+bool state_recording_initialise( state_recording_t* recording, uint32_t* region, uint32_t region_words,
+								 uint32_t n_neurons, uint32_t bits, uint32_t shift, uint32_t subsample,
+								 uint32_t keyframe_interval, int32_t* rebuilt )
+{
+	if( ( bits != 8 && bits != 12 && bits != 16 ) || shift > 16 || subsample == 0
+		|| region_words < STATE_RECORDING_HEADER_WORDS )
+		return false;
+
+	recording->region = region;
+	recording->records = region + STATE_RECORDING_HEADER_WORDS;
+	recording->capacity = region_words - STATE_RECORDING_HEADER_WORDS;
+	recording->used = 0;
+	recording->n_neurons = n_neurons;
+	recording->bits = bits;
+	recording->shift = shift;
+	recording->subsample = subsample;
+	recording->keyframe_interval = keyframe_interval;
+	recording->tick = 0;
+	recording->n_since_keyframe = 0;
+	recording->rebuilt = rebuilt;
+	recording->n_dropped = 0;
+	recording->n_escapes = 0;
+
+	region[0] = 0;
+	region[1] = n_neurons;
+	region[2] = bits;
+	region[3] = shift;
+	region[4] = subsample;
+	region[5] = keyframe_interval;
+	return true;
+}
+
+
+static uint32_t encode_keyframe( state_recording_t* recording, const int32_t* values, uint32_t* out, uint32_t room )
+{
+	uint32_t n = recording->n_neurons;
+
+	if( 1 + n > room )
+		return 0;
+
+	out[0] = STATE_RECORD_HEADER( STATE_RECORD_KEYFRAME, 0 );
+	for( uint32_t i = 0; i < n; i++ ) {
+		out[1 + i] = values[i];
+		recording->rebuilt[i] = values[i];
+		}
+	return 1 + n;
+}
+
+
+// a delta record that does not fit leaves rebuilt partly updated
+static uint32_t encode_delta( state_recording_t* recording, const int32_t* values, uint32_t* out, uint32_t room )
+{
+	uint32_t n = recording->n_neurons, bits = recording->bits, shift = recording->shift;
+	uint32_t packed_words = state_recording_delta_words( n, bits );
+	uint32_t* escapes = out + 1 + packed_words;
+	int32_t limit = ( 1 << ( bits - 1 ) ) - 1;
+	int32_t half = shift > 0 ? 1 << ( shift - 1 ) : 0;
+	uint32_t code_mask = ( 1 << bits ) - 1, escape = limit + 1;
+	uint32_t n_escapes = 0;
+	uint64_t buffer = 0;
+	uint32_t buffered = 0, word = 0;
+
+	if( 1 + packed_words > room )
+		return 0;
+
+	for( uint32_t i = 0; i < n; i++ ) {
+		int64_t step = ( (int64_t) values[i] - recording->rebuilt[i] + half ) >> shift;
+		uint32_t code;
+
+		if( step >= -limit && step <= limit ) {
+			code = (uint32_t) step & code_mask;
+			recording->rebuilt[i] += (int32_t) step * ( 1 << shift );
+			}
+		else {
+			if( 1 + packed_words + n_escapes + 1 > room )
+				return 0;
+			code = escape;
+			escapes[n_escapes++] = values[i];
+			recording->rebuilt[i] = values[i];
+			}
+
+		buffer |= (uint64_t) code << buffered;
+		buffered += bits;
+		if( buffered >= 32 ) {
+			out[1 + word++] = (uint32_t) buffer;
+			buffer >>= 32;
+			buffered -= 32;
+			}
+		}
+	if( buffered > 0 )
+		out[1 + word] = (uint32_t) buffer;
+
+	out[0] = STATE_RECORD_HEADER( STATE_RECORD_DELTA, n_escapes );
+	recording->n_escapes += n_escapes;
+	return 1 + packed_words + n_escapes;
+}
+
+
+static uint32_t encode( state_recording_t* recording, const int32_t* values, uint32_t* out, uint32_t room )
+{
+	uint32_t size;
+
+	if( recording->n_since_keyframe == 0
+		|| ( recording->keyframe_interval > 0 && recording->n_since_keyframe >= recording->keyframe_interval ) ) {
+		size = encode_keyframe( recording, values, out, room );
+		recording->n_since_keyframe = 1;
+		}
+	else {
+		size = encode_delta( recording, values, out, room );
+		recording->n_since_keyframe++;
+		}
+	return size;
+}
+
+
+uint32_t state_recording_encode( state_recording_t* recording, const int32_t* values, uint32_t* out, uint32_t room )
+{
+	if( room < state_recording_max_record_words( recording->n_neurons, recording->bits ) )
+		return 0;
+	return encode( recording, values, out, room );
+}
+
+
+bool state_recording_record( state_recording_t* recording, const int32_t* values )
+{
+	uint32_t tick = recording->tick++;
+	uint32_t size;
+
+	if( tick % recording->subsample != 0 )
+		return true;
+
+	// a gap would shift every later record to the wrong tick
+	if( recording->n_dropped > 0 ) {
+		recording->n_dropped++;
+		return false;
+		}
+
+	size = encode( recording, values, recording->records + recording->used, recording->capacity - recording->used );
+	if( size == 0 ) {
+		recording->n_dropped++;
+		return false;
+		}
+	recording->used += size;
+	recording->region[0] = recording->used;
+	return true;
+}
+
+
+void state_recording_reader_initialise( state_recording_reader_t* reader, const uint32_t* region )
+{
+	reader->records = region + STATE_RECORDING_HEADER_WORDS;
+	reader->used = region[0];
+	reader->n_neurons = region[1];
+	reader->bits = region[2];
+	reader->shift = region[3];
+	reader->subsample = region[4];
+	reader->position = 0;
+	reader->tick = 0;
+}
+
+
+uint32_t state_recording_decode( const uint32_t* record, uint32_t available, uint32_t n_neurons, uint32_t bits,
+								 uint32_t shift, int32_t* values )
+{
+	uint32_t kind = STATE_RECORD_KIND( record[0] ), count = STATE_RECORD_COUNT( record[0] );
+	uint32_t size;
+
+	if( bits != 8 && bits != 12 && bits != 16 )
+		return 0;
+
+	if( kind == STATE_RECORD_KEYFRAME ) {
+		size = 1 + n_neurons;
+		if( size > available )
+			return 0;
+		for( uint32_t i = 0; i < n_neurons; i++ )
+			values[i] = record[1 + i];
+		}
+	else if( kind == STATE_RECORD_DELTA ) {
+		uint32_t packed_words = state_recording_delta_words( n_neurons, bits );
+		const uint32_t* escapes = record + 1 + packed_words;
+		uint32_t code_mask = ( 1 << bits ) - 1, escape = 1 << ( bits - 1 ), sign = escape;
+		uint32_t n_escapes = 0, word = 0, buffered = 0;
+		uint64_t buffer = 0;
+
+		size = 1 + packed_words + count;
+		if( count > n_neurons || size > available )
+			return 0;
+		for( uint32_t i = 0; i < n_neurons; i++ ) {
+			if( buffered < bits ) {
+				buffer |= (uint64_t) record[1 + word++] << buffered;
+				buffered += 32;
+				}
+
+			uint32_t code = (uint32_t) buffer & code_mask;
+
+			buffer >>= bits;
+			buffered -= bits;
+			if( code == escape ) {
+				if( n_escapes == count )
+					return 0;
+				values[i] = escapes[n_escapes++];
+				}
+			else
+				values[i] += (int32_t) ( ( code ^ sign ) - sign ) * ( 1 << shift );
+			}
+		if( n_escapes != count )
+			return 0;
+		}
+	else
+		return 0;
+
+	return size;
+}
+
+
+bool state_recording_read( state_recording_reader_t* reader, uint32_t* tick, int32_t* values )
+{
+	if( reader->position >= reader->used )
+		return false;
+
+	uint32_t size = state_recording_decode( reader->records + reader->position, reader->used - reader->position,
+											reader->n_neurons, reader->bits, reader->shift, values );
+
+	if( size == 0 )
+		return false;
+
+	reader->position += size;
+	*tick = reader->tick;
+	reader->tick += reader->subsample;
+	return true;
+}
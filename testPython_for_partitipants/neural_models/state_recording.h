@@ -0,0 +1,134 @@
+
+
+#ifndef _STATE_RECORDING_
+#define _STATE_RECORDING_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+	Quantized delta recording of a per-neuron state variable (V or gsyn),
+	instead of every neuron's full 32-bit s16.15 value every tick.
+
+	Every subsample'th tick is recorded, as one of
+
+		keyframe	a header and every neuron's value, exactly
+		delta		a header, every neuron's change since the last record
+					in 8, 12 or 16 bits, packed low bits first across
+					words, then an escape value for each neuron whose
+					change did not fit
+
+	A change is in steps of 2^shift s16.15 units and is taken against the
+	value the decoder will have rebuilt, not the last true value, so the
+	error never builds up: it stays within half a step, 2^( shift - 1 )
+	units.  The most negative code is the escape; the neuron's exact value
+	follows.  A keyframe is written every keyframe_interval records
+	(0: only the first), so a region can be decoded from any keyframe.
+
+	Header word:  kind[31:30]  count[29:0], the number of escapes.
+
+	Region layout, 32-bit words:
+
+		words_used			of records, updated every record
+		n_neurons
+		bits
+		shift
+		subsample			ticks per record
+		keyframe_interval	records per keyframe
+		records, one after another from tick 0
+
+	As for spike_recording.h, a record that does not fit ends the
+	recording.  izh_curr_stochastic/state_recording.py decodes a whole
+	region at once with numpy.
+*/
+
+#define STATE_RECORDING_HEADER_WORDS	6
+#define STATE_RECORD_KEYFRAME			0
+#define STATE_RECORD_DELTA				1
+#define STATE_RECORD_KIND( h )			( ( h ) >> 30 )
+#define STATE_RECORD_COUNT( h )			( ( h ) & 0x3FFFFFFF )
+#define STATE_RECORD_HEADER( k, n )		( ( ( k ) << 30 ) | ( n ) )
+
+typedef struct {
+	uint32_t*	region;
+	uint32_t*	records;
+	uint32_t	capacity;			// words for records
+	uint32_t	used;
+	uint32_t	n_neurons;
+	uint32_t	bits;
+	uint32_t	shift;
+	uint32_t	subsample;
+	uint32_t	keyframe_interval;
+	uint32_t	tick;
+	uint32_t	n_since_keyframe;	// records
+	int32_t*	rebuilt;			// the decoder's values, n_neurons
+	uint32_t	n_dropped;			// records that did not fit
+	uint32_t	n_escapes;
+} state_recording_t;
+
+typedef struct {
+	const uint32_t*	records;
+	uint32_t		used;
+	uint32_t		n_neurons;
+	uint32_t		bits;
+	uint32_t		shift;
+	uint32_t		subsample;
+	uint32_t		position;
+	uint32_t		tick;
+} state_recording_reader_t;
+
+
+// Words of packed changes in a delta record
+static inline uint32_t state_recording_delta_words( uint32_t n_neurons, uint32_t bits )
+{
+	return ( n_neurons * bits + 31 ) / 32;
+}
+
+
+// Words of the largest record: a delta record with every neuron escaped
+static inline uint32_t state_recording_max_record_words( uint32_t n_neurons, uint32_t bits )
+{
+	return 1 + state_recording_delta_words( n_neurons, bits ) + n_neurons;
+}
+
+
+// Sets up recording into a region of region_words words, with rebuilt
+// (n_neurons values) as the encoder's copy of the decoder's state; false for
+// a bit depth other than 8, 12 or 16, or a region too small for the header
+bool state_recording_initialise( state_recording_t* recording, uint32_t* region, uint32_t region_words,
+								 uint32_t n_neurons, uint32_t bits, uint32_t shift, uint32_t subsample,
+								 uint32_t keyframe_interval, int32_t* rebuilt );
+
+
+// Records one tick's values, s16.15, if it is a subsampled tick; false if
+// it did not fit
+bool state_recording_record( state_recording_t* recording, const int32_t* values );
+
+
+// Writes the next record, keyframe or delta, of values to out, for buffered
+// output (recording_buffer.h), where the caller picks the ticks; returns the
+// words written, or 0 without changing anything if room is less than
+// state_recording_max_record_words
+uint32_t state_recording_encode( state_recording_t* recording, const int32_t* values, uint32_t* out, uint32_t room );
+
+
+// Starts decoding a region as written so far
+void state_recording_reader_initialise( state_recording_reader_t* reader, const uint32_t* region );
+
+
+// Decodes one record of at most available words into values (n_neurons),
+// which must hold the previous record's values; returns its size in words,
+// or 0 if it is malformed
+uint32_t state_recording_decode( const uint32_t* record, uint32_t available, uint32_t n_neurons, uint32_t bits,
+								 uint32_t shift, int32_t* values );
+
+
+// The next record's values, into values (n_neurons), which must hold the
+// previous record's values between calls; false at the end of the records
+// or at a malformed record
+bool state_recording_read( state_recording_reader_t* reader, uint32_t* tick, int32_t* values );
+
+
+#endif   // include guard
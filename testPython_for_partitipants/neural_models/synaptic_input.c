@@ -0,0 +1,84 @@
+
+
+#include <string.h>
+
+#include "synaptic_input.h"
+
+
+bool synaptic_input_initialise( synaptic_input_t* input, void* buffer, uint32_t n_neurons, bool wide,
+								const uint32_t* shifts )
+{
+	if( n_neurons > SYNAPTIC_INPUT_MAX_NEURONS )
+		return false;
+
+	memset( input, 0, sizeof( *input ) );
+	for( uint32_t t = 0; t < SYNAPTIC_INPUT_TYPES; t++ ) {
+		// at 31 only a sum of 0 would fit s16.15
+		if( shifts[t] > 30 )
+			return false;
+		input->shifts[t] = shifts[t];
+		}
+
+	if( wide )
+		input->wide = buffer;
+	else
+		input->narrow = buffer;
+	input->n_neurons = n_neurons;
+	memset( buffer, 0, SYNAPTIC_INPUT_BUFFER_BYTES( wide ) );
+	return true;
+}
+
+
+void synaptic_input_drain( synaptic_input_t* input, uint32_t tick, int32_t* inputs )
+{
+	uint32_t slot = ( tick & SYNAPTIC_INPUT_SLOT_MASK ) * SYNAPTIC_INPUT_SLOT_ENTRIES;
+	const uint32_t n = SYNAPTIC_INPUT_MAX_NEURONS;
+
+	for( uint32_t t = 0; t < SYNAPTIC_INPUT_TYPES; t++ ) {
+		uint32_t shift = input->shifts[t], limit = INT32_MAX >> shift;
+		uint32_t peak = input->peaks[t], n_clipped = 0;
+		int32_t* out = inputs + t * n;
+
+		// the same branch-free loop over either width of sum, over every index
+		// so that the count is constant and the compiler vectorises it; the
+		// sums past n_neurons are never added to and stay 0
+		if( input->wide != NULL ) {
+			uint32_t* sums = input->wide + slot + ( t << SYNAPTIC_INPUT_INDEX_BITS );
+
+			for( uint32_t i = 0; i < n; i++ ) {
+				uint32_t sum = sums[i];
+
+				peak = sum > peak ? sum : peak;
+				n_clipped += sum > limit;
+				out[i] = ( sum < limit ? sum : limit ) << shift;
+				}
+			memset( sums, 0, n * sizeof( uint32_t ) );
+			}
+		else {
+			uint16_t* sums = input->narrow + slot + ( t << SYNAPTIC_INPUT_INDEX_BITS );
+
+			for( uint32_t i = 0; i < n; i++ ) {
+				uint32_t sum = sums[i];
+
+				peak = sum > peak ? sum : peak;
+				n_clipped += sum > limit;
+				out[i] = ( sum < limit ? sum : limit ) << shift;
+				}
+			memset( sums, 0, n * sizeof( uint16_t ) );
+			}
+
+		input->peaks[t] = peak;
+		input->n_clipped[t] += n_clipped;
+		}
+}
+
+
+uint32_t synaptic_input_provenance( const synaptic_input_t* input, uint32_t* words )
+{
+	for( uint32_t t = 0; t < SYNAPTIC_INPUT_TYPES; t++ ) {
+		words[3 * t] = input->n_saturations[t];
+		words[3 * t + 1] = input->n_clipped[t];
+		words[3 * t + 2] = input->peaks[t];
+		}
+	return SYNAPTIC_INPUT_PROVENANCE_WORDS;
+}
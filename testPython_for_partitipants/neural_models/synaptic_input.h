@@ -0,0 +1,127 @@
+
+
+#ifndef _SYNAPTIC_INPUT_
+#define _SYNAPTIC_INPUT_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+	Synaptic input ring buffers: the weights of arriving synaptic events
+	summed per delay slot, synapse type and neuron, and a tick's sums
+	handed to the neuron loop as s16.15 currents.
+
+	A fixed synapse word, weight[31:16] | delay and type[15:8] | index[7:0]
+	(compressed_synaptic_row.h), is added at
+
+		( ( tick + delay ) & slot mask ) << ( type bits + 8 )  |  type << 8  |  index
+
+	so a slot holds a whole tick's input of the core, type by type, 256
+	neurons each, as in sPyNNaker.  Sums are 16 bits, or 32 bits for heavy
+	fan-in when the buffer is set up wide.
+
+	A sum is in units of 2^( shift - 15 ) nA, with a shift per synapse
+	type: the neuron's input is the sum << shift.  Weights are written by
+	the host at the same scale, so the shift trades headroom against
+	resolution: too small and busy ticks saturate, too large and small
+	weights round to nothing.  izh_curr_stochastic/synaptic_input.py
+	chooses it per type from the rates measured on each input and, after a
+	run, from the provenance below, in place of the single spikes_per_second
+	and ring_buffer_sigma of [Simulation].  With 32-bit sums only the largest
+	weight limits it.
+
+	Nothing is lost silently.  A sum that reaches the top of its
+	accumulator sticks there and counts a saturation; a sum that does not
+	fit s16.15 at its shift is clipped and counted; and the largest sum
+	drained is kept.  These are the provenance, per type:
+
+		n_saturations	events that overflowed an accumulator
+		n_clipped		neuron inputs clipped to the s16.15 range
+		peak			largest sum drained, in the type's units
+
+	The drain converts a whole slot at once, type by type over contiguous
+	neurons without branches, and clears it for tick + 2^delay bits.
+*/
+
+#ifndef SYNAPTIC_INPUT_TYPE_BITS
+#define SYNAPTIC_INPUT_TYPE_BITS		1
+#endif
+#ifndef SYNAPTIC_INPUT_DELAY_BITS
+#define SYNAPTIC_INPUT_DELAY_BITS		4
+#endif
+
+#define SYNAPTIC_INPUT_INDEX_BITS		8
+#define SYNAPTIC_INPUT_MAX_NEURONS		( 1 << SYNAPTIC_INPUT_INDEX_BITS )
+#define SYNAPTIC_INPUT_TYPES			( 1 << SYNAPTIC_INPUT_TYPE_BITS )
+#define SYNAPTIC_INPUT_SLOTS			( 1 << SYNAPTIC_INPUT_DELAY_BITS )
+#define SYNAPTIC_INPUT_SLOT_ENTRIES		( SYNAPTIC_INPUT_TYPES << SYNAPTIC_INPUT_INDEX_BITS )
+#define SYNAPTIC_INPUT_ENTRIES			( SYNAPTIC_INPUT_SLOTS * SYNAPTIC_INPUT_SLOT_ENTRIES )
+#define SYNAPTIC_INPUT_BUFFER_BYTES( wide )		( SYNAPTIC_INPUT_ENTRIES * ( ( wide ) ? 4 : 2 ) )
+#define SYNAPTIC_INPUT_PROVENANCE_WORDS	( 3 * SYNAPTIC_INPUT_TYPES )
+
+#define SYNAPTIC_INPUT_TYPE_INDEX_MASK	( SYNAPTIC_INPUT_SLOT_ENTRIES - 1 )
+#define SYNAPTIC_INPUT_SLOT_MASK		( SYNAPTIC_INPUT_SLOTS - 1 )
+#define SYNAPTIC_INPUT_TYPE( w )		( ( ( w ) >> SYNAPTIC_INPUT_INDEX_BITS ) & ( SYNAPTIC_INPUT_TYPES - 1 ) )
+#define SYNAPTIC_INPUT_DELAY( w )		( ( ( w ) >> ( SYNAPTIC_INPUT_INDEX_BITS + SYNAPTIC_INPUT_TYPE_BITS ) ) \
+										  & SYNAPTIC_INPUT_SLOT_MASK )
+
+typedef struct {
+	uint16_t*	narrow;					// the buffer, when not wide
+	uint32_t*	wide;					// or when wide
+	uint32_t	n_neurons;
+	uint32_t	shifts[SYNAPTIC_INPUT_TYPES];
+	uint32_t	n_saturations[SYNAPTIC_INPUT_TYPES];
+	uint32_t	n_clipped[SYNAPTIC_INPUT_TYPES];
+	uint32_t	peaks[SYNAPTIC_INPUT_TYPES];
+} synaptic_input_t;
+
+
+// Sets up and clears a buffer of SYNAPTIC_INPUT_BUFFER_BYTES( wide ); false
+// for more neurons than an index reaches or a shift that leaves no sum
+// representable
+bool synaptic_input_initialise( synaptic_input_t* input, void* buffer, uint32_t n_neurons, bool wide,
+								const uint32_t* shifts );
+
+
+// Adds a fixed synapse word arriving at tick; saturates rather than wraps
+static inline void synaptic_input_add( synaptic_input_t* input, uint32_t tick, uint32_t word ) {
+
+	uint32_t weight = word >> 16;
+	uint32_t index = ( ( ( tick + SYNAPTIC_INPUT_DELAY( word ) ) & SYNAPTIC_INPUT_SLOT_MASK )
+					   << ( SYNAPTIC_INPUT_TYPE_BITS + SYNAPTIC_INPUT_INDEX_BITS ) )
+					 | ( word & SYNAPTIC_INPUT_TYPE_INDEX_MASK );
+
+	// branch-free: overflow is rare, and a mispredicted branch costs more
+	// than the count
+	if( input->wide != NULL ) {
+		uint32_t sum = input->wide[index] + weight;
+		uint32_t overflow = sum < weight;
+
+		input->wide[index] = overflow ? UINT32_MAX : sum;
+		input->n_saturations[SYNAPTIC_INPUT_TYPE( word )] += overflow;
+		}
+	else {
+		uint32_t sum = input->narrow[index] + weight;
+		uint32_t overflow = sum > UINT16_MAX;
+
+		input->narrow[index] = overflow ? UINT16_MAX : sum;
+		input->n_saturations[SYNAPTIC_INPUT_TYPE( word )] += overflow;
+		}
+}
+
+
+// Converts tick's slot to s16.15 inputs, SYNAPTIC_INPUT_SLOT_ENTRIES laid
+// out as the slot, inputs[type << SYNAPTIC_INPUT_INDEX_BITS | neuron], and
+// clears it
+void synaptic_input_drain( synaptic_input_t* input, uint32_t tick, int32_t* inputs );
+
+
+// Copies the provenance, SYNAPTIC_INPUT_PROVENANCE_WORDS, type by type;
+// returns the words written
+uint32_t synaptic_input_provenance( const synaptic_input_t* input, uint32_t* words );
+
+
+#endif   // include guard
@@ -108,6 +108,11 @@ algorithm = Radial
 [Partitioner]
 # algorithm: {Basic, PartitionAndPlace}
 algorithm = PartitionAndPlace
+# Used when a model's atoms per core are not set by hand:
+# atoms_per_core_safety_margin: fraction of each timer tick left unused
+# atoms_per_core_dtcm_reserved_bytes: DTCM kept back for stack and buffers
+atoms_per_core_safety_margin = 0.1
+atoms_per_core_dtcm_reserved_bytes = 16384
 
 [KeyAllocator]
 # algorithm: {Basic, PyNN}